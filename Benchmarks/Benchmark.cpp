@@ -0,0 +1,339 @@
+/*
+ * Benchmark.cpp
+ * Created by Zachary Ferguson
+ * Source file for the Benchmark class, a small self-contained timing harness
+ * for measuring the run time of the Heightfield Modeler's kernels.
+ */
+
+#include "Benchmark.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/* Sink for consumed values, volatile so stores to it are never removed. */
+static volatile float benchmarkSink = 0;
+
+/* Counters for the heap allocations made through operator new. */
+static std::atomic<unsigned long long> allocationCount(0);
+static std::atomic<unsigned long long> allocationBytes(0);
+static std::atomic<unsigned long long> currentBytes(0);
+static std::atomic<unsigned long long> peakBytes(0);
+
+/* Size of the header placed before each allocation to remember its size. */
+/* Sixteen bytes keeps the returned memory aligned for any type.          */
+#define ALLOCATION_HEADER 16
+
+/* Replacement of the global operator new that counts the allocations. */
+void* operator new(size_t size)
+{
+	char* memory = (char*)malloc(size + ALLOCATION_HEADER);
+	if(!memory)
+	{
+		throw std::bad_alloc();
+	}
+	memcpy(memory, &size, sizeof(size));
+
+	allocationCount++;
+	allocationBytes += size;
+	unsigned long long live = (currentBytes += size);
+	unsigned long long peak = peakBytes;
+	while(live > peak && !peakBytes.compare_exchange_weak(peak, live));
+
+	return memory + ALLOCATION_HEADER;
+}
+
+/* Replacement of the global operator delete that counts the frees. */
+void operator delete(void* pointer) throw()
+{
+	if(pointer)
+	{
+		/* The header is found through the address and copied out of the */
+		/* block, so the compiler does not see it as a read before the    */
+		/* object freed when this is inlined into a container.            */
+		char* memory = (char*)((uintptr_t)pointer - ALLOCATION_HEADER);
+		size_t size;
+		memcpy(&size, memory, sizeof(size));
+		currentBytes -= size;
+		free(memory);
+	}
+}
+
+/* Replacement of the sized global operator delete, which frees through the */
+/* unsized one since the size is already kept in the header.                */
+void operator delete(void* pointer, size_t) throw()
+{
+	::operator delete(pointer);
+}
+
+/* Constructor that takes the minimum number of seconds each measurement */
+/* must run for to be considered stable.                                 */
+Benchmark::Benchmark(double minSeconds)
+{
+	this->minSeconds = minSeconds;
+}
+
+/* Returns the current wall clock time in seconds. */
+double Benchmark::now()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Stores the given value so the compiler can not optimize away the */
+/* computation that produced it.                                    */
+void Benchmark::consume(float value)
+{
+	benchmarkSink = benchmarkSink + value;
+}
+
+/***********************/
+/* Allocation Tracking */
+/***********************/
+
+/* Returns the number of heap allocations made so far. */
+unsigned long long Benchmark::allocations()
+{
+	return allocationCount;
+}
+
+/* Returns the number of bytes allocated on the heap so far. */
+unsigned long long Benchmark::allocatedBytes()
+{
+	return allocationBytes;
+}
+
+/* Returns the number of heap bytes currently allocated. */
+unsigned long long Benchmark::liveBytes()
+{
+	return currentBytes;
+}
+
+/* Returns the largest number of heap bytes allocated at once since the */
+/* last call to resetPeakMemory().                                      */
+unsigned long long Benchmark::peakLiveBytes()
+{
+	return peakBytes;
+}
+
+/* Returns the peak resident set size of the process in bytes. */
+unsigned long long Benchmark::peakRssBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return (unsigned long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/* Restarts the tracking of the peak heap and resident set sizes. The */
+/* resident set peak can only be reset on Linux.                      */
+void Benchmark::resetPeakMemory()
+{
+	peakBytes = (unsigned long long)currentBytes;
+#ifdef __linux__
+	/* Writing 5 to clear_refs resets the peak resident set size. */
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+#endif
+}
+
+/***********/
+/* Results */
+/***********/
+
+/* Writes the given results out to a JSON file. Returns true if the file */
+/* was written.                                                          */
+bool Benchmark::writeJSON(const char* filename, const std::string& suite,
+	const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream outFile(filename, std::ios::out);
+	if(!(outFile.is_open()))
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		return false;
+	}
+
+	outFile.precision(9);
+	outFile << "{" << std::endl
+		<< "  \"suite\": \"" << suite << "\"," << std::endl
+		<< "  \"results\": [" << std::endl;
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		outFile << "    {\"kernel\": \"" << result.kernel << "\", "
+			<< "\"size\": " << result.size << ", "
+			<< "\"vertices\": " << result.vertices << ", "
+			<< "\"seconds\": " << result.seconds << ", "
+			<< "\"verticesPerSecond\": " << result.verticesPerSecond << ", "
+			<< "\"peakHeapBytes\": " << result.peakHeapBytes << ", "
+			<< "\"peakRssBytes\": " << result.peakRssBytes << ", "
+			<< "\"allocations\": " << result.allocations << ", "
+			<< "\"allocatedBytes\": " << result.allocatedBytes << "}"
+			<< ((i + 1 < results.size()) ? "," : "") << std::endl;
+	}
+	outFile << "  ]" << std::endl << "}" << std::endl;
+
+	outFile.close();
+	return true;
+}
+
+/* Returns the text following "key": in the given JSON object, or an empty */
+/* string if the key is missing.                                           */
+static std::string jsonValue(const std::string& object, const char* key)
+{
+	std::string quotedKey = std::string("\"") + key + "\"";
+	size_t start = object.find(quotedKey);
+	if(start == std::string::npos)
+	{
+		return "";
+	}
+	start = object.find(':', start + quotedKey.size());
+	if(start == std::string::npos)
+	{
+		return "";
+	}
+	start = object.find_first_not_of(" \t\n\r\"", start + 1);
+	size_t end = object.find_first_of(",}\"", start);
+	return object.substr(start, end - start);
+}
+
+/* Reads the results written by writeJSON() back in. Returns false if the */
+/* file could not be read.                                                */
+bool Benchmark::readJSON(const char* filename, 
+	std::vector<BenchmarkResult>& results)
+{
+	std::ifstream inFile(filename);
+	if(!inFile)
+	{
+		std::cout << "Unable to read " << filename << std::endl;
+		return false;
+	}
+	std::stringstream contents;
+	contents << inFile.rdbuf();
+	std::string json = contents.str();
+
+	/* Each result is a flat object inside of the results array. */
+	size_t position = json.find("\"results\"");
+	while(position != std::string::npos)
+	{
+		size_t start = json.find('{', position);
+		if(start == std::string::npos)
+		{
+			break;
+		}
+		size_t end = json.find('}', start);
+		std::string object = json.substr(start, end - start + 1);
+
+		BenchmarkResult result;
+		result.kernel = jsonValue(object, "kernel");
+		result.size = strtoul(jsonValue(object, "size").c_str(), NULL, 10);
+		result.vertices = strtoull(jsonValue(object, "vertices").c_str(), 
+			NULL, 10);
+		result.seconds = strtod(jsonValue(object, "seconds").c_str(), NULL);
+		result.verticesPerSecond = strtod(jsonValue(object, 
+			"verticesPerSecond").c_str(), NULL);
+		result.peakHeapBytes = strtoull(jsonValue(object, 
+			"peakHeapBytes").c_str(), NULL, 10);
+		result.peakRssBytes = strtoull(jsonValue(object, 
+			"peakRssBytes").c_str(), NULL, 10);
+		result.allocations = strtoull(jsonValue(object, 
+			"allocations").c_str(), NULL, 10);
+		result.allocatedBytes = strtoull(jsonValue(object, 
+			"allocatedBytes").c_str(), NULL, 10);
+		results.push_back(result);
+
+		position = end;
+	}
+
+	return true;
+}
+
+/* Compares the current results to the baseline results and prints a table */
+/* of the differences. Returns the number of kernels that are slower than  */
+/* the baseline by more than threshold percent.                            */
+int Benchmark::compare(const std::vector<BenchmarkResult>& baseline,
+	const std::vector<BenchmarkResult>& current, double threshold)
+{
+	int regressions = 0;
+
+	std::cout << std::left << std::setw(16) << "Kernel" << std::right 
+		<< std::setw(8) << "Size" << std::setw(14) << "Baseline s"
+		<< std::setw(14) << "Current s" << std::setw(10) << "Change" 
+		<< std::endl << std::string(62, '-') << std::endl;
+
+	for (unsigned int i = 0; i < current.size(); i++)
+	{
+		for (unsigned int j = 0; j < baseline.size(); j++)
+		{
+			if(current[i].kernel != baseline[j].kernel ||
+				current[i].size != baseline[j].size)
+			{
+				continue;
+			}
+
+			double change = (current[i].seconds / baseline[j].seconds - 1.0) *
+				100.0;
+			bool regressed = change > threshold;
+			regressions += regressed;
+
+			std::cout << std::left << std::setw(16) << current[i].kernel 
+				<< std::right << std::setw(8) << current[i].size 
+				<< std::fixed << std::setprecision(6) 
+				<< std::setw(14) << baseline[j].seconds 
+				<< std::setw(14) << current[i].seconds
+				<< std::setprecision(1) << std::setw(9) << change << "%"
+				<< (regressed ? "  REGRESSION" : "") << std::endl;
+			break;
+		}
+	}
+
+	std::cout << regressions << " regression(s) beyond " << threshold 
+		<< "%" << std::endl;
+	return regressions;
+}
+
+/* Prints the header of a results table to standard output. */
+void Benchmark::printHeader()
+{
+	std::cout << std::left << std::setw(28) << "Benchmark"
+		<< std::right << std::setw(12) << "ns/op"
+		<< std::setw(14) << "ref ns/op"
+		<< std::setw(10) << "ratio" << std::endl
+		<< std::string(64, '-') << std::endl;
+}
+
+/* Prints a row of a results table comparing the measured time to the */
+/* reference time. A reference time <= 0 is left blank.              */
+void Benchmark::printRow(const std::string& name, double nsPerOp,
+	double referenceNsPerOp)
+{
+	std::cout << std::left << std::setw(28) << name << std::right
+		<< std::fixed << std::setprecision(3) << std::setw(12) << nsPerOp;
+	if(referenceNsPerOp > 0)
+	{
+		std::cout << std::setw(14) << referenceNsPerOp
+			<< std::setprecision(2) << std::setw(9) 
+			<< (nsPerOp / referenceNsPerOp) << "x";
+	}
+	std::cout << std::endl;
+}
@@ -0,0 +1,155 @@
+/*
+ * Benchmark.h
+ * Created by Zachary Ferguson
+ * Header file for the Benchmark class, a small self-contained timing harness
+ * for measuring the run time of the Heightfield Modeler's kernels.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>   /* Used for the wall clock.               */
+#include <iostream> /* Used to print out the results.         */
+#include <string>   /* Used for the names of the measurements. */
+#include <vector>   /* Used to store the results of a suite.   */
+
+/* The measurements of one kernel run on one grid size. */
+struct BenchmarkResult
+{
+	/* Name of the kernel measured. */
+	std::string kernel;
+	/* Number of rows and columns of quads in the grid. */
+	unsigned int size;
+	/* Number of vertices produced or processed by the kernel. */
+	unsigned long long vertices;
+	/* Fastest wall time of the repetitions in seconds. */
+	double seconds;
+	/* Vertices per second of the fastest repetition. */
+	double verticesPerSecond;
+	/* Largest number of heap bytes live at once above the bytes live */
+	/* before the kernel started.                                     */
+	unsigned long long peakHeapBytes;
+	/* Peak resident set size of the process reported by the OS. */
+	unsigned long long peakRssBytes;
+	/* Number of heap allocations made by one repetition. */
+	unsigned long long allocations;
+	/* Number of bytes allocated by one repetition. */
+	unsigned long long allocatedBytes;
+};
+
+class Benchmark
+{
+	private:
+
+		/* Minimum number of seconds a measurement is run for. */
+		double minSeconds;
+
+	public:
+
+		/* Constructor that takes the minimum number of seconds each */
+		/* measurement must run for to be considered stable.         */
+		Benchmark(double minSeconds = 0.25);
+
+		/* Returns the current wall clock time in seconds. */
+		static double now();
+
+		/* Stores the given value so the compiler can not optimize away the */
+		/* computation that produced it.                                    */
+		static void consume(float value);
+
+		/* Repeatedly calls kernel(), which performs opsPerCall operations, */
+		/* doubling the number of calls until at least minSeconds have      */
+		/* elapsed. Returns the number of nanoseconds per operation.        */
+		template <typename Kernel>
+		double measure(Kernel kernel, unsigned int opsPerCall) const;
+
+		/***********************/
+		/* Allocation Tracking */
+		/***********************/
+		/* Returns the number of heap allocations made so far. */
+		static unsigned long long allocations();
+		/* Returns the number of bytes allocated on the heap so far. */
+		static unsigned long long allocatedBytes();
+		/* Returns the number of heap bytes currently allocated. */
+		static unsigned long long liveBytes();
+		/* Returns the largest number of heap bytes allocated at once since */
+		/* the last call to resetPeakMemory().                              */
+		static unsigned long long peakLiveBytes();
+		/* Returns the peak resident set size of the process in bytes. */
+		static unsigned long long peakRssBytes();
+		/* Restarts the tracking of the peak heap and resident set sizes. */
+		/* The resident set peak can only be reset on Linux.              */
+		static void resetPeakMemory();
+
+		/***********/
+		/* Results */
+		/***********/
+		/* Writes the given results out to a JSON file. Returns true if */
+		/* the file was written.                                        */
+		static bool writeJSON(const char* filename, const std::string& suite,
+			const std::vector<BenchmarkResult>& results);
+
+		/* Reads the results written by writeJSON() back in. Returns false */
+		/* if the file could not be read.                                  */
+		static bool readJSON(const char* filename,
+			std::vector<BenchmarkResult>& results);
+
+		/* Compares the current results to the baseline results and prints */
+		/* a table of the differences. Returns the number of kernels that  */
+		/* are slower than the baseline by more than threshold percent.    */
+		static int compare(const std::vector<BenchmarkResult>& baseline,
+			const std::vector<BenchmarkResult>& current, double threshold);
+
+		/* Prints the header of a results table to standard output. */
+		static void printHeader();
+
+		/* Prints a row of a results table comparing the measured time to */
+		/* the reference time. A reference time <= 0 is left blank.       */
+		static void printRow(const std::string& name, double nsPerOp,
+			double referenceNsPerOp = 0);
+};
+
+/* Repeatedly calls kernel(), which performs opsPerCall operations, doubling */
+/* the number of calls until at least minSeconds have elapsed. Returns the   */
+/* number of nanoseconds per operation.                                      */
+template <typename Kernel>
+double Benchmark::measure(Kernel kernel, unsigned int opsPerCall) const
+{
+	/* Warm up the caches and the branch predictors. */
+	kernel();
+
+	for (unsigned long long calls = 1;; calls *= 2)
+	{
+		double start = Benchmark::now();
+		for (unsigned long long i = 0; i < calls; i++)
+		{
+			kernel();
+		}
+		double elapsed = Benchmark::now() - start;
+
+		if(elapsed >= this->minSeconds)
+		{
+			return (elapsed * 1e9) / ((double)calls * opsPerCall);
+		}
+	}
+}
+
+/* Runs the vec3, vec4, mat3, and mat4 micro benchmarks. */
+int runMathBenchmarks(int argc, char* argv[]);
+
+/* Runs the Mesh kernel benchmarks over a range of grid sizes. */
+int runMeshBenchmarks(int argc, char* argv[]);
+
+/* Benchmarks Mesh::smooth against the original implementation. */
+int runSmoothBenchmarks(int argc, char* argv[]);
+
+/* Benchmarks the droplet erosion across thread counts. */
+int runDropletBenchmarks(int argc, char* argv[]);
+
+/* Benchmarks the cost of a traced scope. */
+int runTraceBenchmarks(int argc, char* argv[]);
+
+/* Compares two JSON result files and fails on regressions. */
+int runCompareBenchmarks(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * BenchmarkMain.cpp
+ * Created by Zachary Ferguson
+ * Main file for the Heightfield Modeler benchmarks. Runs the benchmark suite
+ * named by the first argument.
+ */
+
+#include "Benchmark.h"
+#include <cstring>
+
+/* Prints how to run the benchmarks. */
+static void printUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " <suite> [options]" << std::endl
+		<< "Suites:" << std::endl
+		<< "  math     vec3/vec4/mat3/mat4 operator micro benchmarks" 
+		<< std::endl
+		<< "  mesh     Mesh kernels over a range of grid sizes" << std::endl
+		<< "  smooth   Mesh::smooth against the original stencils" 
+		<< std::endl
+		<< "  droplets droplet erosion throughput across thread counts"
+		<< std::endl
+		<< "  trace    cost of a TRACE_SCOPE with tracing enabled" << std::endl
+		<< "  compare  compare two JSON result files for regressions" 
+		<< std::endl;
+}
+
+/* Runs the benchmark suite given as the first argument. */
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if(strcmp(argv[1], "math") == 0)
+	{
+		return runMathBenchmarks(argc - 1, argv + 1);
+	}
+	else if(strcmp(argv[1], "mesh") == 0)
+	{
+		return runMeshBenchmarks(argc - 1, argv + 1);
+	}
+	else if(strcmp(argv[1], "smooth") == 0)
+	{
+		return runSmoothBenchmarks(argc - 1, argv + 1);
+	}
+	else if(strcmp(argv[1], "droplets") == 0)
+	{
+		return runDropletBenchmarks(argc - 1, argv + 1);
+	}
+	else if(strcmp(argv[1], "trace") == 0)
+	{
+		return runTraceBenchmarks(argc - 1, argv + 1);
+	}
+	else if(strcmp(argv[1], "compare") == 0)
+	{
+		return runCompareBenchmarks(argc - 1, argv + 1);
+	}
+
+	printUsage(argv[0]);
+	return 1;
+}
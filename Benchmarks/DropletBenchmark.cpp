@@ -0,0 +1,131 @@
+/*
+ * DropletBenchmark.cpp
+ * Created by Zachary Ferguson
+ * Benchmark of the droplet erosion, in droplets per second, on one thread
+ * and on every power of two threads up to the processor's threads. Also
+ * checks every thread count erodes exactly the same heights.
+ */
+
+#include "Benchmark.h"
+#include "../DropletErosion.h"
+#include "../Parallel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+/* Default grid size and number of droplets run. */
+#define DEFAULT_SIZE 1024
+#define DEFAULT_DROPLETS 1048576
+
+/* Color of the meshes eroded. */
+static const Color meshColor = Color(BLUE);
+
+/* Prints how to run the droplet benchmarks. */
+static void printDropletUsage()
+{
+	std::cout << "Usage: Benchmarks droplets [options]" << std::endl
+		<< "  --size N            grid size (default " << DEFAULT_SIZE << ")"
+			<< std::endl
+		<< "  --droplets N        droplets run (default " << DEFAULT_DROPLETS
+			<< ")" << std::endl
+		<< "  --seed N            seed of the droplets (default 0)"
+			<< std::endl;
+}
+
+/* Benchmarks the droplet erosion across thread counts. */
+int runDropletBenchmarks(int argc, char* argv[])
+{
+	unsigned int size = DEFAULT_SIZE, droplets = DEFAULT_DROPLETS, seed = 0;
+
+	/* Parse the options. */
+	for (int i = 1; i < argc; i++)
+	{
+		if(i + 1 >= argc)
+		{
+			printDropletUsage();
+			return 1;
+		}
+		if(strcmp(argv[i], "--size") == 0)
+		{
+			size = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--droplets") == 0)
+		{
+			droplets = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--seed") == 0)
+		{
+			seed = atoi(argv[++i]);
+		}
+		else
+		{
+			printDropletUsage();
+			return 1;
+		}
+	}
+	if(size < 2 || droplets == 0)
+	{
+		printDropletUsage();
+		return 1;
+	}
+
+	/* Erode a randomized mesh so every run starts from the same heights. */
+	Mesh* mesh = new Mesh(size, size, 10, 10, &meshColor);
+	mesh->randomize(4.0f, seed);
+	Parallel::setThreadCount(0);
+	unsigned int maxThreads = Parallel::getThreadCount();
+
+	std::cout << std::left << std::setw(10) << "Threads" << std::right
+		<< std::setw(12) << "Seconds" << std::setw(14) << "Droplets/s"
+		<< std::setw(10) << "Same" << std::endl << std::string(46, '-')
+		<< std::endl;
+
+	int failures = 0;
+	Mesh* reference = NULL;
+	for (unsigned int threads = 1; ; threads = std::min(threads * 2,
+		maxThreads))
+	{
+		Parallel::setThreadCount(threads);
+		DropletErosion erosion(mesh, seed);
+		double start = Benchmark::now();
+		erosion.run(droplets);
+		double elapsed = Benchmark::now() - start;
+
+		/* The heights must not depend on the number of threads. */
+		Mesh* eroded = mesh->snapshot();
+		erosion.apply(eroded);
+		bool same = true;
+		if(reference == NULL)
+		{
+			reference = eroded;
+		}
+		else
+		{
+			for (unsigned int r = 0; same && r < size + 1; r++)
+			{
+				same = memcmp(eroded->getRow(r), reference->getRow(r),
+					(size + 1) * sizeof(vec4)) == 0;
+			}
+			delete eroded;
+		}
+
+		std::cout << std::left << std::setw(10) << threads << std::right
+			<< std::fixed << std::setprecision(6) << std::setw(12) << elapsed
+			<< std::setprecision(0) << std::setw(14) << (droplets / elapsed)
+			<< std::setw(10) << (same ? "yes" : "no") << std::endl;
+		if(!same)
+		{
+			failures++;
+		}
+		if(threads == maxThreads)
+		{
+			break;
+		}
+	}
+
+	Parallel::setThreadCount(0);
+	delete reference;
+	delete mesh;
+	return failures;
+}
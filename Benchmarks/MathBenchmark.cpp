@@ -0,0 +1,456 @@
+/*
+ * MathBenchmark.cpp
+ * Created by Zachary Ferguson
+ * Micro benchmarks for the vec3, vec4, mat3, and mat4 classes. Each operator
+ * is timed over arrays of random operands and compared against a reference
+ * implementation that is fully inline.
+ */
+
+#include "Benchmark.h"
+#include "../mat3.h"
+#include "../mat4.h"
+#include <cstdlib>
+#include <vector>
+
+/* Number of operands in each of the input arrays. */
+#define NUM_OPERANDS 1024
+
+/***************************/
+/* Reference Inline Math   */
+/***************************/
+
+/* Plain 3D vector with inline operators. */
+struct RefVec3 { float data[3]; };
+/* Plain 4D vector with inline operators. */
+struct RefVec4 { float data[4]; };
+/* Plain row major 4x4 matrix with inline operators. */
+struct RefMat4 { float data[4][4]; };
+
+static inline RefVec3 operator+(const RefVec3& v1, const RefVec3& v2)
+{
+	RefVec3 v = {{v1.data[0] + v2.data[0], v1.data[1] + v2.data[1],
+		v1.data[2] + v2.data[2]}};
+	return v;
+}
+
+static inline RefVec3 operator-(const RefVec3& v1, const RefVec3& v2)
+{
+	RefVec3 v = {{v1.data[0] - v2.data[0], v1.data[1] - v2.data[1],
+		v1.data[2] - v2.data[2]}};
+	return v;
+}
+
+static inline RefVec3 operator*(const RefVec3& v1, float c)
+{
+	RefVec3 v = {{v1.data[0] * c, v1.data[1] * c, v1.data[2] * c}};
+	return v;
+}
+
+static inline RefVec3 operator/(const RefVec3& v1, float c)
+{
+	return v1 * (1 / c);
+}
+
+static inline float operator*(const RefVec3& v1, const RefVec3& v2)
+{
+	return v1.data[0] * v2.data[0] + v1.data[1] * v2.data[1] +
+		v1.data[2] * v2.data[2];
+}
+
+static inline RefVec3 operator%(const RefVec3& v1, const RefVec3& v2)
+{
+	RefVec3 v = {{v1.data[1] * v2.data[2] - v1.data[2] * v2.data[1],
+		v1.data[2] * v2.data[0] - v1.data[0] * v2.data[2],
+		v1.data[0] * v2.data[1] - v1.data[1] * v2.data[0]}};
+	return v;
+}
+
+static inline float length(const RefVec3& v)
+{
+	return sqrt(v * v);
+}
+
+static inline RefVec4 operator+(const RefVec4& v1, const RefVec4& v2)
+{
+	RefVec4 v;
+	for (int i = 0; i < 4; i++)
+	{
+		v.data[i] = v1.data[i] + v2.data[i];
+	}
+	return v;
+}
+
+static inline RefVec4 operator-(const RefVec4& v1, const RefVec4& v2)
+{
+	RefVec4 v;
+	for (int i = 0; i < 4; i++)
+	{
+		v.data[i] = v1.data[i] - v2.data[i];
+	}
+	return v;
+}
+
+static inline RefVec4 operator*(const RefVec4& v1, float c)
+{
+	RefVec4 v;
+	for (int i = 0; i < 4; i++)
+	{
+		v.data[i] = v1.data[i] * c;
+	}
+	return v;
+}
+
+static inline RefVec4 operator/(const RefVec4& v1, float c)
+{
+	return v1 * (1 / c);
+}
+
+static inline float operator*(const RefVec4& v1, const RefVec4& v2)
+{
+	return v1.data[0] * v2.data[0] + v1.data[1] * v2.data[1] +
+		v1.data[2] * v2.data[2] + v1.data[3] * v2.data[3];
+}
+
+static inline float length(const RefVec4& v)
+{
+	return sqrt(v * v);
+}
+
+static inline RefMat4 operator+(const RefMat4& m1, const RefMat4& m2)
+{
+	RefMat4 m;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m.data[r][c] = m1.data[r][c] + m2.data[r][c];
+		}
+	}
+	return m;
+}
+
+static inline RefMat4 operator*(const RefMat4& m1, const RefMat4& m2)
+{
+	RefMat4 m;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m.data[r][c] = m1.data[r][0] * m2.data[0][c] +
+				m1.data[r][1] * m2.data[1][c] + m1.data[r][2] * m2.data[2][c] +
+				m1.data[r][3] * m2.data[3][c];
+		}
+	}
+	return m;
+}
+
+static inline RefVec4 operator*(const RefMat4& m, const RefVec4& v)
+{
+	RefVec4 product;
+	for (int r = 0; r < 4; r++)
+	{
+		product.data[r] = m.data[r][0] * v.data[0] + m.data[r][1] * v.data[1] +
+			m.data[r][2] * v.data[2] + m.data[r][3] * v.data[3];
+	}
+	return product;
+}
+
+static inline RefVec4 operator*(const RefVec4& v, const RefMat4& m)
+{
+	RefVec4 product;
+	for (int c = 0; c < 4; c++)
+	{
+		product.data[c] = v.data[0] * m.data[0][c] + v.data[1] * m.data[1][c] +
+			v.data[2] * m.data[2][c] + v.data[3] * m.data[3][c];
+	}
+	return product;
+}
+
+static inline RefMat4 transpose(const RefMat4& m)
+{
+	RefMat4 t;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			t.data[r][c] = m.data[c][r];
+		}
+	}
+	return t;
+}
+
+static inline RefMat4 rotation3D(float angle, const RefVec3& axis)
+{
+	float theta = (float)((PI*angle)/180.0);
+	float co = cos(theta);
+	float si = sin(theta);
+	float t = 1.0f - co;
+	RefVec3 n = axis / length(axis);
+	float a = n.data[0], b = n.data[1], c = n.data[2];
+
+	RefMat4 m = {{
+		{t * a * a + co, t * a * b - si * c, t * a * c + si * b, 0},
+		{t * a * b + si * c, t * b * b + co, t * b * c - si * a, 0},
+		{t * a * c - si * b, t * b * c + si * a, t * c * c + co, 0},
+		{0, 0, 0, 1}}};
+	return m;
+}
+
+/********************/
+/* Operand Creation */
+/********************/
+
+/* Returns a random float in the range [-1, 1]. */
+static float randomFloat()
+{
+	return ((float)rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+}
+
+/* Converts the given vec3 to a reference vector. */
+static RefVec3 toRef(const vec3& v)
+{
+	RefVec3 ref = {{v[0], v[1], v[2]}};
+	return ref;
+}
+
+/* Converts the given vec4 to a reference vector. */
+static RefVec4 toRef(const vec4& v)
+{
+	RefVec4 ref = {{v[0], v[1], v[2], v[3]}};
+	return ref;
+}
+
+/* Converts the given mat4 to a reference matrix. */
+static RefMat4 toRef(const mat4& m)
+{
+	RefMat4 ref;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			ref.data[r][c] = m[r][c];
+		}
+	}
+	return ref;
+}
+
+/* Returns a vec4 with random components. */
+static vec4 randomVec4()
+{
+	return vec4(randomFloat(), randomFloat(), randomFloat(), randomFloat());
+}
+
+/* Returns a mat4 with random entries. */
+static mat4 randomMat4()
+{
+	return mat4(randomVec4(), randomVec4(), randomVec4(), randomVec4());
+}
+
+/* Returns a mat3 with random entries. */
+static mat3 randomMat3()
+{
+	return mat3(vec3(randomVec4()), vec3(randomVec4()), vec3(randomVec4()));
+}
+
+/**************/
+/* Benchmarks */
+/**************/
+
+/* Runs the vec3, vec4, mat3, and mat4 micro benchmarks. */
+int runMathBenchmarks(int argc, char* argv[])
+{
+	/* The math suite takes no options. */
+	if(argc > 1)
+	{
+		std::cout << "Unknown option " << argv[1] << std::endl
+			<< "Usage: Benchmarks math" << std::endl;
+		return 1;
+	}
+
+	Benchmark bench = Benchmark();
+	srand(351);
+
+	/* Create the operands for the library and the reference types. */
+	std::vector<vec3> a3, b3, out3;
+	std::vector<vec4> a4, b4, out4;
+	std::vector<mat3> am3, bm3, outm3;
+	std::vector<mat4> am4, bm4, outm4;
+	std::vector<RefVec3> ra3, rb3, rout3;
+	std::vector<RefVec4> ra4, rb4, rout4;
+	std::vector<RefMat4> ram4, rbm4, routm4;
+	std::vector<float> scalars, outf;
+	for (int i = 0; i < NUM_OPERANDS; i++)
+	{
+		a3.push_back(vec3(randomVec4()));
+		b3.push_back(vec3(randomVec4()));
+		a4.push_back(randomVec4());
+		b4.push_back(randomVec4());
+		am3.push_back(randomMat3());
+		bm3.push_back(randomMat3());
+		am4.push_back(randomMat4());
+		bm4.push_back(randomMat4());
+		scalars.push_back(randomFloat() * 90.0f + 91.0f);
+
+		ra3.push_back(toRef(a3.back()));
+		rb3.push_back(toRef(b3.back()));
+		ra4.push_back(toRef(a4.back()));
+		rb4.push_back(toRef(b4.back()));
+		ram4.push_back(toRef(am4.back()));
+		rbm4.push_back(toRef(bm4.back()));
+	}
+	out3.resize(NUM_OPERANDS);
+	out4.resize(NUM_OPERANDS);
+	outm3.resize(NUM_OPERANDS);
+	outm4.resize(NUM_OPERANDS);
+	rout3.resize(NUM_OPERANDS);
+	rout4.resize(NUM_OPERANDS);
+	routm4.resize(NUM_OPERANDS);
+	outf.resize(NUM_OPERANDS);
+
+	double ns, refNs;
+	Benchmark::printHeader();
+
+	/********/
+	/* vec3 */
+	/********/
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = a3[i] + b3[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout3[i] = ra3[i] + rb3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 + vec3", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = a3[i] - b3[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout3[i] = ra3[i] - rb3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 - vec3", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = a3[i] * scalars[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout3[i] = ra3[i] * scalars[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 * float", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = a3[i] / scalars[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout3[i] = ra3[i] / scalars[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 / float", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = a3[i] * b3[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = ra3[i] * rb3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 dot", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = a3[i] % b3[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout3[i] = ra3[i] % rb3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 cross", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = a3[i].length(); }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = length(ra3[i]); }, NUM_OPERANDS);
+	Benchmark::printRow("vec3 length", ns, refNs);
+
+	/********/
+	/* vec4 */
+	/********/
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = a4[i] + b4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ra4[i] + rb4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 + vec4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = a4[i] - b4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ra4[i] - rb4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 - vec4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = a4[i] * scalars[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ra4[i] * scalars[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 * float", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = a4[i] / scalars[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ra4[i] / scalars[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 / float", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = a4[i] * b4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = ra4[i] * rb4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 dot", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = a4[i].length(); }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outf[i] = length(ra4[i]); }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 length", ns, refNs);
+
+	/********/
+	/* mat3 */
+	/********/
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outm3[i] = am3[i] * bm3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("mat3 * mat3", ns);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out3[i] = am3[i] * a3[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("mat3 * vec3", ns);
+
+	/********/
+	/* mat4 */
+	/********/
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outm4[i] = am4[i] + bm4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		routm4[i] = ram4[i] + rbm4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("mat4 + mat4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outm4[i] = am4[i] * bm4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		routm4[i] = ram4[i] * rbm4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("mat4 * mat4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = am4[i] * a4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ram4[i] * ra4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("mat4 * vec4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		out4[i] = a4[i] * am4[i]; }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		rout4[i] = ra4[i] * ram4[i]; }, NUM_OPERANDS);
+	Benchmark::printRow("vec4 * mat4", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outm4[i] = am4[i].transpose(); }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		routm4[i] = transpose(ram4[i]); }, NUM_OPERANDS);
+	Benchmark::printRow("mat4 transpose", ns, refNs);
+
+	ns = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		outm4[i] = mat4::rotation3D(scalars[i], a3[i]); }, NUM_OPERANDS);
+	refNs = bench.measure([&]() { for (int i = 0; i < NUM_OPERANDS; i++)
+		routm4[i] = rotation3D(scalars[i], ra3[i]); }, NUM_OPERANDS);
+	Benchmark::printRow("mat4::rotation3D", ns, refNs);
+
+	/* Consume the outputs so none of the loops can be removed. */
+	for (int i = 0; i < NUM_OPERANDS; i++)
+	{
+		Benchmark::consume(out3[i][0] + out4[i][0] + outm3[i][0][0] +
+			outm4[i][0][0] + rout3[i].data[0] + rout4[i].data[0] +
+			routm4[i].data[0][0] + outf[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,387 @@
+/*
+ * MeshBenchmark.cpp
+ * Created by Zachary Ferguson
+ * Scaling benchmarks for the Mesh kernels. Each kernel is run on square grids
+ * of increasing size and its wall time, throughput, memory, and allocations
+ * are recorded. Results can be written to JSON and compared to a baseline.
+ */
+
+#include "Benchmark.h"
+#include "../Mesh.h"
+#include "../Brush.h"
+#include "../DiamondSquareGenerator.h"
+#include "../HydraulicErosion.h"
+#include "../NoiseGenerator.h"
+#include "../SpectralGenerator.h"
+#include "../Parallel.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+/* Default range of grid sizes, the number of quads along each side. */
+#define DEFAULT_MIN_SIZE 16
+#define DEFAULT_MAX_SIZE 1024
+
+/* Maximum number of times a kernel is repeated on one grid size. */
+#define MAX_REPETITIONS 10
+
+/* Name of the files written by the export kernel. */
+#define EXPORT_FILENAME "benchmark_export.obj"
+#define EXPORT_MTL_FILENAME "benchmark_export.mtl"
+
+/* A kernel to benchmark. Runs on the given mesh and returns a new mesh to */
+/* be deleted after the timer stops, or NULL if no mesh was created.       */
+typedef Mesh* (*MeshKernel)(Mesh* mesh);
+
+/* Color shared by all of the benchmark meshes. */
+static const Color meshColor = Color(BLUE);
+
+/* Creates a new mesh with the same size as the given mesh. */
+static Mesh* constructKernel(Mesh* mesh)
+{
+	return new Mesh(mesh->getRows() - 1, mesh->getCols() - 1,
+		mesh->getWidth(), mesh->getDepth(), &meshColor);
+}
+
+/* Fractalizes the given mesh into a new larger mesh. */
+static Mesh* fractalizeKernel(Mesh* mesh)
+{
+	return mesh->fractalize();
+}
+
+/* Smooths the given mesh into a new larger mesh. */
+static Mesh* smoothKernel(Mesh* mesh)
+{
+	return mesh->smooth();
+}
+
+/* Selects the vertex closest to a ray straight down through the center. */
+static Mesh* selectVertexKernel(Mesh* mesh)
+{
+	ray userRay = ray(vec4(0, 20, 0, 1), vec4(0, 0, 0, 1));
+	deleteIndecies(mesh->selectVertex(userRay));
+	return NULL;
+}
+
+/* Randomizes the heights of the given mesh. */
+static Mesh* randomizeKernel(Mesh* mesh)
+{
+	mesh->randomize(4.0f);
+	return NULL;
+}
+
+/* Flattens the given mesh. */
+static Mesh* flattenKernel(Mesh* mesh)
+{
+	mesh->flatten();
+	return NULL;
+}
+
+/* Rotates the whole mesh a quarter turn about the y axis. */
+static Mesh* transformKernel(Mesh* mesh)
+{
+	mesh->transform(mat4::rotation3D(90, vec3(0, 1, 0)));
+	return NULL;
+}
+
+/* Takes a snapshot of the given mesh and edits one vertex of the mesh, */
+/* which copies the one tile the vertex is in.                          */
+static Mesh* snapshotKernel(Mesh* mesh)
+{
+	Mesh* snapshot = mesh->snapshot();
+	mesh->setHeight(0, 0, 1.0f);
+	return snapshot;
+}
+
+/* Makes a one second drag across the center of the given mesh with a */
+/* brush a sixteenth of its width, a dab for each of 60 drag events.   */
+static Mesh* brushKernel(Mesh* mesh)
+{
+	float radius = mesh->getWidth() / 16;
+	Brush brush(RAISE_BRUSH, SMOOTH_FALLOFF, radius, 0.5f);
+	float step = radius * BRUSH_SPACING;
+	brush.beginStroke(mesh, -30 * step, 0);
+	for (int i = -29; i <= 30; i++)
+	{
+		brush.continueStroke(mesh, i * step, 0);
+	}
+	return NULL;
+}
+
+/* Runs ten hydraulic erosion steps on the given mesh and applies them. */
+static Mesh* erodeKernel(Mesh* mesh)
+{
+	HydraulicErosion erosion(mesh);
+	erosion.run(10);
+	erosion.apply(mesh);
+	return NULL;
+}
+
+/* Runs ten thermal erosion steps on the given mesh. */
+static Mesh* thermalErodeKernel(Mesh* mesh)
+{
+	mesh->thermalErode(10, 0.5f);
+	return NULL;
+}
+
+/* Fills the given mesh with eight octaves of fBm noise. */
+static Mesh* noiseKernel(Mesh* mesh)
+{
+	NoiseSettings settings;
+	settings.octaves = 8;
+	NoiseGenerator(0, settings).fill(mesh, 4.0f);
+	return NULL;
+}
+
+/* Fills the given mesh with noise of a 1/f^3 spectrum. */
+static Mesh* spectralKernel(Mesh* mesh)
+{
+	SpectralGenerator(0).fill(mesh, 4.0f);
+	return NULL;
+}
+
+/* Fills the given mesh with the diamond-square. */
+static Mesh* diamondSquareKernel(Mesh* mesh)
+{
+	DiamondSquareGenerator(0).fill(mesh, 4.0f);
+	return NULL;
+}
+
+/* Saves the given mesh to an OBJ file. */
+static Mesh* exportKernel(Mesh* mesh)
+{
+	mesh->saveOBJ(EXPORT_FILENAME);
+	return NULL;
+}
+
+/* Names and functions of all the kernels, in the order they are run. */
+static const char* kernelNames[] = { "construct", "fractalize", "smooth",
+	"selectVertex", "randomize", "flatten", "transform", "snapshot", 
+	"brush", "erode", "thermalErode", "noise", "spectral", 
+	"diamondSquare", "export" };
+static const MeshKernel kernels[] = { constructKernel, fractalizeKernel,
+	smoothKernel, selectVertexKernel, randomizeKernel, flattenKernel,
+	transformKernel, snapshotKernel, brushKernel, erodeKernel, 
+	thermalErodeKernel, noiseKernel, spectralKernel, diamondSquareKernel, 
+	exportKernel };
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/* Runs the given kernel on the given mesh until minSeconds have elapsed or */
+/* MAX_REPETITIONS runs are made. Returns the results of the fastest run.   */
+static BenchmarkResult measureKernel(const char* name, MeshKernel kernel,
+	Mesh* mesh, unsigned int size, double minSeconds)
+{
+	BenchmarkResult result;
+	result.kernel = name;
+	result.size = size;
+	result.vertices = (unsigned long long)mesh->getRows() * mesh->getCols();
+	result.seconds = 0;
+
+	unsigned long long liveBefore = Benchmark::liveBytes();
+	Benchmark::resetPeakMemory();
+	unsigned long long allocations = Benchmark::allocations();
+	unsigned long long allocatedBytes = Benchmark::allocatedBytes();
+
+	double total = 0;
+	for (int i = 0; i < MAX_REPETITIONS && (i == 0 || total < minSeconds);
+		i++)
+	{
+		double start = Benchmark::now();
+		Mesh* output = kernel(mesh);
+		double elapsed = Benchmark::now() - start;
+
+		/* Record the allocations of the first repetition only. */
+		if(i == 0)
+		{
+			result.allocations = Benchmark::allocations() - allocations;
+			result.allocatedBytes = Benchmark::allocatedBytes() -
+				allocatedBytes;
+			result.peakHeapBytes = Benchmark::peakLiveBytes() - liveBefore;
+			result.peakRssBytes = Benchmark::peakRssBytes();
+			if(output)
+			{
+				result.vertices = (unsigned long long)output->getRows() *
+					output->getCols();
+			}
+		}
+
+		delete output;
+
+		total += elapsed;
+		if(i == 0 || elapsed < result.seconds)
+		{
+			result.seconds = elapsed;
+		}
+	}
+
+	result.verticesPerSecond = result.vertices / result.seconds;
+	return result;
+}
+
+/* Prints how to run the mesh benchmarks. */
+static void printMeshUsage()
+{
+	std::cout << "Usage: Benchmarks mesh [options]" << std::endl
+		<< "  --min-size N        smallest grid size (default "
+			<< DEFAULT_MIN_SIZE << ")" << std::endl
+		<< "  --max-size N        largest grid size (default "
+			<< DEFAULT_MAX_SIZE << ", up to 8192)" << std::endl
+		<< "  --kernel NAME       only run the named kernel" << std::endl
+		<< "  --min-time SECONDS  time to repeat each kernel for" << std::endl
+		<< "  --threads N         threads for the parallel kernels (default "
+			<< "all)" << std::endl
+		<< "  --json FILE         write the results to a JSON file"
+			<< std::endl
+		<< "  --baseline FILE     compare against earlier JSON results"
+			<< std::endl
+		<< "  --threshold PERCENT allowed slow down (default 10)"
+			<< std::endl
+		<< "  --out-of-core DIR   keep the meshes in files in DIR, to compare"
+			<< " against a" << std::endl
+		<< "                      baseline kept in memory" << std::endl;
+}
+
+/* Runs the Mesh kernel benchmarks over a range of grid sizes. */
+int runMeshBenchmarks(int argc, char* argv[])
+{
+	unsigned int minSize = DEFAULT_MIN_SIZE, maxSize = DEFAULT_MAX_SIZE;
+	const char* onlyKernel = NULL;
+	const char* jsonFilename = NULL;
+	const char* baselineFilename = NULL;
+	double threshold = 10.0, minSeconds = 0.5;
+
+	/* Parse the options. */
+	for (int i = 1; i < argc; i++)
+	{
+		if(i + 1 >= argc)
+		{
+			printMeshUsage();
+			return 1;
+		}
+		if(strcmp(argv[i], "--min-size") == 0)
+		{
+			minSize = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--max-size") == 0)
+		{
+			maxSize = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--kernel") == 0)
+		{
+			onlyKernel = argv[++i];
+		}
+		else if(strcmp(argv[i], "--min-time") == 0)
+		{
+			minSeconds = atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--threads") == 0)
+		{
+			Parallel::setThreadCount(atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "--json") == 0)
+		{
+			jsonFilename = argv[++i];
+		}
+		else if(strcmp(argv[i], "--baseline") == 0)
+		{
+			baselineFilename = argv[++i];
+		}
+		else if(strcmp(argv[i], "--threshold") == 0)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--out-of-core") == 0)
+		{
+			Mesh::setOutOfCore(argv[++i]);
+		}
+		else
+		{
+			printMeshUsage();
+			return 1;
+		}
+	}
+	if(minSize < 2 || maxSize < minSize)
+	{
+		printMeshUsage();
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(14) << "Kernel" << std::right
+		<< std::setw(6) << "Size" << std::setw(12) << "Seconds"
+		<< std::setw(14) << "Vertices/s" << std::setw(12) << "Heap MB"
+		<< std::setw(10) << "RSS MB" << std::setw(10) << "Allocs"
+		<< std::endl << std::string(78, '-') << std::endl;
+
+	std::vector<BenchmarkResult> results;
+	for (unsigned int size = minSize; size <= maxSize; size *= 2)
+	{
+		Mesh* mesh = new Mesh(size, size, 10, 10, &meshColor);
+
+		for (unsigned int k = 0; k < NUM_KERNELS; k++)
+		{
+			if(onlyKernel && strcmp(onlyKernel, kernelNames[k]) != 0)
+			{
+				continue;
+			}
+
+			BenchmarkResult result = measureKernel(kernelNames[k],
+				kernels[k], mesh, size, minSeconds);
+			results.push_back(result);
+
+			std::cout << std::left << std::setw(14) << result.kernel
+				<< std::right << std::setw(6) << result.size << std::fixed
+				<< std::setprecision(6) << std::setw(12) << result.seconds
+				<< std::setprecision(0) << std::setw(14)
+				<< result.verticesPerSecond << std::setprecision(1)
+				<< std::setw(12) << (result.peakHeapBytes / 1048576.0)
+				<< std::setw(10) << (result.peakRssBytes / 1048576.0)
+				<< std::setw(10) << result.allocations << std::endl;
+		}
+
+		delete mesh;
+	}
+
+	/* Remove the files written by the export kernel. */
+	remove(EXPORT_FILENAME);
+	remove(EXPORT_MTL_FILENAME);
+
+	if(jsonFilename && !Benchmark::writeJSON(jsonFilename, "mesh", results))
+	{
+		return 1;
+	}
+
+	/* Fail if any kernel regressed compared to the baseline. */
+	if(baselineFilename)
+	{
+		std::vector<BenchmarkResult> baseline;
+		if(!Benchmark::readJSON(baselineFilename, baseline))
+		{
+			return 1;
+		}
+		std::cout << std::endl;
+		return Benchmark::compare(baseline, results, threshold) ? 1 : 0;
+	}
+
+	return 0;
+}
+
+/* Compares two JSON result files and fails on regressions. */
+int runCompareBenchmarks(int argc, char* argv[])
+{
+	if(argc != 3 && !(argc == 5 && strcmp(argv[3], "--threshold") == 0))
+	{
+		std::cout << "Usage: Benchmarks compare BASELINE.json CURRENT.json "
+			<< "[--threshold PERCENT]" << std::endl;
+		return 1;
+	}
+	double threshold = (argc == 5) ? atof(argv[4]) : 10.0;
+
+	std::vector<BenchmarkResult> baseline, current;
+	if(!Benchmark::readJSON(argv[1], baseline) ||
+		!Benchmark::readJSON(argv[2], current))
+	{
+		return 1;
+	}
+	return Benchmark::compare(baseline, current, threshold) ? 1 : 0;
+}
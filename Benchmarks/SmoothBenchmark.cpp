@@ -0,0 +1,285 @@
+/*
+ * SmoothBenchmark.cpp
+ * Created by Zachary Ferguson
+ * Benchmark of Mesh::smooth against the original implementation of the
+ * Catmull-Clark stencils, which built every sum out of vec4 temporaries and
+ * a getVertex copy per term. Also checks both produce the same mesh.
+ */
+
+#include "Benchmark.h"
+#include "../Mesh.h"
+#include <cstdlib>
+#include <cstring>
+
+/* Default range of grid sizes measured. */
+#define DEFAULT_MIN_SIZE 16
+#define DEFAULT_MAX_SIZE 1024
+
+/* Color of the meshes benchmarked. */
+static const Color meshColor = Color(BLUE);
+
+/* The original Mesh::smooth, written against the public Mesh interface. */
+/* Only the column bound of the last loop, which compared against the    */
+/* rows, is corrected.                                                   */
+static Mesh* referenceSmooth(const Mesh* mesh)
+{
+	Mesh* newMesh = new Mesh((mesh->getRows()*2)-2, (mesh->getCols()*2)-2,
+		mesh->getWidth(), mesh->getDepth(), mesh->getColor(),
+		mesh->getSnowCapHeight());
+
+	for (unsigned int newRow = 0, originalRow = 0; newRow < newMesh->getRows();
+		 newRow+=2, originalRow++)
+	{
+		for (unsigned int newCol = 0, originalCol = 0; newCol < newMesh->
+			 getCols(); newCol+=2, originalCol++)
+		{
+			newMesh->setVertex(newRow, newCol,
+				mesh->getVertex(originalRow, originalCol));
+		}
+	}
+
+	for (unsigned int r = 1; r < newMesh->getRows(); r+=2)
+	{
+		for (unsigned int c = 1; c < newMesh->getCols(); c+=2)
+		{
+			vec4 avgVec;
+			avgVec =          newMesh->getVertex(r - 1, c - 1);
+			avgVec = avgVec + newMesh->getVertex(r + 1, c - 1);
+			avgVec = avgVec + newMesh->getVertex(r + 1, c + 1);
+			avgVec = avgVec + newMesh->getVertex(r - 1, c + 1);
+			avgVec = avgVec / 4.0f;
+			newMesh->setVertex(r, c, avgVec);
+		}
+	}
+
+	for (unsigned int r = 0; r < newMesh->getRows(); r+=2)
+	{
+		for (unsigned int c = 1; c < newMesh->getCols(); c+=2)
+		{
+			float n = 2.0f;
+			vec4 avgVec;
+			avgVec =          newMesh->getVertex(r, c - 1);
+			avgVec = avgVec + newMesh->getVertex(r, c + 1);
+			if(r > 0)
+			{
+				avgVec = avgVec + newMesh->getVertex(r-1, c);
+				n++;
+			}
+			if(r < newMesh->getRows()-1)
+			{
+				avgVec = avgVec + newMesh->getVertex(r+1, c);
+				n++;
+			}
+			avgVec = avgVec / n;
+			newMesh->setVertex(r, c, avgVec);
+		}
+	}
+
+	for (unsigned int r = 1; r < newMesh->getRows(); r+=2)
+	{
+		for (unsigned int c = 0; c < newMesh->getCols(); c+=2)
+		{
+			float n = 2.0f;
+			vec4 avgVec;
+			avgVec =		  newMesh->getVertex(r - 1, c);
+			avgVec = avgVec + newMesh->getVertex(r + 1, c);
+			if(c > 0)
+			{
+				avgVec = avgVec + newMesh->getVertex(r, c - 1);
+				n++;
+			}
+			if(c < newMesh->getCols()-1)
+			{
+				avgVec = avgVec + newMesh->getVertex(r, c + 1);
+				n++;
+			}
+			avgVec = avgVec / n;
+			newMesh->setVertex(r, c, avgVec);
+		}
+	}
+
+	for (unsigned int r = 0, origR = 0; r < newMesh->getRows(); r += 2,
+		origR++)
+	{
+		for (unsigned int c = 0, origC = 0; c < newMesh->getCols(); c += 2,
+			origC++)
+		{
+			vec4 faceAvg = vec4(0, 0, 0, 0);
+			float f = 0;
+			if(r > 0 && c > 0)
+			{
+				faceAvg = faceAvg + newMesh->getVertex(r - 1, c - 1);
+				f++;
+			}
+			if(r > 0 && c < newMesh->getCols()-1)
+			{
+				faceAvg = faceAvg + newMesh->getVertex(r - 1, c + 1);
+				f++;
+			}
+			if(r < newMesh->getRows()-1 && c > 0)
+			{
+				faceAvg = faceAvg + newMesh->getVertex(r + 1, c - 1);
+				f++;
+			}
+			if(r < newMesh->getRows()-1 && c < newMesh->getCols()-1)
+			{
+				faceAvg = faceAvg + newMesh->getVertex(r + 1, c + 1);
+				f++;
+			}
+			faceAvg = faceAvg / f;
+
+			vec4 edgeAvg = vec4(0, 0, 0, 0);
+			float valence = 0.0;
+			if(r > 0)
+			{
+				vec4 edgeMid = (mesh->getVertex(origR, origC) +
+					mesh->getVertex(origR - 1, origC)) / 2.0f;
+				edgeAvg = edgeAvg + edgeMid;
+				valence++;
+			}
+			if(r < newMesh->getRows()-1)
+			{
+				vec4 edgeMid = (mesh->getVertex(origR, origC) +
+					mesh->getVertex(origR + 1, origC)) / 2.0f;
+				edgeAvg = edgeAvg + edgeMid;
+				valence++;
+			}
+			if(c > 0)
+			{
+				vec4 edgeMid = (mesh->getVertex(origR, origC) +
+					mesh->getVertex(origR, origC - 1)) / 2.0f;
+				edgeAvg = edgeAvg + edgeMid;
+				valence++;
+			}
+			if(c < newMesh->getCols()-1)
+			{
+				vec4 edgeMid = (mesh->getVertex(origR, origC) +
+					mesh->getVertex(origR, origC + 1)) / 2.0f;
+				edgeAvg = edgeAvg + edgeMid;
+				valence++;
+			}
+			edgeAvg = edgeAvg / valence;
+
+			vec4 origV = newMesh->getVertex(r, c);
+			valence += f;
+			vec4 newVertex = (faceAvg + (2 * edgeAvg) + (valence-3)*origV) /
+				valence;
+			newMesh->setVertex(r, c, newVertex);
+		}
+	}
+
+	return newMesh;
+}
+
+/* Returns the largest difference between the components of the vertices */
+/* of the two meshes, which must be the same size.                       */
+static float maxDifference(const Mesh* mesh1, const Mesh* mesh2)
+{
+	float difference = 0;
+	for (unsigned int r = 0; r < mesh1->getRows(); r++)
+	{
+		for (unsigned int c = 0; c < mesh1->getCols(); c++)
+		{
+			vec4 delta = mesh1->getVertex(r, c) - mesh2->getVertex(r, c);
+			for (int i = 0; i < 4; i++)
+			{
+				if(fabs(delta[i]) > difference)
+				{
+					difference = (float)fabs(delta[i]);
+				}
+			}
+		}
+	}
+	return difference;
+}
+
+/* Prints how to run the smooth benchmarks. */
+static void printSmoothUsage()
+{
+	std::cout << "Usage: Benchmarks smooth [options]" << std::endl
+		<< "  --min-size N        smallest grid size (default "
+			<< DEFAULT_MIN_SIZE << ")" << std::endl
+		<< "  --max-size N        largest grid size (default "
+			<< DEFAULT_MAX_SIZE << ")" << std::endl
+		<< "  --min-time SECONDS  time to repeat each kernel for" << std::endl;
+}
+
+/* Benchmarks Mesh::smooth against the original implementation. */
+int runSmoothBenchmarks(int argc, char* argv[])
+{
+	unsigned int minSize = DEFAULT_MIN_SIZE, maxSize = DEFAULT_MAX_SIZE;
+	double minSeconds = 0.25;
+
+	/* Parse the options. */
+	for (int i = 1; i < argc; i++)
+	{
+		if(i + 1 >= argc)
+		{
+			printSmoothUsage();
+			return 1;
+		}
+		if(strcmp(argv[i], "--min-size") == 0)
+		{
+			minSize = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--max-size") == 0)
+		{
+			maxSize = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--min-time") == 0)
+		{
+			minSeconds = atof(argv[++i]);
+		}
+		else
+		{
+			printSmoothUsage();
+			return 1;
+		}
+	}
+	if(minSize < 2 || maxSize < minSize)
+	{
+		printSmoothUsage();
+		return 1;
+	}
+
+	/* Times are per vertex of the smoothed mesh, the reference time is */
+	/* the original implementation.                                     */
+	Benchmark bench(minSeconds);
+	Benchmark::printHeader();
+
+	int failures = 0;
+	for (unsigned int size = minSize; size <= maxSize; size *= 2)
+	{
+		Mesh* mesh = new Mesh(size, size, 10, 10, &meshColor);
+		/* Random heights, so the heights are compared as well. */
+		mesh->randomize(1.0f, size);
+		unsigned int vertices = (2 * size + 1) * (2 * size + 1);
+
+		/* Both implementations must produce exactly the same vertices, */
+		/* so a change to the order the sums are accumulated in fails.  */
+		Mesh* smoothed = mesh->smooth();
+		Mesh* reference = referenceSmooth(mesh);
+		float difference = maxDifference(smoothed, reference);
+		delete smoothed;
+		delete reference;
+
+		double ns = bench.measure([&]() { delete mesh->smooth(); },
+			vertices);
+		double refNs = bench.measure([&]() { delete referenceSmooth(mesh); },
+			vertices);
+
+		std::stringstream name;
+		name << "smooth " << size << "x" << size;
+		Benchmark::printRow(name.str(), ns, refNs);
+		if(difference != 0)
+		{
+			std::cout << "  differs from the original by " << difference
+				<< std::endl;
+			failures++;
+		}
+
+		delete mesh;
+	}
+
+	return failures;
+}
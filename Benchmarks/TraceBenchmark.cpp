@@ -0,0 +1,37 @@
+/*
+ * TraceBenchmark.cpp
+ * Created by Zachary Ferguson
+ * Benchmarks the cost of a TRACE_SCOPE with tracing compiled in.
+ */
+
+#define ENABLE_TRACING
+
+#include "Benchmark.h"
+#include "../Trace.h"
+#include <cstring>
+
+/* Number of scopes entered per call of the kernel. */
+#define NUM_SCOPES 1000
+
+/* Times entering and leaving a traced scope. Optionally dumps the recorded */
+/* scopes to the file given after --dump.                                   */
+int runTraceBenchmarks(int argc, char* argv[])
+{
+	Benchmark bench = Benchmark();
+	Benchmark::printHeader();
+
+	double ns = bench.measure([]() { for (int i = 0; i < NUM_SCOPES; i++)
+		{ TRACE_SCOPE("TraceBenchmark::scope"); } }, NUM_SCOPES);
+	Benchmark::printRow("TRACE_SCOPE", ns);
+
+	ns = bench.measure([]() { for (int i = 0; i < NUM_SCOPES; i++)
+		Benchmark::consume((float)Trace::now()); }, NUM_SCOPES);
+	Benchmark::printRow("Trace::now", ns);
+
+	if(argc == 3 && strcmp(argv[1], "--dump") == 0)
+	{
+		return Trace::dump(argv[2]) ? 0 : 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * Brush.cpp
+ * Created by Zachary Ferguson
+ * Source file for the Brush class, a sculpting brush that raises, lowers,
+ * smooths, flattens, or adds noise to the heights of a mesh within a radius
+ * of a point on the ground plane.
+ */
+
+#include "Brush.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <vector>
+
+/* Fewest vertices given to each thread by a dab. */
+#define VERTICES_PER_TASK 16384
+
+/* Returns the weight of the brush at the squared distance from its center, */
+/* given as a fraction of the radius.                                       */
+static inline float falloffWeight(BrushFalloff falloff, float distance2)
+{
+	if(distance2 >= 1)
+	{
+		return 0;
+	}
+	if(falloff == CONSTANT_FALLOFF)
+	{
+		return 1;
+	}
+	float t = 1 - std::sqrt(distance2);
+	return (falloff == LINEAR_FALLOFF) ? t : t * t * (3 - 2 * t);
+}
+
+/* Computes the weights of the brush along a row of vertices, given the */
+/* squared distances of the columns and of the row from the center.     */
+static void rowWeights(BrushFalloff falloff, const float* columnDistance2,
+	float rowDistance2, float* weights, unsigned int count)
+{
+	unsigned int i = 0;
+#ifdef VEC4_USE_SSE
+	/* Weigh four vertices at a time. */
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 two = _mm_set1_ps(2);
+	const __m128 three = _mm_set1_ps(3);
+	const __m128 row2 = _mm_set1_ps(rowDistance2);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 distance2 = _mm_add_ps(_mm_loadu_ps(columnDistance2 + i),
+			row2);
+		__m128 weight;
+		if(falloff == CONSTANT_FALLOFF)
+		{
+			weight = _mm_and_ps(_mm_cmplt_ps(distance2, one), one);
+		}
+		else
+		{
+			weight = _mm_max_ps(zero, _mm_sub_ps(one,
+				_mm_sqrt_ps(distance2)));
+			if(falloff == SMOOTH_FALLOFF)
+			{
+				weight = _mm_mul_ps(_mm_mul_ps(weight, weight),
+					_mm_sub_ps(three, _mm_mul_ps(two, weight)));
+			}
+		}
+		_mm_storeu_ps(weights + i, weight);
+	}
+#endif
+	/* Weigh the remaining vertices one at a time. */
+	for (; i < count; i++)
+	{
+		weights[i] = falloffWeight(falloff, columnDistance2[i] +
+			rowDistance2);
+	}
+}
+
+/* Returns a value between -1 and 1 that only depends on the vertex and */
+/* seed, so each thread can make the noise of its own rows.             */
+static inline float vertexNoise(unsigned int row, unsigned int col,
+	unsigned int seed)
+{
+	unsigned int hash = (row * 0x8da6b343u) ^ (col * 0xd8163841u) ^
+		(seed * 0xcb1ab31fu);
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return (hash & 0xffffff) / (float)0x800000 - 1.0f;
+}
+
+/* Creates a brush of the given mode, falloff, radius, and strength. */
+Brush::Brush(BrushMode mode, BrushFalloff falloff, float radius,
+	float strength)
+{
+	this->mode = mode;
+	this->falloff = falloff;
+	this->radius = radius;
+	this->strength = strength;
+	this->lastX = 0;
+	this->lastZ = 0;
+	this->flattenHeight = 0;
+	this->dabs = 0;
+}
+
+/* Sets what the brush does to the heights. */
+void Brush::setMode(BrushMode mode)
+{
+	this->mode = mode;
+}
+
+/* Returns what the brush does to the heights. */
+BrushMode Brush::getMode() const
+{
+	return this->mode;
+}
+
+/* Sets how the strength falls off from the center. */
+void Brush::setFalloff(BrushFalloff falloff)
+{
+	this->falloff = falloff;
+}
+
+/* Returns how the strength falls off from the center. */
+BrushFalloff Brush::getFalloff() const
+{
+	return this->falloff;
+}
+
+/* Sets the radius in the units of the ground plane. */
+void Brush::setRadius(float radius)
+{
+	assert(radius > 0);
+	this->radius = radius;
+}
+
+/* Returns the radius in the units of the ground plane. */
+float Brush::getRadius() const
+{
+	return this->radius;
+}
+
+/* Sets the strength, from zero to one. */
+void Brush::setStrength(float strength)
+{
+	this->strength = std::min(std::max(strength, 0.0f), 1.0f);
+}
+
+/* Returns the strength, from zero to one. */
+float Brush::getStrength() const
+{
+	return this->strength;
+}
+
+/* Begins a stroke at the given point of the ground plane with a dab. */
+/* Returns the rectangle of vertices changed.                         */
+MeshRect Brush::beginStroke(Mesh* mesh, float x, float z)
+{
+	TRACE_SCOPE("Brush::beginStroke");
+
+	/* Flatten towards the height of the vertex nearest the start. */
+	float col = (x / mesh->getWidth() + 0.5f) * (mesh->getCols() - 1);
+	float row = (z / mesh->getDepth() + 0.5f) * (mesh->getRows() - 1);
+	col = std::min(std::max(col + 0.5f, 0.0f),
+		(float)(mesh->getCols() - 1));
+	row = std::min(std::max(row + 0.5f, 0.0f),
+		(float)(mesh->getRows() - 1));
+	this->flattenHeight = mesh->getVertex((unsigned int)row,
+		(unsigned int)col)[1];
+
+	MeshRect dirty = {0, 0, 0, 0};
+	this->dab(mesh, x, z, dirty);
+	this->lastX = x;
+	this->lastZ = z;
+	return dirty;
+}
+
+/* Continues the stroke to the given point, with dabs spaced along the way */
+/* so fast drags leave no gaps. The distance left over after the last dab  */
+/* is carried to the next call. Returns the rectangle of vertices changed. */
+MeshRect Brush::continueStroke(Mesh* mesh, float x, float z)
+{
+	TRACE_SCOPE("Brush::continueStroke");
+
+	MeshRect dirty = {0, 0, 0, 0};
+	float dx = x - this->lastX, dz = z - this->lastZ;
+	float distance = std::sqrt(dx * dx + dz * dz);
+	float spacing = this->radius * BRUSH_SPACING;
+	unsigned int steps = (unsigned int)(distance / spacing);
+	if(steps == 0)
+	{
+		return dirty;
+	}
+
+	float stepX = dx / distance * spacing, stepZ = dz / distance * spacing;
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		this->lastX += stepX;
+		this->lastZ += stepZ;
+		this->dab(mesh, this->lastX, this->lastZ, dirty);
+	}
+	return dirty;
+}
+
+/* Makes one dab centered at the given point, adding the vertices changed */
+/* to dirty. The weights of each row are computed four at a time, and the */
+/* rows are split across threads once the brush covers enough vertices.   */
+void Brush::dab(Mesh* mesh, float x, float z, MeshRect& dirty)
+{
+	TRACE_SCOPE("Brush::dab");
+
+	/* Find the center and radius of the brush in rows and columns. */
+	unsigned int rows = mesh->getRows(), cols = mesh->getCols();
+	float centerCol = (x / mesh->getWidth() + 0.5f) * (cols - 1);
+	float centerRow = (z / mesh->getDepth() + 0.5f) * (rows - 1);
+	float radiusCols = this->radius / mesh->getWidth() * (cols - 1);
+	float radiusRows = this->radius / mesh->getDepth() * (rows - 1);
+
+	/* Find the rectangle of vertices under the brush. */
+	float colBegin = std::max(std::ceil(centerCol - radiusCols), 0.0f);
+	float colEnd = std::min(std::floor(centerCol + radiusCols) + 1,
+		(float)cols);
+	float rowBegin = std::max(std::ceil(centerRow - radiusRows), 0.0f);
+	float rowEnd = std::min(std::floor(centerRow + radiusRows) + 1,
+		(float)rows);
+	if(colBegin >= colEnd || rowBegin >= rowEnd)
+	{
+		return;
+	}
+	MeshRect rect = {(unsigned int)rowBegin, (unsigned int)rowEnd,
+		(unsigned int)colBegin, (unsigned int)colEnd};
+	unsigned int width = rect.colEnd - rect.colBegin;
+
+	/* Smoothing reads the heights around each vertex from before the dab, */
+	/* so copy them with a border of one vertex.                           */
+	std::vector<float> before;
+	MeshRect border = {0, 0, 0, 0};
+	if(this->mode == SMOOTH_BRUSH)
+	{
+		border.rowBegin = (rect.rowBegin > 0) ? rect.rowBegin - 1 : 0;
+		border.rowEnd = std::min(rect.rowEnd + 1, rows);
+		border.colBegin = (rect.colBegin > 0) ? rect.colBegin - 1 : 0;
+		border.colEnd = std::min(rect.colEnd + 1, cols);
+		unsigned int borderWidth = border.colEnd - border.colBegin;
+		before.resize((size_t)(border.rowEnd - border.rowBegin) *
+			borderWidth);
+		MemoryTracker::allocate(TEMPORARIES, before.size() * sizeof(float));
+		for (unsigned int r = border.rowBegin; r < border.rowEnd; r++)
+		{
+			const vec4* row = mesh->getRow(r);
+			float* heights = &before[(size_t)(r - border.rowBegin) *
+				borderWidth];
+			for (unsigned int c = border.colBegin; c < border.colEnd; c++)
+			{
+				heights[c - border.colBegin] = row[c][1];
+			}
+		}
+	}
+
+	/* Squared distance of each column from the center, as a fraction of */
+	/* the radius.                                                       */
+	std::vector<float> columnDistance2(width);
+	for (unsigned int i = 0; i < width; i++)
+	{
+		float d = (rect.colBegin + i - centerCol) / radiusCols;
+		columnDistance2[i] = d * d;
+	}
+
+	/* Copy the tiles under the brush that are shared with snapshots now, */
+	/* so the threads only write to tiles this mesh owns.                 */
+	for (unsigned int r = rect.rowBegin; r < rect.rowEnd;
+		r = (r / TILE_ROWS + 1) * TILE_ROWS)
+	{
+		mesh->getWritableRow(r);
+	}
+
+	float amount = this->strength * this->radius * BRUSH_HEIGHT_SCALE;
+	unsigned int seed = this->dabs++;
+	Parallel::forRange(rect.rowBegin, rect.rowEnd,
+		std::max((size_t)1, (size_t)(VERTICES_PER_TASK / width)),
+		[&](size_t begin, size_t end)
+	{
+		std::vector<float> weights(width);
+		for (size_t r = begin; r < end; r++)
+		{
+			float d = (r - centerRow) / radiusRows;
+			rowWeights(this->falloff, columnDistance2.data(), d * d,
+				weights.data(), width);
+
+			vec4* row = mesh->getWritableRow((unsigned int)r) +
+				rect.colBegin;
+			switch(this->mode)
+			{
+				case RAISE_BRUSH:
+				case LOWER_BRUSH:
+				{
+					float signedAmount = (this->mode == RAISE_BRUSH) ?
+						amount : -amount;
+					for (unsigned int i = 0; i < width; i++)
+					{
+						row[i][1] += signedAmount * weights[i];
+					}
+					break;
+				}
+				case NOISE_BRUSH:
+					for (unsigned int i = 0; i < width; i++)
+					{
+						row[i][1] += amount * weights[i] * vertexNoise(
+							(unsigned int)r, rect.colBegin + i, seed);
+					}
+					break;
+				case FLATTEN_BRUSH:
+					for (unsigned int i = 0; i < width; i++)
+					{
+						row[i][1] += (this->flattenHeight - row[i][1]) *
+							this->strength * weights[i];
+					}
+					break;
+				case SMOOTH_BRUSH:
+				{
+					/* Move each height towards the average of it and its */
+					/* neighbours, the ones past the edges left out.      */
+					unsigned int borderWidth = border.colEnd -
+						border.colBegin;
+					unsigned int above = (r > border.rowBegin) ?
+						(unsigned int)r - 1 : (unsigned int)r;
+					unsigned int below = (r + 1 < border.rowEnd) ?
+						(unsigned int)r + 1 : (unsigned int)r;
+					for (unsigned int i = 0; i < width; i++)
+					{
+						unsigned int c = rect.colBegin + i;
+						unsigned int left = (c > border.colBegin) ? c - 1 : c;
+						unsigned int right = (c + 1 < border.colEnd) ?
+							c + 1 : c;
+						float sum = 0;
+						unsigned int count = 0;
+						for (unsigned int nr = above; nr <= below; nr++)
+						{
+							const float* heights = &before[(size_t)(nr -
+								border.rowBegin) * borderWidth];
+							for (unsigned int nc = left; nc <= right; nc++)
+							{
+								sum += heights[nc - border.colBegin];
+								count++;
+							}
+						}
+						row[i][1] += (sum / count - row[i][1]) *
+							this->strength * weights[i];
+					}
+					break;
+				}
+			}
+		}
+	});
+
+	if(this->mode == SMOOTH_BRUSH)
+	{
+		MemoryTracker::release(TEMPORARIES, before.size() * sizeof(float));
+	}
+	unite(dirty, rect);
+}
+
+/* Finds where the given ray hits the ground plane, y = 0. Returns false if */
+/* it points away from the plane.                                           */
+bool Brush::groundPoint(ray userRay, float& x, float& z)
+{
+	vec4 eye = userRay.value(0);
+	vec4 direction = userRay.value(1) - eye;
+	if(std::fabs(direction[1]) < 1e-6f)
+	{
+		return false;
+	}
+	float t = -eye[1] / direction[1];
+	if(t < 0)
+	{
+		return false;
+	}
+	x = eye[0] + t * direction[0];
+	z = eye[2] + t * direction[2];
+	return true;
+}
+
+/* Returns true if the rectangle holds no vertices. */
+bool isEmpty(const MeshRect& rect)
+{
+	return rect.rowBegin >= rect.rowEnd || rect.colBegin >= rect.colEnd;
+}
+
+/* Grows the rectangle to also hold the other rectangle. */
+void unite(MeshRect& rect, const MeshRect& other)
+{
+	if(isEmpty(other))
+	{
+		return;
+	}
+	if(isEmpty(rect))
+	{
+		rect = other;
+		return;
+	}
+	rect.rowBegin = std::min(rect.rowBegin, other.rowBegin);
+	rect.rowEnd = std::max(rect.rowEnd, other.rowEnd);
+	rect.colBegin = std::min(rect.colBegin, other.colBegin);
+	rect.colEnd = std::max(rect.colEnd, other.colEnd);
+}
@@ -0,0 +1,101 @@
+/*
+ * Brush.h
+ * Created by Zachary Ferguson
+ * Header file for the Brush class, a sculpting brush that raises, lowers,
+ * smooths, flattens, or adds noise to the heights of a mesh within a radius
+ * of a point on the ground plane. Each dab only touches the rectangle of
+ * vertices under the brush, which is returned so just it can be redrawn.
+ */
+
+#ifndef BRUSH_H
+#define BRUSH_H
+
+#include "Mesh.h"
+#include "ray.h"
+
+/* Fraction of the radius the brush moves between dabs along a stroke. */
+#define BRUSH_SPACING 0.25f
+/* Fraction of the radius a full strength raise, lower, or noise dab */
+/* moves the center vertex.                                          */
+#define BRUSH_HEIGHT_SCALE 0.1f
+
+/* What the brush does to the heights under it. */
+enum BrushMode {RAISE_BRUSH, LOWER_BRUSH, SMOOTH_BRUSH, FLATTEN_BRUSH,
+	NOISE_BRUSH};
+
+/* How the strength of the brush drops from its center to its radius. */
+enum BrushFalloff {CONSTANT_FALLOFF, LINEAR_FALLOFF, SMOOTH_FALLOFF};
+
+/* A rectangle of vertices, the rows [rowBegin, rowEnd) and columns */
+/* [colBegin, colEnd). Empty if either range is empty.              */
+struct MeshRect
+{
+	unsigned int rowBegin, rowEnd, colBegin, colEnd;
+};
+
+class Brush
+{
+	private:
+
+		/* What the brush does and how its strength falls off. */
+		BrushMode mode;
+		BrushFalloff falloff;
+		/* Radius of the brush in the units of the ground plane. */
+		float radius;
+		/* Strength of the brush, from zero to one. */
+		float strength;
+
+		/* Point of the ground plane the last dab was made at. */
+		float lastX, lastZ;
+		/* Height flatten dabs move the vertices towards, the height under */
+		/* the brush when the stroke began.                                */
+		float flattenHeight;
+		/* Number of dabs made, used to seed the noise of each dab. */
+		unsigned int dabs;
+
+		/* Makes one dab centered at the given point, adding the vertices */
+		/* changed to dirty.                                              */
+		void dab(Mesh* mesh, float x, float z, MeshRect& dirty);
+
+	public:
+
+		/* Creates a brush of the given mode, falloff, radius, and */
+		/* strength.                                               */
+		Brush(BrushMode mode = RAISE_BRUSH,
+			BrushFalloff falloff = SMOOTH_FALLOFF, float radius = 1.0f,
+			float strength = 0.5f);
+
+		/* Sets and gets what the brush does to the heights. */
+		void setMode(BrushMode mode);
+		BrushMode getMode() const;
+		/* Sets and gets how the strength falls off from the center. */
+		void setFalloff(BrushFalloff falloff);
+		BrushFalloff getFalloff() const;
+		/* Sets and gets the radius in the units of the ground plane. */
+		void setRadius(float radius);
+		float getRadius() const;
+		/* Sets and gets the strength, from zero to one. */
+		void setStrength(float strength);
+		float getStrength() const;
+
+		/* Begins a stroke at the given point of the ground plane with a */
+		/* dab. Returns the rectangle of vertices changed.               */
+		MeshRect beginStroke(Mesh* mesh, float x, float z);
+
+		/* Continues the stroke to the given point, with dabs spaced along */
+		/* the way so fast drags leave no gaps. Returns the rectangle of   */
+		/* vertices changed.                                               */
+		MeshRect continueStroke(Mesh* mesh, float x, float z);
+
+		/* Finds where the given ray hits the ground plane, y = 0. Returns */
+		/* false if it points away from the plane.                         */
+		static bool groundPoint(ray userRay, float& x, float& z);
+};
+
+/* Returns true if the rectangle holds no vertices. */
+bool isEmpty(const MeshRect& rect);
+
+/* Grows the rectangle to also hold the other rectangle. */
+void unite(MeshRect& rect, const MeshRect& other);
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * BrushGroup.cpp
+ * Created by Zachary Ferguson
+ * Source file for the BrushGroup class, a child class of the Fl_Group class
+ * for turning on sculpting with the mouse and choosing the brush to sculpt
+ * with.
+ */
+
+#include "BrushGroup.h"
+
+/* Constructor for creating a new BrushGroup.          */
+/* Requires the x,y coordinates of the new BrushGroup. */
+BrushGroup::BrushGroup(int x, int y) : Fl_Group(x, y, 200, 205, 
+	"Sculpt Brush")
+{
+	this->box(FL_ENGRAVED_FRAME);
+	this->align(Fl_Align(FL_ALIGN_TOP|FL_ALIGN_INSIDE));
+
+	/* Create the sculpt button. */
+	this->sculptB = new Fl_Light_Button(x+10, y+20, 180, 24, 
+		"Sculpt With Mouse");
+
+	/* Create the brush mode choice, in the order of BrushMode. */
+	this->modeChoice = new Fl_Choice(x+70, y+50, 120, 24, "Brush:");
+	this->modeChoice->add("Raise");
+	this->modeChoice->add("Lower");
+	this->modeChoice->add("Smooth");
+	this->modeChoice->add("Flatten");
+	this->modeChoice->add("Noise");
+	this->modeChoice->value(RAISE_BRUSH);
+
+	/* Create the falloff choice, in the order of BrushFalloff. */
+	this->falloffChoice = new Fl_Choice(x+70, y+80, 120, 24, "Falloff:");
+	this->falloffChoice->add("Constant");
+	this->falloffChoice->add("Linear");
+	this->falloffChoice->add("Smooth");
+	this->falloffChoice->value(SMOOTH_FALLOFF);
+
+	/* Create the radius slider. */
+	this->radiusSlider = new Fl_Value_Slider(x+10, y+125, 180, 24, 
+		"Radius");
+	this->radiusSlider->type(1);
+	this->radiusSlider->box(FL_BORDER_BOX);
+	this->radiusSlider->minimum(0.1);
+	this->radiusSlider->maximum(10);
+	this->radiusSlider->step(0.1);
+	this->radiusSlider->value(1);
+	this->radiusSlider->align(Fl_Align(FL_ALIGN_TOP));
+
+	/* Create the strength slider. */
+	this->strengthSlider = new Fl_Value_Slider(x+10, y+170, 180, 24, 
+		"Strength");
+	this->strengthSlider->type(1);
+	this->strengthSlider->box(FL_BORDER_BOX);
+	this->strengthSlider->minimum(0);
+	this->strengthSlider->maximum(1);
+	this->strengthSlider->step(0.01);
+	this->strengthSlider->value(0.5);
+	this->strengthSlider->align(Fl_Align(FL_ALIGN_TOP));
+
+	this->end();
+}
+
+/* Destructor for this BrushGroup. */
+BrushGroup::~BrushGroup()
+{
+	delete this->sculptB;
+	delete this->modeChoice;
+	delete this->falloffChoice;
+	delete this->radiusSlider;
+	delete this->strengthSlider;
+}
+
+/* Accessor Methods */
+
+bool BrushGroup::isSculpting() const
+{
+	return this->sculptB->value() != 0;
+}
+
+BrushMode BrushGroup::getMode() const
+{
+	return (BrushMode)this->modeChoice->value();
+}
+
+BrushFalloff BrushGroup::getFalloff() const
+{
+	return (BrushFalloff)this->falloffChoice->value();
+}
+
+float BrushGroup::getRadius() const
+{
+	return (float)this->radiusSlider->value();
+}
+
+float BrushGroup::getStrength() const
+{
+	return (float)this->strengthSlider->value();
+}
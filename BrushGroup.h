@@ -0,0 +1,49 @@
+/*
+ * BrushGroup.h
+ * Created by Zachary Ferguson
+ * Header for the BrushGroup class, a child class of the Fl_Group class for
+ * turning on sculpting with the mouse and choosing the brush to sculpt with.
+ */
+
+#ifndef BRUSHGROUP_H
+#define BRUSHGROUP_H
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Light_Button.H>
+#include <FL/Fl_Choice.H>
+#include <FL/Fl_Value_Slider.h>
+#include "Brush.h"
+
+class BrushGroup : public Fl_Group
+{
+	private:
+	
+		/* Button to sculpt with the mouse instead of selecting vertices. */
+		Fl_Light_Button* sculptB;
+		/* Choices of what the brush does and how its strength falls off. */
+		Fl_Choice* modeChoice;
+		Fl_Choice* falloffChoice;
+		/* Sliders for the radius and strength of the brush. */
+		Fl_Value_Slider* radiusSlider;
+		Fl_Value_Slider* strengthSlider;
+
+	public:
+		
+		/* Constructor for creating a new BrushGroup.          */
+		/* Requires the x,y coordinates of the new BrushGroup. */
+		BrushGroup(int x, int y);
+
+		/* Destructor for this BrushGroup. */
+		virtual ~BrushGroup();
+
+		/* Accessor Methods */
+		bool isSculpting() const;
+		BrushMode getMode() const;
+		BrushFalloff getFalloff() const;
+		float getRadius() const;
+		float getStrength() const;
+};
+
+#endif
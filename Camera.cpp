@@ -18,6 +18,8 @@ Camera::Camera(float rho, float theta, float phi, float roll)
 	/* Vector orthogonal to the eye and up. */
 	this->right = vec4(vec3(this->eye) % vec3(this->up));
 	this->right = this->right / this->right.length();
+	/* Look at the origin. */
+	this->target = vec4(0, 0, 0, 0);
 
 	/* Calculate the initial rotation of the eye and up vectors. */
 	this->rotation = mat4::rotation3D(theta, vec3(this->up)) *
@@ -60,6 +62,37 @@ void Camera::increaseRad(float inc)
 	(this->eye)[2] += inc;
 }
 		
+/* Moves the target, and the eye with it, along the ground by the given */
+/* distances towards where the camera looks and to its right.           */
+void Camera::pan(float forward, float sideways)
+{
+	/* Flatten the view direction onto the ground. Looking straight down */
+	/* the view direction is the camera's up vector instead.             */
+	vec4 view = -1 * (this->rotation * this->eye);
+	if(fabs(view[0]) + fabs(view[2]) < 1e-4f * fabs(view[1]))
+	{
+		view = this->rotation * this->up;
+	}
+	vec3 ahead(view[0], 0, view[2]);
+	ahead = ahead / ahead.length();
+	vec3 side = ahead % vec3(0, 1, 0);
+
+	vec3 offset = forward * ahead + sideways * side;
+	this->target = this->target + vec4(offset[0], 0, offset[2], 0);
+}
+
+/* Sets the point the camera looks at and orbits around. */
+void Camera::setTarget(const vec4& target)
+{
+	this->target = target;
+}
+
+/* Returns the point the camera looks at and orbits around. */
+const vec4 Camera::getTarget() const
+{
+	return this->target;
+}
+
 /* Returns a vec4 for the up vector. */
 const vec4 Camera::getUp() const
 {
@@ -70,8 +103,8 @@ const vec4 Camera::getUp() const
 /* Returns a vec4 for the current eye position. */
 const vec4 Camera::getEye() const
 {
-	/* Rotate the eye vector then return it. */
-	return this->rotation * this->eye;
+	/* Rotate the eye vector around the target then return it. */
+	return this->target + this->rotation * this->eye;
 }
 
 /* Returns the transformation matrix on the camera. */
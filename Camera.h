@@ -25,6 +25,9 @@ class Camera
 
 		/* Vector orthogonal to the eye and up. */
 		vec4 right;
+
+		/* Point the camera looks at and orbits around. */
+		vec4 target;
 	
 	public:
 	
@@ -51,6 +54,17 @@ class Camera
 		/* radius.                                                      */
 		void increaseRad(float inc);
 		
+		/* Moves the target, and the eye with it, along the ground by the */
+		/* given distances towards where the camera looks and to its      */
+		/* right.                                                         */
+		void pan(float forward, float sideways);
+
+		/* Sets the point the camera looks at and orbits around. */
+		void setTarget(const vec4& target);
+
+		/* Returns the point the camera looks at and orbits around. */
+		const vec4 getTarget() const;
+		
 		/* Returns a vec4 for the up vector. */
 		const vec4 getUp() const;
 
@@ -0,0 +1,190 @@
+/*
+ * DiamondSquareGenerator.cpp
+ * Created by Zachary Ferguson
+ * Source file for the DiamondSquareGenerator class, which generates a
+ * heightfield with the diamond-square algorithm.
+ */
+
+#include "DiamondSquareGenerator.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+/* Fewest vertices given to each thread by a step. */
+#define VERTICES_PER_TASK 16384
+
+/* Returns a random number from -1 up to 1 that only depends on the seed */
+/* and the index of the vertex it displaces.                            */
+static inline float hashDisplacement(unsigned int seed, 
+	unsigned long long index)
+{
+	unsigned int hash = (unsigned int)index * 0x9e3779b9u ^
+		(unsigned int)(index >> 32) * 0xc2b2ae35u ^ seed * 0x85ebca6bu;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return (hash >> 8) * (2.0f / (1 << 24)) - 1.0f;
+}
+
+/* Creates a generator with the given seed and roughness. */
+DiamondSquareGenerator::DiamondSquareGenerator(unsigned int seed,
+	float roughness)
+{
+	this->seed = seed;
+	this->roughness = roughness;
+}
+
+/* Returns the smallest 2^n+1 that is at least rows and cols. */
+unsigned int DiamondSquareGenerator::latticeSize(unsigned int rows,
+	unsigned int cols)
+{
+	unsigned int quads = 1;
+	while(quads + 1 < std::max(rows, cols))
+	{
+		quads *= 2;
+	}
+	return quads + 1;
+}
+
+/* Generates the size*size heights, row by row, where size is 2^n+1. */
+void DiamondSquareGenerator::generate(float* heights, unsigned int size) const
+{
+	TRACE_SCOPE("DiamondSquareGenerator::generate");
+
+	unsigned int last = size - 1;
+	float amplitude = 1.0f;
+	const size_t corners[] = {0, last, (size_t)last * size, 
+		(size_t)last * size + last};
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		heights[corners[i]] = hashDisplacement(this->seed, corners[i]);
+	}
+
+	for (unsigned int step = last; step > 1; step /= 2)
+	{
+		unsigned int half = step / 2;
+		size_t rowsPerTask = std::max((size_t)1, 
+			(size_t)VERTICES_PER_TASK * step / size);
+
+		/* Diamond step: the center of each square from its corners. */
+		Parallel::forRange(0, last / step, rowsPerTask, [&](size_t begin, 
+			size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				size_t y = half + i * step;
+				float* row = heights + y * size;
+				const float* above = row - (size_t)half * size;
+				const float* below = row + (size_t)half * size;
+				for (unsigned int x = half; x < last; x += step)
+				{
+					row[x] = (above[x - half] + above[x + half] + 
+						below[x - half] + below[x + half]) * 0.25f + 
+						amplitude * hashDisplacement(this->seed, y * size + x);
+				}
+			}
+		});
+
+		/* Square step: the center of each diamond from its corners, */
+		/* three of them along the edges.                            */
+		Parallel::forRange(0, last / half + 1, rowsPerTask, [&](size_t begin, 
+			size_t end)
+		{
+			for (size_t j = begin; j < end; j++)
+			{
+				size_t y = j * half;
+				float* row = heights + y * size;
+				const float* above = (y > 0) ? row - (size_t)half * size : 
+					NULL;
+				const float* below = (y < last) ? row + (size_t)half * size : 
+					NULL;
+				for (unsigned int x = (j % 2) ? 0 : half; x < size; 
+					x += step)
+				{
+					float sum = 0;
+					unsigned int count = 0;
+					if(above)
+					{
+						sum += above[x];
+						count++;
+					}
+					if(below)
+					{
+						sum += below[x];
+						count++;
+					}
+					if(x > 0)
+					{
+						sum += row[x - half];
+						count++;
+					}
+					if(x < last)
+					{
+						sum += row[x + half];
+						count++;
+					}
+					row[x] = sum / count + amplitude * 
+						hashDisplacement(this->seed, y * size + x);
+				}
+			}
+		});
+
+		amplitude *= this->roughness;
+	}
+}
+
+/* Sets the heights of the mesh from -range/2 to range/2, scaling the part */
+/* of the lattice under the mesh to exactly fill the range.                */
+void DiamondSquareGenerator::fill(Mesh* mesh, float range) const
+{
+	TRACE_SCOPE("DiamondSquareGenerator::fill");
+
+	unsigned int rows = mesh->getRows(), cols = mesh->getCols();
+	unsigned int size = latticeSize(rows, cols);
+	size_t bytes = (size_t)size * size * sizeof(float);
+	MemoryTracker::allocate(TEMPORARIES, bytes);
+	std::vector<float> heights((size_t)size * size);
+	this->generate(heights.data(), size);
+
+	/* Find the range of the heights under the mesh. */
+	std::vector<float> rowMin(rows), rowMax(rows);
+	size_t rowsPerTask = std::max((size_t)1, (size_t)(VERTICES_PER_TASK / 
+		cols));
+	Parallel::forRange(0, rows, rowsPerTask, [&](size_t begin, size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			const float* row = &heights[r * size];
+			rowMin[r] = *std::min_element(row, row + cols);
+			rowMax[r] = *std::max_element(row, row + cols);
+		}
+	});
+	float low = *std::min_element(rowMin.begin(), rowMin.end());
+	float high = *std::max_element(rowMax.begin(), rowMax.end());
+	float scale = (high > low) ? range / (high - low) : 0.0f;
+	float middle = (high + low) / 2.0f;
+
+	/* Copy the tiles shared with snapshots now, so the threads only */
+	/* write to tiles this mesh owns.                                */
+	mesh->makeWritable();
+
+	Parallel::forRange(0, rows, rowsPerTask, [&](size_t begin, size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			const float* row = &heights[r * size];
+			vec4* vertices = mesh->getWritableRow((unsigned int)r);
+			for (unsigned int c = 0; c < cols; c++)
+			{
+				vertices[c][1] = (row[c] - middle) * scale;
+			}
+		}
+	});
+
+	MemoryTracker::release(TEMPORARIES, bytes);
+}
@@ -0,0 +1,53 @@
+/*
+ * DiamondSquareGenerator.h
+ * Created by Zachary Ferguson
+ * Header file for the DiamondSquareGenerator class, which generates a
+ * heightfield with the diamond-square algorithm on a lattice of 2^n+1 by
+ * 2^n+1 vertices. Each level sets the centers of the squares from their
+ * corners, then the centers of the diamonds from their corners, displaced by
+ * a random amount that shrinks by the roughness every level.
+ *
+ * Every vertex is set once, with a random number hashed from the seed and its
+ * position, and the vertices of a step only read vertices of earlier steps,
+ * so the rows of each step are split across the threads and the heights are
+ * the same for a seed on any number of threads.
+ */
+
+#ifndef DIAMONDSQUAREGENERATOR_H
+#define DIAMONDSQUAREGENERATOR_H
+
+#include "Mesh.h"
+
+/* Default factor the random displacement shrinks by each level. */
+#define DEFAULT_ROUGHNESS 0.5f
+
+class DiamondSquareGenerator
+{
+	private:
+
+		/* Seed the displacements are hashed from. */
+		unsigned int seed;
+		/* Factor the random displacement shrinks by each level. */
+		float roughness;
+
+	public:
+
+		/* Creates a generator with the given seed and roughness. */
+		DiamondSquareGenerator(unsigned int seed = 0,
+			float roughness = DEFAULT_ROUGHNESS);
+
+		/* Returns the smallest 2^n+1 that is at least rows and cols. */
+		static unsigned int latticeSize(unsigned int rows, unsigned int cols);
+
+		/* Generates the size*size heights, row by row, where size is  */
+		/* 2^n+1. The corners are from -1 to 1 and the first level is */
+		/* displaced by up to 1.                                      */
+		void generate(float* heights, unsigned int size) const;
+
+		/* Sets the heights of the mesh from -range/2 to range/2. A mesh of */
+		/* 2^n by 2^n quads is the whole lattice, and any other mesh is the */
+		/* corner of the smallest lattice that covers it.                   */
+		void fill(Mesh* mesh, float range) const;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * DropletErosion.cpp
+ * Created by Zachary Ferguson
+ * Source file for the DropletErosion class, a particle based simulation of
+ * rain wearing down a heightfield, after the droplet model of Hans Theobald
+ * Beyer, "Implementation of a method for hydraulic erosion".
+ */
+
+#include "DropletErosion.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+/* Creates the default settings. */
+DropletErosionSettings::DropletErosionSettings()
+{
+	this->lifetime = 30;
+	this->radius = 3;
+	this->inertia = 0.05f;
+	this->sedimentCapacity = 4.0f;
+	this->minCapacity = 0.01f;
+	this->erodeRate = 0.3f;
+	this->depositRate = 0.3f;
+	this->evaporationRate = 0.01f;
+	this->gravity = 4.0f;
+}
+
+/* Mixes the bits of the given integer, so neighbouring inputs give */
+/* unrelated outputs.                                               */
+static inline unsigned int hashBits(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+/* Creates a simulation of the heights of the given mesh, with droplets */
+/* started from the given seed.                                         */
+DropletErosion::DropletErosion(const Mesh* mesh, unsigned int seed,
+	const DropletErosionSettings& settings)
+{
+	this->rows = mesh->getRows();
+	this->cols = mesh->getCols();
+	this->spacing = 0.5f * (mesh->getWidth() / (this->cols - 1) +
+		mesh->getDepth() / (this->rows - 1));
+	this->settings = settings;
+	this->seed = seed;
+	this->droplets = 0;
+
+	this->heights.resize((size_t)this->rows * this->cols);
+	mesh->getHeights(this->heights.data());
+
+	/* Weights fall off linearly past the radius and sum to one. */
+	int radius = (int)settings.radius;
+	float total = 0;
+	for (int dr = -radius; dr <= radius; dr++)
+	{
+		for (int dc = -radius; dc <= radius; dc++)
+		{
+			float distance = std::sqrt((float)(dr * dr + dc * dc));
+			if(distance <= radius)
+			{
+				this->brushRows.push_back(dr);
+				this->brushCols.push_back(dc);
+				this->brushOffsets.push_back(dr * (ptrdiff_t)this->cols + dc);
+				this->brushWeights.push_back(1 - distance / (radius + 1));
+				total += this->brushWeights.back();
+			}
+		}
+	}
+	for (size_t i = 0; i < this->brushWeights.size(); i++)
+	{
+		this->brushWeights[i] /= total;
+	}
+
+	/* A droplet touches vertices at most its lifetime plus the radius  */
+	/* and the bilinear neighbours away from where it starts, so tiles  */
+	/* of twice that size keep droplets a tile apart from colliding.    */
+	this->tileSize = 2 * (settings.lifetime + settings.radius + 2);
+	this->tileRows = (this->rows + this->tileSize - 1) / this->tileSize;
+	this->tileCols = (this->cols + this->tileSize - 1) / this->tileSize;
+	for (unsigned int r = 0; r < this->tileRows; r++)
+	{
+		for (unsigned int c = 0; c < this->tileCols; c++)
+		{
+			this->phaseTiles[(r % 2) * 2 + c % 2].push_back(
+				r * this->tileCols + c);
+		}
+	}
+	this->batch.reserve(DROPLETS_PER_BATCH);
+	this->tileStarts.resize(this->tileRows * this->tileCols + 1);
+
+	MemoryTracker::allocate(EROSION_FIELDS, this->bytes());
+}
+
+/* Deletes the heights. */
+DropletErosion::~DropletErosion()
+{
+	MemoryTracker::release(EROSION_FIELDS, this->bytes());
+}
+
+/* Returns the bytes held by the heights and batches. */
+size_t DropletErosion::bytes() const
+{
+	return this->heights.size() * sizeof(float) +
+		(this->batch.capacity() + this->tileStarts.size()) *
+		sizeof(unsigned int);
+}
+
+/* Returns where the given droplet starts, a hashed point in a hashed */
+/* square of the lattice.                                             */
+void DropletErosion::start(unsigned int droplet, float& x, float& z) const
+{
+	unsigned int column = hashBits(this->seed ^ hashBits(2 * droplet));
+	unsigned int row = hashBits(this->seed ^ hashBits(2 * droplet + 1));
+	x = (column % (this->cols - 1)) + (column >> 24) / 256.0f;
+	z = (row % (this->rows - 1)) + (row >> 24) / 256.0f;
+}
+
+/* Returns the height at the given point between the vertices, found by   */
+/* bilinear interpolation, and its gradient along the columns and rows.   */
+/* The point must be inside the lattice.                                   */
+float DropletErosion::sample(float x, float z, float& gradientX,
+	float& gradientZ) const
+{
+	unsigned int c = (unsigned int)x, r = (unsigned int)z;
+	float u = x - c, v = z - r;
+	const float* top = &this->heights[(size_t)r * this->cols + c];
+	const float* bottom = top + this->cols;
+	gradientX = (top[1] - top[0]) * (1 - v) + (bottom[1] - bottom[0]) * v;
+	gradientZ = (bottom[0] - top[0]) * (1 - u) + (bottom[1] - top[1]) * u;
+	return top[0] * (1 - u) * (1 - v) + top[1] * u * (1 - v) +
+		bottom[0] * (1 - u) * v + bottom[1] * u * v;
+}
+
+/* Removes the given amount of soil from around a vertex, spread by the */
+/* weights of the brush over the vertices inside the lattice.           */
+void DropletErosion::erode(unsigned int row, unsigned int col, float amount)
+{
+	/* Away from the edges the whole brush fits and its weights sum to */
+	/* one, so the vertices are found by their offsets alone.          */
+	unsigned int radius = this->settings.radius;
+	if(row >= radius && col >= radius && row + radius < this->rows &&
+		col + radius < this->cols)
+	{
+		float* center = &this->heights[(size_t)row * this->cols + col];
+		for (size_t i = 0; i < this->brushWeights.size(); i++)
+		{
+			center[this->brushOffsets[i]] -= amount * this->brushWeights[i];
+		}
+		return;
+	}
+
+	float total = 0;
+	for (size_t i = 0; i < this->brushWeights.size(); i++)
+	{
+		int r = (int)row + this->brushRows[i];
+		int c = (int)col + this->brushCols[i];
+		if(r >= 0 && r < (int)this->rows && c >= 0 && c < (int)this->cols)
+		{
+			total += this->brushWeights[i];
+		}
+	}
+	float scale = amount / total;
+	for (size_t i = 0; i < this->brushWeights.size(); i++)
+	{
+		int r = (int)row + this->brushRows[i];
+		int c = (int)col + this->brushCols[i];
+		if(r >= 0 && r < (int)this->rows && c >= 0 && c < (int)this->cols)
+		{
+			this->heights[(size_t)r * this->cols + c] -=
+				scale * this->brushWeights[i];
+		}
+	}
+}
+
+/* Adds the given amount of soil to the corners of a square, weighted by */
+/* how close the point u, v within it is to each.                        */
+void DropletErosion::deposit(unsigned int row, unsigned int col, float u,
+	float v, float amount)
+{
+	float* top = &this->heights[(size_t)row * this->cols + col];
+	float* bottom = top + this->cols;
+	top[0] += amount * (1 - u) * (1 - v);
+	top[1] += amount * u * (1 - v);
+	bottom[0] += amount * (1 - u) * v;
+	bottom[1] += amount * u * v;
+}
+
+/* Runs one droplet until it evaporates or leaves the lattice. Each step */
+/* turns the droplet downhill, moves it one vertex, and compares the     */
+/* sediment it carries to its capacity, which grows with the slope it    */
+/* descended, its speed, and its water. Over capacity, or going uphill,  */
+/* it deposits around where it was, otherwise it erodes the vertices     */
+/* around there. Whatever it still carries at the end is dropped where   */
+/* it last was, so no soil is lost.                                      */
+void DropletErosion::simulate(unsigned int droplet)
+{
+	const DropletErosionSettings& s = this->settings;
+	float x, z;
+	this->start(droplet, x, z);
+	float directionX = 0, directionZ = 0;
+	float speed = 1, water = 1, sediment = 0;
+	unsigned int c = (unsigned int)x, r = (unsigned int)z;
+	float u = x - c, v = z - r;
+
+	for (unsigned int step = 0; step < s.lifetime; step++)
+	{
+		c = (unsigned int)x;
+		r = (unsigned int)z;
+		u = x - c;
+		v = z - r;
+		float gradientX, gradientZ;
+		float height = this->sample(x, z, gradientX, gradientZ);
+
+		/* Turn by the slope rather than the gradient, so the inertia is */
+		/* the same for any spacing.                                     */
+		directionX = directionX * s.inertia - gradientX / this->spacing *
+			(1 - s.inertia);
+		directionZ = directionZ * s.inertia - gradientZ / this->spacing *
+			(1 - s.inertia);
+		float length = std::sqrt(directionX * directionX +
+			directionZ * directionZ);
+		if(length <= 0)
+		{
+			break;
+		}
+		directionX /= length;
+		directionZ /= length;
+		x += directionX;
+		z += directionZ;
+		if(x < 0 || z < 0 || x >= this->cols - 1 || z >= this->rows - 1)
+		{
+			break;
+		}
+
+		float drop = height - this->sample(x, z, gradientX, gradientZ);
+		float slope = drop / this->spacing;
+		float capacity = this->spacing * std::max(slope * speed * water *
+			s.sedimentCapacity, s.minCapacity);
+		if(sediment > capacity || drop < 0)
+		{
+			float amount = (drop < 0) ? std::min(-drop, sediment) :
+				(sediment - capacity) * s.depositRate;
+			this->deposit(r, c, u, v, amount);
+			sediment -= amount;
+		}
+		else
+		{
+			float amount = std::min((capacity - sediment) * s.erodeRate,
+				drop);
+			this->erode(r, c, amount);
+			sediment += amount;
+		}
+
+		speed = std::sqrt(std::max(0.0f, speed * speed + slope * s.gravity));
+		water *= 1 - s.evaporationRate;
+	}
+	this->deposit(r, c, u, v, sediment);
+}
+
+/* Runs the given number of droplets, in batches of DROPLETS_PER_BATCH. */
+/* The droplets of a batch are sorted by the tile they start in, then   */
+/* the tiles of each phase are run in parallel. If cancelled is given   */
+/* and becomes true the batches stop early. Returns the number of       */
+/* droplets run.                                                        */
+unsigned int DropletErosion::run(unsigned int count,
+	const std::atomic<bool>* cancelled)
+{
+	TRACE_SCOPE("DropletErosion::run");
+
+	unsigned int done = 0;
+	while(done < count)
+	{
+		if(cancelled != NULL && cancelled->load())
+		{
+			break;
+		}
+		unsigned int size = std::min((unsigned int)DROPLETS_PER_BATCH,
+			count - done);
+		unsigned int first = this->droplets;
+
+		/* Count the droplets starting in each tile, then place them in */
+		/* index order after the droplets of the tiles before.          */
+		std::fill(this->tileStarts.begin(), this->tileStarts.end(), 0);
+		std::vector<unsigned int> tiles(size);
+		for (unsigned int i = 0; i < size; i++)
+		{
+			float x, z;
+			this->start(first + i, x, z);
+			tiles[i] = ((unsigned int)z / this->tileSize) * this->tileCols +
+				(unsigned int)x / this->tileSize;
+			this->tileStarts[tiles[i] + 1]++;
+		}
+		for (size_t t = 1; t < this->tileStarts.size(); t++)
+		{
+			this->tileStarts[t] += this->tileStarts[t - 1];
+		}
+		this->batch.resize(size);
+		std::vector<unsigned int> next(this->tileStarts.begin(),
+			this->tileStarts.end() - 1);
+		for (unsigned int i = 0; i < size; i++)
+		{
+			this->batch[next[tiles[i]]++] = first + i;
+		}
+
+		for (int phase = 0; phase < 4; phase++)
+		{
+			const std::vector<unsigned int>& phaseTiles =
+				this->phaseTiles[phase];
+			Parallel::forRange(0, phaseTiles.size(), 1, [&](size_t begin,
+				size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					unsigned int tile = phaseTiles[t];
+					for (unsigned int i = this->tileStarts[tile];
+						i < this->tileStarts[tile + 1]; i++)
+					{
+						this->simulate(this->batch[i]);
+					}
+				}
+			});
+		}
+
+		this->droplets += size;
+		done += size;
+	}
+	return done;
+}
+
+/* Sets the heights of the given mesh, which must be the size of the one */
+/* simulated, to the eroded terrain.                                     */
+void DropletErosion::apply(Mesh* mesh) const
+{
+	TRACE_SCOPE("DropletErosion::apply");
+	const unsigned int cols = this->cols;
+	mesh->applyHeights([&](unsigned int row, unsigned int col, float)
+	{
+		return this->heights[(size_t)row * cols + col];
+	});
+}
+
+/* Returns the number of droplets run so far. */
+unsigned int DropletErosion::getDropletCount() const
+{
+	return this->droplets;
+}
@@ -0,0 +1,130 @@
+/*
+ * DropletErosion.h
+ * Created by Zachary Ferguson
+ * Header file for the DropletErosion class, a particle based simulation of
+ * rain wearing down a heightfield. Each droplet starts at a random vertex and
+ * runs downhill along the bilinear gradient of the heights, dissolving soil
+ * while it speeds up and depositing it where it slows, which carves the fine
+ * gullies a grid simulation smooths over.
+ *
+ * The droplets are run in batches. The droplets of a batch are grouped by
+ * the tile of vertices they start in, and tiles further apart than a droplet
+ * can travel are run at the same time, with the droplets of each tile run in
+ * order. The heights are therefore the same for a given seed no matter how
+ * many threads are used.
+ */
+
+#ifndef DROPLETEROSION_H
+#define DROPLETEROSION_H
+
+#include <atomic>
+#include <vector>
+#include "Mesh.h"
+
+/* Number of droplets run in each batch. */
+#define DROPLETS_PER_BATCH 65536
+
+/* Constants of the droplet simulation. Distances are in vertices. */
+struct DropletErosionSettings
+{
+	/* Most steps a droplet takes before it evaporates. */
+	unsigned int lifetime;
+	/* Radius of the vertices a droplet erodes around it. */
+	unsigned int radius;
+	/* Fraction of a droplet's direction kept each step, the rest turns */
+	/* it downhill.                                                     */
+	float inertia;
+	/* Sediment a droplet can carry per unit of slope, speed, and water. */
+	float sedimentCapacity;
+	/* Smallest capacity as a slope, so droplets on flat ground erode. */
+	float minCapacity;
+	/* Fraction of the spare capacity eroded each step. */
+	float erodeRate;
+	/* Fraction of the sediment over capacity deposited each step. */
+	float depositRate;
+	/* Fraction of a droplet's water evaporated each step. */
+	float evaporationRate;
+	/* Speed gained per unit of slope descended. */
+	float gravity;
+
+	/* Creates the default settings. */
+	DropletErosionSettings();
+};
+
+class DropletErosion
+{
+	private:
+
+		/* Number of rows and columns of the lattice. */
+		unsigned int rows, cols;
+		/* Distance between neighbouring vertices. */
+		float spacing;
+		/* Constants of the simulation. */
+		DropletErosionSettings settings;
+		/* Seed the start of every droplet is hashed from. */
+		unsigned int seed;
+		/* Number of droplets run so far, the index of the next droplet. */
+		unsigned int droplets;
+
+		/* Height of each vertex, row by row. */
+		std::vector<float> heights;
+
+		/* Offsets and weights of the vertices within the radius of a */
+		/* droplet, which it erodes.                                  */
+		std::vector<int> brushRows, brushCols;
+		std::vector<ptrdiff_t> brushOffsets;
+		std::vector<float> brushWeights;
+
+		/* Side of the square tiles the droplets are grouped by, and the */
+		/* number of tiles along the rows and columns.                   */
+		unsigned int tileSize, tileRows, tileCols;
+		/* Tiles of each of the four phases. Tiles of a phase are at least */
+		/* a tile apart, so their droplets never touch the same vertex.    */
+		std::vector<unsigned int> phaseTiles[4];
+		/* Droplets of the batch being run, grouped by tile in the order */
+		/* of their index, and where the droplets of each tile begin.    */
+		std::vector<unsigned int> batch, tileStarts;
+
+		/* Returns where the given droplet starts. */
+		void start(unsigned int droplet, float& x, float& z) const;
+		/* Returns the height at the given point between the vertices and */
+		/* its gradient along the columns and rows.                        */
+		float sample(float x, float z, float& gradientX, float& gradientZ)
+			const;
+		/* Runs one droplet until it evaporates or leaves the lattice. */
+		void simulate(unsigned int droplet);
+		/* Removes the given amount of soil from around a vertex. */
+		void erode(unsigned int row, unsigned int col, float amount);
+		/* Adds the given amount of soil around a point in a square. */
+		void deposit(unsigned int row, unsigned int col, float u, float v,
+			float amount);
+
+		/* Returns the bytes held by the heights and batches. */
+		size_t bytes() const;
+
+	public:
+
+		/* Creates a simulation of the heights of the given mesh, with */
+		/* droplets started from the given seed.                       */
+		DropletErosion(const Mesh* mesh, unsigned int seed = 0,
+			const DropletErosionSettings& settings =
+			DropletErosionSettings());
+
+		/* Deletes the heights. */
+		~DropletErosion();
+
+		/* Runs the given number of droplets, in batches of             */
+		/* DROPLETS_PER_BATCH. If cancelled is given and becomes true   */
+		/* the batches stop early. Returns the number of droplets run.  */
+		unsigned int run(unsigned int count,
+			const std::atomic<bool>* cancelled = NULL);
+
+		/* Sets the heights of the given mesh, which must be the size of */
+		/* the one simulated, to the eroded terrain.                     */
+		void apply(Mesh* mesh) const;
+
+		/* Returns the number of droplets run so far. */
+		unsigned int getDropletCount() const;
+};
+
+#endif
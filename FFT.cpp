@@ -0,0 +1,220 @@
+/*
+ * FFT.cpp
+ * Created by Zachary Ferguson
+ * Source file for the FFT class, a radix-2 fast Fourier transform of complex
+ * data stored as interleaved real and imaginary floats.
+ */
+
+#include "FFT.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include "vec4.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+/* Number of columns copied out and transformed together, so each row of */
+/* the block read is a few whole cache lines.                            */
+#define COLUMNS_PER_BLOCK 8
+
+/* Fewest complex values given to each thread by the 2D transform. */
+#define VALUES_PER_TASK 16384
+
+/* Creates a transform of the given power of two size. */
+FFT::FFT(unsigned int size) : reversed(size), cosines(size), sines(size)
+{
+	assert(size > 0 && (size & (size - 1)) == 0);
+	this->size = size;
+
+	/* Find the bit reversal of each index. */
+	unsigned int bits = 0;
+	while((1U << bits) < size)
+	{
+		bits++;
+	}
+	for (unsigned int i = 0; i < size; i++)
+	{
+		unsigned int r = 0;
+		for (unsigned int b = 0; b < bits; b++)
+		{
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		this->reversed[i] = r;
+	}
+
+	/* Find the twiddles of each stage in double precision, so large   */
+	/* transforms stay accurate. Keeping each stage's twiddles together */
+	/* lets the butterflies read them in order.                        */
+	for (unsigned int half = 1; half < size; half *= 2)
+	{
+		for (unsigned int k = 0; k < half; k++)
+		{
+			double angle = -3.14159265358979323846 * k / half;
+			this->cosines[half + k] = (float)cos(angle);
+			this->sines[half + k] = (float)sin(angle);
+		}
+	}
+}
+
+/* Returns the number of complex values transformed. */
+unsigned int FFT::getSize() const
+{
+	return this->size;
+}
+
+/* Transforms the getSize() complex values of data in place with       */
+/* iterative decimation in time butterflies. The inverse only flips    */
+/* the sign of the twiddles' sines, and is not scaled by 1/getSize().  */
+/* With SSE two butterflies are made at once, each register holding    */
+/* two interleaved complex values.                                     */
+void FFT::transform(float* data, bool inverse) const
+{
+	unsigned int n = this->size;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		unsigned int j = this->reversed[i];
+		if(i < j)
+		{
+			std::swap(data[2 * i], data[2 * j]);
+			std::swap(data[2 * i + 1], data[2 * j + 1]);
+		}
+	}
+
+	/* The first stage's only twiddle is 1. */
+	for (unsigned int i = 0; i + 1 < n; i += 2)
+	{
+		float re = data[2 * i + 2], im = data[2 * i + 3];
+		data[2 * i + 2] = data[2 * i] - re;
+		data[2 * i + 3] = data[2 * i + 1] - im;
+		data[2 * i] += re;
+		data[2 * i + 1] += im;
+	}
+
+	float sign = inverse ? -1.0f : 1.0f;
+#ifdef VEC4_USE_SSE
+	/* Multiplies the sines by -1 for the inverse, and the real parts of */
+	/* the swapped products by -1 for the complex product.               */
+	const __m128 sineSign = _mm_set1_ps(sign);
+	const __m128 realSign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+#endif
+	for (unsigned int half = 2; half < n; half *= 2)
+	{
+		const float* cosines = &this->cosines[half];
+		const float* sines = &this->sines[half];
+		for (unsigned int start = 0; start < n; start += 2 * half)
+		{
+			float* a = data + 2 * start;
+			float* b = a + 2 * half;
+#ifdef VEC4_USE_SSE
+			for (unsigned int k = 0; k < half; k += 2)
+			{
+				/* Twiddles (wr0, wr0, wr1, wr1) and (wi0, wi0, wi1, wi1). */
+				__m128 wr = _mm_loadl_pi(_mm_setzero_ps(),
+					(const __m64*)(cosines + k));
+				wr = _mm_shuffle_ps(wr, wr, _MM_SHUFFLE(1, 1, 0, 0));
+				__m128 wi = _mm_loadl_pi(_mm_setzero_ps(),
+					(const __m64*)(sines + k));
+				wi = _mm_mul_ps(_mm_shuffle_ps(wi, wi, _MM_SHUFFLE(1, 1, 0,
+					0)), sineSign);
+				__m128 bv = _mm_loadu_ps(b + 2 * k);
+				__m128 swapped = _mm_shuffle_ps(bv, bv, _MM_SHUFFLE(2, 3, 0,
+					1));
+				__m128 product = _mm_add_ps(_mm_mul_ps(bv, wr), _mm_mul_ps(
+					_mm_mul_ps(swapped, wi), realSign));
+				__m128 av = _mm_loadu_ps(a + 2 * k);
+				_mm_storeu_ps(b + 2 * k, _mm_sub_ps(av, product));
+				_mm_storeu_ps(a + 2 * k, _mm_add_ps(av, product));
+			}
+#else
+			for (unsigned int k = 0; k < half; k++)
+			{
+				float wr = cosines[k], wi = sign * sines[k];
+				float re = b[2 * k] * wr - b[2 * k + 1] * wi;
+				float im = b[2 * k] * wi + b[2 * k + 1] * wr;
+				b[2 * k] = a[2 * k] - re;
+				b[2 * k + 1] = a[2 * k + 1] - im;
+				a[2 * k] += re;
+				a[2 * k + 1] += im;
+			}
+#endif
+		}
+	}
+}
+
+/* Transforms the rows*cols complex values of data in place in both   */
+/* dimensions. The rows are transformed where they are, split across   */
+/* the threads. The columns are then copied out COLUMNS_PER_BLOCK at a */
+/* time, so the rows are read and written a few cache lines at once,   */
+/* transformed contiguously, and copied back.                          */
+void FFT::transform2D(float* data, unsigned int rows, unsigned int cols,
+	bool inverse)
+{
+	TRACE_SCOPE("FFT::transform2D");
+
+	FFT rowTransform(cols);
+	Parallel::forRange(0, rows, std::max((size_t)1,
+		(size_t)(VALUES_PER_TASK / cols)), [&](size_t begin, size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			rowTransform.transform(data + 2 * r * cols, inverse);
+		}
+	});
+
+	if(rows < 2)
+	{
+		return;
+	}
+	FFT columnTransform(rows);
+	unsigned int blocks = (cols + COLUMNS_PER_BLOCK - 1) / COLUMNS_PER_BLOCK;
+	size_t blockBytes = (size_t)COLUMNS_PER_BLOCK * rows * 2 * sizeof(float);
+	Parallel::forRange(0, blocks, std::max((size_t)1,
+		(size_t)(VALUES_PER_TASK / (COLUMNS_PER_BLOCK * rows))),
+		[&](size_t begin, size_t end)
+	{
+		MemoryTracker::allocate(TEMPORARIES, blockBytes);
+		std::vector<float> block((size_t)COLUMNS_PER_BLOCK * rows * 2);
+		for (size_t b = begin; b < end; b++)
+		{
+			unsigned int first = (unsigned int)b * COLUMNS_PER_BLOCK;
+			unsigned int width = std::min((unsigned int)COLUMNS_PER_BLOCK,
+				cols - first);
+			for (unsigned int r = 0; r < rows; r++)
+			{
+				const float* row = data + 2 * ((size_t)r * cols + first);
+				for (unsigned int c = 0; c < width; c++)
+				{
+					block[2 * ((size_t)c * rows + r)] = row[2 * c];
+					block[2 * ((size_t)c * rows + r) + 1] = row[2 * c + 1];
+				}
+			}
+			for (unsigned int c = 0; c < width; c++)
+			{
+				columnTransform.transform(&block[2 * (size_t)c * rows],
+					inverse);
+			}
+			for (unsigned int r = 0; r < rows; r++)
+			{
+				float* row = data + 2 * ((size_t)r * cols + first);
+				for (unsigned int c = 0; c < width; c++)
+				{
+					row[2 * c] = block[2 * ((size_t)c * rows + r)];
+					row[2 * c + 1] = block[2 * ((size_t)c * rows + r) + 1];
+				}
+			}
+		}
+		MemoryTracker::release(TEMPORARIES, blockBytes);
+	});
+}
+
+/* Returns the smallest power of two that is at least n. */
+unsigned int FFT::nextPowerOfTwo(unsigned int n)
+{
+	unsigned int power = 1;
+	while(power < n)
+	{
+		power *= 2;
+	}
+	return power;
+}
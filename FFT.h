@@ -0,0 +1,50 @@
+/*
+ * FFT.h
+ * Created by Zachary Ferguson
+ * Header file for the FFT class, a radix-2 fast Fourier transform of complex
+ * data stored as interleaved real and imaginary floats. A transform of one
+ * size keeps its bit reversal and twiddle tables so it can be run on many
+ * rows. The 2D transform splits the rows, then blocks of the columns, across
+ * the threads.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+class FFT
+{
+	private:
+
+		/* Number of complex values transformed, a power of two. */
+		unsigned int size;
+		/* Index each value is swapped with before the butterflies. */
+		std::vector<unsigned int> reversed;
+		/* Cosine and sine of the forward twiddles of each stage, the */
+		/* half twiddles of the stage of half size starting at half.  */
+		std::vector<float> cosines, sines;
+
+	public:
+
+		/* Creates a transform of the given power of two size. */
+		FFT(unsigned int size);
+
+		/* Returns the number of complex values transformed. */
+		unsigned int getSize() const;
+
+		/* Transforms the getSize() complex values of data in place. The */
+		/* inverse is not scaled by 1/getSize().                         */
+		void transform(float* data, bool inverse) const;
+
+		/* Transforms the rows*cols complex values of data, row by row, */
+		/* in place in both dimensions. Both sizes must be powers of    */
+		/* two, and the inverse is not scaled by 1/(rows*cols).         */
+		static void transform2D(float* data, unsigned int rows,
+			unsigned int cols, bool inverse);
+
+		/* Returns the smallest power of two that is at least n. */
+		static unsigned int nextPowerOfTwo(unsigned int n);
+};
+
+#endif
@@ -6,6 +6,7 @@
  */
 
 #include "GL3DWindow.h"
+#include "Trace.h"
 
 /* Constructor for a GL3DWindow that takes the int aspects, a char* */
 /* for the window label, and a Node3D for the root.                 */
@@ -14,6 +15,8 @@ GL3DWindow::GL3DWindow(int x, int y, int w, int h, const char* label, Mesh*
 {
 	this->mesh = NULL;
 	this->setMesh(mesh);
+	this->terrain = NULL;
+	this->terrainSelected = false;
 	
 	this->cam = new Camera(15, 0, 45, 0);
 
@@ -28,20 +31,38 @@ GL3DWindow::~GL3DWindow()
 {
 	delete this->cam;
 	delete this->mesh;
-	delete this->selectedIndecies;
+	deleteIndecies(this->selectedIndecies);
 }
 
 /* Sets this GL3DWindows Mesh to the given mesh. */
 void GL3DWindow::setMesh(Mesh* mesh)
 {
 	this->mesh = mesh;
-	if(this->selectedIndecies)
-	{
-		delete this->selectedIndecies;		
-	}
+	deleteIndecies(this->selectedIndecies);
 	this->selectedIndecies = NULL;
 }
 
+/* Sets the virtual terrain to draw instead of the mesh, or NULL to draw */
+/* the mesh again. The camera is moved back to look at the center.      */
+void GL3DWindow::setTerrain(VirtualTerrain* terrain)
+{
+	this->terrain = terrain;
+	this->terrainSelected = false;
+	/* Look back at the center, where the mesh is. */
+	this->cam->setTarget(vec4(0, 0, 0, 0));
+}
+
+/* Selects the vertex of the terrain the ray passes closest to, returning */
+/* false if it passes none.                                               */
+bool GL3DWindow::selectTerrainVertex(ray userRay)
+{
+	assert(this->terrain);
+	this->terrainSelected = this->terrain->selectVertex(userRay, 
+		this->selectedTerrainVertex);
+	this->redraw();
+	return this->terrainSelected;
+}
+
 /* Sets whether or not to draw the edges of the mash. */
 void GL3DWindow::setDrawEdges(bool drawEdges)
 {
@@ -60,14 +81,8 @@ const std::vector<unsigned int>* GL3DWindow::selectMeshIndex(unsigned int row,
 {
 	assert(row < this->mesh->getRows() && col < this->mesh->getCols());
 	
-	if(this->selectedIndecies)
-	{
-		delete this->selectedIndecies;
-	}
-	
-	this->selectedIndecies = new std::vector<unsigned int>();
-	this->selectedIndecies->push_back(row);
-	this->selectedIndecies->push_back(col);
+	deleteIndecies(this->selectedIndecies);
+	this->selectedIndecies = newIndecies(row, col);
 
 	this->redraw();
 
@@ -83,10 +98,9 @@ const std::vector<unsigned int>* GL3DWindow::selectMeshIndex(
 		assert(indecies->size() == 2);
 	}
 	
-	if(this->selectedIndecies)
+	if(this->selectedIndecies != indecies)
 	{
-		delete this->selectedIndecies;	
-		this->selectedIndecies = NULL;	
+		deleteIndecies(this->selectedIndecies);
 	}
 	
 	this->selectedIndecies = indecies;
@@ -107,6 +121,8 @@ void GL3DWindow::cameraAlignCB(Fl_Widget* w, void* data)
 {
 	GL3DWindow* gl3DWin = (GL3DWindow*)data;
 	CameraControlButton* button = (CameraControlButton*)w;
+	/* Keep looking at the same point. */
+	vec4 target = gl3DWin->cam->getTarget();
 
 	switch(button->getCameraPosition())
 	{
@@ -136,6 +152,7 @@ void GL3DWindow::cameraAlignCB(Fl_Widget* w, void* data)
 			gl3DWin->cam = new Camera(15, 0, 90, 0);
 			break;
 	}
+	gl3DWin->cam->setTarget(target);
 
 	gl3DWin->redraw();
 }
@@ -164,6 +181,8 @@ void GL3DWindow::init()
 /* Draws the 3D geometry out to the screen.             */
 void GL3DWindow::draw()
 {
+	TRACE_SCOPE("GL3DWindow::draw");
+
 	if (!valid())
 	{
 		init();
@@ -175,8 +194,10 @@ void GL3DWindow::draw()
 	
 	vec4 eye = this->cam->getEye();
 	vec4 up  = this->cam->getUp();
-	/* Look at the center */
-	gluLookAt(eye[0], eye[1], eye[2], 0, 0, 0, up[0], up[1], up[2]);
+	vec4 target = this->cam->getTarget();
+	/* Look at the target */
+	gluLookAt(eye[0], eye[1], eye[2], target[0], target[1], target[2], 
+		up[0], up[1], up[2]);
 
 	/* X-axis */
 	glColor3f(GREEN);
@@ -200,9 +221,10 @@ void GL3DWindow::draw()
 	glEnd();
 
 	/* Draw out the selection box. */
-	if(this->selectedIndecies)
+	if(this->terrain ? this->terrainSelected : this->selectedIndecies != NULL)
 	{
-		vec4 v = this->mesh->getVertex(selectedIndecies->at(0),
+		vec4 v = this->terrain ? this->selectedTerrainVertex : 
+			this->mesh->getVertex(selectedIndecies->at(0), 
 			selectedIndecies->at(1));
 		float x = v[0]; 
 		float y = v[1];
@@ -230,7 +252,17 @@ void GL3DWindow::draw()
 		//glEnd();
 	}
 
-	this->mesh->draw(this->drawEdges, this->drawFaces);
+	/* Draw the tiles of the terrain in view, generating those that are */
+	/* not cached, or the mesh.                                         */
+	if(this->terrain)
+	{
+		this->terrain->update(eye, target);
+		this->terrain->draw(this->drawEdges, this->drawFaces);
+	}
+	else
+	{
+		this->mesh->draw(this->drawEdges, this->drawFaces);
+	}
 }
 		
 /* Method in FL_GL_Window class for handling FLTK events. */
@@ -284,6 +316,22 @@ void GL3DWindow::handleKeys()
 		case CTRLKEY:
 			this->cam->increaseRad(DELTARADIUS);
 			break;
+		/* Move Forward */
+		case FL_Up:
+			this->cam->pan(DELTAPAN, 0);
+			break;
+		/* Move Backward */
+		case FL_Down:
+			this->cam->pan(-DELTAPAN, 0);
+			break;
+		/* Move Left */
+		case FL_Left:
+			this->cam->pan(0, -DELTAPAN);
+			break;
+		/* Move Right */
+		case FL_Right:
+			this->cam->pan(0, DELTAPAN);
+			break;
 		//default:
 		//	std::cout << Fl::event_key() << std::endl;
 	}
@@ -295,7 +343,8 @@ void GL3DWindow::handleKeys()
 ray GL3DWindow::getRayFromPush() const
 {
 	vec3 eye = this->cam->getEye();
-	vec3 camView = -1*eye;
+	vec3 target = this->cam->getTarget();
+	vec3 camView = target - eye;
 	float camDist = camView.length();
 	vec3 up = this->cam->getUp();
 	float theta = 60;
@@ -314,8 +363,8 @@ ray GL3DWindow::getRayFromPush() const
 	/* (sx, sy), where 0 <= sx <= 1 and 0 <= sy <= 1.                     */
 	float sx = ((float)(Fl::event_x()-this->x()) / this->w());
 	float sy = 1 - ((float)(Fl::event_y()-this->y()) / this->h());
-	vec4 selected = 2*(midpoint + (2 * sx - 1)*horizontal + (2 * sy - 1)*
-		vertical);
+	vec4 selected = target + 2*(midpoint - target + (2 * sx - 1)*horizontal
+		+ (2 * sy - 1)*vertical);
 	/* Step 5: Compute the ray equation, R. */
 	return ray(eye, selected);
 }
\ No newline at end of file
@@ -16,9 +16,11 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "CameraControlButton.h"
+#include "VirtualTerrain.h"
 
 #define DELTARADIUS 1
 #define DELTAANGLE 5
+#define DELTAPAN 2
 #define SHIFTKEY 65505
 #define CTRLKEY 65507
 
@@ -33,6 +35,13 @@ class GL3DWindow : public Fl_Gl_Window
 		/* 3D Mesh to draw out to the screen. */
 		Mesh* mesh;
 
+		/* Virtual terrain drawn instead of the mesh, NULL if there is */
+		/* none. The terrain is not deleted by this GL3DWindow.        */
+		VirtualTerrain* terrain;
+		/* Selected vertex of the terrain, if terrainSelected. */
+		vec4 selectedTerrainVertex;
+		bool terrainSelected;
+
 		/* Booleans for if the elements should be drawn. */
 		bool drawEdges, drawFaces;
 
@@ -62,6 +71,15 @@ class GL3DWindow : public Fl_Gl_Window
 		/* Sets this GL3DWindows Mesh to the given mesh. */   
 		void setMesh(Mesh* mesh);
 
+		/* Sets the virtual terrain to draw instead of the mesh, or NULL */
+		/* to draw the mesh again. The terrain is not deleted by this    */
+		/* GL3DWindow.                                                   */
+		void setTerrain(VirtualTerrain* terrain);
+
+		/* Selects the vertex of the terrain the ray passes closest to, */
+		/* returning false if it passes none.                           */
+		bool selectTerrainVertex(ray userRay);
+
 		/* Sets whether or not to draw the edges of the mash. */
 		void setDrawEdges(bool drawEdges);
 		/* Sets whether or not to draw the faces of the mesh. */
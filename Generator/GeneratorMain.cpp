@@ -0,0 +1,482 @@
+/*
+ * GeneratorMain.cpp
+ * Created by Zachary Ferguson
+ * Main file for the headless terrain generator, a console program that
+ * generates a heightfield with one of the modeler's generators and saves it
+ * as an OBJ file, without opening a window.
+ */
+
+#include "../Mesh.h"
+#include "../DiamondSquareGenerator.h"
+#include "../NoiseGenerator.h"
+#include "../SpectralGenerator.h"
+#include "../TileGenerator.h"
+#include "../Parallel.h"
+#include "ShardCoordinator.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+/* Default number of quads along each side, so the diamond-square fills */
+/* the whole lattice.                                                   */
+#define DEFAULT_SIZE 1024
+
+/* Default width and depth, and range of the heights. */
+#define DEFAULT_EXTENT 10.0f
+#define DEFAULT_RANGE 4.0f
+
+/* Default size in megabytes a heightfield must reach to be kept in a file */
+/* with --out-of-core.                                                     */
+#define DEFAULT_OUT_OF_CORE_MB 1024
+
+/* Options of a generated heightfield. */
+struct GeneratorOptions
+{
+	/* Name of the generator. */
+	const char* generator;
+	/* Number of quads along each side. */
+	unsigned int size;
+	/* Width and depth of the heightfield, and range of its heights. */
+	float extent, range;
+	/* Seed of the generator. */
+	unsigned int seed;
+	/* Factor the displacement or amplitude shrinks by each level. */
+	float roughness;
+	/* Octaves, frequency, and lacunarity of the noise. */
+	unsigned int octaves;
+	float frequency, lacunarity;
+	/* Exponent of the spectrum. */
+	float beta;
+	/* Number of times the heightfield is fractalized. */
+	unsigned int fractalize;
+	/* Whether a tile of a world is generated, and its row and column. */
+	bool tiled;
+	int tileRow, tileCol;
+	/* Number of rows and columns of tiles of a sharded world, 0 if the */
+	/* world is not sharded.                                            */
+	unsigned int worldRows, worldCols;
+	/* Worker processes of a sharded world, and the attempts of each of */
+	/* its shards.                                                      */
+	unsigned int workers, attempts;
+	/* Whether the tiles of a sharded world are stitched into one OBJ. */
+	bool stitch;
+	/* Threads to generate with, 0 for all of them. */
+	unsigned int threads;
+	/* Directory large heightfields are kept in instead of the memory, */
+	/* NULL to keep them all in memory, and the megabytes they must    */
+	/* reach to be kept there.                                         */
+	const char* outOfCore;
+	unsigned int outOfCoreMB;
+	/* File the OBJ is saved to. */
+	const char* output;
+};
+
+/* Color of the generated meshes. */
+static const Color meshColor = Color(BLUE);
+
+/* The noise generators, in the order of NoiseType. */
+static const char* noiseNames[] = {"fbm", "ridged", "billow"};
+#define NUM_NOISE_NAMES (sizeof(noiseNames) / sizeof(noiseNames[0]))
+
+/* Options only read by the coordinator of a sharded world, which are not */
+/* passed on to its workers, besides --stitch.                            */
+static const char* coordinatorOptions[] = {"--world-rows", "--world-cols",
+	"--workers", "--attempts", "--threads"};
+#define NUM_COORDINATOR_OPTIONS (sizeof(coordinatorOptions) / \
+	sizeof(coordinatorOptions[0]))
+
+/* Returns the NoiseType of the generator with the given name, or -1 if it */
+/* is not a noise generator.                                               */
+static int noiseType(const char* generator)
+{
+	for (unsigned int i = 0; i < NUM_NOISE_NAMES; i++)
+	{
+		if(strcmp(generator, noiseNames[i]) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Prints how to run the generator. */
+static void printUsage(const char* program)
+{
+	NoiseSettings noise;
+	SpectralSettings spectral;
+	std::cout << "Usage: " << program << " [options] <output.obj>"
+			<< std::endl
+		<< "  --generator NAME    diamond-square, fbm, ridged, billow, or "
+			<< "spectral" << std::endl
+		<< "                      (default diamond-square)" << std::endl
+		<< "  --size N            quads along each side (default "
+			<< DEFAULT_SIZE << ")" << std::endl
+		<< "  --extent W          width and depth (default "
+			<< DEFAULT_EXTENT << ")" << std::endl
+		<< "  --range R           range of the heights (default "
+			<< DEFAULT_RANGE << ")" << std::endl
+		<< "  --seed N            seed of the generator (default 0)"
+			<< std::endl
+		<< "  --roughness R       diamond-square roughness or noise gain "
+			<< "(default " << DEFAULT_ROUGHNESS << ")" << std::endl
+		<< "  --octaves N         octaves of the noise (default "
+			<< noise.octaves << ")" << std::endl
+		<< "  --frequency F       frequency of the first octave (default "
+			<< noise.frequency << ")" << std::endl
+		<< "  --lacunarity L      frequency factor of each octave (default "
+			<< noise.lacunarity << ")" << std::endl
+		<< "  --beta B            exponent of the spectrum (default "
+			<< spectral.beta << ")" << std::endl
+		<< "  --fractalize N      times to fractalize (default 0)"
+			<< std::endl
+		<< "  --tile-row R        generate the tile at row R of the world"
+			<< std::endl
+		<< "  --tile-col C        generate the tile at column C of the world"
+			<< std::endl
+		<< "  --threads N         threads to generate with (default all)"
+			<< std::endl
+		<< "  --world-rows N      shard a world of N rows of tiles" << std::endl
+		<< "  --world-cols N      shard a world of N columns of tiles"
+			<< std::endl
+		<< "  --workers N         worker processes of the shards (default one "
+			<< "per processor)" << std::endl
+		<< "  --attempts N        times a shard is tried (default "
+			<< DEFAULT_SHARD_ATTEMPTS << ")" << std::endl
+		<< "  --stitch            stitch the shards into the output OBJ"
+			<< std::endl
+		<< "  --out-of-core DIR   keep large heightfields in files in DIR"
+			<< std::endl
+		<< "  --out-of-core-mb N  megabytes a heightfield must reach to be "
+			<< "kept in a file" << std::endl
+		<< "                      (default " << DEFAULT_OUT_OF_CORE_MB << ")"
+			<< std::endl;
+}
+
+/* Parses the options, returning false if they are not valid. */
+static bool parseOptions(int argc, char* argv[], GeneratorOptions& options)
+{
+	NoiseSettings noise;
+	SpectralSettings spectral;
+	options.generator = "diamond-square";
+	options.size = DEFAULT_SIZE;
+	options.extent = DEFAULT_EXTENT;
+	options.range = DEFAULT_RANGE;
+	options.seed = 0;
+	options.roughness = DEFAULT_ROUGHNESS;
+	options.octaves = noise.octaves;
+	options.frequency = noise.frequency;
+	options.lacunarity = noise.lacunarity;
+	options.beta = spectral.beta;
+	options.fractalize = 0;
+	options.tiled = false;
+	options.tileRow = options.tileCol = 0;
+	options.worldRows = options.worldCols = 0;
+	options.workers = 0;
+	options.attempts = DEFAULT_SHARD_ATTEMPTS;
+	options.stitch = false;
+	options.threads = 0;
+	options.outOfCore = NULL;
+	options.outOfCoreMB = DEFAULT_OUT_OF_CORE_MB;
+	options.output = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if(strncmp(argv[i], "--", 2) != 0)
+		{
+			options.output = argv[i];
+			continue;
+		}
+		if(strcmp(argv[i], "--stitch") == 0)
+		{
+			options.stitch = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+		{
+			return false;
+		}
+		if(strcmp(argv[i], "--generator") == 0)
+		{
+			options.generator = argv[++i];
+		}
+		else if(strcmp(argv[i], "--size") == 0)
+		{
+			options.size = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--extent") == 0)
+		{
+			options.extent = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--range") == 0)
+		{
+			options.range = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--seed") == 0)
+		{
+			options.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if(strcmp(argv[i], "--roughness") == 0)
+		{
+			options.roughness = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--octaves") == 0)
+		{
+			options.octaves = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--frequency") == 0)
+		{
+			options.frequency = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--lacunarity") == 0)
+		{
+			options.lacunarity = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--beta") == 0)
+		{
+			options.beta = (float)atof(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--fractalize") == 0)
+		{
+			options.fractalize = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--tile-row") == 0)
+		{
+			options.tiled = true;
+			options.tileRow = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--tile-col") == 0)
+		{
+			options.tiled = true;
+			options.tileCol = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--threads") == 0)
+		{
+			options.threads = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--world-rows") == 0)
+		{
+			options.worldRows = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--world-cols") == 0)
+		{
+			options.worldCols = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--workers") == 0)
+		{
+			options.workers = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--attempts") == 0)
+		{
+			options.attempts = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--out-of-core") == 0)
+		{
+			options.outOfCore = argv[++i];
+		}
+		else if(strcmp(argv[i], "--out-of-core-mb") == 0)
+		{
+			options.outOfCoreMB = atoi(argv[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	/* A sharded world has both rows and columns, and generates its own */
+	/* tiles.                                                           */
+	bool sharded = options.worldRows > 0 || options.worldCols > 0;
+	if(sharded && (options.worldRows == 0 || options.worldCols == 0 ||
+		options.tiled || options.attempts == 0))
+	{
+		return false;
+	}
+	return options.output != NULL && options.size > 0 &&
+		options.extent > 0;
+}
+
+/* Returns a new heightfield made by the generator named by the options, */
+/* or NULL if there is no such generator or it can not make the tile.    */
+/* The noise is position keyed, so a tile of it is generated from the    */
+/* world's rows and columns and moved to its place in the world, where   */
+/* its edges match the tiles around it.                                  */
+static Mesh* generate(const GeneratorOptions& options)
+{
+	int type = noiseType(options.generator);
+	if(type >= 0)
+	{
+		NoiseSettings noise;
+		noise.type = (NoiseType)type;
+		noise.octaves = options.octaves;
+		noise.frequency = options.frequency;
+		noise.lacunarity = options.lacunarity;
+		noise.gain = options.roughness;
+		TileSettings tiles;
+		tiles.quads = options.size;
+		tiles.width = options.extent;
+		tiles.range = options.range;
+		tiles.fractalizeIterations = options.fractalize;
+		Mesh* mesh = TileGenerator(options.seed, noise, tiles).generate(
+			options.tileRow, options.tileCol, &meshColor);
+		if(options.tiled)
+		{
+			mesh->transform(mat4::translation3D((options.tileCol + 0.5f) *
+				options.extent, 0, (options.tileRow + 0.5f) *
+				options.extent));
+		}
+		return mesh;
+	}
+
+	/* The other generators fill the whole heightfield at once. */
+	if(options.tiled)
+	{
+		std::cerr << options.generator << " is not position keyed, so it "
+			<< "can not generate tiles" << std::endl;
+		return NULL;
+	}
+	Mesh* mesh = new Mesh(options.size, options.size, options.extent,
+		options.extent, &meshColor);
+	if(strcmp(options.generator, "diamond-square") == 0)
+	{
+		DiamondSquareGenerator(options.seed, options.roughness).fill(mesh,
+			options.range);
+	}
+	else if(strcmp(options.generator, "spectral") == 0)
+	{
+		SpectralSettings settings;
+		settings.beta = options.beta;
+		SpectralGenerator(options.seed, settings).fill(mesh, options.range);
+	}
+	else
+	{
+		std::cerr << "Unknown generator " << options.generator << std::endl;
+		delete mesh;
+		return NULL;
+	}
+	return TileGenerator::fractalize(mesh, options.seed, options.fractalize,
+		0, 0);
+}
+
+/* Returns the seconds since the given time. */
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+		start).count();
+}
+
+/* Generates the sharded world given by the options, each of its tiles  */
+/* in a worker process running this program with the same options and   */
+/* the tile's row and column. Writes a manifest of the shards, and      */
+/* stitches the tiles into the output if asked to. Returns the exit     */
+/* code of the program.                                                 */
+static int generateShards(int argc, char* argv[],
+	const GeneratorOptions& options)
+{
+	if(noiseType(options.generator) < 0)
+	{
+		std::cerr << options.generator << " is not position keyed, so it "
+			<< "can not generate tiles" << std::endl;
+		return 1;
+	}
+
+	ShardJob job;
+	job.program = ShardCoordinator::currentProgram(argv[0]);
+	for (int i = 1; i < argc; i++)
+	{
+		if(strncmp(argv[i], "--", 2) != 0 || strcmp(argv[i], "--stitch") == 0)
+		{
+			continue;
+		}
+		bool passed = true;
+		for (unsigned int j = 0; j < NUM_COORDINATOR_OPTIONS; j++)
+		{
+			passed = passed && strcmp(argv[i], coordinatorOptions[j]) != 0;
+		}
+		if(passed)
+		{
+			job.arguments.push_back(argv[i]);
+			job.arguments.push_back(argv[i + 1]);
+		}
+		i++;
+	}
+	job.rows = options.worldRows;
+	job.cols = options.worldCols;
+	job.tileVertices = (options.size << options.fractalize) + 1;
+	job.workers = options.workers;
+	job.threads = options.threads;
+	job.maxAttempts = options.attempts;
+	job.output = options.output;
+
+	ShardCoordinator coordinator(job);
+	std::cout << "Generating " << job.rows * job.cols << " tiles across "
+		<< coordinator.getNodeCount() << " NUMA nodes" << std::endl;
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
+	bool generated = coordinator.run();
+	double seconds = secondsSince(start);
+	if(!coordinator.writeManifest())
+	{
+		return 1;
+	}
+	if(!generated)
+	{
+		std::cerr << "Not every tile could be generated, see "
+			<< coordinator.getManifestFilename() << std::endl;
+		return 1;
+	}
+	std::cout << "Generated " << job.rows * job.cols << " tiles in "
+		<< seconds << " s" << std::endl;
+
+	if(options.stitch)
+	{
+		start = std::chrono::steady_clock::now();
+		if(!coordinator.stitch())
+		{
+			return 1;
+		}
+		std::cout << "Stitched " << options.output << " in "
+			<< secondsSince(start) << " s" << std::endl;
+	}
+	return 0;
+}
+
+/* Generates the heightfield given by the arguments and saves it. */
+int main(int argc, char* argv[])
+{
+	GeneratorOptions options;
+	if(!parseOptions(argc, argv, options))
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+	if(options.worldRows > 0)
+	{
+		return generateShards(argc, argv, options);
+	}
+	Parallel::setThreadCount(options.threads);
+	Mesh::setOutOfCore(options.outOfCore, 
+		(unsigned long long)options.outOfCoreMB << 20);
+
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
+	Mesh* mesh = generate(options);
+	if(!mesh)
+	{
+		return 1;
+	}
+	std::cout << "Generated " << mesh->getRows() << " x " << mesh->getCols()
+		<< " vertices with " << options.generator << " in "
+		<< secondsSince(start) << " s" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	bool saved = mesh->saveOBJ(options.output);
+	delete mesh;
+	if(!saved)
+	{
+		std::cerr << "Could not save " << options.output << std::endl;
+		return 1;
+	}
+	std::cout << "Saved " << options.output << " in " << secondsSince(start)
+		<< " s" << std::endl;
+	return 0;
+}
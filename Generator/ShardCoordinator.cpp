@@ -0,0 +1,781 @@
+/*
+ * ShardCoordinator.cpp
+ * Created by Zachary Ferguson
+ * Source file for the ShardCoordinator class, which generates a large world
+ * a tile at a time in worker processes spread across the NUMA nodes.
+ */
+
+#include "ShardCoordinator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#endif
+
+/* Size of the buffer the stitched OBJ is written through. */
+#define STITCH_BUFFER_SIZE (1 << 20)
+
+/* Creates the default parameters. */
+ShardJob::ShardJob()
+{
+	this->rows = this->cols = 1;
+	this->tileVertices = 2;
+	this->snowCapHeight = 100;
+	this->workers = 0;
+	this->threads = 0;
+	this->maxAttempts = DEFAULT_SHARD_ATTEMPTS;
+}
+
+/* Returns the file name without its extension. */
+static std::string withoutExtension(const std::string& filename)
+{
+	size_t dot = filename.rfind('.');
+	size_t slash = filename.find_last_of("/\\");
+	if(dot == std::string::npos || (slash != std::string::npos &&
+		dot < slash))
+	{
+		return filename;
+	}
+	return filename.substr(0, dot);
+}
+
+/* Returns the file name without its directory. */
+static std::string withoutDirectory(const std::string& filename)
+{
+	size_t slash = filename.find_last_of("/\\");
+	return (slash == std::string::npos) ? filename :
+		filename.substr(slash + 1);
+}
+
+/* Returns the number as text. */
+static std::string toString(long long number)
+{
+	std::ostringstream text;
+	text << number;
+	return text.str();
+}
+
+/* Returns the text as a JSON string, escaping its quotes and backslashes. */
+static std::string jsonString(const std::string& text)
+{
+	std::string escaped = "\"";
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if(text[i] == '"' || text[i] == '\\')
+		{
+			escaped += '\\';
+		}
+		escaped += text[i];
+	}
+	return escaped + "\"";
+}
+
+/* Returns the processors in a list such as "0-3,8-11". */
+static std::vector<unsigned int> parseProcessorList(const std::string& list)
+{
+	std::vector<unsigned int> processors;
+	std::stringstream stream(list);
+	std::string range;
+	while(std::getline(stream, range, ','))
+	{
+		unsigned int first, last;
+		int count = sscanf(range.c_str(), "%u-%u", &first, &last);
+		if(count < 1)
+		{
+			continue;
+		}
+		if(count == 1)
+		{
+			last = first;
+		}
+		for (unsigned int processor = first; processor <= last; processor++)
+		{
+			processors.push_back(processor);
+		}
+	}
+	return processors;
+}
+
+/* Creates a coordinator of the given job. */
+ShardCoordinator::ShardCoordinator(const ShardJob& job) : job(job)
+{
+	this->nodes = findNodes();
+	for (unsigned int row = 0; row < job.rows; row++)
+	{
+		for (unsigned int col = 0; col < job.cols; col++)
+		{
+			Shard shard;
+			shard.row = row;
+			shard.col = col;
+			shard.filename = this->tileFilename(row, col);
+			shard.attempts = 0;
+			shard.node = 0;
+			shard.seconds = 0;
+			shard.done = false;
+			this->shards.push_back(shard);
+		}
+	}
+}
+
+/* Returns the processors of each NUMA node this process may run on. */
+/* Without NUMA there is a single node of every processor.           */
+std::vector<std::vector<unsigned int> > ShardCoordinator::findNodes()
+{
+	std::vector<std::vector<unsigned int> > nodes;
+#ifdef _WIN32
+	/* Only the processors of the process's group can be given to a  */
+	/* worker, so those beyond the affinity mask are left out.       */
+	DWORD_PTR processMask = 0, systemMask = 0;
+	ULONG highest = 0;
+	if(GetProcessAffinityMask(GetCurrentProcess(), &processMask,
+		&systemMask) && GetNumaHighestNodeNumber(&highest))
+	{
+		for (ULONG node = 0; node <= highest; node++)
+		{
+			ULONGLONG mask = 0;
+			if(!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+			{
+				continue;
+			}
+			std::vector<unsigned int> processors;
+			for (unsigned int processor = 0; processor <
+				sizeof(DWORD_PTR) * 8; processor++)
+			{
+				if((mask >> processor & 1) && (processMask >> processor & 1))
+				{
+					processors.push_back(processor);
+				}
+			}
+			if(!processors.empty())
+			{
+				nodes.push_back(processors);
+			}
+		}
+	}
+#elif defined(__linux__)
+	/* Each node is listed in sysfs with the processors it holds. Those */
+	/* the process is not allowed to run on are left out.               */
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	DIR* directory = opendir("/sys/devices/system/node");
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && directory)
+	{
+		std::vector<unsigned int> ids;
+		struct dirent* entry;
+		while((entry = readdir(directory)) != NULL)
+		{
+			unsigned int id;
+			char extra;
+			if(sscanf(entry->d_name, "node%u%c", &id, &extra) == 1)
+			{
+				ids.push_back(id);
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			std::ifstream listFile(("/sys/devices/system/node/node" +
+				toString(ids[i]) + "/cpulist").c_str());
+			std::string list;
+			std::getline(listFile, list);
+			std::vector<unsigned int> all = parseProcessorList(list);
+			std::vector<unsigned int> processors;
+			for (size_t j = 0; j < all.size(); j++)
+			{
+				if(all[j] < CPU_SETSIZE && CPU_ISSET(all[j], &allowed))
+				{
+					processors.push_back(all[j]);
+				}
+			}
+			if(!processors.empty())
+			{
+				nodes.push_back(processors);
+			}
+		}
+	}
+	if(directory)
+	{
+		closedir(directory);
+	}
+#endif
+	if(nodes.empty())
+	{
+		unsigned int count = std::max(1u,
+			std::thread::hardware_concurrency());
+		nodes.push_back(std::vector<unsigned int>());
+		for (unsigned int processor = 0; processor < count; processor++)
+		{
+			nodes[0].push_back(processor);
+		}
+	}
+	return nodes;
+}
+
+/* Returns the file of the tile at the given row and column. */
+std::string ShardCoordinator::tileFilename(int row, int col) const
+{
+	return withoutExtension(this->job.output) + "_" + toString(row) + "_" +
+		toString(col) + ".obj";
+}
+
+#ifdef _WIN32
+/* Returns the argument quoted for a Windows command line, so spaces and */
+/* quotes inside it reach the worker unchanged.                          */
+static std::string quoteArgument(const std::string& argument)
+{
+	if(!argument.empty() && argument.find_first_of(" \t\"") ==
+		std::string::npos)
+	{
+		return argument;
+	}
+	std::string quoted = "\"";
+	size_t backslashes = 0;
+	for (size_t i = 0; i < argument.size(); i++)
+	{
+		if(argument[i] == '\\')
+		{
+			backslashes++;
+			continue;
+		}
+		/* Backslashes are only escaped in front of a quote. */
+		quoted.append((argument[i] == '"') ? backslashes * 2 + 1 :
+			backslashes, '\\');
+		quoted += argument[i];
+		backslashes = 0;
+	}
+	quoted.append(backslashes * 2, '\\');
+	return quoted + "\"";
+}
+#endif
+
+/* Starts a worker generating the shard with the given threads on the  */
+/* given node. Returns false if it could not be started.               */
+bool ShardCoordinator::startWorker(const Shard& shard, unsigned int node,
+	unsigned int threads, WorkerProcess& process) const
+{
+	std::vector<std::string> arguments = this->job.arguments;
+	arguments.push_back("--tile-row");
+	arguments.push_back(toString(shard.row));
+	arguments.push_back("--tile-col");
+	arguments.push_back(toString(shard.col));
+	arguments.push_back("--threads");
+	arguments.push_back(toString(threads));
+	arguments.push_back(shard.filename);
+	const std::vector<unsigned int>& processors = this->nodes[node];
+
+#ifdef _WIN32
+	std::string commandLine = quoteArgument(this->job.program);
+	for (size_t i = 0; i < arguments.size(); i++)
+	{
+		commandLine += " " + quoteArgument(arguments[i]);
+	}
+	std::vector<char> line(commandLine.begin(), commandLine.end());
+	line.push_back('\0');
+
+	/* Start the worker suspended so it is pinned to its node before it */
+	/* allocates any memory.                                            */
+	STARTUPINFOA startup;
+	ZeroMemory(&startup, sizeof(startup));
+	startup.cb = sizeof(startup);
+	PROCESS_INFORMATION info;
+	if(!CreateProcessA(this->job.program.c_str(), &line[0], NULL, NULL,
+		FALSE, CREATE_SUSPENDED, NULL, NULL, &startup, &info))
+	{
+		return false;
+	}
+	if(this->nodes.size() > 1)
+	{
+		DWORD_PTR mask = 0;
+		for (size_t i = 0; i < processors.size(); i++)
+		{
+			mask |= (DWORD_PTR)1 << processors[i];
+		}
+		SetProcessAffinityMask(info.hProcess, mask);
+	}
+	ResumeThread(info.hThread);
+	CloseHandle(info.hThread);
+	process = info.hProcess;
+	return true;
+#else
+	/* Everything the child needs is made before the fork, so it only */
+	/* pins itself and runs the worker.                               */
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(this->job.program.c_str()));
+	for (size_t i = 0; i < arguments.size(); i++)
+	{
+		argv.push_back(const_cast<char*>(arguments[i].c_str()));
+	}
+	argv.push_back(NULL);
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (size_t i = 0; i < processors.size(); i++)
+	{
+		CPU_SET(processors[i], &set);
+	}
+#endif
+
+	pid_t pid = fork();
+	if(pid < 0)
+	{
+		return false;
+	}
+	if(pid == 0)
+	{
+#ifdef __linux__
+		/* Pages are placed on the node of the processor that first */
+		/* touches them, so a pinned worker fills its tile in the   */
+		/* memory nearest to it.                                    */
+		if(this->nodes.size() > 1)
+		{
+			sched_setaffinity(0, sizeof(set), &set);
+		}
+#else
+		(void)processors;
+#endif
+		execv(argv[0], &argv[0]);
+		_exit(127);
+	}
+	process = pid;
+	return true;
+#endif
+}
+
+/* Waits for one of the workers to exit. Returns its index and whether it */
+/* exited successfully, or the number of workers if none could be waited  */
+/* for.                                                                   */
+size_t ShardCoordinator::waitForWorker(const std::vector<WorkerProcess>&
+	processes, bool& succeeded)
+{
+	succeeded = false;
+#ifdef _WIN32
+	DWORD index = WaitForMultipleObjects((DWORD)processes.size(),
+		&processes[0], FALSE, INFINITE) - WAIT_OBJECT_0;
+	if(index >= processes.size())
+	{
+		return processes.size();
+	}
+	DWORD exitCode = 1;
+	GetExitCodeProcess(processes[index], &exitCode);
+	CloseHandle(processes[index]);
+	succeeded = exitCode == 0;
+	return index;
+#else
+	for (;;)
+	{
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if(pid < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return processes.size();
+		}
+		for (size_t i = 0; i < processes.size(); i++)
+		{
+			if(processes[i] == pid)
+			{
+				succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+				return i;
+			}
+		}
+	}
+#endif
+}
+
+/* Returns the path of the running program, used to start the workers, or */
+/* the given name if it can not be found.                                 */
+std::string ShardCoordinator::currentProgram(const char* name)
+{
+#ifdef _WIN32
+	char path[MAX_PATH];
+	DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+	if(length > 0 && length < MAX_PATH)
+	{
+		return std::string(path, length);
+	}
+#elif defined(__linux__)
+	char path[4096];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+	if(length > 0 && length < (ssize_t)sizeof(path))
+	{
+		return std::string(path, length);
+	}
+#endif
+	return name;
+}
+
+/* Generates every shard, running up to the job's number of workers at  */
+/* once. Each worker's slot is given a node round robin, so the workers */
+/* are spread evenly across the nodes. A failed shard is queued again   */
+/* until it runs out of attempts. Returns true if every shard was       */
+/* generated.                                                           */
+bool ShardCoordinator::run()
+{
+	unsigned int workers = this->job.workers;
+	if(workers == 0)
+	{
+		for (size_t i = 0; i < this->nodes.size(); i++)
+		{
+			workers += (unsigned int)this->nodes[i].size();
+		}
+	}
+	workers = std::max(1u, std::min(workers,
+		(unsigned int)this->shards.size()));
+#ifdef _WIN32
+	workers = std::min(workers, (unsigned int)MAXIMUM_WAIT_OBJECTS);
+#endif
+
+	/* Find the node and threads of each slot. Unless the threads are */
+	/* given, a node's processors are split between its workers.      */
+	std::vector<unsigned int> slotNodes(workers), slotThreads(workers);
+	std::vector<unsigned int> nodeWorkers(this->nodes.size(), 0);
+	for (unsigned int slot = 0; slot < workers; slot++)
+	{
+		slotNodes[slot] = slot % this->nodes.size();
+		nodeWorkers[slotNodes[slot]]++;
+	}
+	for (unsigned int slot = 0; slot < workers; slot++)
+	{
+		unsigned int node = slotNodes[slot];
+		slotThreads[slot] = (this->job.threads > 0) ? this->job.threads :
+			std::max(1u, (unsigned int)this->nodes[node].size() /
+			nodeWorkers[node]);
+	}
+
+	std::deque<size_t> pending;
+	for (size_t i = 0; i < this->shards.size(); i++)
+	{
+		pending.push_back(i);
+	}
+	std::vector<unsigned int> freeSlots;
+	for (unsigned int slot = workers; slot > 0; slot--)
+	{
+		freeSlots.push_back(slot - 1);
+	}
+
+	/* The running workers, with their shards, slots, and start times. */
+	std::vector<WorkerProcess> processes;
+	std::vector<size_t> runningShards;
+	std::vector<unsigned int> runningSlots;
+	std::vector<std::chrono::steady_clock::time_point> startTimes;
+
+	while(!pending.empty() || !processes.empty())
+	{
+		while(!pending.empty() && !freeSlots.empty())
+		{
+			size_t index = pending.front();
+			pending.pop_front();
+			unsigned int slot = freeSlots.back();
+			Shard& shard = this->shards[index];
+			shard.attempts++;
+			shard.node = slotNodes[slot];
+			WorkerProcess process;
+			if(!this->startWorker(shard, shard.node, slotThreads[slot],
+				process))
+			{
+				std::cerr << "Could not start the worker of tile " <<
+					shard.row << ", " << shard.col << std::endl;
+				if(shard.attempts < this->job.maxAttempts)
+				{
+					pending.push_back(index);
+				}
+				continue;
+			}
+			freeSlots.pop_back();
+			processes.push_back(process);
+			runningShards.push_back(index);
+			runningSlots.push_back(slot);
+			startTimes.push_back(std::chrono::steady_clock::now());
+		}
+		if(processes.empty())
+		{
+			continue;
+		}
+
+		bool succeeded;
+		size_t i = waitForWorker(processes, succeeded);
+		if(i >= processes.size())
+		{
+			std::cerr << "Could not wait for the workers" << std::endl;
+			return false;
+		}
+		Shard& shard = this->shards[runningShards[i]];
+		shard.seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - startTimes[i]).count();
+		shard.done = succeeded &&
+			std::ifstream(shard.filename.c_str()).is_open();
+		if(shard.done)
+		{
+			std::cout << "Generated tile " << shard.row << ", " << shard.col
+				<< " on node " << shard.node << " in " << shard.seconds
+				<< " s" << std::endl;
+		}
+		else
+		{
+			std::cerr << "Worker of tile " << shard.row << ", " << shard.col
+				<< " failed on attempt " << shard.attempts << std::endl;
+			if(shard.attempts < this->job.maxAttempts)
+			{
+				pending.push_back(runningShards[i]);
+			}
+		}
+
+		/* Free the worker's slot for the next shard. */
+		freeSlots.push_back(runningSlots[i]);
+		processes[i] = processes.back();
+		processes.pop_back();
+		runningShards[i] = runningShards.back();
+		runningShards.pop_back();
+		runningSlots[i] = runningSlots.back();
+		runningSlots.pop_back();
+		startTimes[i] = startTimes.back();
+		startTimes.pop_back();
+	}
+
+	for (size_t i = 0; i < this->shards.size(); i++)
+	{
+		if(!this->shards[i].done)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Writes the job and the state of every shard to the manifest. Returns */
+/* true if the file was written.                                        */
+bool ShardCoordinator::writeManifest() const
+{
+	std::string filename = this->getManifestFilename();
+	std::ofstream outFile(filename.c_str(), std::ios::out);
+	if(!(outFile.is_open()))
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		return false;
+	}
+
+	std::string arguments;
+	for (size_t i = 0; i < this->job.arguments.size(); i++)
+	{
+		arguments += ((i > 0) ? " " : "") + this->job.arguments[i];
+	}
+	outFile.precision(9);
+	outFile << "{" << std::endl
+		<< "  \"arguments\": " << jsonString(arguments) << "," << std::endl
+		<< "  \"rows\": " << this->job.rows << "," << std::endl
+		<< "  \"cols\": " << this->job.cols << "," << std::endl
+		<< "  \"tileVertices\": " << this->job.tileVertices << ","
+			<< std::endl
+		<< "  \"nodes\": " << this->nodes.size() << "," << std::endl
+		<< "  \"output\": " << jsonString(this->job.output) << ","
+			<< std::endl
+		<< "  \"shards\": [" << std::endl;
+	for (size_t i = 0; i < this->shards.size(); i++)
+	{
+		const Shard& shard = this->shards[i];
+		outFile << "    {\"row\": " << shard.row << ", "
+			<< "\"col\": " << shard.col << ", "
+			<< "\"file\": " << jsonString(shard.filename) << ", "
+			<< "\"attempts\": " << shard.attempts << ", "
+			<< "\"node\": " << shard.node << ", "
+			<< "\"seconds\": " << shard.seconds << ", "
+			<< "\"done\": " << (shard.done ? "true" : "false") << "}"
+			<< ((i + 1 < this->shards.size()) ? "," : "") << std::endl;
+	}
+	outFile << "  ]" << std::endl << "}" << std::endl;
+
+	outFile.close();
+	return !outFile.fail();
+}
+
+/* Reads lines from the OBJ until its next vertex. Returns false if there */
+/* are no more vertices.                                                  */
+static bool nextVertex(std::istream& objFile, std::string& line)
+{
+	while(std::getline(objFile, line))
+	{
+		if(line.compare(0, 2, "v ") == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Stitches the generated tiles into the job's output OBJ, dropping the */
+/* rows and columns neighbouring tiles share. The tiles are read a row  */
+/* of tiles at a time, and each row of faces is written as soon as the  */
+/* vertices below it are, so only two rows of heights are kept. Returns */
+/* true if the OBJ was written.                                         */
+bool ShardCoordinator::stitch() const
+{
+	const unsigned int n = this->job.tileVertices;
+	const unsigned long long worldRows =
+		(unsigned long long)this->job.rows * (n - 1) + 1;
+	const unsigned long long worldCols =
+		(unsigned long long)this->job.cols * (n - 1) + 1;
+
+	/* Every tile has the same materials. */
+	std::string mtlFilename = withoutExtension(this->job.output) + ".mtl";
+	std::ifstream tileMtl((withoutExtension(this->shards[0].filename) +
+		".mtl").c_str(), std::ios::in | std::ios::binary);
+	std::ofstream mtlFile(mtlFilename.c_str(), std::ios::out |
+		std::ios::binary);
+	if(!tileMtl.is_open() || !mtlFile.is_open())
+	{
+		std::cout << "Unable to save to " << mtlFilename << std::endl;
+		return false;
+	}
+	mtlFile << tileMtl.rdbuf();
+	mtlFile.close();
+
+	char* exportBuffer = new char[STITCH_BUFFER_SIZE];
+	std::ofstream objFile;
+	objFile.rdbuf()->pubsetbuf(exportBuffer, STITCH_BUFFER_SIZE);
+	objFile.open(this->job.output.c_str(), std::ios::out);
+	if(!(objFile.is_open()))
+	{
+		std::cout << "Unable to save to " << this->job.output << std::endl;
+		delete[] exportBuffer;
+		return false;
+	}
+
+	/* Write out the header. */
+	objFile << "########################################################"
+			<< std::endl << "#"<< std::endl;
+	objFile << "# Created with Mesh Modeler(Copyright Zachary Ferguson)"
+		<< std::endl;
+	objFile << "#" << std::endl
+			<< "########################################################"
+			<< std::endl;
+	objFile << "#" << std::endl
+			<< "# Vertices: " << worldRows * worldCols << std::endl
+			<< "# Faces: " << 2 * (worldRows - 1) * (worldCols - 1)
+			<< std::endl
+			<< "#" << std::endl
+			<< "########################################################"
+			<< std::endl;
+	objFile << "mtllib " << withoutDirectory(mtlFilename) << std::endl;
+
+	std::ifstream* tiles = new std::ifstream[this->job.cols];
+	std::vector<float> heights((size_t)worldCols),
+		previousHeights((size_t)worldCols);
+	std::string line;
+	bool read = true;
+	unsigned long long row = 0;
+	for (unsigned int tileRow = 0; tileRow < this->job.rows && read;
+		tileRow++)
+	{
+		for (unsigned int tileCol = 0; tileCol < this->job.cols; tileCol++)
+		{
+			const Shard& shard = this->shards[tileRow * this->job.cols +
+				tileCol];
+			tiles[tileCol].close();
+			tiles[tileCol].clear();
+			tiles[tileCol].open(shard.filename.c_str(), std::ios::in);
+			read = read && tiles[tileCol].is_open();
+		}
+
+		/* The first row of every tile but the first is the last row of */
+		/* the tile above, and the first column of every tile but the   */
+		/* first is the last column of the tile before it.              */
+		for (unsigned int r = 0; r < n && read; r++)
+		{
+			bool shared = tileRow > 0 && r == 0;
+			size_t col = 0;
+			for (unsigned int tileCol = 0; tileCol < this->job.cols && read;
+				tileCol++)
+			{
+				for (unsigned int c = 0; c < n; c++)
+				{
+					if(!nextVertex(tiles[tileCol], line))
+					{
+						read = false;
+						break;
+					}
+					if(shared || (tileCol > 0 && c == 0))
+					{
+						continue;
+					}
+					objFile << line << '\n';
+					float x, height;
+					sscanf(line.c_str(), "v %f %f", &x, &height);
+					heights[col++] = height;
+				}
+			}
+			if(!read || shared)
+			{
+				continue;
+			}
+
+			/* Write out the faces above the row, as Mesh::saveOBJ does. */
+			for (unsigned long long c = 1; row > 0 && c < worldCols; c++)
+			{
+				unsigned long long v1 = (row - 1) * worldCols + c;
+				unsigned long long v2 = v1 + 1;
+				unsigned long long v3 = v1 + worldCols;
+				unsigned long long v4 = v3 + 1;
+				objFile << ((previousHeights[(size_t)c - 1] >=
+					this->job.snowCapHeight) ? ("usemtl snow") :
+					("usemtl color")) << '\n';
+				objFile << "f " << v1 << " " << v4 << " " << v2 << '\n';
+				objFile << "f " << v1 << " " << v3 << " " << v4 << '\n';
+			}
+			heights.swap(previousHeights);
+			row++;
+		}
+	}
+	delete[] tiles;
+
+	/* A write that fails part way through, such as to a full disk, only */
+	/* shows once the files are closed.                                  */
+	objFile.close();
+	delete[] exportBuffer;
+	if(!read)
+	{
+		std::cerr << "Could not read the tiles to stitch" << std::endl;
+	}
+	else if(objFile.fail() || mtlFile.fail())
+	{
+		std::cout << "Unable to save to " << (objFile.fail() ?
+			this->job.output : mtlFilename) << std::endl;
+	}
+	return read && !objFile.fail() && !mtlFile.fail();
+}
+
+/* Returns the JSON file the manifest is written to, beside the output */
+/* OBJ.                                                                */
+std::string ShardCoordinator::getManifestFilename() const
+{
+	return withoutExtension(this->job.output) + "_manifest.json";
+}
+
+/* Returns the shards of the world. */
+const std::vector<Shard>& ShardCoordinator::getShards() const
+{
+	return this->shards;
+}
+
+/* Returns the number of NUMA nodes the workers are spread across. */
+unsigned int ShardCoordinator::getNodeCount() const
+{
+	return (unsigned int)this->nodes.size();
+}
@@ -0,0 +1,140 @@
+/*
+ * ShardCoordinator.h
+ * Created by Zachary Ferguson
+ * Header file for the ShardCoordinator class, which splits a large world into
+ * tiles and generates each tile, a shard, in its own worker process running
+ * the headless generator. The workers are spread across the NUMA nodes and
+ * pinned to their node's processors, so each process allocates and fills its
+ * tile in the memory nearest to it. A worker that fails only has its own
+ * shard run again. The tiles can then be stitched into one OBJ, and a
+ * manifest of the shards is written.
+ */
+
+#ifndef SHARDCOORDINATOR_H
+#define SHARDCOORDINATOR_H
+
+#include <string> /* Used for the file names and arguments. */
+#include <vector> /* Used to store the shards and nodes.     */
+
+/* Default number of times a shard's worker is started before it fails. */
+#define DEFAULT_SHARD_ATTEMPTS 3
+
+/* A running worker, a process handle on Windows and a process id */
+/* elsewhere.                                                     */
+#ifdef _WIN32
+typedef void* WorkerProcess;
+#else
+typedef int WorkerProcess;
+#endif
+
+/* A tile of the world generated by one worker process. */
+struct Shard
+{
+	/* Row and column of the tile in the world. */
+	int row, col;
+	/* OBJ file the worker saves the tile to. */
+	std::string filename;
+	/* Number of times a worker was started for the shard. */
+	unsigned int attempts;
+	/* NUMA node the last worker ran on. */
+	unsigned int node;
+	/* Seconds the last worker ran for. */
+	double seconds;
+	/* Whether a worker saved the tile. */
+	bool done;
+};
+
+/* Parameters of a sharded generation. */
+struct ShardJob
+{
+	/* Program the workers run, the headless generator. */
+	std::string program;
+	/* Arguments given to every worker, before the tile's row, column, */
+	/* threads, and output file.                                       */
+	std::vector<std::string> arguments;
+	/* Number of rows and columns of tiles in the world. */
+	unsigned int rows, cols;
+	/* Vertices along each side of a tile. */
+	unsigned int tileVertices;
+	/* Height the stitched OBJ's faces are given the snow material at. */
+	float snowCapHeight;
+	/* Worker processes run at once, 0 for one per processor. */
+	unsigned int workers;
+	/* Threads of each worker, 0 to split its node's processors between  */
+	/* the workers on the node.                                          */
+	unsigned int threads;
+	/* Number of times a shard's worker is started before it fails. */
+	unsigned int maxAttempts;
+	/* OBJ file of the world. The tiles are saved beside it, with their */
+	/* row and column appended to its name.                             */
+	std::string output;
+
+	/* Creates the default parameters. */
+	ShardJob();
+};
+
+class ShardCoordinator
+{
+	private:
+
+		/* Parameters of the generation. */
+		ShardJob job;
+		/* Shards of the world, row by row. */
+		std::vector<Shard> shards;
+		/* Processors of each NUMA node. */
+		std::vector<std::vector<unsigned int> > nodes;
+
+		/* Returns the processors of each NUMA node this process may run */
+		/* on. Without NUMA there is a single node of every processor.   */
+		static std::vector<std::vector<unsigned int> > findNodes();
+
+		/* Returns the file of the tile at the given row and column. */
+		std::string tileFilename(int row, int col) const;
+
+		/* Starts a worker generating the shard with the given threads on */
+		/* the given node. Returns false if it could not be started.      */
+		bool startWorker(const Shard& shard, unsigned int node,
+			unsigned int threads, WorkerProcess& process) const;
+
+		/* Waits for one of the workers to exit. Returns its index and */
+		/* whether it exited successfully, or the number of workers if */
+		/* none could be waited for.                                   */
+		static size_t waitForWorker(const std::vector<WorkerProcess>&
+			processes, bool& succeeded);
+
+	public:
+
+		/* Creates a coordinator of the given job. */
+		ShardCoordinator(const ShardJob& job);
+
+		/* Returns the path of the running program, used to start the */
+		/* workers, or the given name if it can not be found.         */
+		static std::string currentProgram(const char* name);
+
+		/* Generates every shard, running up to the job's number of workers */
+		/* at once. A failed shard is queued again until it runs out of     */
+		/* attempts. Returns true if every shard was generated.             */
+		bool run();
+
+		/* Writes the job and the state of every shard to the manifest. */
+		/* Returns true if the file was written.                        */
+		bool writeManifest() const;
+
+		/* Stitches the generated tiles into the job's output OBJ, dropping */
+		/* the rows and columns neighbouring tiles share. The tiles are     */
+		/* read a row of tiles at a time, so the world never has to fit in  */
+		/* memory. Returns true if the OBJ was written.                     */
+		bool stitch() const;
+
+		/* Returns the JSON file the manifest is written to, beside the */
+		/* output OBJ.                                                  */
+		std::string getManifestFilename() const;
+
+		/* Returns the shards of the world. */
+		const std::vector<Shard>& getShards() const;
+
+		/* Returns the number of NUMA nodes the workers are spread across. */
+		unsigned int getNodeCount() const;
+};
+
+#endif
@@ -0,0 +1,503 @@
+/*
+ * HydraulicErosion.cpp
+ * Created by Zachary Ferguson
+ * Source file for the HydraulicErosion class, a grid based simulation of
+ * rain wearing down a heightfield with the virtual pipe model of Mei et al.,
+ * "Fast Hydraulic Erosion Simulation and Visualization on GPU".
+ */
+
+#include "HydraulicErosion.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+/* Fewest vertices given to each thread by a pass. */
+#define VERTICES_PER_TASK 16384
+
+/* Water shallower than this is treated as dry when finding its velocity. */
+#define DRY_DEPTH 1e-6f
+
+/* Creates the default settings. */
+HydraulicErosionSettings::HydraulicErosionSettings()
+{
+	this->timeStep = 0.02f;
+	this->rainRate = 0.002f;
+	this->evaporationRate = 0.02f;
+	this->sedimentCapacity = 0.05f;
+	this->dissolveRate = 0.1f;
+	this->depositRate = 0.1f;
+	this->minSlope = 0.05f;
+	this->gravity = 9.81f;
+}
+
+/* Creates a simulation of the heights of the given mesh, with no water or */
+/* sediment.                                                               */
+HydraulicErosion::HydraulicErosion(const Mesh* mesh,
+	const HydraulicErosionSettings& settings)
+{
+	this->rows = mesh->getRows();
+	this->cols = mesh->getCols();
+	this->settings = settings;
+	/* The vertices are usually evenly spaced, but average the two in */
+	/* case the mesh was stretched.                                   */
+	this->spacing = 0.5f * (mesh->getWidth() / (this->cols - 1) +
+		mesh->getDepth() / (this->rows - 1));
+
+	size_t count = (size_t)this->rows * this->cols;
+	this->terrain.resize(count);
+	mesh->getHeights(this->terrain.data());
+	this->water.assign(count, 0.0f);
+	this->sediment.assign(count, 0.0f);
+	this->flowLeft.assign(count, 0.0f);
+	this->flowRight.assign(count, 0.0f);
+	this->flowUp.assign(count, 0.0f);
+	this->flowDown.assign(count, 0.0f);
+	this->velocityX.assign(count, 0.0f);
+	this->velocityZ.assign(count, 0.0f);
+	this->scratch.assign(count, 0.0f);
+	MemoryTracker::allocate(EROSION_FIELDS, this->bytes());
+}
+
+/* Deletes the fields. */
+HydraulicErosion::~HydraulicErosion()
+{
+	MemoryTracker::release(EROSION_FIELDS, this->bytes());
+}
+
+/* Returns the bytes held by the fields. */
+size_t HydraulicErosion::bytes() const
+{
+	return 11 * (size_t)this->rows * this->cols * sizeof(float);
+}
+
+/* Calls body(row) for every row, with the rows split across the threads. */
+/* Each pass only writes the fields of its own row, so rows can run in    */
+/* any order.                                                             */
+template <typename Body>
+void HydraulicErosion::forEachRow(const Body& body)
+{
+	size_t rowsPerTask = std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / this->cols));
+	Parallel::forRange(0, this->rows, rowsPerTask, [&](size_t begin,
+		size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			body((unsigned int)r);
+		}
+	});
+}
+
+/* Rains on every vertex, then accelerates the flow through the pipes to  */
+/* each neighbour by the difference in the water's surface height. The    */
+/* flow is scaled down where it would drain more water than the vertex    */
+/* holds. Pipes off the edge of the lattice carry no flow.                */
+void HydraulicErosion::updateFlow()
+{
+	TRACE_SCOPE("HydraulicErosion::updateFlow");
+	const unsigned int cols = this->cols;
+	const unsigned int rows = this->rows;
+	const float dt = this->settings.timeStep;
+	const float area = this->spacing * this->spacing;
+	/* Pipes are as wide as the spacing, so their cross section over */
+	/* their length is the spacing.                                  */
+	const float acceleration = dt * this->settings.gravity * this->spacing;
+	const float rain = this->settings.rainRate;
+
+	/* Rain on its own pass, since the flow reads the neighbours' water. */
+	this->forEachRow([&](unsigned int r)
+	{
+		float* water = &this->water[(size_t)r * cols];
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			water[c] += rain;
+		}
+	});
+
+	const float* terrain = &this->terrain[0];
+	const float* water = &this->water[0];
+	float* flowLeft = &this->flowLeft[0];
+	float* flowRight = &this->flowRight[0];
+	float* flowUp = &this->flowUp[0];
+	float* flowDown = &this->flowDown[0];
+
+	/* Updates the flow out of one vertex, which may be on the edge. */
+	auto flowAt = [&](unsigned int r, unsigned int c)
+	{
+		size_t i = (size_t)r * cols + c;
+		float height = terrain[i] + water[i];
+
+		float left = (c > 0) ? std::max(0.0f, flowLeft[i] +
+			acceleration * (height - terrain[i - 1] - water[i - 1])) : 0;
+		float right = (c + 1 < cols) ? std::max(0.0f, flowRight[i] +
+			acceleration * (height - terrain[i + 1] - water[i + 1])) : 0;
+		float up = (r > 0) ? std::max(0.0f, flowUp[i] + acceleration *
+			(height - terrain[i - cols] - water[i - cols])) : 0;
+		float down = (r + 1 < rows) ? std::max(0.0f, flowDown[i] +
+			acceleration * (height - terrain[i + cols] - water[i + cols])) :
+			0;
+
+		float out = (left + right + up + down) * dt;
+		float scale = std::min(1.0f, water[i] * area / std::max(out,
+			FLT_MIN));
+		flowLeft[i] = left * scale;
+		flowRight[i] = right * scale;
+		flowUp[i] = up * scale;
+		flowDown[i] = down * scale;
+	};
+
+	this->forEachRow([&](unsigned int r)
+	{
+		unsigned int c = 0;
+		if(r > 0 && r + 1 < rows)
+		{
+			flowAt(r, c++);
+#ifdef VEC4_USE_SSE
+			/* Vertices inside the edges have all four neighbours. */
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 tiny = _mm_set1_ps(FLT_MIN);
+			const __m128 a = _mm_set1_ps(acceleration);
+			const __m128 dts = _mm_set1_ps(dt);
+			const __m128 areas = _mm_set1_ps(area);
+			for (; c + 4 < cols; c += 4)
+			{
+				size_t i = (size_t)r * cols + c;
+				__m128 depth = _mm_loadu_ps(water + i);
+				__m128 height = _mm_add_ps(_mm_loadu_ps(terrain + i), depth);
+				__m128 left = _mm_max_ps(zero, _mm_add_ps(
+					_mm_loadu_ps(flowLeft + i), _mm_mul_ps(a, _mm_sub_ps(
+					height, _mm_add_ps(_mm_loadu_ps(terrain + i - 1),
+					_mm_loadu_ps(water + i - 1))))));
+				__m128 right = _mm_max_ps(zero, _mm_add_ps(
+					_mm_loadu_ps(flowRight + i), _mm_mul_ps(a, _mm_sub_ps(
+					height, _mm_add_ps(_mm_loadu_ps(terrain + i + 1),
+					_mm_loadu_ps(water + i + 1))))));
+				__m128 up = _mm_max_ps(zero, _mm_add_ps(
+					_mm_loadu_ps(flowUp + i), _mm_mul_ps(a, _mm_sub_ps(
+					height, _mm_add_ps(_mm_loadu_ps(terrain + i - cols),
+					_mm_loadu_ps(water + i - cols))))));
+				__m128 down = _mm_max_ps(zero, _mm_add_ps(
+					_mm_loadu_ps(flowDown + i), _mm_mul_ps(a, _mm_sub_ps(
+					height, _mm_add_ps(_mm_loadu_ps(terrain + i + cols),
+					_mm_loadu_ps(water + i + cols))))));
+
+				__m128 out = _mm_mul_ps(_mm_add_ps(_mm_add_ps(left, right),
+					_mm_add_ps(up, down)), dts);
+				__m128 scale = _mm_min_ps(one, _mm_div_ps(_mm_mul_ps(depth,
+					areas), _mm_max_ps(out, tiny)));
+				_mm_storeu_ps(flowLeft + i, _mm_mul_ps(left, scale));
+				_mm_storeu_ps(flowRight + i, _mm_mul_ps(right, scale));
+				_mm_storeu_ps(flowUp + i, _mm_mul_ps(up, scale));
+				_mm_storeu_ps(flowDown + i, _mm_mul_ps(down, scale));
+			}
+#endif
+		}
+		for (; c < cols; c++)
+		{
+			flowAt(r, c);
+		}
+	});
+}
+
+/* Moves the water by the flow into and out of each vertex and finds the */
+/* velocity of the water from the flow passing through it. The velocity  */
+/* is limited to one vertex per step so the sediment is never carried    */
+/* past a neighbour.                                                     */
+void HydraulicErosion::updateWater()
+{
+	TRACE_SCOPE("HydraulicErosion::updateWater");
+	const unsigned int cols = this->cols;
+	const unsigned int rows = this->rows;
+	const float dt = this->settings.timeStep;
+	const float depthScale = dt / (this->spacing * this->spacing);
+	const float maxSpeed = this->spacing / dt;
+	const float speedScale = 0.5f / this->spacing;
+
+	const float* flowLeft = &this->flowLeft[0];
+	const float* flowRight = &this->flowRight[0];
+	const float* flowUp = &this->flowUp[0];
+	const float* flowDown = &this->flowDown[0];
+	float* water = &this->water[0];
+	float* velocityX = &this->velocityX[0];
+	float* velocityZ = &this->velocityZ[0];
+
+	/* Updates the water of one vertex, which may be on the edge. The */
+	/* velocity is the average flow through the vertex along each     */
+	/* axis, over the cross section of the water.                     */
+	auto waterAt = [&](unsigned int r, unsigned int c)
+	{
+		size_t i = (size_t)r * cols + c;
+		float fromLeft = (c > 0) ? flowRight[i - 1] : 0;
+		float fromRight = (c + 1 < cols) ? flowLeft[i + 1] : 0;
+		float fromUp = (r > 0) ? flowDown[i - cols] : 0;
+		float fromDown = (r + 1 < rows) ? flowUp[i + cols] : 0;
+		float in = fromLeft + fromRight + fromUp + fromDown;
+		float out = flowLeft[i] + flowRight[i] + flowUp[i] + flowDown[i];
+
+		float before = water[i];
+		float after = std::max(0.0f, before + depthScale * (in - out));
+		water[i] = after;
+
+		float depth = 0.5f * (before + after);
+		float u = 0, v = 0;
+		if(depth > DRY_DEPTH)
+		{
+			u = speedScale * (fromLeft - flowLeft[i] + flowRight[i] -
+				fromRight) / depth;
+			v = speedScale * (fromUp - flowUp[i] + flowDown[i] - fromDown) /
+				depth;
+		}
+		velocityX[i] = std::max(-maxSpeed, std::min(u, maxSpeed));
+		velocityZ[i] = std::max(-maxSpeed, std::min(v, maxSpeed));
+	};
+
+	this->forEachRow([&](unsigned int r)
+	{
+		unsigned int c = 0;
+		if(r > 0 && r + 1 < rows)
+		{
+			waterAt(r, c++);
+#ifdef VEC4_USE_SSE
+			/* Vertices inside the edges have all four neighbours. */
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 dry = _mm_set1_ps(DRY_DEPTH);
+			const __m128 depthScales = _mm_set1_ps(depthScale);
+			const __m128 speedScales = _mm_set1_ps(speedScale);
+			const __m128 maxSpeeds = _mm_set1_ps(maxSpeed);
+			const __m128 minSpeeds = _mm_set1_ps(-maxSpeed);
+			for (; c + 4 < cols; c += 4)
+			{
+				size_t i = (size_t)r * cols + c;
+				__m128 fromLeft = _mm_loadu_ps(flowRight + i - 1);
+				__m128 fromRight = _mm_loadu_ps(flowLeft + i + 1);
+				__m128 fromUp = _mm_loadu_ps(flowDown + i - cols);
+				__m128 fromDown = _mm_loadu_ps(flowUp + i + cols);
+				__m128 left = _mm_loadu_ps(flowLeft + i);
+				__m128 right = _mm_loadu_ps(flowRight + i);
+				__m128 up = _mm_loadu_ps(flowUp + i);
+				__m128 down = _mm_loadu_ps(flowDown + i);
+				__m128 in = _mm_add_ps(_mm_add_ps(fromLeft, fromRight),
+					_mm_add_ps(fromUp, fromDown));
+				__m128 out = _mm_add_ps(_mm_add_ps(left, right),
+					_mm_add_ps(up, down));
+
+				__m128 before = _mm_loadu_ps(water + i);
+				__m128 after = _mm_max_ps(zero, _mm_add_ps(before,
+					_mm_mul_ps(depthScales, _mm_sub_ps(in, out))));
+				_mm_storeu_ps(water + i, after);
+
+				/* Dry vertices are given no velocity. */
+				__m128 depth = _mm_mul_ps(half, _mm_add_ps(before, after));
+				__m128 wet = _mm_cmpgt_ps(depth, dry);
+				__m128 scale = _mm_and_ps(wet, _mm_div_ps(speedScales,
+					_mm_max_ps(depth, dry)));
+				__m128 u = _mm_mul_ps(scale, _mm_sub_ps(_mm_add_ps(fromLeft,
+					right), _mm_add_ps(left, fromRight)));
+				__m128 v = _mm_mul_ps(scale, _mm_sub_ps(_mm_add_ps(fromUp,
+					down), _mm_add_ps(up, fromDown)));
+				_mm_storeu_ps(velocityX + i, _mm_max_ps(minSpeeds,
+					_mm_min_ps(u, maxSpeeds)));
+				_mm_storeu_ps(velocityZ + i, _mm_max_ps(minSpeeds,
+					_mm_min_ps(v, maxSpeeds)));
+			}
+#endif
+		}
+		for (; c < cols; c++)
+		{
+			waterAt(r, c);
+		}
+	});
+}
+
+/* Dissolves terrain into the water where it carries less sediment than  */
+/* its capacity and deposits sediment where it carries more. Deep, fast   */
+/* water down steep slopes carries the most. The slope is read from the   */
+/* neighbours, so the new terrain is written to scratch.                  */
+void HydraulicErosion::erodeAndDeposit()
+{
+	TRACE_SCOPE("HydraulicErosion::erodeAndDeposit");
+	const unsigned int cols = this->cols;
+	const unsigned int rows = this->rows;
+	const float capacityScale = this->settings.sedimentCapacity;
+	const float dissolveRate = this->settings.dissolveRate;
+	const float depositRate = this->settings.depositRate;
+	const float minSlope = this->settings.minSlope;
+
+	const float* terrain = &this->terrain[0];
+	const float* water = &this->water[0];
+	const float* velocityX = &this->velocityX[0];
+	const float* velocityZ = &this->velocityZ[0];
+	float* sediment = &this->sediment[0];
+	float* eroded = &this->scratch[0];
+
+	/* Erodes or deposits at one vertex, which may be on the edge, where */
+	/* the slope is taken one sided.                                     */
+	auto erodeAt = [&](unsigned int r, unsigned int c)
+	{
+		size_t i = (size_t)r * cols + c;
+		unsigned int left = (c > 0) ? c - 1 : c;
+		unsigned int right = (c + 1 < cols) ? c + 1 : c;
+		unsigned int up = (r > 0) ? r - 1 : r;
+		unsigned int down = (r + 1 < rows) ? r + 1 : r;
+		float dx = (terrain[i - c + right] - terrain[i - c + left]) /
+			((right - left) * this->spacing);
+		float dz = (terrain[(size_t)down * cols + c] -
+			terrain[(size_t)up * cols + c]) / ((down - up) * this->spacing);
+		float gradient2 = dx * dx + dz * dz;
+		float slope = std::max(minSlope,
+			std::sqrt(gradient2 / (1 + gradient2)));
+
+		float u = velocityX[i], v = velocityZ[i];
+		float capacity = capacityScale * slope * water[i] *
+			std::sqrt(u * u + v * v);
+
+		/* Dissolves when under capacity and deposits when over it. */
+		float spare = capacity - sediment[i];
+		float amount = spare * ((spare > 0) ? dissolveRate : depositRate);
+		eroded[i] = terrain[i] - amount;
+		sediment[i] += amount;
+	};
+
+	this->forEachRow([&](unsigned int r)
+	{
+		unsigned int c = 0;
+		if(r > 0 && r + 1 < rows)
+		{
+			erodeAt(r, c++);
+#ifdef VEC4_USE_SSE
+			/* Vertices inside the edges have all four neighbours. */
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 gradientScale = _mm_set1_ps(0.5f / this->spacing);
+			const __m128 minSlopes = _mm_set1_ps(minSlope);
+			const __m128 capacityScales = _mm_set1_ps(capacityScale);
+			const __m128 dissolveRates = _mm_set1_ps(dissolveRate);
+			const __m128 depositRates = _mm_set1_ps(depositRate);
+			for (; c + 4 < cols; c += 4)
+			{
+				size_t i = (size_t)r * cols + c;
+				__m128 dx = _mm_mul_ps(gradientScale, _mm_sub_ps(
+					_mm_loadu_ps(terrain + i + 1),
+					_mm_loadu_ps(terrain + i - 1)));
+				__m128 dz = _mm_mul_ps(gradientScale, _mm_sub_ps(
+					_mm_loadu_ps(terrain + i + cols),
+					_mm_loadu_ps(terrain + i - cols)));
+				__m128 gradient2 = _mm_add_ps(_mm_mul_ps(dx, dx),
+					_mm_mul_ps(dz, dz));
+				__m128 slope = _mm_max_ps(minSlopes, _mm_sqrt_ps(_mm_div_ps(
+					gradient2, _mm_add_ps(one, gradient2))));
+
+				__m128 u = _mm_loadu_ps(velocityX + i);
+				__m128 v = _mm_loadu_ps(velocityZ + i);
+				__m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(u, u),
+					_mm_mul_ps(v, v)));
+				__m128 capacity = _mm_mul_ps(_mm_mul_ps(capacityScales,
+					slope), _mm_mul_ps(_mm_loadu_ps(water + i), speed));
+
+				__m128 carried = _mm_loadu_ps(sediment + i);
+				__m128 spare = _mm_sub_ps(capacity, carried);
+				__m128 under = _mm_cmpgt_ps(spare, zero);
+				__m128 rate = _mm_or_ps(_mm_and_ps(under, dissolveRates),
+					_mm_andnot_ps(under, depositRates));
+				__m128 amount = _mm_mul_ps(spare, rate);
+				_mm_storeu_ps(eroded + i, _mm_sub_ps(
+					_mm_loadu_ps(terrain + i), amount));
+				_mm_storeu_ps(sediment + i, _mm_add_ps(carried, amount));
+			}
+#endif
+		}
+		for (; c < cols; c++)
+		{
+			erodeAt(r, c);
+		}
+	});
+	this->terrain.swap(this->scratch);
+}
+
+/* Carries the sediment along the velocity of the water by sampling the  */
+/* sediment where the water came from, and evaporates some of the water. */
+void HydraulicErosion::transportSediment()
+{
+	TRACE_SCOPE("HydraulicErosion::transportSediment");
+	const unsigned int cols = this->cols;
+	const unsigned int rows = this->rows;
+	const float stepScale = this->settings.timeStep / this->spacing;
+	const float keep = 1 - this->settings.evaporationRate;
+
+	this->forEachRow([&](unsigned int r)
+	{
+		size_t row = (size_t)r * cols;
+		const float* sediment = &this->sediment[0];
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			size_t i = row + c;
+			float x = std::max(0.0f, std::min((float)c -
+				this->velocityX[i] * stepScale, (float)(cols - 1)));
+			float z = std::max(0.0f, std::min((float)r -
+				this->velocityZ[i] * stepScale, (float)(rows - 1)));
+			unsigned int c0 = std::min((unsigned int)x, cols - 2);
+			unsigned int r0 = std::min((unsigned int)z, rows - 2);
+			float tx = x - c0, tz = z - r0;
+			const float* top = &sediment[(size_t)r0 * cols + c0];
+			const float* bottom = top + cols;
+			float upper = top[0] + tx * (top[1] - top[0]);
+			float lower = bottom[0] + tx * (bottom[1] - bottom[0]);
+			this->scratch[i] = upper + tz * (lower - upper);
+
+			this->water[i] *= keep;
+		}
+	});
+	this->sediment.swap(this->scratch);
+}
+
+/* Runs the given number of steps. If cancelled is given and becomes true */
+/* the steps stop early. Returns the number of steps run.                 */
+unsigned int HydraulicErosion::run(unsigned int steps,
+	const std::atomic<bool>* cancelled)
+{
+	TRACE_SCOPE("HydraulicErosion::run");
+	unsigned int step = 0;
+	for (; step < steps; step++)
+	{
+		if (cancelled != NULL && cancelled->load())
+		{
+			break;
+		}
+		this->updateFlow();
+		this->updateWater();
+		this->erodeAndDeposit();
+		this->transportSediment();
+	}
+	return step;
+}
+
+/* Sets the heights of the given mesh, which must be the size of the one */
+/* simulated, to the eroded terrain. Sediment still carried by the water  */
+/* is settled where it is so no material is lost.                         */
+void HydraulicErosion::apply(Mesh* mesh) const
+{
+	TRACE_SCOPE("HydraulicErosion::apply");
+	const unsigned int cols = this->cols;
+	mesh->applyHeights([&](unsigned int row, unsigned int col, float)
+	{
+		size_t i = (size_t)row * cols + col;
+		return this->terrain[i] + this->sediment[i];
+	});
+}
+
+/* Returns the total depth of water on the lattice. */
+double HydraulicErosion::getTotalWater() const
+{
+	double total = 0;
+	for (size_t i = 0; i < this->water.size(); i++)
+	{
+		total += this->water[i];
+	}
+	return total;
+}
@@ -0,0 +1,106 @@
+/*
+ * HydraulicErosion.h
+ * Created by Zachary Ferguson
+ * Header file for the HydraulicErosion class, a grid based simulation of
+ * rain wearing down a heightfield. Water, sediment, outflow, and velocity
+ * fields are kept on the same lattice as the vertices of the mesh. Each step
+ * rains, moves the water through virtual pipes between neighbouring
+ * vertices, dissolves and deposits sediment by the capacity of the flow,
+ * carries the sediment along the flow, and evaporates some water.
+ */
+
+#ifndef HYDRAULICEROSION_H
+#define HYDRAULICEROSION_H
+
+#include <atomic>
+#include <vector>
+#include "Mesh.h"
+
+/* Constants of the erosion simulation. */
+struct HydraulicErosionSettings
+{
+	/* Time simulated by each step. */
+	float timeStep;
+	/* Depth of rain added to every vertex each step. */
+	float rainRate;
+	/* Fraction of the water evaporated each step. */
+	float evaporationRate;
+	/* Sediment a unit depth of water can carry moving at unit speed down */
+	/* a vertical slope.                                                  */
+	float sedimentCapacity;
+	/* Fraction of the spare capacity dissolved from the terrain each */
+	/* step.                                                          */
+	float dissolveRate;
+	/* Fraction of the sediment over capacity deposited each step. */
+	float depositRate;
+	/* Smallest slope the capacity is computed for, so flat ground still */
+	/* erodes.                                                           */
+	float minSlope;
+	/* Gravity accelerating the water through the pipes. */
+	float gravity;
+
+	/* Creates the default settings. */
+	HydraulicErosionSettings();
+};
+
+class HydraulicErosion
+{
+	private:
+
+		/* Number of rows and columns of the lattice. */
+		unsigned int rows, cols;
+		/* Distance between neighbouring vertices. */
+		float spacing;
+		/* Constants of the simulation. */
+		HydraulicErosionSettings settings;
+
+		/* Height of the terrain, depth of the water, and sediment carried */
+		/* at each vertex, row by row.                                     */
+		std::vector<float> terrain, water, sediment;
+		/* Flow out of each vertex to the left, right, up, and down. */
+		std::vector<float> flowLeft, flowRight, flowUp, flowDown;
+		/* Velocity of the water along the columns and rows. */
+		std::vector<float> velocityX, velocityZ;
+		/* Buffer the terrain and sediment of the next step are written to, */
+		/* since they are read from the neighbouring vertices.              */
+		std::vector<float> scratch;
+
+		/* Calls body(row) for every row, with the rows split across the */
+		/* threads.                                                      */
+		template <typename Body>
+		void forEachRow(const Body& body);
+
+		/* The passes of a step. */
+		void updateFlow();
+		void updateWater();
+		void erodeAndDeposit();
+		void transportSediment();
+
+		/* Returns the bytes held by the fields. */
+		size_t bytes() const;
+
+	public:
+
+		/* Creates a simulation of the heights of the given mesh, with no */
+		/* water or sediment.                                             */
+		HydraulicErosion(const Mesh* mesh, const HydraulicErosionSettings&
+			settings = HydraulicErosionSettings());
+
+		/* Deletes the fields. */
+		~HydraulicErosion();
+
+		/* Runs the given number of steps. If cancelled is given and */
+		/* becomes true the steps stop early. Returns the number of  */
+		/* steps run.                                                */
+		unsigned int run(unsigned int steps,
+			const std::atomic<bool>* cancelled = NULL);
+
+		/* Sets the heights of the given mesh, which must be the size of */
+		/* the one simulated, to the eroded terrain.                     */
+		void apply(Mesh* mesh) const;
+
+		/* Returns the total depth of water on the lattice. */
+		double getTotalWater() const;
+};
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * MappedFile.cpp
+ * Created by Zachary Ferguson
+ * Source file for the MappedFile class, a temporary file mapped into memory
+ * in one piece.
+ */
+
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Creates an unopened file. */
+MappedFile::MappedFile()
+{
+#ifdef _WIN32
+	this->file = INVALID_HANDLE_VALUE;
+	this->mapping = NULL;
+#else
+	this->file = -1;
+#endif
+	this->data = NULL;
+	this->size = 0;
+}
+
+/* Creates a temporary file of the given bytes in the directory and maps */
+/* it. Returns NULL if it can not be created or mapped.                  */
+MappedFile* MappedFile::create(const char* directory,
+	unsigned long long bytes)
+{
+	if(bytes == 0 || bytes > (size_t)-1)
+	{
+		return NULL;
+	}
+	MappedFile* mapped = new MappedFile();
+	mapped->size = bytes;
+
+#ifdef _WIN32
+	/* The file is deleted by Windows once its last handle is closed, and */
+	/* as a temporary file it is only written to the disk when the memory */
+	/* runs short.                                                        */
+	char path[MAX_PATH];
+	if(GetTempFileNameA(directory, "msh", 0, path) == 0)
+	{
+		delete mapped;
+		return NULL;
+	}
+	mapped->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+		NULL);
+	if(mapped->file == INVALID_HANDLE_VALUE)
+	{
+		DeleteFileA(path);
+		delete mapped;
+		return NULL;
+	}
+	mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READWRITE,
+		(DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+	if(mapped->mapping)
+	{
+		mapped->data = MapViewOfFile(mapped->mapping, FILE_MAP_ALL_ACCESS, 0,
+			0, (SIZE_T)bytes);
+	}
+#else
+	/* The file is unlinked as soon as it is opened, so it is deleted */
+	/* once it is closed, even if the program crashes.                */
+	std::string path = std::string(directory) + "/meshXXXXXX";
+	mapped->file = mkstemp(&path[0]);
+	if(mapped->file < 0)
+	{
+		delete mapped;
+		return NULL;
+	}
+	unlink(path.c_str());
+#ifdef __linux__
+	/* Reserve the disk space now, so a full disk fails here instead of */
+	/* when a page of the mapping is first written.                     */
+	bool sized = posix_fallocate(mapped->file, 0, (off_t)bytes) == 0;
+#else
+	bool sized = ftruncate(mapped->file, (off_t)bytes) == 0;
+#endif
+	if(sized)
+	{
+		void* data = mmap(NULL, (size_t)bytes, PROT_READ | PROT_WRITE,
+			MAP_SHARED, mapped->file, 0);
+		if(data != MAP_FAILED)
+		{
+			/* The meshes are read and written a few rows at a time, so */
+			/* the pages are read ahead and dropped soon after use.     */
+			madvise(data, (size_t)bytes, MADV_SEQUENTIAL);
+			mapped->data = data;
+		}
+	}
+#endif
+
+	if(!mapped->data)
+	{
+		delete mapped;
+		return NULL;
+	}
+	MemoryTracker::allocate(MAPPED_STORAGE, (size_t)bytes);
+	return mapped;
+}
+
+/* Unmaps and deletes the file. */
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if(this->data)
+	{
+		UnmapViewOfFile(this->data);
+	}
+	if(this->mapping)
+	{
+		CloseHandle(this->mapping);
+	}
+	if(this->file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(this->file);
+	}
+#else
+	if(this->data)
+	{
+		munmap(this->data, (size_t)this->size);
+	}
+	if(this->file >= 0)
+	{
+		close(this->file);
+	}
+#endif
+	if(this->data)
+	{
+		MemoryTracker::release(MAPPED_STORAGE, (size_t)this->size);
+	}
+}
+
+/* Returns the address the file is mapped at. */
+void* MappedFile::getData() const
+{
+	return this->data;
+}
+
+/* Returns the size of the file in bytes. */
+unsigned long long MappedFile::getSize() const
+{
+	return this->size;
+}
+
+#ifndef _WIN32
+/* Returns the size of a page of memory. */
+static size_t pageSize()
+{
+	static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+	return size;
+}
+#endif
+
+/* Hints that the mapped bytes will be read soon, so the OS starts paging */
+/* them in.                                                               */
+void MappedFile::prefetch(const void* address, size_t bytes)
+{
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<void*>(address);
+	range.NumberOfBytes = bytes;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	/* Windows before 8 has no prefetch, so the pages are read in as they */
+	/* are touched.                                                       */
+	(void)address;
+	(void)bytes;
+#endif
+#else
+	/* The first page holding any of the bytes is read in as well. */
+	size_t start = (size_t)address & ~(pageSize() - 1);
+	madvise((void*)start, (size_t)address + bytes - start, MADV_WILLNEED);
+#endif
+}
+
+/* Hints that the mapped bytes will not be read again soon, so the OS can */
+/* write them out and reuse their memory. The bytes stay mapped and are   */
+/* paged back in if they are read again.                                  */
+void MappedFile::release(const void* address, size_t bytes)
+{
+#ifdef _WIN32
+	/* Unlocking pages that are not locked removes them from the working */
+	/* set, so they are written out to the file and their memory reused. */
+	VirtualUnlock(const_cast<void*>(address), bytes);
+#else
+	/* Only whole pages of the bytes are released, so the neighbouring */
+	/* bytes stay in memory. The pages of a shared mapping keep their  */
+	/* changes, which are written out to the file.                     */
+	size_t start = ((size_t)address + pageSize() - 1) & ~(pageSize() - 1);
+	size_t end = ((size_t)address + bytes) & ~(pageSize() - 1);
+	if(end > start)
+	{
+		madvise((void*)start, end - start, MADV_DONTNEED);
+	}
+#endif
+}
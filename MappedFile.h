@@ -0,0 +1,63 @@
+/*
+ * MappedFile.h
+ * Created by Zachary Ferguson
+ * Header file for the MappedFile class, a temporary file mapped into memory
+ * in one piece. The OS pages the file in as it is read and may page it back
+ * out under memory pressure, so the file can be larger than the memory of the
+ * machine. The file is deleted when it is closed.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+class MappedFile
+{
+	private:
+
+		/* Handles of the file and its mapping on Windows, the file */
+		/* descriptor elsewhere.                                    */
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#else
+		int file;
+#endif
+		/* Address the file is mapped at and its size in bytes. */
+		void* data;
+		unsigned long long size;
+
+		/* Creates an unopened file. */
+		MappedFile();
+
+		/* Private so a mapping is never copied. */
+		MappedFile(const MappedFile& other);
+
+	public:
+
+		/* Creates a temporary file of the given bytes in the directory and */
+		/* maps it. Returns NULL if it can not be created or mapped.        */
+		static MappedFile* create(const char* directory,
+			unsigned long long bytes);
+
+		/* Unmaps and deletes the file. */
+		virtual ~MappedFile();
+
+		/* Returns the address the file is mapped at. */
+		void* getData() const;
+
+		/* Returns the size of the file in bytes. */
+		unsigned long long getSize() const;
+
+		/* Hints that the mapped bytes will be read soon, so the OS starts */
+		/* paging them in.                                                 */
+		static void prefetch(const void* address, size_t bytes);
+
+		/* Hints that the mapped bytes will not be read again soon, so the */
+		/* OS can write them out and reuse their memory. The bytes stay    */
+		/* mapped and are paged back in if they are read again.            */
+		static void release(const void* address, size_t bytes);
+};
+
+#endif
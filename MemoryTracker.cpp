@@ -0,0 +1,162 @@
+/*
+ * MemoryTracker.cpp
+ * Created by Zachary Ferguson
+ * Source file for the MemoryTracker class, a set of counters for the memory
+ * used by each subsystem of the Heightfield Modeler.
+ */
+
+#include "MemoryTracker.h"
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+/* Counters start at zero since they have static storage. */
+MemoryTracker::Counters MemoryTracker::subsystems[NUM_MEMORY_SUBSYSTEMS];
+MemoryTracker::Counters MemoryTracker::total;
+std::string MemoryTracker::exitFilename;
+
+/* Adds bytes to the given counters and updates the peak. */
+void MemoryTracker::add(Counters& counters, long long bytes)
+{
+	long long current = (counters.currentBytes += bytes);
+	long long peak = counters.peakBytes;
+	while(current > peak &&
+		!counters.peakBytes.compare_exchange_weak(peak, current));
+}
+
+/* Records an allocation of the given bytes by the subsystem. */
+void MemoryTracker::allocate(MemorySubsystem subsystem, size_t bytes)
+{
+	assert(subsystem < NUM_MEMORY_SUBSYSTEMS);
+	MemoryTracker::add(subsystems[subsystem], bytes);
+	MemoryTracker::add(total, bytes);
+	subsystems[subsystem].allocations++;
+	total.allocations++;
+}
+
+/* Records the release of the given bytes by the subsystem. */
+void MemoryTracker::release(MemorySubsystem subsystem, size_t bytes)
+{
+	assert(subsystem < NUM_MEMORY_SUBSYSTEMS);
+	subsystems[subsystem].currentBytes -= bytes;
+	total.currentBytes -= bytes;
+	subsystems[subsystem].releases++;
+	total.releases++;
+}
+
+/* Returns the bytes currently held by the subsystem. */
+long long MemoryTracker::getCurrentBytes(MemorySubsystem subsystem)
+{
+	return subsystems[subsystem].currentBytes;
+}
+
+/* Returns the most bytes ever held at once by the subsystem. */
+long long MemoryTracker::getPeakBytes(MemorySubsystem subsystem)
+{
+	return subsystems[subsystem].peakBytes;
+}
+
+/* Returns the bytes currently held by all of the subsystems. */
+long long MemoryTracker::getTotalBytes()
+{
+	return total.currentBytes;
+}
+
+/* Returns the most bytes ever held at once by all of the subsystems */
+/* together.                                                         */
+long long MemoryTracker::getTotalPeakBytes()
+{
+	return total.peakBytes;
+}
+
+/* Returns the name of the given subsystem. */
+const char* MemoryTracker::getName(MemorySubsystem subsystem)
+{
+	switch(subsystem)
+	{
+		case MESH_STORAGE:
+			return "Mesh storage";
+		case TEMPORARIES:
+			return "Temporaries";
+		case EXPORT_BUFFERS:
+			return "Export buffers";
+		case UNDO_HISTORY:
+			return "Undo history";
+		case EROSION_FIELDS:
+			return "Erosion fields";
+		case MAPPED_STORAGE:
+			return "Mapped storage";
+		default:
+			return "Unknown";
+	}
+}
+
+/* Writes a row of the report for the given counters. */
+static void reportRow(std::stringstream& stream, const char* name,
+	long long current, long long peak, long long allocations,
+	long long releases)
+{
+	stream << std::left << std::setw(16) << name << std::right
+		<< std::fixed << std::setprecision(3)
+		<< std::setw(14) << (current / 1048576.0)
+		<< std::setw(14) << (peak / 1048576.0)
+		<< std::setw(10) << allocations
+		<< std::setw(10) << releases << std::endl;
+}
+
+/* Returns a table of the counters of every subsystem. */
+std::string MemoryTracker::report()
+{
+	std::stringstream stream;
+	stream << std::left << std::setw(16) << "Subsystem" << std::right
+		<< std::setw(14) << "Current MB" << std::setw(14) << "Peak MB"
+		<< std::setw(10) << "Allocs" << std::setw(10) << "Frees"
+		<< std::endl << std::string(64, '-') << std::endl;
+
+	for (int i = 0; i < NUM_MEMORY_SUBSYSTEMS; i++)
+	{
+		reportRow(stream, MemoryTracker::getName((MemorySubsystem)i),
+			subsystems[i].currentBytes, subsystems[i].peakBytes,
+			subsystems[i].allocations, subsystems[i].releases);
+	}
+
+	stream << std::string(64, '-') << std::endl;
+	reportRow(stream, "Total", total.currentBytes, total.peakBytes,
+		total.allocations, total.releases);
+
+	return stream.str();
+}
+
+/* Writes the report to the given file. Returns true if the file was */
+/* written.                                                          */
+bool MemoryTracker::dump(const char* filename)
+{
+	std::ofstream outFile(filename, std::ios::out);
+	if(!(outFile.is_open()))
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		return false;
+	}
+	outFile << MemoryTracker::report();
+	outFile.close();
+	return true;
+}
+
+/* Writes the report to exitFilename, registered with atexit. */
+void MemoryTracker::dumpAtExit()
+{
+	MemoryTracker::dump(exitFilename.c_str());
+}
+
+/* Writes the report to the given file when the program exits. */
+void MemoryTracker::dumpOnExit(const char* filename)
+{
+	if(exitFilename.empty())
+	{
+		atexit(MemoryTracker::dumpAtExit);
+	}
+	exitFilename = filename;
+}
@@ -0,0 +1,89 @@
+/*
+ * MemoryTracker.h
+ * Created by Zachary Ferguson
+ * Header file for the MemoryTracker class, a set of counters for the memory
+ * used by each subsystem of the Heightfield Modeler. Keeps the current and
+ * peak number of bytes of each subsystem so the footprint of a session can be
+ * reported and leaks can be found.
+ */
+
+#ifndef MEMORYTRACKER_H
+#define MEMORYTRACKER_H
+
+#include <atomic>
+#include <string>
+
+/* Subsystems whose memory is accounted for separately. */
+enum MemorySubsystem
+{
+	MESH_STORAGE,   /* Vertices of every mesh.                        */
+	TEMPORARIES,    /* Short lived data such as selected indecies.    */
+	EXPORT_BUFFERS, /* Buffers used while saving a mesh to a file.    */
+	UNDO_HISTORY,   /* Compressed heights kept to undo edits.         */
+	EROSION_FIELDS, /* Water and sediment fields of the erosion.      */
+	MAPPED_STORAGE, /* Vertices of out-of-core meshes, kept in files. */
+	NUM_MEMORY_SUBSYSTEMS
+};
+
+class MemoryTracker
+{
+	private:
+
+		/* Counters of a single subsystem. */
+		struct Counters
+		{
+			std::atomic<long long> currentBytes;
+			std::atomic<long long> peakBytes;
+			std::atomic<long long> allocations;
+			std::atomic<long long> releases;
+		};
+
+		/* Counters for each subsystem. */
+		static Counters subsystems[NUM_MEMORY_SUBSYSTEMS];
+		/* Counters for the sum of all the subsystems. */
+		static Counters total;
+
+		/* Adds bytes to the given counters and updates the peak. */
+		static void add(Counters& counters, long long bytes);
+
+		/* Filename the report is written to at exit. */
+		static std::string exitFilename;
+		/* Writes the report to exitFilename, registered with atexit. */
+		static void dumpAtExit();
+
+	public:
+
+		/* Records an allocation of the given bytes by the subsystem. */
+		static void allocate(MemorySubsystem subsystem, size_t bytes);
+
+		/* Records the release of the given bytes by the subsystem. */
+		static void release(MemorySubsystem subsystem, size_t bytes);
+
+		/* Returns the bytes currently held by the subsystem. */
+		static long long getCurrentBytes(MemorySubsystem subsystem);
+
+		/* Returns the most bytes ever held at once by the subsystem. */
+		static long long getPeakBytes(MemorySubsystem subsystem);
+
+		/* Returns the bytes currently held by all of the subsystems. */
+		static long long getTotalBytes();
+
+		/* Returns the most bytes ever held at once by all of the */
+		/* subsystems together.                                   */
+		static long long getTotalPeakBytes();
+
+		/* Returns the name of the given subsystem. */
+		static const char* getName(MemorySubsystem subsystem);
+
+		/* Returns a table of the counters of every subsystem. */
+		static std::string report();
+
+		/* Writes the report to the given file. Returns true if the file */
+		/* was written.                                                  */
+		static bool dump(const char* filename);
+
+		/* Writes the report to the given file when the program exits. */
+		static void dumpOnExit(const char* filename);
+};
+
+#endif
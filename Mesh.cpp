@@ -5,25 +5,147 @@
  */
 
 #include "Mesh.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+/* Fewest vertices given to each thread by the parallel operations. */
+#define VERTICES_PER_TASK 16384
+
+/* Bytes of the rows a streaming pass over a mesh works on at once. */
+#define STREAM_BAND_BYTES (16 << 20)
+
+/* Size of the buffer the OBJ file is written through. */
+#define EXPORT_BUFFER_SIZE (1 << 20)
+
+/* A tile of TILE_ROWS rows of vertices, stored row after row. The last */
+/* tile of a mesh may hold fewer rows. The vertices are either kept in  */
+/* memory or in the file of an out-of-core mesh.                        */
+struct MeshTile
+{
+	/* Vertices of a tile kept in memory. */
+	std::vector<vec4> vertices;
+	/* File mapping the vertices of an out-of-core tile, shared by every */
+	/* tile of the mesh, or NULL for a tile kept in memory.              */
+	std::shared_ptr<MappedFile> file;
+	/* First vertex of the tile and the number of vertices. */
+	vec4* data;
+	size_t count;
+
+	/* Creates a tile of the given number of vertices in memory. */
+	MeshTile(size_t count) : vertices(count), data(&vertices[0]), 
+		count(count)
+	{
+		MemoryTracker::allocate(MESH_STORAGE, count * sizeof(vec4));
+	}
+
+	/* Creates a tile of the given number of vertices stored at the given */
+	/* address of the mapped file.                                        */
+	MeshTile(size_t count, const std::shared_ptr<MappedFile>& file, 
+		vec4* data) : file(file), data(data), count(count)
+	{
+	}
+
+	/* Copies the given tile into memory, before it is written by one of */
+	/* its owners.                                                       */
+	MeshTile(const MeshTile& other) : vertices(other.data, 
+		other.data + other.count), data(&vertices[0]), count(other.count)
+	{
+		MemoryTracker::allocate(MESH_STORAGE, this->count * sizeof(vec4));
+	}
+
+	~MeshTile()
+	{
+		if(!this->file)
+		{
+			MemoryTracker::release(MESH_STORAGE, 
+				this->count * sizeof(vec4));
+		}
+	}
+};
+
+/* Returns the number of rows of the given columns a streaming pass works */
+/* on at once, a whole number of tiles.                                   */
+static unsigned int bandRows(unsigned int cols)
+{
+	unsigned int rows = (unsigned int)(STREAM_BAND_BYTES / 
+		((size_t)cols * sizeof(vec4)));
+	return std::max(1u, rows / TILE_ROWS) * TILE_ROWS;
+}
+
+/* Directory out-of-core meshes are stored in, empty to keep every mesh in */
+/* memory, and the fewest bytes of vertices a mesh must have to be stored  */
+/* there.                                                                  */
+std::string Mesh::outOfCoreDirectory;
+unsigned long long Mesh::outOfCoreBytes = 0;
+
+/* Stores the vertices of every mesh created from now on with at least */
+/* minBytes of vertices in a memory-mapped file in the directory, so   */
+/* the OS pages them in and out as they are used. A NULL directory     */
+/* keeps every new mesh in memory.                                     */
+void Mesh::setOutOfCore(const char* directory, unsigned long long minBytes)
+{
+	outOfCoreDirectory = directory ? directory : "";
+	outOfCoreBytes = minBytes;
+}
 
 /* Constructor for creating a new mesh.                                   */
 /* Must send a unsigned int for the number of rows and cols of the  mesh. */
 /* Also requires the width and depth of the mesh in 3D space. Lastly      */
-/* requires the color of the mesh.                                        */
+/* requires the color of the mesh, which is copied.                       */
 Mesh::Mesh(const unsigned int rows, const unsigned int cols, const float width,
-	const float depth, const Color* color, const float snowCapHeight)
+	const float depth, const Color* color, const float snowCapHeight) :
+	color(*color)
 {
 	/* Check that the width and depth are non-negative. */
 	assert(depth > 0 && width > 0);
 
-	/* Create new vector for the rows. */
-	this->vertices = new std::vector<std::vector<vec4>*>();
+	/* Create the tiles for the rows. */
+	this->rows = rows + 1;
+	this->cols = cols + 1;
+	unsigned int tileCount = (this->rows + TILE_ROWS - 1) / TILE_ROWS;
+	this->tiles.reserve(tileCount);
+
+	/* A large enough mesh is stored in a file, its tiles laid out one */
+	/* after another so the rows can be streamed through in order.     */
+	std::shared_ptr<MappedFile> file;
+	unsigned long long bytes = (unsigned long long)this->rows * this->cols * 
+		sizeof(vec4);
+	if(!outOfCoreDirectory.empty() && bytes >= outOfCoreBytes)
+	{
+		file.reset(MappedFile::create(outOfCoreDirectory.c_str(), bytes));
+		if(!file)
+		{
+			std::cout << "Unable to map " << bytes << " bytes in " << 
+				outOfCoreDirectory << ", keeping the mesh in memory" << 
+				std::endl;
+		}
+	}
+	for (unsigned int t = 0; t < tileCount; t++)
+	{
+		unsigned int tileRows = std::min((unsigned int)TILE_ROWS, 
+			this->rows - t * TILE_ROWS);
+		size_t count = (size_t)tileRows * this->cols;
+		if(file)
+		{
+			this->tiles.push_back(std::make_shared<MeshTile>(count, file,
+				(vec4*)file->getData() + (size_t)t * TILE_ROWS * this->cols));
+		}
+		else
+		{
+			this->tiles.push_back(std::make_shared<MeshTile>(count));
+		}
+	}
 	
 	/* Fill the rows with columns. */
 	float range = (width / rows + depth / cols)/2;
 	for (unsigned int r = 0; r <= rows; r++)
 	{
-		std::vector<vec4>* row = new std::vector<vec4>();
+		vec4* row = this->getWritableRow(r);
 		float z = depth * (r/(rows*1.0f)) - (depth / 2.0f);
 		for (unsigned int c = 0; c <= cols; c++)
 		{
@@ -32,41 +154,148 @@ Mesh::Mesh(const unsigned int rows, const unsigned int cols, const float width,
 			//float y = ((float)rand()/(float)RAND_MAX) * .5f - .25f;
 			//float y = (x*x+z*z)/5;
 			//float y = 0;
-			row->push_back(vec4(x, y, z, 0.0));
+			row[c] = vec4(x, y, z, 0.0);
+		}
+		if((r + 1) % TILE_ROWS == 0)
+		{
+			this->releaseRows(r + 1 - TILE_ROWS, r + 1);
 		}
-		this->vertices->push_back(row);
 	}
 
 	/* Set the instance variables. */
-	this->color = color;
-
 	this->snowCapHeight = snowCapHeight;
 
 	this->width = width;
 	this->depth = depth;
 }
+
+/* Creates a copy of the given mesh that shares its tiles. The tiles are */
+/* copied later, by whichever mesh writes to them first.                 */
+Mesh::Mesh(const Mesh& other) : tiles(other.tiles), color(other.color)
+{
+	this->rows = other.rows;
+	this->cols = other.cols;
+	this->snowCapHeight = other.snowCapHeight;
+	this->width = other.width;
+	this->depth = other.depth;
+}
 		
-/* Deletes this Face */
+/* Deletes this Face. The tiles are deleted once no mesh shares them. */
 Mesh::~Mesh()
 {
-	for (unsigned int r = 0; r < this->vertices->size(); r++)
+}
+
+/* Returns the vertices of the given row. */
+const vec4* Mesh::getRow(unsigned int row) const
+{
+	assert(row < this->rows);
+	return this->tiles[row / TILE_ROWS]->data + 
+		(size_t)(row % TILE_ROWS) * this->cols;
+}
+
+/* Returns the vertices of the given row to be written, copying its tile */
+/* first if it is shared with another mesh. A snapshot may be released   */
+/* by the journal or writer thread, so once the tile is found to be no   */
+/* longer shared the fence orders that thread's last reads of it before  */
+/* the writes made here.                                                 */
+vec4* Mesh::getWritableRow(unsigned int row)
+{
+	assert(row < this->rows);
+	std::shared_ptr<MeshTile>& tile = this->tiles[row / TILE_ROWS];
+	if(tile.use_count() != 1)
+	{
+		tile = std::make_shared<MeshTile>(*tile);
+	}
+	else
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return tile->data + (size_t)(row % TILE_ROWS) * this->cols;
+}
+
+/* Returns the number of tiles the rows are stored in. */
+unsigned int Mesh::getTileCount() const
+{
+	return (unsigned int)this->tiles.size();
+}
+
+/* Returns true if the given tile of this mesh is shared with the same tile */
+/* of the other mesh, so neither has changed it since one was copied from   */
+/* the other.                                                               */
+bool Mesh::sharesTile(const Mesh* other, unsigned int tile) const
+{
+	return tile < this->tiles.size() && tile < other->tiles.size() &&
+		this->tiles[tile] == other->tiles[tile];
+}
+
+/* Makes this mesh share every tile of the other mesh, which must have as */
+/* many rows and columns, so the heights return to those of the other     */
+/* without copying them.                                                  */
+void Mesh::shareTiles(const Mesh* other)
+{
+	assert(other->rows == this->rows && other->cols == this->cols);
+	this->tiles = other->tiles;
+}
+
+/* Returns true if the vertices of this mesh are stored in a file. */
+bool Mesh::isOutOfCore() const
+{
+	return this->tiles[0]->file != NULL;
+}
+
+/* Gives the advice about the rows from begin up to end to the OS, for */
+/* the tiles stored in a file.                                         */
+void Mesh::adviseRows(unsigned int begin, unsigned int end, 
+	void (*advice)(const void* address, size_t bytes)) const
+{
+	end = std::min(end, this->rows);
+	while(begin < end)
 	{
-		this->vertices->at(r)->clear();
+		unsigned int tileEnd = std::min(end, 
+			(begin / TILE_ROWS + 1) * TILE_ROWS);
+		if(this->tiles[begin / TILE_ROWS]->file)
+		{
+			advice(this->getRow(begin), 
+				(size_t)(tileEnd - begin) * this->cols * sizeof(vec4));
+		}
+		begin = tileEnd;
+	}
+}
+
+/* Hints that the rows from begin up to end will be read soon, so an */
+/* out-of-core mesh starts paging them in.                           */
+void Mesh::prefetchRows(unsigned int begin, unsigned int end) const
+{
+	this->adviseRows(begin, end, MappedFile::prefetch);
+}
+
+/* Hints that the rows from begin up to end will not be read again soon, */
+/* so an out-of-core mesh lets the OS page them out.                     */
+void Mesh::releaseRows(unsigned int begin, unsigned int end) const
+{
+	this->adviseRows(begin, end, MappedFile::release);
+}
+
+/* Copies every tile shared with another mesh, so the rows can be written */
+/* from several threads at once.                                          */
+void Mesh::makeWritable()
+{
+	for (unsigned int r = 0; r < this->rows; r += TILE_ROWS)
+	{
+		this->getWritableRow(r);
 	}
-	this->vertices->clear();
-	delete this->vertices;
 }
 
 /* Returns the number of rows in the mesh. */
 const unsigned int Mesh::getRows() const
 {
-	return this->vertices->size();
+	return this->rows;
 }
 		
 /* Returns the number of rows in the mesh. */
 const unsigned int Mesh::getCols() const
 {
-	return this->vertices->at(0)->size();
+	return this->cols;
 }
 		
 /* Returns the width of this mesh. */
@@ -81,16 +310,16 @@ const float Mesh::getDepth() const
 	return this->depth;
 }
 
-/* Deletes the old color and sets it to the given new one. */
+/* Sets the color to a copy of the given new one. */
 void Mesh::setColor(const Color* newColor)
 {
-	this->color = newColor;
+	this->color = *newColor;
 }
 
 /* Returns a constant pointer to the color of this face. */
 const Color* Mesh::getColor() const
 {
-	return this->color;
+	return &(this->color);
 }
 
 /* Sets the height of a vertex at the given row and column number. */
@@ -101,7 +330,7 @@ void Mesh::setHeight(const unsigned int row, const unsigned int col,
 	assert(row < this->getRows() && col < this->getCols());
 
 	/* Set the height. */
-	this->vertices->at(row)->at(col)[1] = height;
+	this->getWritableRow(row)[col][1] = height;
 }
 
 /* Sets the vertex at the given row and column number with the new vec4. */
@@ -110,7 +339,7 @@ void Mesh::setVertex(const unsigned int row, const unsigned int col,
 {
 	/* Check the row and col are in bounds. */
 	assert(row < this->getRows() && col < this->getCols());
-	this->vertices->at(row)->at(col) = newVertex;
+	this->getWritableRow(row)[col] = newVertex;
 }
 
 /* Returns the vertex at the given row and column number. */
@@ -119,7 +348,7 @@ const vec4 Mesh::getVertex(unsigned int row, unsigned int col) const
 	/* Check the row and col are in bounds. */
 	assert(row < this->getRows() && col < this->getCols());
 	
-	return this->vertices->at(row)->at(col);
+	return this->getRow(row)[col];
 }
 
 /* Set the current snow cap height. */
@@ -134,10 +363,250 @@ const float Mesh::getSnowCapHeight() const
 	return this->snowCapHeight;
 }
 
+/* Sets the height of every vertex to a random value between -range/2 and */
+/* range/2.                                                               */
+void Mesh::randomize(const float range)
+{
+	this->randomize(range, (unsigned int)rand());
+}
+
+/* Returns a random number from 0 up to 1 that only depends on the seed and */
+/* index, so each thread can generate the numbers of its own rows and the  */
+/* same seed always gives the same heights on every platform.              */
+static inline float hashUniform(unsigned int seed, unsigned int index)
+{
+	unsigned int hash = index * 0x9e3779b9u ^ seed * 0x85ebca6bu;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return (hash >> 8) * (1.0f / (1 << 24));
+}
+
+/* Returns a random number from 0 up to 1 that only depends on the seed */
+/* and the row and column, so meshes cut from the same world find the    */
+/* same number for the vertices they share.                              */
+static inline float hashUniform(unsigned int seed, int row, int col)
+{
+	return hashUniform(seed ^ (unsigned int)row * 0xcb1ab31fu, 
+		(unsigned int)col);
+}
+
+/* Sets the height of every vertex to a random value between -range/2 and */
+/* range/2, generated from the given seed so the same seed always gives   */
+/* the same heights.                                                      */
+void Mesh::randomize(const float range, const unsigned int seed)
+{
+	TRACE_SCOPE("Mesh::randomize");
+
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int r, vec4* row)
+	{
+		unsigned int index = r * cols;
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			row[c][1] = hashUniform(seed, index + c) * range - range / 2.0f;
+		}
+	});
+}
+
+/* Copies the height of every vertex, row by row, into heights, which */
+/* must hold getRows()*getCols() floats.                              */
+void Mesh::getHeights(float* heights) const
+{
+	for (unsigned int r = 0; r < this->getRows(); r++)
+	{
+		const vec4* row = this->getRow(r);
+		for (unsigned int c = 0; c < this->getCols(); c++)
+		{
+			*(heights++) = row[c][1];
+		}
+	}
+}
+
+/* Sets the height of every vertex, row by row, from heights. */
+void Mesh::setHeights(const float* heights)
+{
+	for (unsigned int r = 0; r < this->getRows(); r++)
+	{
+		vec4* row = this->getWritableRow(r);
+		for (unsigned int c = 0; c < this->getCols(); c++)
+		{
+			row[c][1] = *(heights++);
+		}
+	}
+}
+
+/* Sets the height of every vertex to zero. */
+void Mesh::flatten()
+{
+	TRACE_SCOPE("Mesh::flatten");
+
+	this->fillHeights(0);
+}
+
+#ifdef VEC4_USE_SSE
+/* Returns a register with every bit of the height, y, set and the other */
+/* components clear, to pick out the heights of vertices.                */
+static inline __m128 heightMask()
+{
+	return _mm_cmpneq_ps(_mm_set_ps(0, 0, 1, 0), _mm_setzero_ps());
+}
+#endif
+
+/* Sets the height of every vertex to the given height. */
+void Mesh::fillHeights(const float height)
+{
+	TRACE_SCOPE("Mesh::fillHeights");
+
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int, vec4* row)
+	{
+		unsigned int c = 0;
+#ifdef VEC4_USE_SSE
+		/* Replace the height bits of each vertex. */
+		const __m128 mask = heightMask();
+		const __m128 heights = _mm_set_ps(0, 0, height, 0);
+		for (; c < cols; c++)
+		{
+			row[c] = vec4(_mm_or_ps(_mm_andnot_ps(mask, row[c].simd()), 
+				heights));
+		}
+#endif
+		for (; c < cols; c++)
+		{
+			row[c][1] = height;
+		}
+	});
+}
+
+/* Adds the given amount to the height of every vertex. */
+void Mesh::addHeights(const float amount)
+{
+	TRACE_SCOPE("Mesh::addHeights");
+
+	unsigned int cols = this->getCols();
+	const vec4 offset = vec4(0, amount, 0, 0);
+	this->forEachRow([&](unsigned int, vec4* row)
+	{
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			row[c] += offset;
+		}
+	});
+}
+
+/* Multiplies the height of every vertex by the given factor. */
+void Mesh::scaleHeights(const float factor)
+{
+	TRACE_SCOPE("Mesh::scaleHeights");
+
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int, vec4* row)
+	{
+		unsigned int c = 0;
+#ifdef VEC4_USE_SSE
+		/* Multiply the other components by one. */
+		const __m128 factors = _mm_set_ps(1, 1, factor, 1);
+		for (; c < cols; c++)
+		{
+			row[c] = vec4(_mm_mul_ps(row[c].simd(), factors));
+		}
+#endif
+		for (; c < cols; c++)
+		{
+			row[c][1] *= factor;
+		}
+	});
+}
+
+/* Clamps the height of every vertex between min and max. */
+void Mesh::clampHeights(const float min, const float max)
+{
+	TRACE_SCOPE("Mesh::clampHeights");
+
+	assert(min <= max);
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int, vec4* row)
+	{
+		unsigned int c = 0;
+#ifdef VEC4_USE_SSE
+		/* Clamp every component, then keep only the clamped height. */
+		const __m128 mask = heightMask();
+		const __m128 mins = _mm_set1_ps(min);
+		const __m128 maxs = _mm_set1_ps(max);
+		for (; c < cols; c++)
+		{
+			__m128 vertex = row[c].simd();
+			__m128 clamped = _mm_min_ps(_mm_max_ps(vertex, mins), maxs);
+			row[c] = vec4(_mm_or_ps(_mm_andnot_ps(mask, vertex), 
+				_mm_and_ps(mask, clamped)));
+		}
+#endif
+		for (; c < cols; c++)
+		{
+			row[c][1] = std::min(std::max(row[c][1], min), max);
+		}
+	});
+}
+
+/* Sets the height of every vertex to the value returned by function(row, */
+/* col, height). The function is called from several threads at once, so */
+/* it must only read shared state.                                       */
+void Mesh::applyHeights(const std::function<float(unsigned int row, 
+	unsigned int col, float height)>& function)
+{
+	TRACE_SCOPE("Mesh::applyHeights");
+
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int r, vec4* row)
+	{
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			row[c][1] = function(r, c, row[c][1]);
+		}
+	});
+}
+
+/* Calls body(row, vertices) for every row, split across the threads. Each */
+/* thread is given whole rows, so the shared tiles are copied before the   */
+/* threads start.                                                          */
+void Mesh::forEachRow(const std::function<void(unsigned int row, 
+	vec4* vertices)>& body)
+{
+	this->makeWritable();
+	size_t rowsPerTask = std::max((size_t)1, 
+		(size_t)(VERTICES_PER_TASK / this->getCols()));
+	Parallel::forRange(0, this->getRows(), rowsPerTask, [&](size_t begin, 
+		size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			body((unsigned int)r, this->getWritableRow((unsigned int)r));
+		}
+	});
+}
+
+/* Multiplies every vertex by the given matrix in place, as a point so */
+/* translations apply. The width and depth are unchanged.              */
+void Mesh::transform(const mat4& matrix)
+{
+	TRACE_SCOPE("Mesh::transform");
+
+	unsigned int cols = this->getCols();
+	this->forEachRow([&](unsigned int, vec4* row)
+	{
+		matrix.transformPoints(row, row, cols);
+	});
+}
+
 /* Returns the indecies of the userRay's selected vertex. Returns NULL if no */
 /* vertex selected.                                                          */
 std::vector<unsigned int>* Mesh::selectVertex(ray userRay)
 {
+	TRACE_SCOPE("Mesh::selectVertex");
+
 	/* Step 6: For each vertex, v, in the mesh, compute the distance from v */
 	/* to the ray, R, computed in step 5. If the distance is less than or   */
 	/* equal to r, then select that vertex.                                 */
@@ -149,15 +618,19 @@ std::vector<unsigned int>* Mesh::selectVertex(ray userRay)
 
 	for (unsigned int r = 0; r < this->getRows(); r++)
 	{
+		const vec4* row = this->getRow(r);
 		for (unsigned int c = 0; c < this->getCols(); c++)
 		{
-			vec4 v = this->vertices->at(r)->at(c);
+			vec4 v = row[c];
 			float distance = (rayDirection % (v - userRay.origin())).length();
 			if(distance <= SELECTION_RADIUS && distance < closestDistance)
 			{
-				closestIndecies = new std::vector<unsigned int>();
-				closestIndecies->push_back(r);
-				closestIndecies->push_back(c);
+				if(!closestIndecies)
+				{
+					closestIndecies = newIndecies(r, c);
+				}
+				closestIndecies->at(0) = r;
+				closestIndecies->at(1) = c;
 				closestDistance = distance;
 			}
 		}
@@ -166,9 +639,41 @@ std::vector<unsigned int>* Mesh::selectVertex(ray userRay)
 	return closestIndecies;
 }
 
-/* Copies this mesh into a larger mesh and fractalizes it. */
-Mesh* Mesh::fractalize() const
+/* Returns a new copy of this mesh that later edits to this mesh do not */
+/* change, so it can be read from another thread.                       */
+Mesh* Mesh::snapshot() const
+{
+	TRACE_SCOPE("Mesh::snapshot");
+
+	return new Mesh(*this);
+}
+
+/* Returns true if the given cancel flag is set. */
+static inline bool isCancelled(const std::atomic<bool>* cancelled)
+{
+	return cancelled && cancelled->load(std::memory_order_relaxed);
+}
+
+/* Copies this mesh into a larger mesh and fractalizes it with a new */
+/* seed. If cancelled is given and becomes true the new mesh is       */
+/* deleted and NULL is returned.                                      */
+Mesh* Mesh::fractalize(const std::atomic<bool>* cancelled) const
+{
+	return this->fractalize((unsigned int)rand(), 0, 0, cancelled);
+}
+
+/* Copies this mesh into a larger mesh and fractalizes it. Every new     */
+/* vertex is the average of its two neighbours along its row or column,  */
+/* moved up or down by up to half the spacing of this mesh's vertices.   */
+/* The displacement is hashed from the seed and the vertex's row and     */
+/* column in the world, so the vertices on an edge only depend on the    */
+/* edge and the rows can be split across the threads. If cancelled is    */
+/* given and becomes true the new mesh is deleted and NULL is returned.  */
+Mesh* Mesh::fractalize(unsigned int seed, int firstRow, int firstCol,
+	const std::atomic<bool>* cancelled) const
 {
+	TRACE_SCOPE("Mesh::fractalize");
+
 	//////////////////////////
 	// Calculate the range. //
 	//////////////////////////
@@ -186,70 +691,124 @@ Mesh* Mesh::fractalize() const
 
 	/* Create a new larger mesh. */
 	Mesh* newMesh = new Mesh((this->getRows()*2)-2, (this->getCols()*2)-2,
-		this->getWidth(), this->getDepth(), this->color, this->snowCapHeight);
+		this->getWidth(), this->getDepth(), &(this->color), 
+		this->snowCapHeight);
+	newMesh->makeWritable();
 
-	//////////////////////////////////////
-	// Copy over the original vertices. //
-	//////////////////////////////////////
+	const unsigned int cols = newMesh->getCols();
+	/* Row and column of the new mesh's first vertex in the world. */
+	const int worldRow = 2 * firstRow, worldCol = 2 * firstCol;
+	const size_t rowsPerTask = std::max((size_t)1, 
+		(size_t)(VERTICES_PER_TASK / cols));
+	/* Original rows filled at once, a band of the new mesh's rows. */
+	const unsigned int band = std::max(1u, bandRows(cols) / 2);
 
-	/* Copy over the original values of the Mesh to the new mesh's even */
-	/* indecies. Run time complexity of O((r*c)/4).                     */
-	for (unsigned int newRow = 0, originalRow = 0; newRow < newMesh->getRows();
-		 newRow+=2, originalRow++)
+	///////////////////////////////////////////////////////////
+	// Copy over the original vertices, and add new averaged //
+	// vertices between them changed by a random delta.      //
+	///////////////////////////////////////////////////////////
+
+	/* Both passes stream through the meshes a band of rows at a time, */
+	/* the odd rows following the even rows they are averaged from.    */
+	unsigned int nextOddRow = 0;
+	for (unsigned int first = 0; first < this->getRows() && 
+		!isCancelled(cancelled); first += band)
 	{
-		for (unsigned int newCol = 0, originalCol = 0; newCol < newMesh->
-			 getCols(); newCol+=2, originalCol++)
-		{
-			newMesh->setVertex(newRow, newCol, 
-				this->getVertex(originalRow, originalCol));
-		}
-	}
+		unsigned int last = std::min(this->getRows(), first + band);
+		this->prefetchRows(last, last + band);
 
-	//////////////////////////////////////////////////////////////
-	// Add new averaged vertices between the original vertices, //
-	// and change their heights by a random delta.              //
-	//////////////////////////////////////////////////////////////
+		/* Fill the even rows from the original rows. Run time complexity */
+		/* of O((r*c)/2).                                                 */
+		Parallel::forRange(first, last, rowsPerTask, [&](size_t begin, 
+			size_t end)
+		{
+			for (size_t originalRow = begin; originalRow < end && 
+				!isCancelled(cancelled); originalRow++)
+			{
+				unsigned int r = 2 * (unsigned int)originalRow;
+				const vec4* origRow = this->getRow(
+					(unsigned int)originalRow);
+				vec4* row = newMesh->getWritableRow(r);
+				for (unsigned int newCol = 0, originalCol = 0; 
+					newCol < cols; newCol+=2, originalCol++)
+				{
+					row[newCol] = origRow[originalCol];
+				}
+				for (unsigned int c = 1; c < cols; c+=2)
+				{
+					vec4 prev = row[c - 1];
+					vec4 next = row[c + 1];
+					float delta = hashUniform(seed, worldRow + (int)r, 
+						worldCol + (int)c) * range - (range/2.0f);
+					row[c] = vec4((prev[0]+next[0])/2.0f,
+						(prev[1]+next[1])/2.0f+ delta, 
+						(prev[2]+next[2])/2.0f, 1.0);
+				}
+			}
+		});
 
-	/* Create new vectors that are averages of the original mesh's vectors. */
-	/* Run time complexity of O((r*c)/4).                                   */
-	for (unsigned int r = 0; r < newMesh->getRows(); r+=2)
-	{
-		for (unsigned int c = 1; c < newMesh->getCols(); c+=2)
+		/* Create new rows that are average of the above and below */ 
+		/* column values. Run time complexity of O((r*c)/2).       */
+		Parallel::forRange(nextOddRow, last - 1, rowsPerTask, [&](
+			size_t begin, size_t end)
 		{
-			vec4 prev = newMesh->getVertex(r, c - 1);
-			vec4 next = newMesh->getVertex(r, c + 1);
-			float delta = ((float)rand()/(float)RAND_MAX)*range-(range/2.0f);
-			newMesh->setVertex(r, c, vec4((prev[0]+next[0])/2.0f,
-				(prev[1]+next[1])/2.0f+ delta, (prev[2]+next[2])/2.0f, 1.0));
-		}
+			for (size_t i = begin; i < end && !isCancelled(cancelled); i++)
+			{
+				unsigned int r = 2 * (unsigned int)i + 1;
+				const vec4* above = newMesh->getRow(r - 1);
+				const vec4* below = newMesh->getRow(r + 1);
+				vec4* row = newMesh->getWritableRow(r);
+				for (unsigned int c = 0; c < cols; c++)
+				{
+					vec4 prev = above[c];
+					vec4 next = below[c];
+					float delta = hashUniform(seed, worldRow + (int)r, 
+						worldCol + (int)c) * range - (range/2.0f);
+					row[c] = vec4((prev[0]+next[0])/2.0f,
+						(prev[1]+next[1])/2.0f+ delta, 
+						(prev[2]+next[2])/2.0f, 1.0);
+				}
+			}
+		});
+		nextOddRow = last - 1;
+
+		/* Only the last even row is read again, by the next band. */
+		this->releaseRows(first, last);
+		newMesh->releaseRows(2 * first, 2 * (last - 1));
 	}
 
-	/* Create new rows that are average of the above and below column */ 
-	/* values. Run time complexity of O((r*c)/2).                     */
-	for (unsigned int r = 1; r < newMesh->getRows(); r+=2)
+	if(isCancelled(cancelled))
 	{
-		for (unsigned int c = 0; c < newMesh->getCols(); c++)
-		{
-			vec4 prev = newMesh->getVertex(r-1, c);
-			vec4 next = newMesh->getVertex(r+1, c);
-			float delta = ((float)rand()/(float)RAND_MAX)*range-(range/2.0f);
-			newMesh->setVertex(r, c, vec4((prev[0]+next[0])/2.0f,
-				(prev[1]+next[1])/2.0f+ delta, (prev[2]+next[2])/2.0f, 1.0));
-		}
+		delete newMesh;
+		return NULL;
 	}
-
 	return newMesh;
 }
 
-Mesh* Mesh::smooth() const
+/* Copies this mesh into a larger mesh and subdivides it using the */
+/* Catmull-Clark Subdivision Algorithm. The stencils read the rows  */
+/* directly and accumulate each sum in place, so every weighted     */
+/* average is computed in registers without a copy per vertex. If  */
+/* cancelled is given and becomes true the new mesh is deleted and  */
+/* NULL is returned.                                                */
+Mesh* Mesh::smooth(const std::atomic<bool>* cancelled) const
 {
+	TRACE_SCOPE("Mesh::smooth");
+
 	////////////////////////
 	// Create a new mesh. //
 	////////////////////////
 
 	/* Create a new larger mesh. */
 	Mesh* newMesh = new Mesh((this->getRows()*2)-2, (this->getCols()*2)-2,
-		this->getWidth(), this->getDepth(), this->color, this->snowCapHeight);
+		this->getWidth(), this->getDepth(), &(this->color), 
+		this->snowCapHeight);
+
+	const unsigned int rows = newMesh->getRows();
+	const unsigned int cols = newMesh->getCols();
+
+	/* Each step below fills part of one row of the new mesh, reading */
+	/* only that row and the rows next to it.                         */
 
 	//////////////////////////////////////
 	// Copy over the original vertices. //
@@ -257,40 +816,48 @@ Mesh* Mesh::smooth() const
 
 	/* Copy over the original values of the Mesh to the new mesh's even */
 	/* indecies. Run time complexity of O((r*c)/4).                     */
-	for (unsigned int newRow = 0, originalRow = 0; newRow < newMesh->getRows();
-		 newRow+=2, originalRow++)
+	auto copyVertices = [&](unsigned int r)
 	{
-		for (unsigned int newCol = 0, originalCol = 0; newCol < newMesh->
-			 getCols(); newCol+=2, originalCol++)
+		if(r % 2 != 0)
 		{
-			newMesh->setVertex(newRow, newCol, 
-				this->getVertex(originalRow, originalCol));
+			return;
 		}
-	}
+		vec4* row = newMesh->getWritableRow(r);
+		const vec4* origRow = this->getRow(r / 2);
+		for (unsigned int newCol = 0, originalCol = 0; newCol < cols; 
+			newCol+=2, originalCol++)
+		{
+			row[newCol] = origRow[originalCol];
+		}
+	};
 
 	/////////////////////////////////////////////////////
 	// Create new vertices at the center of each face. //
 	/////////////////////////////////////////////////////
 	
 	/* Average the vertices of the face to make a centered face vertex. */
-	for (unsigned int r = 1; r < newMesh->getRows(); r+=2)
+	auto addFaceVertices = [&](unsigned int r)
 	{
-		for (unsigned int c = 1; c < newMesh->getCols(); c+=2)
+		if(r % 2 != 1)
+		{
+			return;
+		}
+		const vec4* above = newMesh->getRow(r - 1);
+		vec4* row = newMesh->getWritableRow(r);
+		const vec4* below = newMesh->getRow(r + 1);
+		for (unsigned int c = 1; c < cols; c+=2)
 		{
-			/* Determine the face's vertices. */
-			vec4 avgVec;
-			
 			/* Sum up the connected vertices. */
-			avgVec =          newMesh->getVertex(r - 1, c - 1);
-			avgVec = avgVec + newMesh->getVertex(r + 1, c - 1);
-			avgVec = avgVec + newMesh->getVertex(r + 1, c + 1);
-			avgVec = avgVec + newMesh->getVertex(r - 1, c + 1);
+			vec4 avgVec = above[c - 1];
+			avgVec += below[c - 1];
+			avgVec += below[c + 1];
+			avgVec += above[c + 1];
 			/* Average the sum. */
-			avgVec = avgVec / 4.0f;
-			
-			newMesh->setVertex(r, c, avgVec);
+			avgVec /= 4.0f;
+		
+			row[c] = avgVec;
 		}
-	}
+	};
 
 	//////////////////////////////////////////////////////////////
 	// For each edge in the mesh, create a new edge midpoint    //
@@ -298,167 +865,575 @@ Mesh* Mesh::smooth() const
 	// and the adjacent face vertices.                          //
 	//////////////////////////////////////////////////////////////
 
-	/* Iterate through even rows creating edge vertices. */
-	for (unsigned int r = 0; r < newMesh->getRows(); r+=2)
+	/* Create the edge vertices of the even rows. */
+	auto addEvenEdgeVertices = [&](unsigned int r)
 	{
-		for (unsigned int c = 1; c < newMesh->getCols(); c+=2)
+		if(r % 2 != 0)
+		{
+			return;
+		}
+		vec4* row = newMesh->getWritableRow(r);
+		const vec4* above = (r > 0) ? newMesh->getRow(r - 1) : NULL;
+		const vec4* below = (r < rows-1) ? newMesh->getRow(r + 1) : NULL;
+		for (unsigned int c = 1; c < cols; c+=2)
 		{
 			float n = 2.0f;
-			vec4 avgVec; 
 
 			/* Sum up the connected vertices. */
-			avgVec =          newMesh->getVertex(r, c - 1);
-			avgVec = avgVec + newMesh->getVertex(r, c + 1);
-			
+			vec4 avgVec = row[c - 1];
+			avgVec += row[c + 1];
+		
 			/* Sum up the connected face vertices. */
-			if(r > 0)
+			if(above)
 			{
-				avgVec = avgVec + newMesh->getVertex(r-1, c);
+				avgVec += above[c];
 				n++;
 			}
-			if(r < newMesh->getRows()-1)
+			if(below)
 			{
-				avgVec = avgVec + newMesh->getVertex(r+1, c);
+				avgVec += below[c];
 				n++;
 			}
 
 			/* Average the sum. */
-			avgVec = avgVec / n;
+			avgVec /= n;
 
-			newMesh->setVertex(r, c, avgVec);
+			row[c] = avgVec;
 		}
-	}
+	};
 
-
-	/* Iterate through odd rows creating edge vertices. */
-	for (unsigned int r = 1; r < newMesh->getRows(); r+=2)
+	/* Create the edge vertices of the odd rows. */
+	auto addOddEdgeVertices = [&](unsigned int r)
 	{
-		for (unsigned int c = 0; c < newMesh->getCols(); c+=2)
+		if(r % 2 != 1)
+		{
+			return;
+		}
+		const vec4* above = newMesh->getRow(r - 1);
+		vec4* row = newMesh->getWritableRow(r);
+		const vec4* below = newMesh->getRow(r + 1);
+		for (unsigned int c = 0; c < cols; c+=2)
 		{
 			float n = 2.0f;
-			vec4 avgVec;
 
 			/* Sum up the connected vertices. */
-			avgVec =		  newMesh->getVertex(r - 1, c);
-			avgVec = avgVec + newMesh->getVertex(r + 1, c);
+			vec4 avgVec = above[c];
+			avgVec += below[c];
 
 			/* Sum up the connected faces. */
 			if(c > 0)
 			{
-				avgVec = avgVec + newMesh->getVertex(r, c - 1);
+				avgVec += row[c - 1];
 				n++;
 			}
-			if(c < newMesh->getCols()-1)
+			if(c < cols-1)
 			{
-				avgVec = avgVec + newMesh->getVertex(r, c + 1);
+				avgVec += row[c + 1];
 				n++;
 			}
 
-			avgVec = avgVec / n;
+			avgVec /= n;
 
-			newMesh->setVertex(r, c, avgVec);
+			row[c] = avgVec;
 		}
-	}
+	};
 	
 	///////////////////////////////////////////////////////////////////
 	// Update the original vertices to be an weighted average of the //
 	// surrounding face centres, edge midpoints, and vertex.         //
 	///////////////////////////////////////////////////////////////////
-	for (unsigned int r = 0, origR = 0; r < newMesh->getRows(); r += 2, 
-		origR++)
+	auto updateVertices = [&](unsigned int r)
 	{
-		for (unsigned int c = 0, origC = 0; c < newMesh->getRows(); c += 2, 
-			origC++)
+		if(r % 2 != 0)
+		{
+			return;
+		}
+		unsigned int origR = r / 2;
+		vec4* row = newMesh->getWritableRow(r);
+		const vec4* above = (r > 0) ? newMesh->getRow(r - 1) : NULL;
+		const vec4* below = (r < rows-1) ? newMesh->getRow(r + 1) : NULL;
+		const vec4* origRow = this->getRow(origR);
+		const vec4* origAbove = (r > 0) ? this->getRow(origR - 1) : NULL;
+		const vec4* origBelow = (r < rows-1) ? this->getRow(origR + 1) : NULL;
+		for (unsigned int c = 0, origC = 0; c < cols; c += 2, origC++)
 		{
 			/* Sum up faces the vertex is part of. */
 			vec4 faceAvg = vec4(0, 0, 0, 0);
 			float f = 0;
 			if(r > 0 && c > 0)
 			{
-				faceAvg = faceAvg + newMesh->getVertex(r - 1, c - 1);
+				faceAvg += above[c - 1];
 				f++;
 			}
-			if(r > 0 && c < newMesh->getCols()-1)
+			if(r > 0 && c < cols-1)
 			{
-				faceAvg = faceAvg + newMesh->getVertex(r - 1, c + 1);
+				faceAvg += above[c + 1];
 				f++;
 			}
-			if(r < newMesh->getRows()-1 && c > 0)
+			if(r < rows-1 && c > 0)
 			{
-				faceAvg = faceAvg + newMesh->getVertex(r + 1, c - 1);
+				faceAvg += below[c - 1];
 				f++;
 			}
-			if(r < newMesh->getRows()-1 && c < newMesh->getCols()-1)
+			if(r < rows-1 && c < cols-1)
 			{
-				faceAvg = faceAvg + newMesh->getVertex(r + 1, c + 1);
+				faceAvg += below[c + 1];
 				f++;
 			}
 			/* Average */
-			faceAvg = faceAvg / f;
+			faceAvg /= f;
 
 			/* Sum up all of the edge midpoints connected to the vertex. */
+			const vec4& vertex = origRow[origC];
 			vec4 edgeAvg = vec4(0, 0, 0, 0);
 			float valence = 0.0;
 			/* Up Edge */
 			if(r > 0)
 			{
-				vec4 edgeMid = (this->getVertex(origR, origC) +
-					this->getVertex(origR - 1, origC)) / 2.0f;
-				edgeAvg = edgeAvg + edgeMid;
+				edgeAvg += (vertex + origAbove[origC]) / 2.0f;
 				valence++;
 			}
 			/* Down Edge */
-			if(r < newMesh->getRows()-1)
+			if(r < rows-1)
 			{
-				vec4 edgeMid = (this->getVertex(origR, origC) +
-					this->getVertex(origR + 1, origC)) / 2.0f;
-				edgeAvg = edgeAvg + edgeMid;
+				edgeAvg += (vertex + origBelow[origC]) / 2.0f;
 				valence++;
 			}
 			/* Left Edge */
 			if(c > 0)
 			{
-				vec4 edgeMid = (this->getVertex(origR, origC) +
-					this->getVertex(origR, origC - 1)) / 2.0f;
-				edgeAvg = edgeAvg + edgeMid;
+				edgeAvg += (vertex + origRow[origC - 1]) / 2.0f;
 				valence++;
 			}
 			/* Right Edge */
-			if(c < newMesh->getCols()-1)
+			if(c < cols-1)
 			{
-				vec4 edgeMid = (this->getVertex(origR, origC) +
-					this->getVertex(origR, origC + 1)) / 2.0f;
-				edgeAvg = edgeAvg + edgeMid;
+				edgeAvg += (vertex + origRow[origC + 1]) / 2.0f;
 				valence++;
 			}
 			/* Average */
-			edgeAvg = edgeAvg / valence;
-
-			/* Move the vertex. */
-			vec4 origV = newMesh->getVertex(r, c);
+			edgeAvg /= valence;
 
 			/* Update the vertex. */
 			valence += f;
-			vec4 newVertex = (faceAvg + (2 * edgeAvg) + (valence-3)*origV) / 
-				valence;
-			newMesh->setVertex(r, c, newVertex);
+			vec4 newVertex = faceAvg;
+			newVertex += 2 * edgeAvg;
+			newVertex += (valence-3) * row[c];
+			newVertex /= valence;
+			row[c] = newVertex;
+		}
+	};
+
+	//////////////////////////////////////////////
+	// Run the steps through the rows together. //
+	//////////////////////////////////////////////
+
+	/* Each step runs a row behind the step before it, so the rows it    */
+	/* reads are finished and an original vertex is only updated once    */
+	/* every step reading it is done. The steps so stream through the    */
+	/* meshes together a band of rows at a time, instead of each passing */
+	/* over the whole new mesh.                                          */
+	const std::function<void(unsigned int)> steps[] = {copyVertices,
+		addFaceVertices, addEvenEdgeVertices, addOddEdgeVertices,
+		updateVertices};
+	const unsigned int numSteps = sizeof(steps) / sizeof(steps[0]);
+	const unsigned int band = bandRows(cols);
+	unsigned int done[numSteps] = {0};
+	unsigned int end = 0, released = 0, releasedOriginal = 0;
+	while(done[numSteps - 1] < rows)
+	{
+		end = std::min(rows, end + band);
+		this->prefetchRows(end / 2, (end + band) / 2 + 1);
+		for (unsigned int step = 0; step < numSteps; step++)
+		{
+			unsigned int last = (end == rows) ? rows : 
+				end - std::min(end, step);
+			for (; done[step] < last; done[step]++)
+			{
+				if(isCancelled(cancelled))
+				{
+					delete newMesh;
+					return NULL;
+				}
+				steps[step](done[step]);
+			}
 		}
+
+		/* The next row updated reads the row above it and the original */
+		/* row above its own, so the rows before those are done with.   */
+		unsigned int updated = done[numSteps - 1];
+		unsigned int finished = std::max(released, 
+			updated - std::min(updated, 1u));
+		unsigned int finishedOriginal = std::max(releasedOriginal, 
+			updated / 2 - std::min(updated / 2, 1u));
+		newMesh->releaseRows(released, finished);
+		this->releaseRows(releasedOriginal, finishedOriginal);
+		released = finished;
+		releasedOriginal = finishedOriginal;
 	}
 
 	return newMesh;
 }
 
+/* Moves material downhill wherever a vertex is steeper than the talus     */
+/* angle, in degrees, above any of its eight neighbours. Each iteration    */
+/* is two passes over a copy of the heights so the rows can run on every   */
+/* thread without races. The first finds how much each vertex sheds,       */
+/* strength of half its steepest excess, and the share given per unit of   */
+/* excess to each lower neighbour. The second gathers the shares flowing   */
+/* into each vertex from its higher neighbours into a second buffer. The   */
+/* material moved is conserved. If cancelled is given and becomes true the */
+/* heights are left unchanged and false is returned.                       */
+bool Mesh::thermalErode(const unsigned int iterations, const float strength,
+	const float talusAngle, const std::atomic<bool>* cancelled)
+{
+	TRACE_SCOPE("Mesh::thermalErode");
+
+	const unsigned int rows = this->getRows(), cols = this->getCols();
+	const size_t count = (size_t)rows * cols;
+	std::vector<float> heights(count), next(count), shares(count);
+	MemoryTracker::allocate(TEMPORARIES, 3 * count * sizeof(float));
+	this->getHeights(heights.data());
+
+	/* Offsets to the eight neighbours and the drop to each that is just */
+	/* at the talus angle.                                               */
+	const int rowOffsets[8] = {0, 0, -1, 1, -1, -1, 1, 1};
+	const int colOffsets[8] = {-1, 1, 0, 0, -1, 1, -1, 1};
+	const float slope = (float)tan(PI * talusAngle / 180.0);
+	const float spacingX = this->getWidth() / (cols - 1);
+	const float spacingZ = this->getDepth() / (rows - 1);
+	const float diagonal = sqrt(spacingX * spacingX + spacingZ * spacingZ);
+	const float talus[8] = {slope * spacingX, slope * spacingX,
+		slope * spacingZ, slope * spacingZ, slope * diagonal,
+		slope * diagonal, slope * diagonal, slope * diagonal};
+	const float halfStrength = 0.5f * strength;
+	ptrdiff_t offsets[8];
+	for (int k = 0; k < 8; k++)
+	{
+		offsets[k] = rowOffsets[k] * (ptrdiff_t)cols + colOffsets[k];
+	}
+
+	/* Sheds from one vertex, which may be on the edge. */
+	auto shedAt = [&](const float* h, unsigned int r, unsigned int c)
+	{
+		size_t i = (size_t)r * cols + c;
+		float excessSum = 0, excessMax = 0;
+		for (int k = 0; k < 8; k++)
+		{
+			int nr = (int)r + rowOffsets[k], nc = (int)c + colOffsets[k];
+			if(nr >= 0 && nr < (int)rows && nc >= 0 && nc < (int)cols)
+			{
+				float excess = std::max(0.0f, h[i] - 
+					h[(size_t)nr * cols + nc] - talus[k]);
+				excessSum += excess;
+				excessMax = std::max(excessMax, excess);
+			}
+		}
+		float shed = halfStrength * excessMax;
+		next[i] = h[i] - shed;
+		shares[i] = shed / std::max(excessSum, FLT_MIN);
+	};
+
+	/* Gathers into one vertex, which may be on the edge. */
+	auto gatherAt = [&](const float* h, unsigned int r, unsigned int c)
+	{
+		size_t i = (size_t)r * cols + c;
+		float gathered = 0;
+		for (int k = 0; k < 8; k++)
+		{
+			int nr = (int)r + rowOffsets[k], nc = (int)c + colOffsets[k];
+			if(nr >= 0 && nr < (int)rows && nc >= 0 && nc < (int)cols)
+			{
+				size_t j = (size_t)nr * cols + nc;
+				gathered += shares[j] * std::max(0.0f, h[j] - h[i] - 
+					talus[k]);
+			}
+		}
+		next[i] += gathered;
+	};
+
+	size_t rowsPerTask = std::max((size_t)1, 
+		(size_t)(VERTICES_PER_TASK / cols));
+	for (unsigned int iteration = 0; iteration < iterations; iteration++)
+	{
+		if(isCancelled(cancelled))
+		{
+			MemoryTracker::release(TEMPORARIES, 3 * count * sizeof(float));
+			return false;
+		}
+		const float* h = heights.data();
+
+		Parallel::forRange(0, rows, rowsPerTask, [&](size_t begin, 
+			size_t end)
+		{
+			for (unsigned int r = (unsigned int)begin; r < end; r++)
+			{
+				unsigned int c = 0;
+				if(r == 0 || r == rows - 1)
+				{
+					for (; c < cols; c++)
+					{
+						shedAt(h, r, c);
+					}
+					continue;
+				}
+				shedAt(h, r, c++);
+#ifdef VEC4_USE_SSE
+				/* Compare four vertices inside the edges with each of */
+				/* their neighbours at once.                            */
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 tiny = _mm_set1_ps(FLT_MIN);
+				const __m128 strengths = _mm_set1_ps(halfStrength);
+				for (; c + 4 < cols; c += 4)
+				{
+					size_t i = (size_t)r * cols + c;
+					__m128 height = _mm_loadu_ps(h + i);
+					__m128 excessSum = zero, excessMax = zero;
+					for (int k = 0; k < 8; k++)
+					{
+						__m128 excess = _mm_max_ps(zero, _mm_sub_ps(
+							_mm_sub_ps(height, _mm_loadu_ps(h + i + 
+							offsets[k])), _mm_set1_ps(talus[k])));
+						excessSum = _mm_add_ps(excessSum, excess);
+						excessMax = _mm_max_ps(excessMax, excess);
+					}
+					__m128 shed = _mm_mul_ps(strengths, excessMax);
+					_mm_storeu_ps(&next[i], _mm_sub_ps(height, shed));
+					_mm_storeu_ps(&shares[i], _mm_div_ps(shed, 
+						_mm_max_ps(excessSum, tiny)));
+				}
+#endif
+				for (; c < cols; c++)
+				{
+					shedAt(h, r, c);
+				}
+			}
+		});
+
+		Parallel::forRange(0, rows, rowsPerTask, [&](size_t begin, 
+			size_t end)
+		{
+			for (unsigned int r = (unsigned int)begin; r < end; r++)
+			{
+				unsigned int c = 0;
+				if(r == 0 || r == rows - 1)
+				{
+					for (; c < cols; c++)
+					{
+						gatherAt(h, r, c);
+					}
+					continue;
+				}
+				gatherAt(h, r, c++);
+#ifdef VEC4_USE_SSE
+				const __m128 zero = _mm_setzero_ps();
+				for (; c + 4 < cols; c += 4)
+				{
+					size_t i = (size_t)r * cols + c;
+					__m128 height = _mm_loadu_ps(h + i);
+					__m128 gathered = zero;
+					for (int k = 0; k < 8; k++)
+					{
+						__m128 excess = _mm_max_ps(zero, _mm_sub_ps(
+							_mm_sub_ps(_mm_loadu_ps(h + i + offsets[k]), 
+							height), _mm_set1_ps(talus[k])));
+						gathered = _mm_add_ps(gathered, _mm_mul_ps(
+							_mm_loadu_ps(&shares[i + offsets[k]]), excess));
+					}
+					_mm_storeu_ps(&next[i], _mm_add_ps(
+						_mm_loadu_ps(&next[i]), gathered));
+				}
+#endif
+				for (; c < cols; c++)
+				{
+					gatherAt(h, r, c);
+				}
+			}
+		});
+
+		heights.swap(next);
+	}
+
+	this->applyHeights([&](unsigned int row, unsigned int col, float)
+	{
+		return heights[(size_t)row * cols + col];
+	});
+	MemoryTracker::release(TEMPORARIES, 3 * count * sizeof(float));
+	return true;
+}
+
+/* Saves this mesh to the given OBJ file. The color of the mesh is saved */
+/* to an MTL file of the same name. Returns true if both files were      */
+/* written.                                                               */
+bool Mesh::saveOBJ(const char* filename) const
+{
+	TRACE_SCOPE("Mesh::saveOBJ");
+
+	char* mtlFilename = strcat(extractFilename(filename), ".mtl");
+	//std::cout << extractFilename(filename) << std::endl;
+	std::ofstream outFile(mtlFilename, std::ios::out);
+	if(!(outFile.is_open()))
+	{
+		std::cout << "Unable to save to " << mtlFilename << std::endl;
+		delete[] mtlFilename;
+		return false;
+	}
+
+	/* Write out the materal file. */
+	outFile << "newmtl snow"	<< std::endl
+			<< "illum 4"		<< std::endl
+			<< "Kd 1.0 1.0 1.0" << std::endl
+			<< "Ka 0.0 0.0 0.0" << std::endl
+			<< "Tf 1.0 1.0 1.0" << std::endl
+			<< "Ni 1.00"		<< std::endl
+			<< std::endl
+			<< "newmtl color"	<< std::endl
+			<< "illum 4"		<< std::endl
+			<< "Kd "
+				<< this->getColor()->toString()
+				<< std::endl
+			<< "Ka 0.0 0.0 0.0" << std::endl
+			<< "Tf 1.0 1.0 1.0" << std::endl
+			<< "Ni 1.00"		<< std::endl;
+
+	/* A write that fails part way through, such as to a full disk, */
+	/* only shows once the file is closed.                          */
+	outFile.close();
+	if(outFile.fail())
+	{
+		std::cout << "Unable to save to " << mtlFilename << std::endl;
+		delete[] mtlFilename;
+		return false;
+	}
+
+	/* Save the mesh to an OBJ file through a large buffer, so the many */
+	/* small writes reach the disk in a few large ones.                 */
+	char* exportBuffer = new char[EXPORT_BUFFER_SIZE];
+	MemoryTracker::allocate(EXPORT_BUFFERS, EXPORT_BUFFER_SIZE);
+	std::ofstream objFile;
+	objFile.rdbuf()->pubsetbuf(exportBuffer, EXPORT_BUFFER_SIZE);
+	objFile.open(filename, std::ios::out);
+	if(!(objFile.is_open()))
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		delete[] mtlFilename;
+		delete[] exportBuffer;
+		MemoryTracker::release(EXPORT_BUFFERS, EXPORT_BUFFER_SIZE);
+		return false;
+	}
+	
+	/* Write out the header. */
+	objFile << "########################################################" 
+			<< std::endl << "#"<< std::endl;
+	objFile << "# Created with Mesh Modeler(Copyright Zachary Ferguson)"
+		<< std::endl;
+	objFile << "#" << std::endl 
+			<< "########################################################" 
+			<< std::endl;
+	objFile << "#" << std::endl
+			<< "# Vertices: " << 
+				(this->getRows() * this->getCols())
+			<< std::endl
+			<< "# Faces: "    <<
+			2 * (this->getRows()-1) * (this->getCols()-1)
+			<< std::endl
+			<< "#" << std::endl 
+			<< "########################################################" 
+			<< std::endl;
+		
+	const char* mtlName = extractName(mtlFilename);
+	objFile << "mtllib " << mtlName << std::endl;
+	if(mtlName != mtlFilename)
+	{
+		delete[] mtlName;
+	}
+	delete[] mtlFilename;
+
+	/* Write out the vertices of the mesh. Lines end with '\n' instead of */
+	/* std::endl so the buffer is not flushed after every line. The rows  */
+	/* of an out-of-core mesh are read a band ahead and let go once they  */
+	/* are written.                                                       */
+	unsigned int band = bandRows(this->getCols());
+	for (unsigned int r = 0; r < this->getRows(); r++)
+	{
+		if(r % band == 0)
+		{
+			this->prefetchRows(r, r + band);
+			this->releaseRows(r < band ? 0 : r - band, r);
+		}
+		for (unsigned int c = 0; c < this->getCols(); c++)
+		{
+			vec4 vertex = this->getVertex(r, c);
+			objFile << "v " << vertex[0] << " " << vertex[1] << " "
+				<< vertex[2] << '\n';
+				
+			//float height = this->getSnowCapHeight();
+			///* Write out the color of the vertex. */
+			//if(vertex[1] >= height)
+			//{
+			//	objFile << " 1.0 1.0 1.0" << std::endl;
+			//}
+			//else
+			//{
+			//	objFile << " " << this->getColor()->toString() 
+			//			<< std::endl;
+			//}
+		}
+	}
+		
+	/* Write out the faces of the mesh. */
+	float snowHeight = this->getSnowCapHeight();
+	this->releaseRows(0, this->getRows());
+	for (unsigned int r = 1; r < this->getRows(); r++)
+	{
+		if((r - 1) % band == 0)
+		{
+			this->prefetchRows(r - 1, r - 1 + band);
+			this->releaseRows(r - 1 < band ? 0 : r - 1 - band, r - 1);
+		}
+		for (unsigned int c = 1; c < this->getCols(); c++)
+		{
+			int v1 = (r-1) * this->getCols() + c;
+			int v2 = v1 + 1;
+			int v3 = v1 + this->getCols();
+			int v4 = v3 + 1;
+
+			/* Write out the color of the vertex. */
+			vec4 vertex = this->getVertex(r-1, c-1);
+			objFile << ((vertex[1] >= snowHeight) ? ("usemtl snow") : 
+				("usemtl color")) << '\n';
+			objFile << "f " << v1 << " " << v4 << " " << v2 << '\n';
+			objFile << "f " << v1 << " " << v3 << " " << v4 << '\n';
+		}
+	}
+
+	this->releaseRows(0, this->getRows());
+
+	objFile.close();
+	delete[] exportBuffer;
+	MemoryTracker::release(EXPORT_BUFFERS, EXPORT_BUFFER_SIZE);
+	if(objFile.fail())
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
 /* Draws this mesh out to 3D space. */
 void Mesh::draw(bool displayEdges, bool displayFaces) const
 {
+	TRACE_SCOPE("Mesh::draw");
+
 	/* Draw the vertices */
-	for (unsigned int r = 0; r < this->vertices->size()-1; r++)
+	for (unsigned int r = 0; r < this->getRows()-1; r++)
 	{
-		for (unsigned int c = 0; c < this->vertices->at(0)->size()-1; c++)
+		const vec4* row1 = this->getRow(r);
+		const vec4* row2 = this->getRow(r + 1);
+		for (unsigned int c = 0; c < this->getCols()-1; c++)
 		{
-			std::vector<vec4>* row1 = this->vertices->at(r);
-			std::vector<vec4>* row2 = this->vertices->at(r + 1);
-			
 			/* If the edges are choosen to be displayed. */
 			if(displayEdges)
 			{
@@ -466,19 +1441,19 @@ void Mesh::draw(bool displayEdges, bool displayFaces) const
 
 				/* Draw triangle one */
 				glBegin(GL_LINE_LOOP);
-					glVertex3f(row1->at(c)[0], row1->at(c)[1], row1->at(c)[2]);
-					glVertex3f(row2->at(c+1)[0], row2->at(c+1)[1], 
-						row2->at(c+1)[2]);
-					glVertex3f(row2->at(c)[0], row2->at(c)[1], row2->at(c)[2]);
+					glVertex3f(row1[c][0], row1[c][1], row1[c][2]);
+					glVertex3f(row2[c+1][0], row2[c+1][1], 
+						row2[c+1][2]);
+					glVertex3f(row2[c][0], row2[c][1], row2[c][2]);
 				glEnd();
 
 				/* Draw triangle two */
 				glBegin(GL_LINE_LOOP);
-					glVertex3f(row1->at(c)[0], row1->at(c)[1], row1->at(c)[2]);
-					glVertex3f(row1->at(c+1)[0], row1->at(c+1)[1], 
-						row1->at(c+1)[2]);
-					glVertex3f(row2->at(c+1)[0], row2->at(c+1)[1], 
-						row2->at(c+1)[2]);
+					glVertex3f(row1[c][0], row1[c][1], row1[c][2]);
+					glVertex3f(row1[c+1][0], row1[c+1][1], 
+						row1[c+1][2]);
+					glVertex3f(row2[c+1][0], row2[c+1][1], 
+						row2[c+1][2]);
 				glEnd();
 			}
 
@@ -490,34 +1465,34 @@ void Mesh::draw(bool displayEdges, bool displayFaces) const
 				/* Draw triangle one */
 				glBegin(GL_POLYGON);
 					/* Vertex 1 */
-					this->colorVertices(row1->at(c)[1]);
-					glVertex3f(row1->at(c)[0], row1->at(c)[1], row1->at(c)[2]);
+					this->colorVertices(row1[c][1]);
+					glVertex3f(row1[c][0], row1[c][1], row1[c][2]);
 
 					/* Vertex 2 */
-					this->colorVertices(row2->at(c+1)[1]);
-					glVertex3f(row2->at(c+1)[0], row2->at(c+1)[1], 
-						row2->at(c+1)[2]);
+					this->colorVertices(row2[c+1][1]);
+					glVertex3f(row2[c+1][0], row2[c+1][1], 
+						row2[c+1][2]);
 
 					/* Vertex 3 */
-					this->colorVertices(row2->at(c)[1]);
-					glVertex3f(row2->at(c)[0], row2->at(c)[1], row2->at(c)[2]);
+					this->colorVertices(row2[c][1]);
+					glVertex3f(row2[c][0], row2[c][1], row2[c][2]);
 				glEnd();
 
 				/* Draw triangle two */
 				glBegin(GL_POLYGON);
 					/* Vertex 1 */
-					this->colorVertices(row1->at(c)[1]);
-					glVertex3f(row1->at(c)[0], row1->at(c)[1], row1->at(c)[2]);
+					this->colorVertices(row1[c][1]);
+					glVertex3f(row1[c][0], row1[c][1], row1[c][2]);
 
 					/* Vertex 2 */
-					this->colorVertices(row1->at(c+1)[1]);
-					glVertex3f(row1->at(c+1)[0], row1->at(c+1)[1], 
-						row1->at(c+1)[2]);
+					this->colorVertices(row1[c+1][1]);
+					glVertex3f(row1[c+1][0], row1[c+1][1], 
+						row1[c+1][2]);
 
 					/* Vertex 3 */
-					this->colorVertices(row2->at(c+1)[1]);
-					glVertex3f(row2->at(c+1)[0], row2->at(c+1)[1], 
-						row2->at(c+1)[2]);
+					this->colorVertices(row2[c+1][1]);
+					glVertex3f(row2[c+1][0], row2[c+1][1], 
+						row2[c+1][2]);
 				glEnd();
 			}
 		}
@@ -537,7 +1512,67 @@ void Mesh::colorVertices(const float y) const
 	/* Default color otherwise. */
 	else
 	{
-		glColor3f(this->color->getRed(), this->color->
-			getGreen(), this->color->getBlue());
+		glColor3f(this->color.getRed(), this->color.getGreen(), 
+			this->color.getBlue());
+	}
+}
+
+/* Returns a new vector of the given row and column indecies. Must be */
+/* deleted with deleteIndecies.                                       */
+std::vector<unsigned int>* newIndecies(const unsigned int row,
+	const unsigned int col)
+{
+	std::vector<unsigned int>* indecies = new std::vector<unsigned int>(2);
+	indecies->at(0) = row;
+	indecies->at(1) = col;
+	MemoryTracker::allocate(TEMPORARIES, sizeof(std::vector<unsigned int>) + 
+		indecies->capacity() * sizeof(unsigned int));
+	return indecies;
+}
+
+/* Deletes indecies returned by newIndecies or Mesh::selectVertex. */
+void deleteIndecies(const std::vector<unsigned int>* indecies)
+{
+	if(indecies)
+	{
+		MemoryTracker::release(TEMPORARIES, sizeof(std::vector<unsigned int>)
+			+ indecies->capacity() * sizeof(unsigned int));
+		delete indecies;
 	}
+}
+
+/* Extracts the filename with out the extension of the given char*. Room */
+/* is left at the end of the returned string for a four character        */
+/* extension.                                                            */
+char* extractFilename(const char* filename)
+{
+	char* extractedName = new char[strlen(filename) + 5];
+	strcpy(extractedName, filename);
+
+	for (int i = strlen(filename) - 1; i >= 0; i--)
+	{
+		if(extractedName[i] == '.')
+		{
+			extractedName[i] = 0;
+			break;
+		}
+	}
+
+	return extractedName;
+}
+
+/* Extracts the filename, without the path, of the given char*. */
+const char* extractName(const char* filename)
+{
+	for (int i = strlen(filename) - 1; i >= 0; i--)
+	{
+		if(filename[i] == '/')
+		{
+			char* extractedName = new char[strlen(&(filename[i+1])) + 1];
+			strcpy(extractedName, &(filename[i + 1]));
+			return extractedName;
+		}
+	}
+
+	return filename;
 }
\ No newline at end of file
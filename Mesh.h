@@ -8,20 +8,39 @@
 #define MESH_H
 
 #include "vec4.h"
+#include "mat4.h"
 #include "ray.h"
 #include "Color.h"
 #include <FL/Gl.H>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
 
 #define SELECTION_RADIUS 0.5
 
+/* Steepest slope, in degrees, a thermal erosion leaves by default. */
+#define DEFAULT_TALUS_ANGLE 30.0f
+
+/* Number of rows of vertices stored in each tile of a mesh. */
+#define TILE_ROWS 16
+
+/* A tile of TILE_ROWS rows of vertices. Defined in Mesh.cpp. */
+struct MeshTile;
+
 class Mesh
 {
 	private:
 		
-		/* Vector of vertices. */
-		std::vector<std::vector<vec4>*>* vertices;
+		/* Tiles of the vertices, each holding TILE_ROWS whole rows. A tile */
+		/* is shared by a mesh and its snapshots until one writes to it,    */
+		/* so a new version only copies the tiles that were edited.         */
+		std::vector<std::shared_ptr<MeshTile> > tiles;
+		/* Number of rows and columns of vertices. */
+		unsigned int rows, cols;
 		/* The color of this face. */
-		const Color* color;
+		Color color;
 		/* Height of the snow caps. Any vertex above this height is drawn */
 		/* white.                                                         */
 		float snowCapHeight;
@@ -34,12 +53,32 @@ class Mesh
 		/* otherwise.                                                     */
 		void colorVertices(const float y) const;
 
+		/* Creates a copy of the given mesh that shares its tiles. Private */
+		/* so meshes are only copied on purpose, through snapshot.         */
+		Mesh(const Mesh& other);
+
+		/* Calls body(row, vertices) for every row, split across the */
+		/* threads. The shared tiles are copied first.               */
+		void forEachRow(const std::function<void(unsigned int row, 
+			vec4* vertices)>& body);
+
+		/* Directory out-of-core meshes are stored in, empty to keep every */
+		/* mesh in memory, and the fewest bytes of vertices a mesh must    */
+		/* have to be stored there.                                        */
+		static std::string outOfCoreDirectory;
+		static unsigned long long outOfCoreBytes;
+
+		/* Gives the advice about the rows from begin up to end to the OS, */
+		/* for the tiles stored in a file.                                 */
+		void adviseRows(unsigned int begin, unsigned int end, 
+			void (*advice)(const void* address, size_t bytes)) const;
+
 	public:
 		
 		/* Constructor for creating a new mesh.                             */
 		/* Must send a unsigned int for the number of rows and cols of the  */
 		/* mesh. Also requires the width and depth of the mesh in 3D space. */
-		/* Lastly requires the color of the mesh.                           */
+		/* Lastly requires the color of the mesh, which is copied.          */
 		Mesh(const unsigned int rows, const unsigned int cols, 
 			 const float width, const float depth, 
 			 const Color* color, const float snowCapHeight = 100);
@@ -58,7 +97,7 @@ class Mesh
 		/* Returns the depth of this mesh. */
 		const float getDepth() const; 
 
-		/* Deletes the old color and sets it to the given new one. */
+		/* Sets the color to a copy of the given new one. */
 		void setColor(const Color* newColor);
 
 		/* Returns a constant pointer to the color of this face. */
@@ -76,25 +115,161 @@ class Mesh
 		/* Returns the vertex at the given row and column number. */
 		const vec4 getVertex(unsigned int row, unsigned int col) const;
 
+		/* Returns the getCols() vertices of the given row. */
+		const vec4* getRow(unsigned int row) const;
+
+		/* Returns the getCols() vertices of the given row to be written, */
+		/* copying its tile first if it is shared with another mesh.      */
+		vec4* getWritableRow(unsigned int row);
+
+		/* Copies every tile shared with another mesh, so the rows can be */
+		/* written from several threads at once.                          */
+		void makeWritable();
+
+		/* Returns the number of tiles the rows are stored in. Tile t */
+		/* holds the rows from t*TILE_ROWS up to (t+1)*TILE_ROWS.     */
+		unsigned int getTileCount() const;
+
+		/* Returns true if the given tile of this mesh is shared with the */
+		/* same tile of the other mesh, so neither has changed it since   */
+		/* one was copied from the other.                                 */
+		bool sharesTile(const Mesh* other, unsigned int tile) const;
+
+		/* Makes this mesh share every tile of the other mesh, which must */
+		/* have as many rows and columns, so the heights return to those  */
+		/* of the other without copying them.                             */
+		void shareTiles(const Mesh* other);
+
+		/* Stores the vertices of every mesh created from now on with at */
+		/* least minBytes of vertices in a memory-mapped file in the     */
+		/* directory, so the OS pages them in and out as they are used.  */
+		/* The meshes can then be larger than the memory. A NULL         */
+		/* directory keeps every new mesh in memory.                     */
+		static void setOutOfCore(const char* directory, 
+			unsigned long long minBytes = 0);
+
+		/* Returns true if the vertices of this mesh are stored in a file. */
+		bool isOutOfCore() const;
+
+		/* Hints that the rows from begin up to end will be read soon, so */
+		/* an out-of-core mesh starts paging them in.                     */
+		void prefetchRows(unsigned int begin, unsigned int end) const;
+
+		/* Hints that the rows from begin up to end will not be read     */
+		/* again soon, so an out-of-core mesh lets the OS page them out. */
+		/* The rows can still be read and written.                       */
+		void releaseRows(unsigned int begin, unsigned int end) const;
+
 		/* Set the current snow cap height. */
 		void setSnowCapHeight(const float height);
 
 		/* Get the current snow cap height. */
 		const float getSnowCapHeight() const;
 
+		/* Sets the height of every vertex to a random value between */
+		/* -range/2 and range/2.                                     */
+		void randomize(const float range);
+
+		/* Sets the height of every vertex to a random value between */
+		/* -range/2 and range/2, generated from the given seed so    */
+		/* the same seed always gives the same heights.              */
+		void randomize(const float range, const unsigned int seed);
+
+		/* Copies the height of every vertex, row by row, into heights, */
+		/* which must hold getRows()*getCols() floats.                  */
+		void getHeights(float* heights) const;
+
+		/* Sets the height of every vertex, row by row, from heights. */
+		void setHeights(const float* heights);
+
+		/* Sets the height of every vertex to zero. */
+		void flatten();
+
+		/* Sets the height of every vertex to the given height. */
+		void fillHeights(const float height);
+
+		/* Adds the given amount to the height of every vertex. */
+		void addHeights(const float amount);
+
+		/* Multiplies the height of every vertex by the given factor. */
+		void scaleHeights(const float factor);
+
+		/* Clamps the height of every vertex between min and max. */
+		void clampHeights(const float min, const float max);
+
+		/* Sets the height of every vertex to the value returned by */
+		/* function(row, col, height). The function is called from  */
+		/* several threads at once, so it must only read shared     */
+		/* state.                                                    */
+		void applyHeights(const std::function<float(unsigned int row, 
+			unsigned int col, float height)>& function);
+
+		/* Multiplies every vertex by the given matrix in place, as a point */
+		/* so translations apply. The width and depth are unchanged.        */
+		void transform(const mat4& matrix);
+
 		/* Returns the indecies of the userRay's selected vertex. Returns */
 		/* NULL if no vertex selected.                                    */
 		std::vector<unsigned int>* selectVertex(ray userRay);
 
-		/* Copies this mesh into a larger mesh and fractalizes it. */
-		Mesh* fractalize() const;
+		/* Returns a new copy of this mesh that later edits to this mesh */
+		/* do not change, so it can be read from another thread. The     */
+		/* copy shares the tiles, so only the tile pointers are copied.  */
+		Mesh* snapshot() const;
+
+		/* Copies this mesh into a larger mesh and fractalizes it. If     */
+		/* cancelled is given and becomes true the new mesh is deleted    */
+		/* and NULL is returned.                                          */
+		Mesh* fractalize(const std::atomic<bool>* cancelled = NULL) const;
+
+		/* Copies this mesh into a larger mesh and fractalizes it with   */
+		/* displacements hashed from the seed and each new vertex's row  */
+		/* and column in the world, this mesh's first vertex being at    */
+		/* firstRow and firstCol of the world's vertices. Meshes cut     */
+		/* from the same world with the same spacing so find the same    */
+		/* vertices where they meet, on any thread count. If cancelled   */
+		/* is given and becomes true the new mesh is deleted and NULL is */
+		/* returned.                                                     */
+		Mesh* fractalize(unsigned int seed, int firstRow, int firstCol,
+			const std::atomic<bool>* cancelled = NULL) const;
 
 		/* Copies this mesh into a larger mesh and subdivides it using the */
-		/* Catmull-Clark Subdivision Algorithm.                            */
-		Mesh* smooth() const;
+		/* Catmull-Clark Subdivision Algorithm. If cancelled is given and  */
+		/* becomes true the new mesh is deleted and NULL is returned.      */
+		Mesh* smooth(const std::atomic<bool>* cancelled = NULL) const;
+
+		/* Moves material downhill wherever a vertex is steeper than the  */
+		/* talus angle, in degrees, above any of its eight neighbours.   */
+		/* Each iteration moves strength, from zero to one, of half the  */
+		/* steepest excess. If cancelled is given and becomes true the   */
+		/* heights are left unchanged and false is returned.             */
+		bool thermalErode(const unsigned int iterations, const float strength,
+			const float talusAngle = DEFAULT_TALUS_ANGLE,
+			const std::atomic<bool>* cancelled = NULL);
+
+		/* Saves this mesh to the given OBJ file. The color of the mesh is */
+		/* saved to an MTL file of the same name. Returns true if both     */
+		/* files were written.                                             */
+		bool saveOBJ(const char* filename) const;
 
 		/* Draws this mesh out to 3D space. */
 		void draw(bool displayEdges, bool displayFaces) const;
 };
 
+/* Returns a new vector of the given row and column indecies. Must be */
+/* deleted with deleteIndecies.                                       */
+std::vector<unsigned int>* newIndecies(const unsigned int row,
+	const unsigned int col);
+
+/* Deletes indecies returned by newIndecies or Mesh::selectVertex. */
+void deleteIndecies(const std::vector<unsigned int>* indecies);
+
+/* Extracts the filename, without the extension, of the given char*. The */
+/* returned string must be deleted.                                      */
+char* extractFilename(const char* filename);
+
+/* Extracts the filename, without the path, of the given char*. Returns */
+/* either a new string or filename itself.                              */
+const char* extractName(const char* filename);
+
 #endif
\ No newline at end of file
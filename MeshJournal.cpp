@@ -0,0 +1,443 @@
+/*
+ * MeshJournal.cpp
+ * Created by Zachary Ferguson
+ * Source file for the MeshJournal class, an autosave that appends the tiles
+ * of a mesh changed since the last checkpoint to a journal file from a
+ * background thread. The latest checkpoint can be recovered from the journal
+ * after a crash.
+ *
+ * The journal starts with JOURNAL_MAGIC followed by records, each starting
+ * with a byte giving its type:
+ *     MESH_RECORD       rows, cols, width, depth of a new mesh
+ *     PROPERTIES_RECORD snow cap height and red, green, blue of the color
+ *     TILE_RECORD       index of a tile then the vertices of its rows
+ *     COMMIT_RECORD     number of the checkpoint just finished
+ * A checkpoint is complete once its COMMIT_RECORD is written, so a journal
+ * cut short by a crash recovers to the checkpoint before.
+ */
+
+#include "MeshJournal.h"
+#include "Trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/* First bytes of a journal file. */
+#define JOURNAL_MAGIC "HFJ1"
+#define JOURNAL_MAGIC_SIZE 4
+
+/* Types of the records in a journal. */
+enum JournalRecord {MESH_RECORD = 1, PROPERTIES_RECORD, TILE_RECORD,
+	COMMIT_RECORD};
+
+/* Writes the bytes of value to the journal. Returns the bytes written. */
+template <typename T>
+static unsigned long long writeValue(std::ofstream& out, const T& value)
+{
+	out.write((const char*)&value, sizeof(T));
+	return sizeof(T);
+}
+
+/* Reads the bytes of value from the journal. Returns false at the end. */
+template <typename T>
+static bool readValue(std::ifstream& in, T& value)
+{
+	return (bool)in.read((char*)&value, sizeof(T));
+}
+
+/* Returns the first row and one past the last row of the given tile. */
+static void tileRows(const Mesh* mesh, unsigned int tile, unsigned int& begin,
+	unsigned int& end)
+{
+	begin = tile * TILE_ROWS;
+	end = begin + TILE_ROWS;
+	if(end > mesh->getRows())
+	{
+		end = mesh->getRows();
+	}
+}
+
+/* Writes the vertices of a tile of the mesh. Returns the bytes written. */
+static unsigned long long writeTile(std::ofstream& out, const Mesh* mesh,
+	unsigned int tile)
+{
+	unsigned long long bytes = writeValue(out, (unsigned char)TILE_RECORD);
+	bytes += writeValue(out, tile);
+
+	unsigned int begin, end;
+	tileRows(mesh, tile, begin, end);
+	size_t rowBytes = (size_t)mesh->getCols() * sizeof(vec4);
+	for (unsigned int row = begin; row < end; row++)
+	{
+		out.write((const char*)mesh->getRow(row), rowBytes);
+		bytes += rowBytes;
+	}
+	return bytes;
+}
+
+/* Writes the snow cap height and color of the mesh. Returns the bytes */
+/* written.                                                            */
+static unsigned long long writeProperties(std::ofstream& out,
+	const Mesh* mesh)
+{
+	unsigned long long bytes = writeValue(out,
+		(unsigned char)PROPERTIES_RECORD);
+	bytes += writeValue(out, mesh->getSnowCapHeight());
+	bytes += writeValue(out, mesh->getColor()->getRed());
+	bytes += writeValue(out, mesh->getColor()->getGreen());
+	bytes += writeValue(out, mesh->getColor()->getBlue());
+	return bytes;
+}
+
+/* Writes the whole mesh as a new mesh. Returns the bytes written. */
+static unsigned long long writeMesh(std::ofstream& out, const Mesh* mesh)
+{
+	unsigned long long bytes = writeValue(out, (unsigned char)MESH_RECORD);
+	bytes += writeValue(out, mesh->getRows());
+	bytes += writeValue(out, mesh->getCols());
+	bytes += writeValue(out, mesh->getWidth());
+	bytes += writeValue(out, mesh->getDepth());
+	bytes += writeProperties(out, mesh);
+	for (unsigned int tile = 0; tile < mesh->getTileCount(); tile++)
+	{
+		bytes += writeTile(out, mesh, tile);
+	}
+	return bytes;
+}
+
+/* Writes the end of a checkpoint and flushes it to the file. Returns the */
+/* bytes written.                                                         */
+static unsigned long long writeCommit(std::ofstream& out,
+	unsigned int sequence)
+{
+	unsigned long long bytes = writeValue(out, (unsigned char)COMMIT_RECORD);
+	bytes += writeValue(out, sequence);
+	out.flush();
+	return bytes;
+}
+
+/* Returns true if the snow cap height or color of the meshes differ. */
+static bool propertiesDiffer(const Mesh* a, const Mesh* b)
+{
+	return a->getSnowCapHeight() != b->getSnowCapHeight() ||
+		a->getColor()->getRed() != b->getColor()->getRed() ||
+		a->getColor()->getGreen() != b->getColor()->getGreen() ||
+		a->getColor()->getBlue() != b->getColor()->getBlue();
+}
+
+/* Creates a journal in the given file, replacing any journal already */
+/* there.                                                             */
+MeshJournal::MeshJournal(const char* filename)
+{
+	this->filename = filename;
+	remove((this->filename + ".tmp").c_str());
+	this->file.open(filename, std::ios::out | std::ios::binary |
+		std::ios::trunc);
+	this->opened = this->file.is_open();
+	if(!(this->opened))
+	{
+		std::cout << "Unable to autosave to " << filename << std::endl;
+	}
+	this->file.write(JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+	this->file.flush();
+	this->fileBytes = JOURNAL_MAGIC_SIZE;
+	this->sequence = 0;
+
+	this->pending = NULL;
+	this->written = NULL;
+	this->stop = false;
+	this->thread = std::thread(&MeshJournal::run, this);
+}
+
+/* Writes the pending checkpoint, joins the thread, and deletes the journal */
+/* file since it is not needed after a clean exit.                          */
+MeshJournal::~MeshJournal()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+	}
+	this->wake.notify_one();
+	this->thread.join();
+
+	delete this->written;
+	if(this->opened)
+	{
+		this->file.close();
+		remove(this->filename.c_str());
+	}
+}
+
+/* Returns true if the journal file was opened. */
+bool MeshJournal::isOpen() const
+{
+	return this->opened;
+}
+
+/* Returns the path of the journal with the given name in the user's local */
+/* application data directory, or their home directory outside of Windows, */
+/* falling back to the temporary directory and then the working directory. */
+std::string MeshJournal::getUserFilename(const char* name)
+{
+#ifdef _WIN32
+	const char* directories[] = {"LOCALAPPDATA", "TEMP"};
+	const char separator = '\\';
+	std::string prefix = "";
+#else
+	const char* directories[] = {"HOME", "TMPDIR"};
+	const char separator = '/';
+	/* Hidden like the other files kept in the home directory. */
+	std::string prefix = ".";
+#endif
+	for (size_t i = 0; i < sizeof(directories) / sizeof(directories[0]); i++)
+	{
+		const char* directory = getenv(directories[i]);
+		if(directory && directory[0] != '\0')
+		{
+			return std::string(directory) + separator + prefix + name;
+		}
+	}
+	return name;
+}
+
+/* Takes a snapshot of the mesh to be written in the background. Only the */
+/* tile pointers are copied on the calling thread. A snapshot still       */
+/* waiting is replaced by the new one, as it is older.                    */
+void MeshJournal::checkpoint(const Mesh* mesh)
+{
+	TRACE_SCOPE("MeshJournal::checkpoint");
+
+	if(!(this->opened))
+	{
+		return;
+	}
+	Mesh* snapshot = mesh->snapshot();
+	Mesh* replaced;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		replaced = this->pending;
+		this->pending = snapshot;
+	}
+	this->wake.notify_one();
+	delete replaced;
+}
+
+/* Body of the journal thread. Writes each pending snapshot. Once stopped */
+/* the last pending snapshot is still written.                            */
+void MeshJournal::run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	for (;;)
+	{
+		while(!this->stop && !this->pending)
+		{
+			this->wake.wait(lock);
+		}
+		if(!this->pending)
+		{
+			return;
+		}
+		Mesh* snapshot = this->pending;
+		this->pending = NULL;
+
+		lock.unlock();
+		this->append(snapshot);
+		lock.lock();
+	}
+}
+
+/* Appends the changes from the last snapshot written to the given one. A */
+/* mesh of a different size is written whole. Only the tiles the two      */
+/* snapshots do not share have changed, so only those are written. The    */
+/* journal is compacted once it grows too large compared to the mesh.     */
+void MeshJournal::append(Mesh* snapshot)
+{
+	TRACE_SCOPE("MeshJournal::append");
+
+	const Mesh* last = this->written;
+	unsigned long long bytes = 0;
+	if(!last || last->getRows() != snapshot->getRows() ||
+		last->getCols() != snapshot->getCols() ||
+		last->getWidth() != snapshot->getWidth() ||
+		last->getDepth() != snapshot->getDepth())
+	{
+		bytes += writeMesh(this->file, snapshot);
+	}
+	else
+	{
+		if(propertiesDiffer(last, snapshot))
+		{
+			bytes += writeProperties(this->file, snapshot);
+		}
+		for (unsigned int tile = 0; tile < snapshot->getTileCount(); tile++)
+		{
+			if(!snapshot->sharesTile(last, tile))
+			{
+				bytes += writeTile(this->file, snapshot, tile);
+			}
+		}
+	}
+
+	/* Nothing has changed since the last checkpoint. */
+	if(bytes == 0)
+	{
+		delete snapshot;
+		return;
+	}
+
+	bytes += writeCommit(this->file, ++(this->sequence));
+	this->fileBytes += bytes;
+
+	delete this->written;
+	this->written = snapshot;
+
+	unsigned long long meshBytes = (unsigned long long)snapshot->getRows() *
+		snapshot->getCols() * sizeof(vec4);
+	if(this->fileBytes > JOURNAL_COMPACT_RATIO * meshBytes)
+	{
+		this->compact(snapshot);
+	}
+}
+
+/* Rewrites the journal as a single full checkpoint of the given snapshot. */
+/* The checkpoint is written to a temporary file that then replaces the    */
+/* journal, so a crash part way through still leaves one to recover from. */
+void MeshJournal::compact(const Mesh* snapshot)
+{
+	TRACE_SCOPE("MeshJournal::compact");
+
+	std::string tmpFilename = this->filename + ".tmp";
+	std::ofstream tmpFile(tmpFilename.c_str(), std::ios::out |
+		std::ios::binary | std::ios::trunc);
+	if(!(tmpFile.is_open()))
+	{
+		return;
+	}
+	tmpFile.write(JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+	unsigned long long bytes = JOURNAL_MAGIC_SIZE +
+		writeMesh(tmpFile, snapshot);
+	bytes += writeCommit(tmpFile, this->sequence);
+	bool written = tmpFile.good();
+	tmpFile.close();
+	if(!written)
+	{
+		remove(tmpFilename.c_str());
+		return;
+	}
+
+	/* Recovery falls back to the temporary file while the journal is */
+	/* missing.                                                        */
+	this->file.close();
+	remove(this->filename.c_str());
+	rename(tmpFilename.c_str(), this->filename.c_str());
+	this->file.open(this->filename.c_str(), std::ios::out |
+		std::ios::binary | std::ios::app);
+	this->fileBytes = bytes;
+}
+
+/* Returns the mesh of the last complete checkpoint in the given journal */
+/* file, or NULL if there is none. The records after the last commit are */
+/* from a checkpoint cut short and are ignored.                          */
+Mesh* MeshJournal::recover(const char* filename)
+{
+	TRACE_SCOPE("MeshJournal::recover");
+
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if(!(in.is_open()))
+	{
+		/* The journal was being compacted. */
+		in.open((std::string(filename) + ".tmp").c_str(),
+			std::ios::in | std::ios::binary);
+		if(!(in.is_open()))
+		{
+			return NULL;
+		}
+	}
+
+	char magic[JOURNAL_MAGIC_SIZE];
+	if(!in.read(magic, JOURNAL_MAGIC_SIZE) ||
+		std::string(magic, JOURNAL_MAGIC_SIZE) != JOURNAL_MAGIC)
+	{
+		return NULL;
+	}
+
+	/* The mesh the records are applied to, and a snapshot of it at the */
+	/* last commit.                                                     */
+	Mesh* working = NULL;
+	Mesh* committed = NULL;
+	unsigned char type;
+	bool valid = true;
+	while(valid && readValue(in, type))
+	{
+		switch(type)
+		{
+			case MESH_RECORD:
+			{
+				unsigned int rows, cols;
+				float width, depth;
+				valid = readValue(in, rows) && readValue(in, cols) &&
+					readValue(in, width) && readValue(in, depth) &&
+					rows > 1 && cols > 1;
+				if(valid)
+				{
+					Color color = Color(BLUE);
+					delete working;
+					working = new Mesh(rows - 1, cols - 1, width, depth,
+						&color);
+				}
+				break;
+			}
+			case PROPERTIES_RECORD:
+			{
+				float snowCapHeight, red, green, blue;
+				valid = working && readValue(in, snowCapHeight) &&
+					readValue(in, red) && readValue(in, green) &&
+					readValue(in, blue);
+				if(valid)
+				{
+					Color color = Color(red, green, blue);
+					working->setColor(&color);
+					working->setSnowCapHeight(snowCapHeight);
+				}
+				break;
+			}
+			case TILE_RECORD:
+			{
+				unsigned int tile;
+				valid = working && readValue(in, tile) &&
+					tile < working->getTileCount();
+				unsigned int begin = 0, end = 0;
+				if(valid)
+				{
+					tileRows(working, tile, begin, end);
+				}
+				size_t rowBytes = valid ?
+					(size_t)working->getCols() * sizeof(vec4) : 0;
+				for (unsigned int row = begin; valid && row < end; row++)
+				{
+					valid = (bool)in.read((char*)working->getWritableRow(row),
+						rowBytes);
+				}
+				break;
+			}
+			case COMMIT_RECORD:
+			{
+				unsigned int sequence;
+				valid = working && readValue(in, sequence);
+				if(valid)
+				{
+					delete committed;
+					committed = working->snapshot();
+				}
+				break;
+			}
+			default:
+				valid = false;
+				break;
+		}
+	}
+
+	delete working;
+	return committed;
+}
@@ -0,0 +1,93 @@
+/*
+ * MeshJournal.h
+ * Created by Zachary Ferguson
+ * Header file for the MeshJournal class, an autosave that appends the tiles
+ * of a mesh changed since the last checkpoint to a journal file from a
+ * background thread. The latest checkpoint can be recovered from the journal
+ * after a crash.
+ */
+
+#ifndef MESHJOURNAL_H
+#define MESHJOURNAL_H
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Mesh.h"
+
+/* The journal is compacted into a single full checkpoint once it is this */
+/* many times larger than the mesh.                                       */
+#define JOURNAL_COMPACT_RATIO 4
+
+class MeshJournal
+{
+	private:
+
+		/* Name of the journal file. */
+		std::string filename;
+		/* The journal file, opened for appending. */
+		std::ofstream file;
+		/* Whether the journal file was opened. Kept apart from the file, */
+		/* which the thread reopens when it compacts the journal.         */
+		bool opened;
+		/* Bytes written to the journal file. */
+		unsigned long long fileBytes;
+		/* Number of checkpoints written. */
+		unsigned int sequence;
+
+		/* Thread writing the checkpoints. */
+		std::thread thread;
+		/* Guards the pending snapshot and the stop flag. */
+		std::mutex mutex;
+		/* Signals the thread a checkpoint was made or it should stop. */
+		std::condition_variable wake;
+		/* Snapshot waiting to be written, NULL if there is none. */
+		Mesh* pending;
+		/* Set to tell the thread to exit once the pending one is written. */
+		bool stop;
+
+		/* The last snapshot written, only used by the thread. */
+		Mesh* written;
+
+		/* Body of the journal thread. */
+		void run();
+		/* Appends the changes from the last snapshot written to the */
+		/* given one, which is kept as the last one written.         */
+		void append(Mesh* snapshot);
+		/* Rewrites the journal as a single full checkpoint of the given */
+		/* snapshot.                                                     */
+		void compact(const Mesh* snapshot);
+
+	public:
+
+		/* Creates a journal in the given file, replacing any journal */
+		/* already there.                                             */
+		MeshJournal(const char* filename);
+
+		/* Writes the pending checkpoint, joins the thread, and deletes */
+		/* the journal file since it is not needed after a clean exit.  */
+		~MeshJournal();
+
+		/* Takes a snapshot of the mesh to be written in the background. */
+		/* Only the tile pointers are copied on the calling thread. A    */
+		/* snapshot still waiting is replaced by the new one.            */
+		void checkpoint(const Mesh* mesh);
+
+		/* Returns true if the journal file was opened. A journal that */
+		/* could not be opened ignores its checkpoints.                */
+		bool isOpen() const;
+
+		/* Returns the mesh of the last complete checkpoint in the given */
+		/* journal file, or NULL if there is none.                       */
+		static Mesh* recover(const char* filename);
+
+		/* Returns the path of the journal with the given name in the */
+		/* user's local application data directory, or their home     */
+		/* directory outside of Windows, so it is written somewhere   */
+		/* the user can write whatever the working directory is.      */
+		static std::string getUserFilename(const char* name);
+};
+
+#endif
@@ -6,6 +6,8 @@
  */
 
 #include "MeshModeler.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
 
 /* Constructor for creating a new MeshModeler.                               */
 /* Requires the x,y coordinates and the width and height of the window. Also */
@@ -13,24 +15,57 @@
 MeshModeler::MeshModeler(int x, int y, int w, int h, const char* label) :
 	Fl_Window(x, y, w, h, label)
 {
-	/* Create the starting mesh. */
-	this->mesh = new Mesh(4, 4, 10, 10, new Color(BLUE), 1.5);
+	/* Create the starting mesh, or recover the one autosaved before a */
+	/* crash.                                                          */
+	std::string autosaveFilename = MeshJournal::getUserFilename(
+		AUTOSAVE_FILENAME);
+	this->mesh = MeshJournal::recover(autosaveFilename.c_str());
+	if(this->mesh && fl_choice("The mesh being edited when the Mesh "
+		"Modeler last closed was autosaved. Recover it?", "Discard", 
+		"Recover", NULL) != 1)
+	{
+		delete this->mesh;
+		this->mesh = NULL;
+	}
+	if(!this->mesh)
+	{
+		Color color = Color(BLUE);
+		this->mesh = new Mesh(4, 4, 10, 10, &color, 1.5);
+	}
+
+	/* The GL3DWindow is square and the status bar is below it. */
+	int glSize = h - STATUS_BAR_HEIGHT;
 
 	/* Create the GL3DWindow to display the mesh in. */
-	this->gl3DWin = new GL3DWindow(0, 0, h, h, "3D Modeler", this->mesh, true, 
-		true);
+	this->gl3DWin = new GL3DWindow(0, 0, glSize, glSize, "3D Modeler", 
+		this->mesh, true, true);
 
-	Fl_Menu_Bar* menu = new Fl_Menu_Bar(h, 0, w-h, 24, "Mesh Modeler");
+	Fl_Menu_Bar* menu = new Fl_Menu_Bar(glSize, 0, w-glSize, 24, 
+		"Mesh Modeler");
 	menu->box(FL_BORDER_BOX);
 	menu->down_box(FL_BORDER_BOX);
 	menu->add("File/Save", 0, MeshModeler::saveCB, this);
+#ifdef ENABLE_TRACING
+	menu->add("File/Save Trace", 0, MeshModeler::saveTraceCB, this);
+#endif
 	menu->add("File/Exit", 0, MeshModeler::exitCB, this);
+	menu->add("Edit/Undo", FL_CTRL + 'z', MeshModeler::undoCB, this);
+	menu->add("Edit/Redo", FL_CTRL + 'y', MeshModeler::redoCB, this);
+	menu->add("View/Explore Infinite Terrain", 0, MeshModeler::exploreCB, 
+		this, FL_MENU_TOGGLE);
 	menu->add("Help/How To Use", 0, MeshModeler::helpCB, this);
+	menu->add("Help/Memory Usage", 0, MeshModeler::memoryCB, this);
 	menu->add("Help/About", 0, MeshModeler::aboutCB, this);
+	this->helpBox = NULL;
+	this->aboutBox = NULL;
+	this->memoryBox = NULL;
 
 	/* Create the color chooser. */
-	this->colorChooser = new Fl_Color_Chooser(h+5, menu->h() + 6, 175, 100);
-	this->colorChooser->rgb(BLUE);
+	this->colorChooser = new Fl_Color_Chooser(glSize+5, menu->h() + 6, 175, 
+		100);
+	this->colorChooser->rgb(this->mesh->getColor()->getRed(), 
+		this->mesh->getColor()->getGreen(), 
+		this->mesh->getColor()->getBlue());
 	this->colorChooser->callback(MeshModeler::colorCB, this);
 	
 	/* Create the create mesh group. */
@@ -92,14 +127,84 @@ MeshModeler::MeshModeler(int x, int y, int w, int h, const char* label) :
 		this->smoothSlider->w(), 24, "Smooth Mesh");
 	this->smoothB->callback(MeshModeler::smoothCB, this);
 
+	/* Create the sculpting brush group, right of the new mesh group. */
+	this->brushControls = new BrushGroup(w-205, this->colorChooser->y());
+	this->brush = new Brush();
+	this->strokeBefore = NULL;
+
+	/* Slider for the number of erosion steps, below the brush group. */
+	this->erodeSlider = makeHorizSlider(this->brushControls->x(), 
+		this->brushControls->y() + this->brushControls->h() + 25, 
+		this->brushControls->w(), 24, "Erosion Steps", 0, 500, 100, 5);
+	/* Buttons for eroding the mesh with rain, by the talus angle, or */
+	/* with droplets.                                                 */
+	this->erodeB = new Fl_Button(this->erodeSlider->x(), 
+		this->erodeSlider->y() + this->erodeSlider->h() + 5, 
+		(this->erodeSlider->w() - 10) / 3, 24, "Hydraulic");
+	this->erodeB->labelsize(12);
+	this->erodeB->callback(MeshModeler::erodeCB, this);
+	this->thermalErodeB = new Fl_Button(this->erodeB->x() + 
+		this->erodeB->w() + 5, this->erodeB->y(), this->erodeB->w(), 24, 
+		"Thermal");
+	this->thermalErodeB->labelsize(12);
+	this->thermalErodeB->callback(MeshModeler::thermalErodeCB, this);
+	this->dropletErodeB = new Fl_Button(this->thermalErodeB->x() + 
+		this->thermalErodeB->w() + 5, this->erodeB->y(), 
+		this->erodeB->w(), 24, "Droplets");
+	this->dropletErodeB->labelsize(12);
+	this->dropletErodeB->callback(MeshModeler::dropletErodeCB, this);
+
+	/* Create the noise terrain group, below the erosion buttons. */
+	this->noiseControls = new NoiseGroup(this->erodeSlider->x(), 
+		this->dropletErodeB->y() + this->dropletErodeB->h() + 10);
+	this->noiseControls->callback(MeshModeler::noiseCB, this);
+	this->terrain = NULL;
+
 	/* Create the view mode group. */
-	this->viewMode = new ViewModeGroup(w-297, h-117);
+	this->viewMode = new ViewModeGroup(w-297, glSize-117);
 	this->viewMode->callback(MeshModeler::viewModeCB, this);
 
 	/* Create the camera control group. */
-	this->cameraControls = new CameraControlGroup(w-183, h-117);
+	this->cameraControls = new CameraControlGroup(w-183, glSize-117);
 	this->cameraControls->callback(GL3DWindow::cameraAlignCB, this->gl3DWin);
 
+	/* Create the status bar for the fractalize and smooth progress. */
+	this->cancelB = new Fl_Button(glSize-85, glSize+3, 80, 24, "Cancel");
+	this->cancelB->callback(MeshModeler::cancelCB, this);
+	this->cancelB->deactivate();
+	this->progressBar = new Fl_Progress(5, glSize+3, this->cancelB->x()-10, 
+		24);
+	this->progressBar->minimum(0);
+	this->progressBar->maximum(1);
+	this->progressBar->value(0);
+	this->progressBar->selection_color(FL_BLUE);
+	this->progressBar->labelcolor(FL_WHITE);
+
+	/* Create the worker for running fractalize and smooth. */
+	this->worker = new MeshWorker(MeshModeler::workerCB, this);
+
+	/* Create the status of the saves, beside the progress. */
+	this->saveStatus = new Fl_Box(glSize+5, glSize+3, w-glSize-10, 24);
+	this->saveStatus->box(FL_THIN_DOWN_BOX);
+	this->saveStatus->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+
+	/* Create the writer for saving in the background. */
+	this->writer = new MeshWriter(MeshModeler::writerCB, this);
+	this->savesPending = 0;
+
+	/* Create the history of the edits to undo. */
+	this->history = new UndoHistory();
+
+	/* Start the journal with the whole mesh, then autosave the changes. */
+	this->journal = new MeshJournal(autosaveFilename.c_str());
+	if(!(this->journal->isOpen()))
+	{
+		fl_alert("Unable to autosave to %s, so the mesh can not be "
+			"recovered after a crash.", autosaveFilename.c_str());
+	}
+	this->journal->checkpoint(this->mesh);
+	Fl::add_timeout(AUTOSAVE_INTERVAL, MeshModeler::autosaveCB, this);
+
 	/* Sets this mesh modeler as the Fl focus. */
 	Fl::focus(this);
 }
@@ -124,10 +229,21 @@ Fl_Value_Slider* makeHorizSlider(int x, int y, int w, int h, const char* label,
 /* Destructor for this MeshModeler. */
 MeshModeler::~MeshModeler()
 {
-	/* Delete GL3DWindow and mesh. */
+	/* Stop the worker before the mesh it reads is deleted, and finish */
+	/* writing the saves still queued.                                 */
+	delete this->worker;
+	delete this->writer;
+	/* Exiting cleanly, so the autosave is not needed. */
+	Fl::remove_timeout(MeshModeler::autosaveCB, this);
+	delete this->journal;
+	/* Delete the edit history and the old meshes it holds. */
+	delete this->history;
+	delete this->strokeBefore;
+	delete this->brush;
+	/* Delete GL3DWindow, mesh, and terrain. */
 	delete this->gl3DWin;
-	/* Delete the vector of selected indecies. */
-	delete this->selectedIndecies;
+	delete this->terrain;
+	/* The selected indecies are deleted by the gl3DWin. */
 	/* Delete the widgets. */
 	delete this->newMesh;
 	delete this->colorChooser;
@@ -135,12 +251,23 @@ MeshModeler::~MeshModeler()
 	delete this->viewMode;
 	delete this->cameraControls;
 	delete this->heightEditor;
+	delete this->brushControls;
 	delete this->snowHeightSlider;
 	delete this->fractalizeSlider;
 	delete this->fractalizeB;
 	delete this->smoothSlider;
 	delete this->smoothB;
+	delete this->erodeSlider;
+	delete this->erodeB;
+	delete this->thermalErodeB;
+	delete this->dropletErodeB;
+	delete this->noiseControls;
+	delete this->progressBar;
+	delete this->cancelB;
+	delete this->saveStatus;
 	delete this->helpBox;
+	delete this->aboutBox;
+	delete this->memoryBox;
 }
 
 /**********************/
@@ -150,32 +277,30 @@ MeshModeler::~MeshModeler()
 /* Creates a new mesh for the GL3DWindow. */
 void MeshModeler::newMeshCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::newMeshCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 
-	/* Delete the old mesh. */
-	delete modeler->mesh;
+	/* Keep the old mesh so the new one can be undone. */
+	modeler->history->recordReplace(modeler->mesh);
 
 	/* Get the new mesh's property. */
 	int rows = modeler->newMesh->getRowsValue();
 	int cols = modeler->newMesh->getColsValue();
 	float width = modeler->newMesh->getWidthValue();
 	float depth = modeler->newMesh->getDepthValue();
-	Color* color = new Color((float)modeler->colorChooser->r(), 
+	Color color = Color((float)modeler->colorChooser->r(), 
 		(float)modeler->colorChooser->g(), (float)modeler->colorChooser->b());
 	float snowCapHeight = (float)modeler->snowHeightSlider->value();
 
 	/* Create the new mesh. */
-	modeler->mesh = new Mesh(rows, cols, width, depth, color, snowCapHeight);
+	modeler->mesh = new Mesh(rows, cols, width, depth, &color, snowCapHeight);
 
 	/* Set the mesh of the gl3DWin. */
 	modeler->gl3DWin->setMesh(modeler->mesh);
 
 	/* Set the height editor's values. */
-	modeler->heightEditor->setRow(0);
-	modeler->heightEditor->setCol(0);
-	modeler->heightEditor->setRows(modeler->mesh->getRows());
-	modeler->heightEditor->setCols(modeler->mesh->getCols());
-	MeshModeler::selectIndexCB(NULL, modeler);
+	modeler->resetHeightEditor();
 	
 	/* Redraw the gl3DWin. */
 	modeler->gl3DWin->redraw();
@@ -185,12 +310,14 @@ void MeshModeler::newMeshCB(Fl_Widget* w, void* data)
 /* Changes the current mesh's color. */
 void MeshModeler::colorCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::colorCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 
-	Color* color = new Color((float)modeler->colorChooser->r(), 
+	Color color = Color((float)modeler->colorChooser->r(), 
 		(float)modeler->colorChooser->g(), (float)modeler->colorChooser->b());
 
-	modeler->mesh->setColor(color);
+	modeler->mesh->setColor(&color);
 
 	modeler->gl3DWin->redraw();
 }
@@ -198,6 +325,8 @@ void MeshModeler::colorCB(Fl_Widget* w, void* data)
 /* Callbacks for setting if the elements should be drawn. */
 void MeshModeler::viewModeCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::viewModeCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	
 	switch(modeler->viewMode->getViewMode())
@@ -225,21 +354,28 @@ void MeshModeler::viewModeCB(Fl_Widget* w, void* data)
 /* Callback function for selecting a vertex in the mesh. */
 void MeshModeler::selectIndexCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::selectIndexCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	modeler->selectedIndecies = modeler->gl3DWin->selectMeshIndex(modeler->
 		heightEditor->getRow(), modeler->heightEditor->getCol());
 	modeler->updateHeightSlider();
+	modeler->history->endHeightEdit();
 }
 
 /* Callback for the height slider. */
 void MeshModeler::changeHeightCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::changeHeightCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	if(modeler->selectedIndecies)
 	{
 		unsigned int row = modeler->selectedIndecies->at(0);
 		unsigned int col = modeler->selectedIndecies->at(1);
 		float height = modeler->heightEditor->getHeight();
+		modeler->history->recordHeight(row, col, 
+			modeler->mesh->getVertex(row, col)[1], height);
 		modeler->mesh->setHeight(row, col, height);
 		modeler->gl3DWin->redraw();
 	}
@@ -248,73 +384,162 @@ void MeshModeler::changeHeightCB(Fl_Widget* w, void* data)
 /* Callback for the snow cap height slider. */
 void MeshModeler::changeSnowHeightCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::changeSnowHeightCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	modeler->mesh->setSnowCapHeight((float)modeler->snowHeightSlider->value());
 	modeler->gl3DWin->redraw();
 }
 
-/* Callback function for fractalizing the mesh of the data. */
+/* Callback function for fractalizing the mesh of the data. The iterations */
+/* are run in the background by the worker.                               */
 void MeshModeler::fractalizeCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::fractalizeCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->startOperation(FRACTALIZE_MESH, 
+		(unsigned int)modeler->fractalizeSlider->value());
+}
 
-	for (int i = 0; i < modeler->fractalizeSlider->value(); i++)
-	{
-		Mesh* newMesh = modeler->mesh->fractalize();
-		delete modeler->mesh;
-		modeler->mesh = newMesh;
-	}
-	modeler->gl3DWin->setMesh(modeler->mesh);
+/* Callback function for smoothing the mesh of the data. The iterations are */
+/* run in the background by the worker.                                     */
+void MeshModeler::smoothCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::smoothCB");
 
-	/* Set the height editor's values. */
-	modeler->heightEditor->setRow(0);
-	modeler->heightEditor->setCol(0);
-	modeler->heightEditor->setRows(modeler->mesh->getRows());
-	modeler->heightEditor->setCols(modeler->mesh->getCols());
-	MeshModeler::selectIndexCB(NULL, modeler);
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->startOperation(SMOOTH_MESH, 
+		(unsigned int)modeler->smoothSlider->value());
+}
 
-	modeler->gl3DWin->redraw();
+/* Callback function for eroding the mesh of the data with rain. The */
+/* steps are run in the background by the worker.                    */
+void MeshModeler::erodeCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::erodeCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->startOperation(ERODE_MESH, 
+		(unsigned int)modeler->erodeSlider->value());
 }
 
-/* Callback function for fractalizing the mesh of the data. */
-void MeshModeler::smoothCB(Fl_Widget* w, void* data)
+/* Callback function for thermally eroding the mesh of the data. The */
+/* steps are run in the background by the worker.                    */
+void MeshModeler::thermalErodeCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::thermalErodeCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->startOperation(THERMAL_ERODE_MESH, 
+		(unsigned int)modeler->erodeSlider->value());
+}
+
+/* Callback function for eroding the mesh of the data with droplets. The */
+/* steps are run in the background by the worker.                        */
+void MeshModeler::dropletErodeCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::dropletErodeCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->startOperation(DROPLET_ERODE_MESH, 
+		(unsigned int)modeler->erodeSlider->value());
+}
+
+/* Callback function for cancelling the fractalize, smooth, or erosion. */
+void MeshModeler::cancelCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::cancelCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->worker->cancel();
+	modeler->cancelB->deactivate();
+	modeler->progressBar->copy_label("Cancelling...");
+}
+
+/* Receives the progress of the fractalize, smooth, or erosion from the */
+/* worker, and swaps in each level as it is finished.                   */
+void MeshModeler::workerCB(const MeshWorkerUpdate* update, void* data)
 {
+	TRACE_SCOPE("MeshModeler::workerCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 
-	for (int i = 0; i < modeler->smoothSlider->value(); i++)
+	/* Each iteration quadruples the vertices, so the progress of an */
+	/* iteration is weighted by its share of the work. Every erosion */
+	/* step takes the same time.                                     */
+	if((update->operation == ERODE_MESH || 
+		update->operation == THERMAL_ERODE_MESH || 
+		update->operation == DROPLET_ERODE_MESH) && update->iterations > 0)
 	{
-		Mesh* newMesh = modeler->mesh->smooth();
-		delete modeler->mesh;
-		modeler->mesh = newMesh;
+		modeler->progressBar->value((float)update->iteration / 
+			update->iterations);
+	}
+	else if(update->iterations > 0)
+	{
+		modeler->progressBar->value((float)((pow(4.0, update->iteration) - 1)
+			/ (pow(4.0, update->iterations) - 1)));
 	}
-	modeler->gl3DWin->setMesh(modeler->mesh);
 
-	/* Set the height editor's values. */
-	modeler->heightEditor->setRow(0);
-	modeler->heightEditor->setCol(0);
-	modeler->heightEditor->setRows(modeler->mesh->getRows());
-	modeler->heightEditor->setCols(modeler->mesh->getCols());
-	MeshModeler::selectIndexCB(NULL, modeler);
+	/* Display the new level. The worker has finished reading the level */
+	/* before it, which is the one being replaced. The mesh from before */
+	/* the first level is kept so the run can be undone.               */
+	if(update->mesh)
+	{
+		if(update->first)
+		{
+			modeler->history->recordReplace(modeler->mesh);
+		}
+		else
+		{
+			delete modeler->mesh;
+		}
+		modeler->mesh = update->mesh;
+		modeler->gl3DWin->setMesh(modeler->mesh);
+		modeler->resetHeightEditor();
+		modeler->gl3DWin->redraw();
+	}
 
+	std::stringstream status;
+	if(!update->finished)
+	{
+		status << "Iteration " << update->iteration << " of " << 
+			update->iterations << " done";
+		modeler->progressBar->copy_label(status.str().c_str());
+		return;
+	}
+
+	/* A cancelled run keeps the last level that was finished. */
+	if(update->cancelled)
+	{
+		status << "Cancelled after " << update->iteration << " of " << 
+			update->iterations << " iterations";
+	}
+	else
+	{
+		status << "Done";
+	}
+	modeler->progressBar->copy_label(status.str().c_str());
+
+	modeler->cancelB->deactivate();
+	modeler->setEditingActive(modeler->terrain == NULL);
 	modeler->gl3DWin->redraw();
 }
 
 /* Callback function for randomizing the mesh's heights. */
 void MeshModeler::randomizeCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::randomizeCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 
 	float range = (float)(modeler->randomizeSlider->value());
 
-	/* Set all vertices' heights to zero. */
-	for (unsigned int r = 0; r < modeler->mesh->getRows(); r++)
-	{
-		for (unsigned int c = 0; c < modeler->mesh->getCols(); c++)
-		{
-			modeler->mesh->setHeight(r, c, 
-				(((float)rand()/(float)RAND_MAX) * range) - (range/2.0f));
-		}
-	}
+	/* Set all vertices' heights to random values. The seed is kept so */
+	/* the randomize can be redone after it is undone.                 */
+	unsigned int seed = (unsigned int)rand();
+	modeler->history->recordRandomize(modeler->mesh, range, seed);
+	modeler->mesh->randomize(range, seed);
 
 	/* Update the height editors value. */
 	if(modeler->selectedIndecies)
@@ -334,191 +559,238 @@ void MeshModeler::randomizeCB(Fl_Widget* w, void* data)
 /* Callback function for flattening the mesh. */
 void MeshModeler::flattenCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::flattenCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 
 	/* Set all vertices' heights to zero. */
-	for (unsigned int r = 0; r < modeler->mesh->getRows(); r++)
+	modeler->history->recordFlatten(modeler->mesh);
+	modeler->mesh->flatten();
+
+	/* Update the height editors value. */
+	modeler->heightEditor->setHeight(0);
+
+	modeler->gl3DWin->redraw();
+}
+
+/* Callback function for generating the heights from noise, from  */
+/* -range/2 to range/2 of the randomize range. A new seed is used  */
+/* each time, and the mesh from before is kept to undo it.         */
+void MeshModeler::noiseCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::noiseCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+
+	float range = (float)(modeler->randomizeSlider->value());
+	unsigned int seed = (unsigned int)rand();
+	Mesh* before = modeler->mesh->snapshot();
+	if(modeler->noiseControls->isDiamondSquare())
 	{
-		for (unsigned int c = 0; c < modeler->mesh->getCols(); c++)
-		{
-			modeler->mesh->setHeight(r, c, 0);
-		}
+		DiamondSquareGenerator(seed, 
+			modeler->noiseControls->getRoughness()).fill(modeler->mesh, 
+			range);
+	}
+	else if(modeler->noiseControls->isSpectral())
+	{
+		SpectralGenerator(seed, 
+			modeler->noiseControls->getSpectralSettings()).fill(
+			modeler->mesh, range);
+	}
+	else
+	{
+		NoiseGenerator(seed, modeler->noiseControls->getSettings()).fill(
+			modeler->mesh, range);
 	}
+	modeler->history->recordStroke(before, modeler->mesh);
 
 	/* Update the height editors value. */
-	modeler->heightEditor->setHeight(0);
+	if(modeler->selectedIndecies)
+	{
+		modeler->heightEditor->setHeight((modeler->mesh->getVertex(
+			modeler->selectedIndecies->at(0), 
+			modeler->selectedIndecies->at(1)))[1]);
+	}
+	else
+	{
+		modeler->heightEditor->setHeight(0);
+	}
+
+	modeler->gl3DWin->redraw();
+}
+
+/* Callback function for exploring a terrain of the noise. While it is */
+/* explored the tiles near the camera are generated with the noise     */
+/* group's settings and a new seed, the arrow keys move the camera     */
+/* over it, and the controls that edit the mesh are disabled.          */
+void MeshModeler::exploreCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::exploreCB");
 
+	MeshModeler* modeler = (MeshModeler*)data;
+	bool exploring = ((Fl_Menu_Bar*)w)->mvalue()->value() != 0;
+
+	modeler->gl3DWin->setTerrain(NULL);
+	delete modeler->terrain;
+	modeler->terrain = NULL;
+	if(exploring)
+	{
+		/* Only the position keyed noise has no edges. */
+		NoiseSettings settings = modeler->noiseControls->getSettings();
+		if(modeler->noiseControls->isSpectral() || 
+			modeler->noiseControls->isDiamondSquare())
+		{
+			settings.type = FBM_NOISE;
+		}
+		Color color = Color((float)modeler->colorChooser->r(), 
+			(float)modeler->colorChooser->g(), 
+			(float)modeler->colorChooser->b());
+		modeler->terrain = new VirtualTerrain((unsigned int)rand(), settings,
+			(float)modeler->randomizeSlider->value(), &color, 
+			(float)modeler->snowHeightSlider->value());
+		modeler->gl3DWin->setTerrain(modeler->terrain);
+	}
+	modeler->setEditingActive(!exploring && !modeler->worker->isBusy());
 	modeler->gl3DWin->redraw();
 }
 
-/* Save the current mesh in the mesh modeler, data, to and obj file. */
+/* Save the current mesh in the mesh modeler, data, to and obj file. A */
+/* snapshot of the mesh is written in the background so editing can    */
+/* continue while the files are written.                                */
 void MeshModeler::saveCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::saveCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	modeler->deactivate();
 	const char* filename = fl_file_chooser("Save Mesh", "*",  "NewMesh.obj",  
 		0);
+	modeler->activate();
 
 	if(!filename)
 	{
-		modeler->activate();
 		return;
 	}
 
 	std::cout << "Saving to " << filename << std::endl;
 
-	const char* mtlFilename = strcat(extractFilename(filename), ".mtl");
-	//std::cout << extractFilename(filename) << std::endl;
-	std::ofstream outFile(mtlFilename, std::ios::out);
-	if(!(outFile.is_open()))
+	/* Save the mesh to an OBJ file and its colors to an MTL file. */
+	modeler->writer->save(modeler->mesh, filename);
+	modeler->savesPending++;
+
+	const char* name = extractName(filename);
+	std::stringstream status;
+	status << "Saving " << name << "...";
+	modeler->saveStatus->copy_label(status.str().c_str());
+	if(name != filename)
 	{
-		std::cout << "Unable to save to " << mtlFilename << std::endl;
-		modeler->activate();
-		return;
+		delete[] name;
 	}
+}
 
-	/* Write out the materal file. */
-	outFile << "newmtl snow"	<< std::endl
-			<< "illum 4"		<< std::endl
-			<< "Kd 1.0 1.0 1.0" << std::endl
-			<< "Ka 0.0 0.0 0.0" << std::endl
-			<< "Tf 1.0 1.0 1.0" << std::endl
-			<< "Ni 1.00"		<< std::endl
-			<< std::endl
-			<< "newmtl color"	<< std::endl
-			<< "illum 4"		<< std::endl
-			<< "Kd "
-				<< modeler->mesh->getColor()->toString()
-				<< std::endl
-			<< "Ka 0.0 0.0 0.0" << std::endl
-			<< "Tf 1.0 1.0 1.0" << std::endl
-			<< "Ni 1.00"		<< std::endl;
-
-	outFile.close();
-
-	/* Save the mesh to an OBJ file. */
-	outFile = std::ofstream(filename, std::ios::out);
-	if(!(outFile.is_open()))
-	{
-		std::cout << "Unable to save to " << filename << std::endl;
-		modeler->activate();
-		return;
+/* Receives the result of a save from the writer and reports it. */
+void MeshModeler::writerCB(const MeshWriterResult* result, void* data)
+{
+	TRACE_SCOPE("MeshModeler::writerCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->savesPending--;
+
+	std::stringstream status;
+	if(modeler->savesPending > 0)
+	{
+		status << "Saving " << modeler->savesPending << " more...";
 	}
-	
-	/* Write out the header. */
-	outFile << "########################################################" 
-			<< std::endl << "#"<< std::endl;
-	outFile << "# Created with Mesh Modeler(Copyright Zachary Ferguson)"
-		<< std::endl;
-	outFile << "#" << std::endl 
-			<< "########################################################" 
-			<< std::endl;
-	outFile << "#" << std::endl
-			<< "# Vertices: " << 
-				(modeler->mesh->getRows() * modeler->mesh->getCols())
-			<< std::endl
-			<< "# Faces: "    <<
-			2 * (modeler->mesh->getRows()-1) * (modeler->mesh->getCols()-1)
-			<< std::endl
-			<< "#" << std::endl 
-			<< "########################################################" 
-			<< std::endl;
-		
-	const char* mtlName = extractName(mtlFilename);
-	outFile << "mtllib " << mtlName << std::endl;
-
-	/* Write out the vertices of the mesh. */
-	for (unsigned int r = 0; r < modeler->mesh->getRows(); r++)
-	{
-		for (unsigned int c = 0; c < modeler->mesh->getCols(); c++)
+	else if(result->saved)
+	{
+		const char* name = extractName(result->filename.c_str());
+		status << "Saved " << name;
+		if(name != result->filename.c_str())
 		{
-			vec4 vertex = modeler->mesh->getVertex(r, c);
-			outFile << "v " << vertex[0] << " " << vertex[1] << " "
-				<< vertex[2] << std::endl;
-				
-			//float height = modeler->mesh->getSnowCapHeight();
-			///* Write out the color of the vertex. */
-			//if(vertex[1] >= height)
-			//{
-			//	outFile << " 1.0 1.0 1.0" << std::endl;
-			//}
-			//else
-			//{
-			//	outFile << " " << modeler->mesh->getColor()->toString() 
-			//			<< std::endl;
-			//}
+			delete[] name;
 		}
 	}
-		
-	/* Write out the faces of the mesh. */
-	float snowHeight = modeler->mesh->getSnowCapHeight();
-	for (unsigned int r = 1; r < modeler->mesh->getRows(); r++)
+	else
 	{
-		for (unsigned int c = 1; c < modeler->mesh->getCols(); c++)
-		{
-			int v1 = (r-1) * modeler->mesh->getCols() + c;
-			int v2 = v1 + 1;
-			int v3 = v1 + modeler->mesh->getCols();
-			int v4 = v3 + 1;
-
-			/* Write out the color of the vertex. */
-			vec4 vertex = modeler->mesh->getVertex(r-1, c-1);
-			outFile << ((vertex[1] >= snowHeight) ? ("usemtl snow") : 
-				("usemtl color")) << std::endl;
-			outFile << "f " << v1 << " " << v4 << " " << v2 << std::endl;
-			outFile << "f " << v1 << " " << v3 << " " << v4 << std::endl;
-		}
+		status << "Save failed";
 	}
+	modeler->saveStatus->copy_label(status.str().c_str());
 
-	outFile.close();
-
-	modeler->activate();
+	if(!result->saved)
+	{
+		fl_alert("Unable to save the mesh to %s", result->filename.c_str());
+	}
 }
 
-/* Extracts the filename with out the extension of the given char*. */
-char* extractFilename(const char* filename)
+/* Autosaves the mesh to the journal every AUTOSAVE_INTERVAL seconds. Only */
+/* a snapshot is taken here, the changed tiles are written in the          */
+/* background.                                                             */
+void MeshModeler::autosaveCB(void* data)
 {
-	char* extractedName = new char[strlen(filename)];
-	strcpy(extractedName, filename);
+	TRACE_SCOPE("MeshModeler::autosaveCB");
 
-	for (int i = strlen(filename) - 1; i >= 0; i--)
+	MeshModeler* modeler = (MeshModeler*)data;
+	modeler->journal->checkpoint(modeler->mesh);
+	Fl::repeat_timeout(AUTOSAVE_INTERVAL, MeshModeler::autosaveCB, data);
+}
+
+#ifdef ENABLE_TRACING
+/* Save the scopes traced so far to a Chrome trace event JSON file. */
+void MeshModeler::saveTraceCB(Fl_Widget* w, void* data)
+{
+	const char* filename = fl_file_chooser("Save Trace", "*.json",
+		"trace.json", 0);
+	if(filename && Trace::dump(filename))
 	{
-		if(extractedName[i] == '.')
-		{
-			extractedName[i] = 0;
-			break;
-		}
+		std::cout << "Saved trace to " << filename << std::endl;
 	}
-
-	return extractedName;
 }
+#endif
 
-/* Extracts the filename, without the path, of the given char*. */
-const char* extractName(const char* filename)
+/* Undo the most recent edit of the mesh. Disabled while the worker reads */
+/* the mesh or the infinite terrain is shown in its place.                */
+void MeshModeler::undoCB(Fl_Widget* w, void* data)
 {
-	for (int i = strlen(filename) - 1; i >= 0; i--)
+	TRACE_SCOPE("MeshModeler::undoCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	if(!modeler->worker->isBusy() && modeler->terrain == NULL &&
+		modeler->history->canUndo())
 	{
-		if(filename[i] == '/')
-		{
-			char* extractedName = new char[strlen(&(filename[i+1]))];
-			strcpy(extractedName, &(filename[i + 1]));
-			return extractedName;
-		}
+		modeler->showUndoneMesh(modeler->history->undo(modeler->mesh));
 	}
+}
+
+/* Redo the most recently undone edit of the mesh. Disabled while the   */
+/* worker reads the mesh or the infinite terrain is shown in its place. */
+void MeshModeler::redoCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::redoCB");
 
-	return filename;
+	MeshModeler* modeler = (MeshModeler*)data;
+	if(!modeler->worker->isBusy() && modeler->terrain == NULL &&
+		modeler->history->canRedo())
+	{
+		modeler->showUndoneMesh(modeler->history->redo(modeler->mesh));
+	}
 }
 
-/* Exit the mesh modeler. */
+/* Exit the mesh modeler. Hiding every window ends Fl::run, and main */
+/* then deletes the modeler, which finishes the queued saves and     */
+/* deletes the autosave journal.                                     */
 void MeshModeler::exitCB(Fl_Widget* w, void* data)
 {
-	delete data;
-	exit(0);
+	while(Fl::first_window())
+	{
+		Fl::first_window()->hide();
+	}
 }
 
 /* Display the Help window. */
 void MeshModeler::helpCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::helpCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	if (modeler->helpBox)
 		delete modeler->helpBox;
@@ -530,6 +802,8 @@ void MeshModeler::helpCB(Fl_Widget* w, void* data)
 /* Display the About window. */
 void MeshModeler::aboutCB(Fl_Widget* w, void* data)
 {
+	TRACE_SCOPE("MeshModeler::aboutCB");
+
 	MeshModeler* modeler = (MeshModeler*)data;
 	if (modeler->aboutBox)
 		delete modeler->aboutBox;
@@ -538,10 +812,96 @@ void MeshModeler::aboutCB(Fl_Widget* w, void* data)
 	modeler->aboutBox->show();
 }
 
+/* Display the memory used by each subsystem. */
+void MeshModeler::memoryCB(Fl_Widget* w, void* data)
+{
+	TRACE_SCOPE("MeshModeler::memoryCB");
+
+	MeshModeler* modeler = (MeshModeler*)data;
+	if (modeler->memoryBox)
+		delete modeler->memoryBox;
+	MemoryTracker::dump(MEMORY_REPORT_FILENAME);
+	modeler->memoryBox = new HelpBox(modeler->x(), modeler->y(), 580, 215, 
+		MEMORY_REPORT_FILENAME, "Memory Usage");
+	modeler->memoryBox->show();
+}
+
 /********************/
 /* Update Functions */
 /********************/
 
+/* Starts running the operation on the current mesh in the background. The */
+/* controls that modify the mesh are disabled until it is finished.        */
+void MeshModeler::startOperation(MeshOperation operation, 
+	unsigned int iterations)
+{
+	if(iterations == 0 || !this->worker->start(operation, this->mesh, 
+		iterations))
+	{
+		return;
+	}
+
+	this->setEditingActive(false);
+	this->cancelB->activate();
+	this->progressBar->value(0);
+	this->progressBar->copy_label((operation == FRACTALIZE_MESH) ? 
+		"Fractalizing..." : (operation == SMOOTH_MESH) ? "Smoothing..." : 
+		(operation == ERODE_MESH) ? "Eroding..." : 
+		(operation == THERMAL_ERODE_MESH) ? "Eroding slopes..." : 
+		"Running droplets...");
+}
+
+/* Enables or disables the controls that modify the mesh. The camera, view */
+/* mode, and saving only read the mesh so they stay enabled.               */
+void MeshModeler::setEditingActive(bool active)
+{
+	Fl_Widget* widgets[] = {this->newMesh, this->colorChooser, 
+		this->randomizeSlider, this->randomizeB, this->flattenB, 
+		this->heightEditor, this->brushControls, this->snowHeightSlider, 
+		this->fractalizeSlider, 
+		this->fractalizeB, this->smoothSlider, this->smoothB, 
+		this->erodeSlider, this->erodeB, this->thermalErodeB, 
+		this->dropletErodeB, this->noiseControls};
+	for (unsigned int i = 0; i < sizeof(widgets)/sizeof(widgets[0]); i++)
+	{
+		if(active)
+		{
+			widgets[i]->activate();
+		}
+		else
+		{
+			widgets[i]->deactivate();
+		}
+	}
+}
+
+/* Displays the mesh returned by an undo or redo. If the mesh was swapped */
+/* for another the height editor is reset to fit it.                      */
+void MeshModeler::showUndoneMesh(Mesh* mesh)
+{
+	if(mesh != this->mesh)
+	{
+		this->mesh = mesh;
+		this->gl3DWin->setMesh(this->mesh);
+		this->resetHeightEditor();
+	}
+	else
+	{
+		this->updateHeightSlider();
+	}
+	this->gl3DWin->redraw();
+}
+
+/* Resets the height editor to the first vertex of the current mesh. */
+void MeshModeler::resetHeightEditor()
+{
+	this->heightEditor->setRow(0);
+	this->heightEditor->setCol(0);
+	this->heightEditor->setRows(this->mesh->getRows());
+	this->heightEditor->setCols(this->mesh->getCols());
+	MeshModeler::selectIndexCB(NULL, this);
+}
+
 /* Update the height slider's value. */
 void MeshModeler::updateHeightSlider()
 {
@@ -571,6 +931,12 @@ void MeshModeler::updateIndexSpinners()
 /* Moves the camera around according to key presses.      */
 int MeshModeler::handle(int event)
 {
+	/* Sculpting uses the mouse pushes, drags, and releases. */
+	if(this->handleStroke(event))
+	{
+		return 1;
+	}
+
 	/* MeshModeler does not handle draging. */
 	/* Prevent stack overflow exception.    */
 	if(event == FL_DRAG)
@@ -599,16 +965,90 @@ int MeshModeler::handle(int event)
 /* Handle the mouse clicks on the GL3DWindow. */
 void MeshModeler::handlePush()
 {
+	TRACE_SCOPE("MeshModeler::handlePush");
+
 	ray userRay = this->gl3DWin->getRayFromPush();
 
+	/* The terrain is only looked at, so its vertex is only shown. */
+	if(this->terrain)
+	{
+		this->gl3DWin->selectTerrainVertex(userRay);
+		return;
+	}
+
 	/* Check for the vertices that the ray passes through, within a radius */
 	/* of r from the vertex.                                               */
 	this->selectedIndecies = this->gl3DWin->selectMeshIndex(this->mesh->
 		selectVertex(userRay));
+	this->history->endHeightEdit();
 
 	/* Update the height editor. */
 	this->updateHeightSlider();
 	this->updateIndexSpinners();
 
 	this->gl3DWin->redraw();
-}
\ No newline at end of file
+}
+
+/* Handle the mouse sculpting the mesh on the GL3DWindow. A push begins a */
+/* stroke, each drag continues it, and the release records it so it can  */
+/* be undone. Only the GL3DWindow is redrawn, and only if a dab changed   */
+/* some vertices. Returns true if the event was used by a stroke.        */
+bool MeshModeler::handleStroke(int event)
+{
+	bool stroking = (this->strokeBefore != NULL);
+	if(event == FL_PUSH && !stroking)
+	{
+		if(!this->brushControls->isSculpting() || this->worker->isBusy() || 
+			this->terrain || 
+			Fl::event_x() > this->gl3DWin->w() || 
+			Fl::event_y() > this->gl3DWin->h())
+		{
+			return false;
+		}
+	}
+	else if(!stroking || (event != FL_DRAG && event != FL_RELEASE))
+	{
+		return false;
+	}
+
+	TRACE_SCOPE("MeshModeler::handleStroke");
+
+	if(event == FL_RELEASE)
+	{
+		this->history->recordStroke(this->strokeBefore, this->mesh);
+		this->strokeBefore = NULL;
+		this->updateHeightSlider();
+		return true;
+	}
+
+	float x, z;
+	if(!Brush::groundPoint(this->gl3DWin->getRayFromPush(), x, z))
+	{
+		return true;
+	}
+
+	MeshRect dirty;
+	if(event == FL_PUSH)
+	{
+		/* Keep the mesh from before the stroke, which only holds the */
+		/* tiles the stroke changes.                                  */
+		Fl::focus(this->gl3DWin);
+		this->history->endHeightEdit();
+		this->strokeBefore = this->mesh->snapshot();
+		this->brush->setMode(this->brushControls->getMode());
+		this->brush->setFalloff(this->brushControls->getFalloff());
+		this->brush->setRadius(this->brushControls->getRadius());
+		this->brush->setStrength(this->brushControls->getStrength());
+		dirty = this->brush->beginStroke(this->mesh, x, z);
+	}
+	else
+	{
+		dirty = this->brush->continueStroke(this->mesh, x, z);
+	}
+
+	if(!isEmpty(dirty))
+	{
+		this->gl3DWin->redraw();
+	}
+	return true;
+}
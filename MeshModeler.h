@@ -15,12 +15,32 @@
 #include <FL/Fl_Menu_Bar.H>
 #include <FL/Fl_File_Chooser.H>
 #include <FL/fl_ask.H>
+#include <FL/Fl_Progress.H>
+#include <FL/Fl_Box.H>
 #include "CreateMeshGroup.h"
 #include "ViewModeGroup.h"
 #include "CameraControlGroup.h"
 #include "HeightEditorGroup.h"
+#include "BrushGroup.h"
+#include "NoiseGroup.h"
 #include "HelpBox.h"
 #include "GL3DWindow.h"
+#include "MeshWorker.h"
+#include "MeshWriter.h"
+#include "MeshJournal.h"
+#include "UndoHistory.h"
+
+/* File the memory report is written to, both when it is displayed and when */
+/* the program exits.                                                       */
+#define MEMORY_REPORT_FILENAME "memory_report.txt"
+
+/* Height of the status bar below the GL3DWindow. */
+#define STATUS_BAR_HEIGHT 30
+
+/* Journal the mesh is autosaved to, and recovered from after a crash. */
+#define AUTOSAVE_FILENAME "MeshModeler_autosave.journal"
+/* Seconds between autosaves of the mesh. */
+#define AUTOSAVE_INTERVAL 5.0
 
 class MeshModeler : public Fl_Window
 {
@@ -51,6 +71,13 @@ class MeshModeler : public Fl_Window
 		CameraControlGroup* cameraControls;
 		/* Group for the height editing controls. */
 		HeightEditorGroup* heightEditor;
+		/* Group for the sculpting brush controls. */
+		BrushGroup* brushControls;
+		/* Brush the mesh is sculpted with. */
+		Brush* brush;
+		/* Snapshot of the mesh from before the stroke being made, NULL if */
+		/* no stroke is being made.                                        */
+		Mesh* strokeBefore;
 		/* Slider for changing the snow cap height. */
 		Fl_Value_Slider* snowHeightSlider;
 		/* Slider for the number of fractilization iterations. */
@@ -61,10 +88,41 @@ class MeshModeler : public Fl_Window
 		Fl_Value_Slider* smoothSlider;
 		/* Button to smooth the mesh. */
 		Fl_Button* smoothB;
+		/* Slider for the number of erosion steps. */
+		Fl_Value_Slider* erodeSlider;
+		/* Button to erode the mesh with rain. */
+		Fl_Button* erodeB;
+		/* Button to erode the mesh by the talus angle. */
+		Fl_Button* thermalErodeB;
+		/* Button to erode the mesh with droplets. */
+		Fl_Button* dropletErodeB;
+		/* Group for the noise the heights are generated from. */
+		NoiseGroup* noiseControls;
+		/* Terrain without edges being explored instead of the mesh, NULL */
+		/* if the mesh is shown.                                          */
+		VirtualTerrain* terrain;
+		/* Progress of the running fractalize, smooth, or erosion. */
+		Fl_Progress* progressBar;
+		/* Button to cancel the running fractalize, smooth, or erosion. */
+		Fl_Button* cancelB;
+		/* Background thread running the fractalize, smooth, and erosion. */
+		MeshWorker* worker;
+		/* Status of the saves being written in the background. */
+		Fl_Box* saveStatus;
+		/* Background thread writing the saved meshes. */
+		MeshWriter* writer;
+		/* Number of saves queued that have not finished. */
+		unsigned int savesPending;
+		/* Journal the changes to the mesh are autosaved to. */
+		MeshJournal* journal;
+		/* Edits of the mesh that can be undone and redone. */
+		UndoHistory* history;
 		/* Window for displaying help info. */
 		HelpBox* helpBox;
 		/* Window for displaying help info. */
 		HelpBox* aboutBox;
+		/* Window for displaying the memory report. */
+		HelpBox* memoryBox;
 		
 		/* Creates a new mesh for the GL3DWindow. */
 		static void newMeshCB(Fl_Widget* w, void* data);
@@ -82,19 +140,56 @@ class MeshModeler : public Fl_Window
 		static void fractalizeCB(Fl_Widget* w, void* data);
 		/* Callback function for smoothing the mesh. */
 		static void smoothCB(Fl_Widget* w, void* data);
+		/* Callback function for eroding the mesh with rain. */
+		static void erodeCB(Fl_Widget* w, void* data);
+		/* Callback function for thermally eroding the mesh. */
+		static void thermalErodeCB(Fl_Widget* w, void* data);
+		/* Callback function for eroding the mesh with droplets. */
+		static void dropletErodeCB(Fl_Widget* w, void* data);
+		/* Callback function for cancelling the running operation. */
+		static void cancelCB(Fl_Widget* w, void* data);
+		/* Receives the progress of the running operation from the worker. */
+		static void workerCB(const MeshWorkerUpdate* update, void* data);
 		/* Callback function for randomizing the mesh's heights. */
 		static void randomizeCB(Fl_Widget* w, void* data);
 		/* Callback function for flattening the mesh. */
 		static void flattenCB(Fl_Widget* w, void* data);
+		/* Callback function for generating the heights from noise. */
+		static void noiseCB(Fl_Widget* w, void* data);
+		/* Callback function for exploring a terrain of the noise. */
+		static void exploreCB(Fl_Widget* w, void* data);
 		/* Save the current mesh in the mesh modeler, data, to and obj file. */
 		static void saveCB(Fl_Widget* w, void* data);
+		/* Receives the result of a save from the writer. */
+		static void writerCB(const MeshWriterResult* result, void* data);
+		/* Autosaves the changes to the mesh to the journal. */
+		static void autosaveCB(void* data);
+#ifdef ENABLE_TRACING
+		/* Save the scopes traced so far to a Chrome trace event file. */
+		static void saveTraceCB(Fl_Widget* w, void* data);
+#endif
+		/* Undo the most recent edit of the mesh. */
+		static void undoCB(Fl_Widget* w, void* data);
+		/* Redo the most recently undone edit of the mesh. */
+		static void redoCB(Fl_Widget* w, void* data);
 		/* Exit the mesh modeler. */
 		static void exitCB(Fl_Widget* w, void* data);
 		/* Displays a help window for the mesh modeler. */
 		static void helpCB(Fl_Widget* w, void* data);
 		/* Display the About window. */
 		static void aboutCB(Fl_Widget* w, void* data);
+		/* Display the memory used by each subsystem. */
+		static void memoryCB(Fl_Widget* w, void* data);
 		
+		/* Starts running the operation in the background. */
+		void startOperation(MeshOperation operation, unsigned int iterations);
+		/* Enables or disables the controls that modify the mesh. */
+		void setEditingActive(bool active);
+		/* Resets the height editor to the first vertex of the mesh. */
+		void resetHeightEditor();
+		/* Displays the mesh returned by an undo or redo. */
+		void showUndoneMesh(Mesh* mesh);
+
 		/* Update the height sliders value. */
 		void updateHeightSlider();
 		/* Update the index spinners' values. */
@@ -102,6 +197,9 @@ class MeshModeler : public Fl_Window
 		
 		/* Handle the mouse clicks on the GL3DWindow. */
 		void handlePush();
+		/* Handle the mouse sculpting the mesh on the GL3DWindow. Returns */
+		/* true if the event was used by a stroke.                        */
+		bool handleStroke(int event);
 
 	public:
 		
@@ -122,10 +220,4 @@ class MeshModeler : public Fl_Window
 Fl_Value_Slider* makeHorizSlider(int x, int y, int w, int h, const char* label,
 	float min, float max, double value = 1.0, double step = 1.0);
 
-/* Extracts the filename, without the extension, of the given char*. */
-char* extractFilename(const char* filename);
-
-/* Extracts the filename, without the path, of the given char*. */
-const char* extractName(const char* filename);
-
 #endif
\ No newline at end of file
@@ -0,0 +1,310 @@
+/*
+ * MeshWorker.cpp
+ * Created by Zachary Ferguson
+ * Source file for the MeshWorker class, a background thread that runs the
+ * iterations of a fractalize, smooth, or erosion so the FLTK thread stays
+ * responsive. Each level is posted back to the FLTK thread with Fl::awake as
+ * soon as it is finished, so it can be displayed while the next level is
+ * computed.
+ */
+
+#include "MeshWorker.h"
+#include "DropletErosion.h"
+#include "HydraulicErosion.h"
+#include "Trace.h"
+#include <FL/Fl.H>
+#include <algorithm>
+#include <chrono>
+
+/* Time to wait before posting again when the FLTK awake queue is full. */
+#define AWAKE_RETRY_MS 1
+
+/* An update and the worker it is from, passed through Fl::awake. */
+struct MeshWorkerMessage
+{
+	MeshWorker* worker;
+	MeshWorkerUpdate update;
+};
+
+/* Creates a worker that passes its updates to callback. */
+MeshWorker::MeshWorker(MeshWorkerCallback callback, void* data)
+{
+	this->operation = FRACTALIZE_MESH;
+	this->input = NULL;
+	this->iterations = 0;
+	this->pending = false;
+	this->stop = false;
+	this->cancelled = false;
+	this->busy = false;
+	this->callback = callback;
+	this->callbackData = data;
+	this->thread = std::thread(&MeshWorker::run, this);
+}
+
+/* Cancels the running operation and joins the thread. */
+MeshWorker::~MeshWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+		this->cancelled = true;
+	}
+	this->wake.notify_one();
+	this->thread.join();
+}
+
+/* Starts running the operation on the given mesh, which must not be */
+/* modified or deleted until the first update is received.           */
+/* Returns false if an operation is already running.                 */
+bool MeshWorker::start(MeshOperation operation, const Mesh* mesh,
+	unsigned int iterations)
+{
+	if(this->busy)
+	{
+		return false;
+	}
+	this->busy = true;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->operation = operation;
+		this->input = mesh;
+		this->iterations = iterations;
+		this->cancelled = false;
+		this->pending = true;
+	}
+	this->wake.notify_one();
+	return true;
+}
+
+/* Asks the running operation to stop as soon as possible. */
+void MeshWorker::cancel()
+{
+	this->cancelled = true;
+}
+
+/* Returns true while an operation is running. */
+bool MeshWorker::isBusy() const
+{
+	return this->busy;
+}
+
+/* Body of the worker thread. Waits for an operation and runs it. */
+void MeshWorker::run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	for (;;)
+	{
+		while(!this->stop && !this->pending)
+		{
+			this->wake.wait(lock);
+		}
+		if(this->stop)
+		{
+			return;
+		}
+		this->pending = false;
+		MeshOperation operation = this->operation;
+		const Mesh* input = this->input;
+		unsigned int iterations = this->iterations;
+
+		lock.unlock();
+		this->process(operation, input, iterations);
+		lock.lock();
+	}
+}
+
+/* Runs the iterations of one operation, posting each level once it is */
+/* made. The levels belong to the receiver, which keeps each one until  */
+/* the next arrives, so the previous level can be read without a copy.  */
+void MeshWorker::process(MeshOperation operation, const Mesh* input,
+	unsigned int iterations)
+{
+	TRACE_SCOPE("MeshWorker::process");
+
+	if(iterations == 0)
+	{
+		this->post(operation, 0, 0, NULL, false, true);
+		return;
+	}
+	if(operation == ERODE_MESH)
+	{
+		this->erode(input, iterations);
+		return;
+	}
+	if(operation == THERMAL_ERODE_MESH)
+	{
+		this->thermalErode(input, iterations);
+		return;
+	}
+	if(operation == DROPLET_ERODE_MESH)
+	{
+		this->dropletErode(input, iterations);
+		return;
+	}
+
+	const Mesh* current = input;
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		Mesh* next = (operation == FRACTALIZE_MESH) ?
+			current->fractalize(&(this->cancelled)) :
+			current->smooth(&(this->cancelled));
+		if(!next)
+		{
+			this->post(operation, i, iterations, NULL, false, true);
+			return;
+		}
+		if(!this->post(operation, i + 1, iterations, next, i == 0,
+			i + 1 == iterations))
+		{
+			return;
+		}
+		current = next;
+	}
+}
+
+/* Runs the given number of erosion steps, posting the eroded terrain */
+/* every EROSION_STEPS_PER_UPDATE steps. The levels are made from a    */
+/* snapshot of the input, so the input is only read before the first  */
+/* update.                                                            */
+void MeshWorker::erode(const Mesh* input, unsigned int steps)
+{
+	TRACE_SCOPE("MeshWorker::erode");
+
+	HydraulicErosion erosion(input);
+	Mesh* base = input->snapshot();
+	unsigned int done = 0;
+	while(done < steps)
+	{
+		unsigned int count = std::min((unsigned int)EROSION_STEPS_PER_UPDATE,
+			steps - done);
+		unsigned int ran = erosion.run(count, &(this->cancelled));
+		if(ran < count)
+		{
+			this->post(ERODE_MESH, done + ran, steps, NULL, false, true);
+			break;
+		}
+		Mesh* level = base->snapshot();
+		erosion.apply(level);
+		bool first = (done == 0);
+		done += ran;
+		if(!this->post(ERODE_MESH, done, steps, level, first, done == steps))
+		{
+			break;
+		}
+	}
+	delete base;
+}
+
+/* Runs the given number of thermal erosion steps, posting the eroded  */
+/* mesh every EROSION_STEPS_PER_UPDATE steps. Each level is a snapshot */
+/* of the one before it, eroded in place.                              */
+void MeshWorker::thermalErode(const Mesh* input, unsigned int steps)
+{
+	TRACE_SCOPE("MeshWorker::thermalErode");
+
+	const Mesh* current = input;
+	unsigned int done = 0;
+	while(done < steps)
+	{
+		unsigned int count = std::min((unsigned int)EROSION_STEPS_PER_UPDATE,
+			steps - done);
+		Mesh* next = current->snapshot();
+		if(!next->thermalErode(count, THERMAL_EROSION_STRENGTH,
+			DEFAULT_TALUS_ANGLE, &(this->cancelled)))
+		{
+			delete next;
+			this->post(THERMAL_ERODE_MESH, done, steps, NULL, false, true);
+			return;
+		}
+		bool first = (done == 0);
+		done += count;
+		if(!this->post(THERMAL_ERODE_MESH, done, steps, next, first,
+			done == steps))
+		{
+			return;
+		}
+		current = next;
+	}
+}
+
+/* Runs the given number of droplet erosion steps, each releasing a      */
+/* droplet per VERTICES_PER_DROPLET vertices, and posts the eroded mesh  */
+/* every EROSION_STEPS_PER_UPDATE steps. Like the grid erosion, the      */
+/* levels are made from a snapshot of the input.                         */
+void MeshWorker::dropletErode(const Mesh* input, unsigned int steps)
+{
+	TRACE_SCOPE("MeshWorker::dropletErode");
+
+	DropletErosion erosion(input);
+	Mesh* base = input->snapshot();
+	unsigned int dropletsPerStep = std::max(1U, input->getRows() *
+		input->getCols() / VERTICES_PER_DROPLET);
+	unsigned int done = 0;
+	while(done < steps)
+	{
+		unsigned int count = std::min((unsigned int)EROSION_STEPS_PER_UPDATE,
+			steps - done);
+		unsigned int droplets = count * dropletsPerStep;
+		if(erosion.run(droplets, &(this->cancelled)) < droplets)
+		{
+			this->post(DROPLET_ERODE_MESH, done, steps, NULL, false, true);
+			break;
+		}
+		Mesh* level = base->snapshot();
+		erosion.apply(level);
+		bool first = (done == 0);
+		done += count;
+		if(!this->post(DROPLET_ERODE_MESH, done, steps, level, first,
+			done == steps))
+		{
+			break;
+		}
+	}
+	delete base;
+}
+
+/* Posts an update to the FLTK thread. If the awake queue is full the post */
+/* is retried until it fits, or dropped if the worker is being destroyed.  */
+/* Returns false if the update was dropped.                                */
+bool MeshWorker::post(MeshOperation operation, unsigned int iteration,
+	unsigned int iterations, Mesh* mesh, bool first, bool finished)
+{
+	MeshWorkerMessage* message = new MeshWorkerMessage();
+	message->worker = this;
+	message->update.operation = operation;
+	message->update.iteration = iteration;
+	message->update.iterations = iterations;
+	message->update.mesh = mesh;
+	message->update.first = first;
+	message->update.finished = finished;
+	message->update.cancelled = finished && iteration < iterations;
+
+	while(Fl::awake(MeshWorker::awakeCB, message) != 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if(this->stop)
+			{
+				delete message->update.mesh;
+				delete message;
+				return false;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(
+			AWAKE_RETRY_MS));
+	}
+	return true;
+}
+
+/* Passes an update to the callback on the FLTK thread. */
+void MeshWorker::awakeCB(void* data)
+{
+	MeshWorkerMessage* message = (MeshWorkerMessage*)data;
+	MeshWorker* worker = message->worker;
+	if(message->update.finished)
+	{
+		worker->busy = false;
+	}
+	worker->callback(&(message->update), worker->callbackData);
+	delete message;
+}
@@ -0,0 +1,132 @@
+/*
+ * MeshWorker.h
+ * Created by Zachary Ferguson
+ * Header file for the MeshWorker class, a background thread that runs the
+ * iterations of a fractalize, smooth, or erosion so the FLTK thread stays
+ * responsive. Each level is posted back to the FLTK thread with Fl::awake as
+ * soon as it is finished, so it can be displayed while the next level is
+ * computed.
+ */
+
+#ifndef MESHWORKER_H
+#define MESHWORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Mesh.h"
+
+/* Number of hydraulic or thermal erosion steps run between the levels */
+/* posted.                                                             */
+#define EROSION_STEPS_PER_UPDATE 25
+
+/* Number of vertices per droplet released by each droplet erosion step. */
+#define VERTICES_PER_DROPLET 16
+
+/* Fraction of the excess slope moved by each thermal erosion step. */
+#define THERMAL_EROSION_STRENGTH 0.5f
+
+/* Operations the worker can run on a mesh. */
+enum MeshOperation {FRACTALIZE_MESH, SMOOTH_MESH, ERODE_MESH,
+	THERMAL_ERODE_MESH, DROPLET_ERODE_MESH};
+
+/* Progress of the running operation, posted after every iteration, or */
+/* every EROSION_STEPS_PER_UPDATE steps of an erosion.                 */
+struct MeshWorkerUpdate
+{
+	/* The operation running. */
+	MeshOperation operation;
+	/* Number of iterations finished and the number requested. */
+	unsigned int iteration, iterations;
+	/* The level made by the iteration, NULL if cancelled or no iterations */
+	/* were run. The receiver takes ownership of the mesh, but must keep   */
+	/* it unmodified until the next update since the worker makes the next */
+	/* level from it.                                                      */
+	Mesh* mesh;
+	/* True if the mesh is the first level, which replaces the mesh the */
+	/* operation was started on.                                        */
+	bool first;
+	/* True for the last update of the operation. */
+	bool finished;
+	/* True if the operation was cancelled before it finished. */
+	bool cancelled;
+};
+
+/* Called on the FLTK thread with each update of the running operation. */
+typedef void (*MeshWorkerCallback)(const MeshWorkerUpdate* update,
+	void* data);
+
+class MeshWorker
+{
+	private:
+
+		/* Thread running the operations. */
+		std::thread thread;
+		/* Guards the operation to be run and the stop flag. */
+		std::mutex mutex;
+		/* Signals the thread an operation was started or it should stop. */
+		std::condition_variable wake;
+
+		/* The operation to be run. */
+		MeshOperation operation;
+		/* Mesh the operation is run on, read only while running. */
+		const Mesh* input;
+		/* Number of iterations to run. */
+		unsigned int iterations;
+		/* Set when an operation is waiting for the thread. */
+		bool pending;
+		/* Set to tell the thread to exit. */
+		bool stop;
+
+		/* Set to abandon the running operation. */
+		std::atomic<bool> cancelled;
+		/* True from start until the finished update is received, only */
+		/* used on the FLTK thread.                                    */
+		bool busy;
+
+		/* Receives the updates on the FLTK thread. */
+		MeshWorkerCallback callback;
+		void* callbackData;
+
+		/* Body of the worker thread. */
+		void run();
+		/* Runs the iterations of one operation. */
+		void process(MeshOperation operation, const Mesh* input,
+			unsigned int iterations);
+		/* Runs the given number of erosion steps. */
+		void erode(const Mesh* input, unsigned int steps);
+		/* Runs the given number of thermal erosion steps. */
+		void thermalErode(const Mesh* input, unsigned int steps);
+		/* Runs the given number of droplet erosion steps. */
+		void dropletErode(const Mesh* input, unsigned int steps);
+		/* Posts an update to the FLTK thread. Returns false if the worker */
+		/* is being destroyed and the update was dropped.                  */
+		bool post(MeshOperation operation, unsigned int iteration,
+			unsigned int iterations, Mesh* mesh, bool first, bool finished);
+
+		/* Passes an update to the callback on the FLTK thread. */
+		static void awakeCB(void* data);
+
+	public:
+
+		/* Creates a worker that passes its updates to callback. */
+		MeshWorker(MeshWorkerCallback callback, void* data);
+
+		/* Cancels the running operation and joins the thread. */
+		~MeshWorker();
+
+		/* Starts running the operation on the given mesh, which must not be */
+		/* modified or deleted until the first update is received.           */
+		/* Returns false if an operation is already running.                 */
+		bool start(MeshOperation operation, const Mesh* mesh,
+			unsigned int iterations);
+
+		/* Asks the running operation to stop as soon as possible. */
+		void cancel();
+
+		/* Returns true while an operation is running. */
+		bool isBusy() const;
+};
+
+#endif
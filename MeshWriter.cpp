@@ -0,0 +1,118 @@
+/*
+ * MeshWriter.cpp
+ * Created by Zachary Ferguson
+ * Source file for the MeshWriter class, a background thread that saves
+ * snapshots of meshes to OBJ files so editing can continue during the write.
+ * The result of each save is posted back to the FLTK thread with Fl::awake.
+ */
+
+#include "MeshWriter.h"
+#include "Trace.h"
+#include <FL/Fl.H>
+#include <chrono>
+
+/* Time to wait before posting again when the FLTK awake queue is full. */
+#define AWAKE_RETRY_MS 1
+
+/* A result and the writer it is from, passed through Fl::awake. */
+struct MeshWriterMessage
+{
+	MeshWriter* writer;
+	MeshWriterResult result;
+};
+
+/* Creates a writer that passes its results to callback. */
+MeshWriter::MeshWriter(MeshWriterCallback callback, void* data)
+{
+	this->stop = false;
+	this->callback = callback;
+	this->callbackData = data;
+	this->thread = std::thread(&MeshWriter::run, this);
+}
+
+/* Writes the saves still queued and joins the thread. */
+MeshWriter::~MeshWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+	}
+	this->wake.notify_one();
+	this->thread.join();
+}
+
+/* Queues a snapshot of the given mesh to be saved to filename. Only the */
+/* snapshot is taken on the calling thread.                              */
+void MeshWriter::save(const Mesh* mesh, const char* filename)
+{
+	TRACE_SCOPE("MeshWriter::save");
+
+	Job job;
+	job.snapshot = mesh->snapshot();
+	job.filename = filename;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->queue.push_back(job);
+	}
+	this->wake.notify_one();
+}
+
+/* Body of the writer thread. Saves the queued snapshots in order and */
+/* posts the result of each. Once stopped the rest of the queue is    */
+/* still written, but the results are no longer posted.               */
+void MeshWriter::run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	for (;;)
+	{
+		while(!this->stop && this->queue.empty())
+		{
+			this->wake.wait(lock);
+		}
+		if(this->queue.empty())
+		{
+			return;
+		}
+		Job job = this->queue.front();
+		this->queue.pop_front();
+
+		lock.unlock();
+		bool saved;
+		{
+			TRACE_SCOPE("MeshWriter::write");
+			saved = job.snapshot->saveOBJ(job.filename.c_str());
+		}
+		delete job.snapshot;
+		lock.lock();
+
+		MeshWriterMessage* message = new MeshWriterMessage();
+		message->writer = this;
+		message->result.filename = job.filename;
+		message->result.saved = saved;
+		bool posted = false;
+		while(!this->stop && !posted)
+		{
+			posted = (Fl::awake(MeshWriter::awakeCB, message) == 0);
+			if(!posted)
+			{
+				lock.unlock();
+				std::this_thread::sleep_for(std::chrono::milliseconds(
+					AWAKE_RETRY_MS));
+				lock.lock();
+			}
+		}
+		if(!posted)
+		{
+			delete message;
+		}
+	}
+}
+
+/* Passes a result to the callback on the FLTK thread. */
+void MeshWriter::awakeCB(void* data)
+{
+	MeshWriterMessage* message = (MeshWriterMessage*)data;
+	MeshWriter* writer = message->writer;
+	writer->callback(&(message->result), writer->callbackData);
+	delete message;
+}
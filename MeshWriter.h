@@ -0,0 +1,77 @@
+/*
+ * MeshWriter.h
+ * Created by Zachary Ferguson
+ * Header file for the MeshWriter class, a background thread that saves
+ * snapshots of meshes to OBJ files so editing can continue during the write.
+ * The result of each save is posted back to the FLTK thread with Fl::awake.
+ */
+
+#ifndef MESHWRITER_H
+#define MESHWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Mesh.h"
+
+/* Result of a save, posted once the files are written. */
+struct MeshWriterResult
+{
+	/* Name of the OBJ file saved to. */
+	std::string filename;
+	/* True if both the OBJ and MTL files were written. */
+	bool saved;
+};
+
+/* Called on the FLTK thread with the result of each save. */
+typedef void (*MeshWriterCallback)(const MeshWriterResult* result,
+	void* data);
+
+class MeshWriter
+{
+	private:
+
+		/* A snapshot waiting to be saved and the file to save it to. */
+		struct Job
+		{
+			Mesh* snapshot;
+			std::string filename;
+		};
+
+		/* Thread writing the files. */
+		std::thread thread;
+		/* Guards the queue and the stop flag. */
+		std::mutex mutex;
+		/* Signals the thread a save was queued or it should stop. */
+		std::condition_variable wake;
+		/* Saves waiting to be written, in the order they were made. */
+		std::deque<Job> queue;
+		/* Set to tell the thread to exit once the queue is written. */
+		bool stop;
+
+		/* Receives the results on the FLTK thread. */
+		MeshWriterCallback callback;
+		void* callbackData;
+
+		/* Body of the writer thread. */
+		void run();
+
+		/* Passes a result to the callback on the FLTK thread. */
+		static void awakeCB(void* data);
+
+	public:
+
+		/* Creates a writer that passes its results to callback. */
+		MeshWriter(MeshWriterCallback callback, void* data);
+
+		/* Writes the saves still queued and joins the thread. */
+		~MeshWriter();
+
+		/* Queues a snapshot of the given mesh to be saved to filename. */
+		/* Only the snapshot is taken on the calling thread.            */
+		void save(const Mesh* mesh, const char* filename);
+};
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * NoiseGenerator.cpp
+ * Created by Zachary Ferguson
+ * Source file for the NoiseGenerator class, which fills a heightfield with
+ * gradient noise summed over octaves as fBm, ridged, or billow noise.
+ */
+
+#include "NoiseGenerator.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/* Fewest vertices given to each thread by the fill. */
+#define VERTICES_PER_TASK 16384
+
+/* Scales the noise of unit gradients, at most sqrt(1/2), to -1 to 1. */
+#define NOISE_SCALE 1.41421356f
+
+/* Components of the eight unit gradients a lattice point picks from. */
+static const float gradientX[8] = {1, -1, 0, 0, 0.70710678f, -0.70710678f,
+	0.70710678f, -0.70710678f};
+static const float gradientZ[8] = {0, 0, 1, -1, 0.70710678f, 0.70710678f,
+	-0.70710678f, -0.70710678f};
+
+/* Creates the default settings. */
+NoiseSettings::NoiseSettings()
+{
+	this->type = FBM_NOISE;
+	this->octaves = 6;
+	this->frequency = 0.2f;
+	this->lacunarity = 2.0f;
+	this->gain = 0.5f;
+}
+
+/* Returns the gradient of the given lattice point, hashed from the seed */
+/* and the point so every point can be found on its own.                 */
+static inline unsigned int hashGradient(unsigned int seed, int ix, int iz)
+{
+	unsigned int hash = (unsigned int)ix * 0x8da6b343u ^
+		(unsigned int)iz * 0xd8163841u ^ seed * 0xcb1ab31fu;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash & 7;
+}
+
+/* Returns the seed of the given octave, so the octaves are not aligned. */
+static inline unsigned int octaveSeed(unsigned int seed, unsigned int octave)
+{
+	return seed + octave * 0x9e3779b9u;
+}
+
+/* Returns the quintic fade curve of t, from 0 to 1. */
+static inline float fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+/* Returns the linear interpolation from a to b by t. */
+static inline float interpolate(float a, float b, float t)
+{
+	return a + t * (b - a);
+}
+
+/* The noise along a row is the noise of the two lattice rows around it  */
+/* blended by the fade of z. Along the row that reduces every lattice    */
+/* column to a line, slope*(x - column) + offset, and the noise between  */
+/* two columns is their lines blended by the fade of x. Finds the slope  */
+/* and offset of the given column.                                       */
+static inline void columnLine(unsigned int seed, int column, int iz, float dz,
+	float uz, float& slope, float& offset)
+{
+	unsigned int g0 = hashGradient(seed, column, iz);
+	unsigned int g1 = hashGradient(seed, column, iz + 1);
+	slope = interpolate(gradientX[g0], gradientX[g1], uz);
+	offset = interpolate(gradientZ[g0] * dz, gradientZ[g1] * (dz - 1.0f), uz);
+}
+
+/* Adds the noise of an octave with the given amplitude to the total, as */
+/* the type of noise. Ridged noise is weighted by the octave before it,  */
+/* so the ridges stay sharp and the valleys smooth.                      */
+static inline void accumulate(NoiseType type, float noise, float amplitude,
+	float& total, float& weight)
+{
+	switch(type)
+	{
+		case FBM_NOISE:
+			total += amplitude * noise;
+			break;
+		case BILLOW_NOISE:
+			total += amplitude * (2.0f * fabs(noise) - 1.0f);
+			break;
+		case RIDGED_NOISE:
+		{
+			float signal = 1.0f - fabs(noise);
+			signal = signal * signal;
+			signal = signal * weight;
+			weight = std::min(signal * 2.0f, 1.0f);
+			total += amplitude * signal;
+			break;
+		}
+	}
+}
+
+/* Creates a generator of the noise with the given seed. */
+NoiseGenerator::NoiseGenerator(unsigned int seed, const NoiseSettings&
+	settings) : settings(settings)
+{
+	this->seed = seed;
+	this->settings.octaves = std::max(1U, std::min(this->settings.octaves,
+		(unsigned int)MAX_NOISE_OCTAVES));
+}
+
+/* Returns the noise at the given point, from -1 to 1. */
+float NoiseGenerator::sample(float x, float z) const
+{
+	float total = 0, weight = 1, amplitude = 1, amplitudes = 0;
+	float frequency = this->settings.frequency;
+	for (unsigned int o = 0; o < this->settings.octaves; o++)
+	{
+		unsigned int seed = octaveSeed(this->seed, o);
+		float xo = x * frequency, zo = z * frequency;
+		int ix = (int)floor(xo), iz = (int)floor(zo);
+		float dx = xo - ix, dz = zo - iz;
+		float slope0, offset0, slope1, offset1;
+		columnLine(seed, ix, iz, dz, fade(dz), slope0, offset0);
+		columnLine(seed, ix + 1, iz, dz, fade(dz), slope1, offset1);
+		float n0 = slope0 * dx + offset0;
+		float n1 = slope1 * (dx - 1.0f) + offset1;
+		float noise = interpolate(n0, n1, fade(dx)) * NOISE_SCALE;
+		accumulate(this->settings.type, noise, amplitude, total, weight);
+
+		amplitudes += amplitude;
+		amplitude *= this->settings.gain;
+		frequency *= this->settings.lacunarity;
+	}
+	if(this->settings.type == RIDGED_NOISE)
+	{
+		return 2.0f * total / amplitudes - 1.0f;
+	}
+	return total / amplitudes;
+}
+
+/* Sets the height of every vertex of the mesh to the noise at its      */
+/* distance from the first vertex, scaled from -range/2 to range/2. The */
+/* first vertex is at firstRow and firstCol vertex spacings from the    */
+/* noise's origin. The columns of every octave are the same for every   */
+/* row, so their lattice column and fades are found once. Each task     */
+/* then runs four rows at a time, one to each lane of an SSE register,  */
+/* so the lines of a lattice column are loaded together and no lane     */
+/* needs a gather.                                                      */
+void NoiseGenerator::fill(Mesh* mesh, float range, int firstRow,
+	int firstCol) const
+{
+	TRACE_SCOPE("NoiseGenerator::fill");
+
+	unsigned int rows = mesh->getRows(), cols = mesh->getCols();
+	unsigned int octaves = this->settings.octaves;
+	NoiseType type = this->settings.type;
+	float spacingX = mesh->getWidth() / (cols - 1);
+	float spacingZ = mesh->getDepth() / (rows - 1);
+
+	/* Frequency, amplitude, and seed of each octave, and the lattice   */
+	/* column, fraction, and fade of x of every column in each octave.  */
+	/* The lattice columns are kept from the first one, firstCells.     */
+	float frequencies[MAX_NOISE_OCTAVES], amplitudes[MAX_NOISE_OCTAVES];
+	unsigned int seeds[MAX_NOISE_OCTAVES], cellCounts[MAX_NOISE_OCTAVES];
+	int firstCells[MAX_NOISE_OCTAVES];
+	std::vector<int> columnCells((size_t)octaves * cols);
+	std::vector<float> columnFractions((size_t)octaves * cols);
+	std::vector<float> columnFades((size_t)octaves * cols);
+	size_t columnBytes = (size_t)octaves * cols * (sizeof(int) +
+		2 * sizeof(float));
+	MemoryTracker::allocate(TEMPORARIES, columnBytes);
+
+	float frequency = this->settings.frequency, amplitude = 1;
+	float amplitudeSum = 0;
+	unsigned int maxCells = 0;
+	for (unsigned int o = 0; o < octaves; o++)
+	{
+		frequencies[o] = frequency;
+		amplitudes[o] = amplitude;
+		seeds[o] = octaveSeed(this->seed, o);
+		/* The position is found from the vertex index in double, so */
+		/* meshes filled side by side find the same noise where they */
+		/* meet.                                                     */
+		firstCells[o] = (int)floor((double)firstCol * spacingX * frequency);
+		for (unsigned int c = 0; c < cols; c++)
+		{
+			double x = ((double)firstCol + c) * spacingX * frequency;
+			int ix = (int)floor(x);
+			float dx = (float)(x - ix);
+			size_t index = (size_t)o * cols + c;
+			columnCells[index] = ix - firstCells[o];
+			columnFractions[index] = dx;
+			columnFades[index] = fade(dx);
+		}
+		/* Every column is at or right of the first, so the lines of the */
+		/* lattice columns from the first to the right of the last are   */
+		/* needed.                                                       */
+		cellCounts[o] = columnCells[(size_t)o * cols + cols - 1] + 2;
+		maxCells = std::max(maxCells, cellCounts[o]);
+
+		amplitudeSum += amplitude;
+		amplitude *= this->settings.gain;
+		frequency *= this->settings.lacunarity;
+	}
+
+	/* Scale of the total to the range, ridged noise is from 0 up. */
+	float scale = range / 2.0f / amplitudeSum, bias = 0;
+	if(type == RIDGED_NOISE)
+	{
+		scale = range / amplitudeSum;
+		bias = -range / 2.0f;
+	}
+
+	/* Copy the tiles shared with snapshots now, so the threads only */
+	/* write to tiles this mesh owns.                                */
+	mesh->makeWritable();
+
+	unsigned int quads = (rows + 3) / 4;
+	Parallel::forRange(0, quads, std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / (4 * cols))), [&](size_t begin,
+		size_t end)
+	{
+		/* Lines of the lattice columns and totals of the four rows, */
+		/* interleaved so a column of the four rows is one register.  */
+		std::vector<float> slopes(4 * (size_t)maxCells);
+		std::vector<float> offsets(4 * (size_t)maxCells);
+		std::vector<float> totals(4 * (size_t)cols);
+		std::vector<float> weights(4 * (size_t)cols);
+
+		for (size_t q = begin; q < end; q++)
+		{
+			unsigned int row = (unsigned int)q * 4;
+			std::fill(totals.begin(), totals.end(), 0.0f);
+			std::fill(weights.begin(), weights.end(), 1.0f);
+
+			for (unsigned int o = 0; o < octaves; o++)
+			{
+				/* Find the lines of the lattice columns for each row. */
+				for (unsigned int k = 0; k < 4; k++)
+				{
+					double z = ((double)firstRow + row + k) * spacingZ *
+						frequencies[o];
+					int iz = (int)floor(z);
+					float dz = (float)(z - iz), uz = fade(dz);
+					for (unsigned int i = 0; i < cellCounts[o]; i++)
+					{
+						columnLine(seeds[o], firstCells[o] + (int)i, iz, dz,
+							uz, slopes[4 * i + k], offsets[4 * i + k]);
+					}
+				}
+
+				const int* cells = &columnCells[(size_t)o * cols];
+				const float* fractions = &columnFractions[(size_t)o * cols];
+				const float* fades = &columnFades[(size_t)o * cols];
+				float* total = totals.data();
+				float* weight = weights.data();
+#ifdef VEC4_USE_SSE
+				const __m128 one = _mm_set1_ps(1.0f);
+				const __m128 two = _mm_set1_ps(2.0f);
+				const __m128 noiseScale = _mm_set1_ps(NOISE_SCALE);
+				const __m128 signMask = _mm_set1_ps(-0.0f);
+				const __m128 amplitudeV = _mm_set1_ps(amplitudes[o]);
+				for (unsigned int c = 0; c < cols; c++)
+				{
+					const float* slope = &slopes[4 * cells[c]];
+					const float* offset = &offsets[4 * cells[c]];
+					__m128 dx = _mm_set1_ps(fractions[c]);
+					__m128 n0 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(slope),
+						dx), _mm_loadu_ps(offset));
+					__m128 n1 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(slope + 4),
+						_mm_sub_ps(dx, one)), _mm_loadu_ps(offset + 4));
+					__m128 noise = _mm_mul_ps(_mm_add_ps(n0, _mm_mul_ps(
+						_mm_set1_ps(fades[c]), _mm_sub_ps(n1, n0))),
+						noiseScale);
+					__m128 sum = _mm_loadu_ps(total + 4 * c);
+					switch(type)
+					{
+						case FBM_NOISE:
+							sum = _mm_add_ps(sum, _mm_mul_ps(amplitudeV,
+								noise));
+							break;
+						case BILLOW_NOISE:
+							sum = _mm_add_ps(sum, _mm_mul_ps(amplitudeV,
+								_mm_sub_ps(_mm_mul_ps(two, _mm_andnot_ps(
+								signMask, noise)), one)));
+							break;
+						case RIDGED_NOISE:
+						{
+							__m128 signal = _mm_sub_ps(one, _mm_andnot_ps(
+								signMask, noise));
+							signal = _mm_mul_ps(signal, signal);
+							signal = _mm_mul_ps(signal, _mm_loadu_ps(weight +
+								4 * c));
+							_mm_storeu_ps(weight + 4 * c, _mm_min_ps(
+								_mm_mul_ps(signal, two), one));
+							sum = _mm_add_ps(sum, _mm_mul_ps(amplitudeV,
+								signal));
+							break;
+						}
+					}
+					_mm_storeu_ps(total + 4 * c, sum);
+				}
+#else
+				for (unsigned int c = 0; c < cols; c++)
+				{
+					const float* slope = &slopes[4 * cells[c]];
+					const float* offset = &offsets[4 * cells[c]];
+					float dx = fractions[c];
+					for (unsigned int k = 0; k < 4; k++)
+					{
+						float n0 = slope[k] * dx + offset[k];
+						float n1 = slope[4 + k] * (dx - 1.0f) + offset[4 + k];
+						float noise = interpolate(n0, n1, fades[c]) *
+							NOISE_SCALE;
+						accumulate(type, noise, amplitudes[o],
+							total[4 * c + k], weight[4 * c + k]);
+					}
+				}
+#endif
+			}
+
+			/* Scale the totals of the rows inside the mesh to the range. */
+			for (unsigned int k = 0; k < 4 && row + k < rows; k++)
+			{
+				vec4* vertices = mesh->getWritableRow(row + k);
+				for (unsigned int c = 0; c < cols; c++)
+				{
+					vertices[c][1] = totals[4 * c + k] * scale + bias;
+				}
+			}
+		}
+	});
+
+	MemoryTracker::release(TEMPORARIES, columnBytes);
+}
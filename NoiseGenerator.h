@@ -0,0 +1,68 @@
+/*
+ * NoiseGenerator.h
+ * Created by Zachary Ferguson
+ * Header file for the NoiseGenerator class, which fills a heightfield with
+ * gradient noise summed over octaves. Each octave is Perlin noise with its
+ * gradients hashed from the seed and the lattice point, so no table is kept
+ * and any point can be sampled on its own. The octaves are summed as fBm,
+ * ridged, or billow noise.
+ */
+
+#ifndef NOISEGENERATOR_H
+#define NOISEGENERATOR_H
+
+#include "Mesh.h"
+
+/* How the octaves of noise are summed. */
+enum NoiseType {FBM_NOISE, RIDGED_NOISE, BILLOW_NOISE};
+
+/* Most octaves that can be summed. */
+#define MAX_NOISE_OCTAVES 16
+
+/* Parameters of the noise. */
+struct NoiseSettings
+{
+	/* How the octaves are summed. */
+	NoiseType type;
+	/* Number of octaves summed. */
+	unsigned int octaves;
+	/* Cycles of the first octave per unit of width. */
+	float frequency;
+	/* Factor the frequency grows by each octave. */
+	float lacunarity;
+	/* Factor the amplitude shrinks by each octave. */
+	float gain;
+
+	/* Creates the default settings. */
+	NoiseSettings();
+};
+
+class NoiseGenerator
+{
+	private:
+
+		/* Seed the gradients are hashed from. */
+		unsigned int seed;
+		/* Parameters of the noise. */
+		NoiseSettings settings;
+
+	public:
+
+		/* Creates a generator of the noise with the given seed. */
+		NoiseGenerator(unsigned int seed = 0, const NoiseSettings& settings =
+			NoiseSettings());
+
+		/* Returns the noise at the given point, from -1 to 1. */
+		float sample(float x, float z) const;
+
+		/* Sets the height of every vertex of the mesh to the noise at its  */
+		/* distance from the first vertex, scaled from -range/2 to range/2. */
+		/* The first vertex is firstRow rows and firstCol columns of the    */
+		/* mesh's spacing from the origin of the noise, so meshes of the    */
+		/* same spacing filled side by side match where they meet. The      */
+		/* rows are split across the threads.                               */
+		void fill(Mesh* mesh, float range, int firstRow = 0,
+			int firstCol = 0) const;
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * NoiseGroup.cpp
+ * Created by Zachary Ferguson
+ * Source file for the NoiseGroup class, a child class of the Fl_Group class
+ * for choosing the noise to generate the heights of the mesh from.
+ */
+
+#include "NoiseGroup.h"
+#include <algorithm>
+#include <cmath>
+
+/* Constructor for creating a new NoiseGroup.          */
+/* Requires the x,y coordinates of the new NoiseGroup. */
+NoiseGroup::NoiseGroup(int x, int y) : Fl_Group(x, y, 200, 140, 
+	"Noise Terrain")
+{
+	this->box(FL_ENGRAVED_FRAME);
+	this->align(Fl_Align(FL_ALIGN_TOP|FL_ALIGN_INSIDE));
+
+	/* Create the noise type choice, in the order of NoiseType, then the */
+	/* spectral noise and the diamond-square.                            */
+	this->typeChoice = new Fl_Choice(x+10, y+20, 95, 24);
+	this->typeChoice->add("fBm");
+	this->typeChoice->add("Ridged");
+	this->typeChoice->add("Billow");
+	this->typeChoice->add("Spectral");
+	this->typeChoice->add("Diamond-Sq");
+	this->typeChoice->value(FBM_NOISE);
+	this->typeChoice->callback(NoiseGroup::typeCB, this);
+
+	/* Create the generate button. */
+	this->generateB = new Fl_Button(x+110, y+20, 80, 24, "Generate");
+
+	/* Create the sliders, starting at the default settings. */
+	NoiseSettings defaults;
+	this->octavesSlider = makeSlider(x+10, y+65, "Octaves", 1, 
+		MAX_NOISE_OCTAVES, defaults.octaves, 1);
+	this->frequencySlider = makeSlider(x+105, y+65, "Frequency", 0.01, 2, 
+		defaults.frequency, 0.01);
+	this->lacunaritySlider = makeSlider(x+10, y+110, "Lacunarity", 1, 4, 
+		defaults.lacunarity, 0.05);
+	this->gainSlider = makeSlider(x+105, y+110, "Gain", 0, 1, 
+		defaults.gain, 0.01);
+
+	this->end();
+}
+
+/* Makes a half width slider with the given specs. */
+Fl_Value_Slider* NoiseGroup::makeSlider(int x, int y, const char* label,
+	double min, double max, double value, double step)
+{
+	Fl_Value_Slider* slider = new Fl_Value_Slider(x, y, 85, 24, label);
+	slider->type(1);
+	slider->box(FL_BORDER_BOX);
+	slider->minimum(min);
+	slider->maximum(max);
+	slider->step(step);
+	slider->value(value);
+	slider->align(Fl_Align(FL_ALIGN_TOP));
+	return slider;
+}
+
+/* Turns off the sliders the chosen generator does not use. The spectrum */
+/* has every octave, and the diamond-square only has a roughness, which */
+/* is the gain.                                                         */
+void NoiseGroup::typeCB(Fl_Widget* w, void* data)
+{
+	NoiseGroup* group = (NoiseGroup*)data;
+	Fl_Value_Slider* sliders[] = {group->octavesSlider, 
+		group->frequencySlider, group->lacunaritySlider};
+	bool used[] = {!group->isSpectral() && !group->isDiamondSquare(), 
+		!group->isDiamondSquare(), !group->isDiamondSquare()};
+	for (unsigned int i = 0; i < sizeof(sliders)/sizeof(sliders[0]); i++)
+	{
+		if(used[i])
+		{
+			sliders[i]->activate();
+		}
+		else
+		{
+			sliders[i]->deactivate();
+		}
+	}
+}
+
+/* Destructor for this NoiseGroup. */
+NoiseGroup::~NoiseGroup()
+{
+	delete this->typeChoice;
+	delete this->generateB;
+	delete this->octavesSlider;
+	delete this->frequencySlider;
+	delete this->lacunaritySlider;
+	delete this->gainSlider;
+}
+
+/* Sets the callback function of the generate button to cb with an */
+/* argument of p.                                                  */
+void NoiseGroup::callback(Fl_Callback* cb, void *p)
+{
+	this->generateB->callback(cb, p);
+}
+
+/* Returns true if the spectral noise is chosen. */
+bool NoiseGroup::isSpectral() const
+{
+	return this->typeChoice->value() == SPECTRAL_CHOICE;
+}
+
+/* Returns true if the diamond-square is chosen. */
+bool NoiseGroup::isDiamondSquare() const
+{
+	return this->typeChoice->value() == DIAMOND_SQUARE_CHOICE;
+}
+
+/* Returns the settings of the noise chosen. */
+NoiseSettings NoiseGroup::getSettings() const
+{
+	NoiseSettings settings;
+	settings.type = (NoiseType)this->typeChoice->value();
+	settings.octaves = (unsigned int)this->octavesSlider->value();
+	settings.frequency = (float)this->frequencySlider->value();
+	settings.lacunarity = (float)this->lacunaritySlider->value();
+	settings.gain = (float)this->gainSlider->value();
+	return settings;
+}
+
+/* Returns the settings of the spectrum with the slope of the chosen gain */
+/* and lacunarity. fBm with amplitudes shrinking by the gain as the       */
+/* frequencies grow by the lacunarity has a Hurst exponent of            */
+/* H = -log(gain)/log(lacunarity), and a surface with that exponent has  */
+/* a power spectrum of 1/f^(2H+2).                                       */
+SpectralSettings NoiseGroup::getSpectralSettings() const
+{
+	double gain = std::max(this->gainSlider->value(), 0.01);
+	double lacunarity = std::max(this->lacunaritySlider->value(), 1.05);
+	double hurst = -log(gain) / log(lacunarity);
+
+	SpectralSettings settings;
+	settings.beta = (float)std::min(2.0 * hurst + 2.0, 8.0);
+	settings.minFrequency = (float)this->frequencySlider->value();
+	return settings;
+}
+
+/* Returns the roughness of the diamond-square, the gain. Halving the */
+/* squares each level, like a lacunarity of 2, the roughness is the   */
+/* factor the displacement shrinks by.                                */
+float NoiseGroup::getRoughness() const
+{
+	return (float)this->gainSlider->value();
+}
@@ -0,0 +1,76 @@
+/*
+ * NoiseGroup.h
+ * Created by Zachary Ferguson
+ * Header for the NoiseGroup class, a child class of the Fl_Group class for
+ * choosing the noise to generate the heights of the mesh from.
+ */
+
+#ifndef NOISEGROUP_H
+#define NOISEGROUP_H
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Choice.H>
+#include <FL/Fl_Value_Slider.h>
+#include "NoiseGenerator.h"
+#include "SpectralGenerator.h"
+#include "DiamondSquareGenerator.h"
+
+/* Index of the spectral and diamond-square choices, after those of */
+/* NoiseType.                                                       */
+#define SPECTRAL_CHOICE 3
+#define DIAMOND_SQUARE_CHOICE 4
+
+class NoiseGroup : public Fl_Group
+{
+	private:
+	
+		/* Choice of how the octaves are summed. */
+		Fl_Choice* typeChoice;
+		/* Button to generate the heights. */
+		Fl_Button* generateB;
+		/* Sliders for the octaves, frequency, lacunarity, and gain. */
+		Fl_Value_Slider* octavesSlider;
+		Fl_Value_Slider* frequencySlider;
+		Fl_Value_Slider* lacunaritySlider;
+		Fl_Value_Slider* gainSlider;
+
+		/* Makes a half width slider with the given specs. */
+		static Fl_Value_Slider* makeSlider(int x, int y, const char* label,
+			double min, double max, double value, double step);
+
+		/* Turns off the sliders the chosen generator does not use. */
+		static void typeCB(Fl_Widget* w, void* data);
+
+	public:
+		
+		/* Constructor for creating a new NoiseGroup.          */
+		/* Requires the x,y coordinates of the new NoiseGroup. */
+		NoiseGroup(int x, int y);
+
+		/* Destructor for this NoiseGroup. */
+		virtual ~NoiseGroup();
+
+		/* Sets the callback function of the generate button to cb with an */
+		/* argument of p.                                                  */
+		void callback(Fl_Callback* cb, void *p);
+
+		/* Returns true if the spectral noise is chosen. */
+		bool isSpectral() const;
+		/* Returns true if the diamond-square is chosen. */
+		bool isDiamondSquare() const;
+
+		/* Returns the settings of the noise chosen. */
+		NoiseSettings getSettings() const;
+
+		/* Returns the settings of the spectrum with the slope of the    */
+		/* chosen gain and lacunarity, flat below the chosen frequency.  */
+		SpectralSettings getSpectralSettings() const;
+
+		/* Returns the roughness of the diamond-square, the gain. */
+		float getRoughness() const;
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Parallel.cpp
+ * Created by Zachary Ferguson
+ * Source file for the Parallel class, a small pool of worker threads for
+ * splitting a loop over a range of indecies across the processor's cores.
+ */
+
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Compiler specific storage class for thread local variables. */
+#ifdef _MSC_VER
+#define PARALLEL_THREAD_LOCAL __declspec(thread)
+#else
+#define PARALLEL_THREAD_LOCAL __thread
+#endif
+
+/* Number of chunks each thread is given on average, so threads that */
+/* finish early can take work from the slower ones.                  */
+#define CHUNKS_PER_THREAD 4
+
+/* A loop being run by the pool. */
+struct ParallelJob
+{
+	/* Body of the loop. */
+	const std::function<void(size_t, size_t)>* body;
+	/* Range of the loop and the size of each chunk. */
+	size_t begin, end, chunkSize;
+	/* Start of the next chunk to be run. */
+	std::atomic<size_t> next;
+};
+
+/* The worker threads and the state they share. The pool is never deleted */
+/* since joining threads while the program exits can dead lock.            */
+struct ParallelPool
+{
+	/* Threads waiting for loops to run. */
+	std::vector<std::thread> workers;
+	/* Guards the fields below. */
+	std::mutex mutex;
+	/* Signals the workers a new loop or stop is set. */
+	std::condition_variable wake;
+	/* Signals the caller a worker has finished its part of the loop. */
+	std::condition_variable done;
+	/* The loop being run, valid while the caller waits for the workers. */
+	ParallelJob* job;
+	/* Incremented for every loop so workers can tell a new one was set. */
+	unsigned long long generation;
+	/* Number of workers that finished the current loop. */
+	unsigned int finished;
+	/* Set to tell the workers to exit. */
+	bool stop;
+};
+
+/* Serializes loops started from different threads. */
+static std::mutex jobMutex;
+/* Guards creating and replacing the pool. */
+static std::mutex poolMutex;
+/* The current pool, created on first use. */
+static ParallelPool* pool = NULL;
+/* Requested thread count, zero for one per hardware thread. */
+static unsigned int requestedThreads = 0;
+/* Set on threads running a loop body, so nested loops run serially. */
+static PARALLEL_THREAD_LOCAL bool inLoop = false;
+
+/* Runs chunks of the given job until there are none left. */
+static void runChunks(ParallelJob* job)
+{
+	for (;;)
+	{
+		size_t chunkBegin = job->next.fetch_add(job->chunkSize);
+		if(chunkBegin >= job->end)
+		{
+			return;
+		}
+		(*(job->body))(chunkBegin, std::min(chunkBegin + job->chunkSize,
+			job->end));
+	}
+}
+
+/* Body of each worker thread. Waits for a loop, helps run it, and reports */
+/* when done.                                                              */
+static void workerMain(ParallelPool* workerPool)
+{
+	inLoop = true;
+	unsigned long long seen = 0;
+	std::unique_lock<std::mutex> lock(workerPool->mutex);
+	for (;;)
+	{
+		while(!workerPool->stop && workerPool->generation == seen)
+		{
+			workerPool->wake.wait(lock);
+		}
+		if(workerPool->stop)
+		{
+			return;
+		}
+		seen = workerPool->generation;
+		ParallelJob* job = workerPool->job;
+
+		lock.unlock();
+		runChunks(job);
+		lock.lock();
+
+		workerPool->finished++;
+		workerPool->done.notify_one();
+	}
+}
+
+/* Returns the number of threads the requested count resolves to. */
+static unsigned int resolveThreadCount()
+{
+	if(requestedThreads > 0)
+	{
+		return requestedThreads;
+	}
+	unsigned int hardware = std::thread::hardware_concurrency();
+	return (hardware > 0) ? hardware : 1;
+}
+
+/* Stops and joins the workers of the given pool and deletes it. */
+static void destroyPool(ParallelPool* oldPool)
+{
+	{
+		std::lock_guard<std::mutex> lock(oldPool->mutex);
+		oldPool->stop = true;
+	}
+	oldPool->wake.notify_all();
+	for (unsigned int i = 0; i < oldPool->workers.size(); i++)
+	{
+		oldPool->workers[i].join();
+	}
+	delete oldPool;
+}
+
+/* Returns the pool, creating it with the requested number of threads. */
+static ParallelPool* getPool()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if(!pool)
+	{
+		pool = new ParallelPool();
+		pool->job = NULL;
+		pool->generation = 0;
+		pool->finished = 0;
+		pool->stop = false;
+		for (unsigned int i = 1; i < resolveThreadCount(); i++)
+		{
+			pool->workers.push_back(std::thread(workerMain, pool));
+		}
+	}
+	return pool;
+}
+
+/* Returns the number of threads loops are split across, including the */
+/* calling thread.                                                     */
+unsigned int Parallel::getThreadCount()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	return resolveThreadCount();
+}
+
+/* Sets the number of threads loops are split across. Zero uses one thread */
+/* per hardware thread and one runs every loop serially.                   */
+void Parallel::setThreadCount(unsigned int count)
+{
+	std::lock_guard<std::mutex> jobLock(jobMutex);
+	ParallelPool* oldPool;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		requestedThreads = count;
+		oldPool = pool;
+		pool = NULL;
+	}
+	if(oldPool)
+	{
+		destroyPool(oldPool);
+	}
+}
+
+/* Calls body(chunkBegin, chunkEnd) for chunks covering [begin, end) from */
+/* the calling thread and the workers, returning once every chunk is done. */
+void Parallel::forRange(size_t begin, size_t end, size_t grain,
+	const std::function<void(size_t, size_t)>& body)
+{
+	if(end <= begin)
+	{
+		return;
+	}
+	grain = std::max(grain, (size_t)1);
+
+	/* Small and nested loops are not worth waking the workers for. */
+	if(inLoop || end - begin <= grain)
+	{
+		body(begin, end);
+		return;
+	}
+
+	std::lock_guard<std::mutex> jobLock(jobMutex);
+	ParallelPool* currentPool = getPool();
+	unsigned int workers = (unsigned int)currentPool->workers.size();
+	if(workers == 0)
+	{
+		body(begin, end);
+		return;
+	}
+
+	ParallelJob job;
+	job.body = &body;
+	job.begin = begin;
+	job.end = end;
+	job.chunkSize = std::max(grain,
+		(end - begin + (workers + 1) * CHUNKS_PER_THREAD - 1) /
+		((workers + 1) * CHUNKS_PER_THREAD));
+	job.next = begin;
+
+	/* Publish the loop and wake the workers. */
+	{
+		std::lock_guard<std::mutex> lock(currentPool->mutex);
+		currentPool->job = &job;
+		currentPool->finished = 0;
+		currentPool->generation++;
+	}
+	currentPool->wake.notify_all();
+
+	/* Help run the loop, then wait for every worker to let go of it. */
+	inLoop = true;
+	runChunks(&job);
+	inLoop = false;
+
+	std::unique_lock<std::mutex> lock(currentPool->mutex);
+	while(currentPool->finished < workers)
+	{
+		currentPool->done.wait(lock);
+	}
+	currentPool->job = NULL;
+}
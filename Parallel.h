@@ -0,0 +1,35 @@
+/*
+ * Parallel.h
+ * Created by Zachary Ferguson
+ * Header file for the Parallel class, a small pool of worker threads for
+ * splitting a loop over a range of indecies across the processor's cores.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+class Parallel
+{
+	public:
+
+		/* Returns the number of threads loops are split across, including */
+		/* the calling thread.                                             */
+		static unsigned int getThreadCount();
+
+		/* Sets the number of threads loops are split across. Zero uses one */
+		/* thread per hardware thread and one runs every loop serially.     */
+		static void setThreadCount(unsigned int count);
+
+		/* Calls body(chunkBegin, chunkEnd) for chunks covering [begin, end) */
+		/* from the calling thread and the workers, returning once every     */
+		/* chunk is done. Chunks hold at least grain indecies, so ranges of  */
+		/* grain or fewer run serially on the calling thread, as do loops    */
+		/* started from inside another loop's body.                          */
+		static void forRange(size_t begin, size_t end, size_t grain,
+			const std::function<void(size_t, size_t)>& body);
+};
+
+#endif
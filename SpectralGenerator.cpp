@@ -0,0 +1,216 @@
+/*
+ * SpectralGenerator.cpp
+ * Created by Zachary Ferguson
+ * Source file for the SpectralGenerator class, which synthesizes a
+ * heightfield with a 1/f^beta power spectrum by filtering white noise in the
+ * frequency domain.
+ */
+
+#include "SpectralGenerator.h"
+#include "FFT.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+/* Fewest values given to each thread by a pass. */
+#define VERTICES_PER_TASK 16384
+
+/* Number of radii and angles the Gaussians are drawn from, a power of */
+/* two so a hash picks one of each with its bits.                      */
+#define GAUSSIAN_TABLE_BITS 12
+#define GAUSSIAN_TABLE_SIZE (1 << GAUSSIAN_TABLE_BITS)
+
+/* Creates the default settings. */
+SpectralSettings::SpectralSettings()
+{
+	this->beta = 3.0f;
+	this->minFrequency = 0.05f;
+}
+
+/* Returns bits that only depend on the seed and index, so every thread */
+/* can make the noise of its own rows.                                  */
+static inline unsigned int hashBits(unsigned int seed, unsigned int index)
+{
+	unsigned int hash = index * 0x9e3779b9u ^ seed * 0x85ebca6bu;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/* Returns the signed frequency of the given index of a transform of the */
+/* size, the indices past the middle being the negative frequencies.     */
+static inline int signedFrequency(unsigned int index, unsigned int size)
+{
+	return (index <= size / 2) ? (int)index : (int)index - (int)size;
+}
+
+/* Creates a generator of the spectrum with the given seed. */
+SpectralGenerator::SpectralGenerator(unsigned int seed,
+	const SpectralSettings& settings) : settings(settings)
+{
+	this->seed = seed;
+}
+
+/* Sets the heights of the mesh to one period of the noise. A complex     */
+/* Gaussian is drawn for every frequency and scaled by f^(-beta/2), so    */
+/* the power falls off as 1/f^beta. The real part of its inverse          */
+/* transform is a real field with that spectrum, without having to make   */
+/* the spectrum symmetric. The field is then sampled with wrap around at  */
+/* the vertices, which land exactly on the lattice if the quads are a     */
+/* power of two.                                                          */
+void SpectralGenerator::fill(Mesh* mesh, float range) const
+{
+	TRACE_SCOPE("SpectralGenerator::fill");
+
+	unsigned int rows = mesh->getRows(), cols = mesh->getCols();
+	unsigned int periodRows = FFT::nextPowerOfTwo(std::max(2U, rows - 1));
+	unsigned int periodCols = FFT::nextPowerOfTwo(std::max(2U, cols - 1));
+	size_t count = (size_t)periodRows * periodCols;
+	std::vector<float> field(2 * count);
+	MemoryTracker::allocate(TEMPORARIES, 2 * count * sizeof(float));
+
+	/* Find the amplitude of each frequency. A period spans the width  */
+	/* and depth, so index k along the columns is k/width cycles per   */
+	/* unit. The amplitude only depends on the size of the frequency,  */
+	/* so it is found for the positive quarter and mirrored.           */
+	float width = mesh->getWidth(), depth = mesh->getDepth();
+	float minFrequency = this->settings.minFrequency;
+	float exponent = -this->settings.beta / 4.0f;
+	unsigned int halfRows = periodRows / 2 + 1, halfCols = periodCols / 2 + 1;
+	std::vector<float> amplitudes((size_t)halfRows * halfCols);
+	Parallel::forRange(0, halfRows, std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / halfCols)), [&](size_t begin,
+		size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			float fz = r / depth;
+			for (unsigned int c = 0; c < halfCols; c++)
+			{
+				float fx = c / width;
+				float frequency = std::max(fx * fx + fz * fz,
+					minFrequency * minFrequency);
+				amplitudes[r * halfCols + c] = pow(frequency, exponent);
+			}
+		}
+	});
+
+	/* Radii and angles of the Box-Muller transform, so a pair of */
+	/* Gaussians is a hash and a few lookups.                     */
+	std::vector<float> radii(GAUSSIAN_TABLE_SIZE);
+	std::vector<float> cosines(GAUSSIAN_TABLE_SIZE);
+	std::vector<float> sines(GAUSSIAN_TABLE_SIZE);
+	for (unsigned int i = 0; i < GAUSSIAN_TABLE_SIZE; i++)
+	{
+		double u = (i + 0.5) / GAUSSIAN_TABLE_SIZE;
+		radii[i] = (float)sqrt(-2.0 * log(u));
+		cosines[i] = (float)cos(2.0 * 3.14159265358979323846 * u);
+		sines[i] = (float)sin(2.0 * 3.14159265358979323846 * u);
+	}
+
+	/* Draw the shaped spectrum, without the constant height. */
+	Parallel::forRange(0, periodRows, std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / periodCols)), [&](size_t begin,
+		size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			const float* rowAmplitudes = &amplitudes[(size_t)abs(
+				signedFrequency((unsigned int)r, periodRows)) * halfCols];
+			float* row = &field[2 * r * periodCols];
+			for (unsigned int c = 0; c < periodCols; c++)
+			{
+				float amplitude = rowAmplitudes[abs(signedFrequency(c,
+					periodCols))];
+				unsigned int bits = hashBits(this->seed,
+					(unsigned int)(r * periodCols + c));
+				float radius = amplitude * radii[bits &
+					(GAUSSIAN_TABLE_SIZE - 1)];
+				unsigned int angle = (bits >> GAUSSIAN_TABLE_BITS) &
+					(GAUSSIAN_TABLE_SIZE - 1);
+				row[2 * c] = radius * cosines[angle];
+				row[2 * c + 1] = radius * sines[angle];
+			}
+		}
+	});
+	field[0] = field[1] = 0;
+
+	FFT::transform2D(field.data(), periodRows, periodCols, true);
+
+	/* Find the range of the field to scale it by. */
+	std::vector<float> rowMin(periodRows), rowMax(periodRows);
+	Parallel::forRange(0, periodRows, std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / periodCols)), [&](size_t begin,
+		size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			const float* row = &field[2 * r * periodCols];
+			float low = FLT_MAX, high = -FLT_MAX;
+			for (unsigned int c = 0; c < periodCols; c++)
+			{
+				low = std::min(low, row[2 * c]);
+				high = std::max(high, row[2 * c]);
+			}
+			rowMin[r] = low;
+			rowMax[r] = high;
+		}
+	});
+	float low = *std::min_element(rowMin.begin(), rowMin.end());
+	float high = *std::max_element(rowMax.begin(), rowMax.end());
+	float scale = (high > low) ? range / (high - low) : 0.0f;
+	float middle = (high + low) / 2.0f;
+
+	/* Lattice column and fraction of every column of the mesh. */
+	std::vector<unsigned int> columnCells(cols);
+	std::vector<float> columnFractions(cols);
+	for (unsigned int c = 0; c < cols; c++)
+	{
+		double x = (double)c * periodCols / (cols - 1);
+		unsigned int ix = (unsigned int)x;
+		columnCells[c] = ix % periodCols;
+		columnFractions[c] = (float)(x - ix);
+	}
+
+	/* Copy the tiles shared with snapshots now, so the threads only */
+	/* write to tiles this mesh owns.                                */
+	mesh->makeWritable();
+
+	Parallel::forRange(0, rows, std::max((size_t)1,
+		(size_t)(VERTICES_PER_TASK / cols)), [&](size_t begin, size_t end)
+	{
+		for (size_t r = begin; r < end; r++)
+		{
+			double z = (double)r * periodRows / (rows - 1);
+			unsigned int iz = (unsigned int)z;
+			float dz = (float)(z - iz);
+			const float* row0 = &field[2 * (size_t)(iz % periodRows) *
+				periodCols];
+			const float* row1 = &field[2 * (size_t)((iz + 1) % periodRows) *
+				periodCols];
+			vec4* vertices = mesh->getWritableRow((unsigned int)r);
+			for (unsigned int c = 0; c < cols; c++)
+			{
+				unsigned int c0 = columnCells[c];
+				unsigned int c1 = (c0 + 1) % periodCols;
+				float dx = columnFractions[c];
+				float top = row0[2 * c0] + dx * (row0[2 * c1] -
+					row0[2 * c0]);
+				float bottom = row1[2 * c0] + dx * (row1[2 * c1] -
+					row1[2 * c0]);
+				float height = top + dz * (bottom - top);
+				vertices[c][1] = (height - middle) * scale;
+			}
+		}
+	});
+
+	MemoryTracker::release(TEMPORARIES, 2 * count * sizeof(float));
+}
@@ -0,0 +1,52 @@
+/*
+ * SpectralGenerator.h
+ * Created by Zachary Ferguson
+ * Header file for the SpectralGenerator class, which synthesizes a
+ * heightfield by shaping white noise in the frequency domain to a 1/f^beta
+ * power spectrum and transforming it back with an FFT. The heights are one
+ * period of the noise, so the heightfield tiles seamlessly with copies of
+ * itself.
+ */
+
+#ifndef SPECTRALGENERATOR_H
+#define SPECTRALGENERATOR_H
+
+#include "Mesh.h"
+
+/* Parameters of the spectrum. */
+struct SpectralSettings
+{
+	/* Exponent of the power spectrum. Larger is smoother, from about 2 */
+	/* for rough to 4 for rolling terrain.                              */
+	float beta;
+	/* Frequency, in cycles per unit of width, below which the spectrum */
+	/* stays flat instead of growing, so there is no single huge hill.  */
+	float minFrequency;
+
+	/* Creates the default settings. */
+	SpectralSettings();
+};
+
+class SpectralGenerator
+{
+	private:
+
+		/* Seed the white noise is hashed from. */
+		unsigned int seed;
+		/* Parameters of the spectrum. */
+		SpectralSettings settings;
+
+	public:
+
+		/* Creates a generator of the spectrum with the given seed. */
+		SpectralGenerator(unsigned int seed = 0, const SpectralSettings&
+			settings = SpectralSettings());
+
+		/* Sets the heights of the mesh, from -range/2 to range/2, to one  */
+		/* period of the noise, so its last row and column match its first */
+		/* ones. The noise is synthesized on the smallest power of two     */
+		/* lattice with as many quads and sampled at the vertices.         */
+		void fill(Mesh* mesh, float range) const;
+};
+
+#endif
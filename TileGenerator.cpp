@@ -0,0 +1,93 @@
+/*
+ * TileGenerator.cpp
+ * Created by Zachary Ferguson
+ * Source file for the TileGenerator class, which generates any tile of a
+ * world without edges from the world's seed.
+ */
+
+#include "TileGenerator.h"
+#include "Trace.h"
+
+/* Creates the default settings. */
+TileSettings::TileSettings()
+{
+	this->quads = 64;
+	this->width = 10.0f;
+	this->range = 4.0f;
+	this->fractalizeIterations = 0;
+}
+
+/* Returns the seed of the given iteration of the fractalize, so the     */
+/* levels are not aligned with each other or with the noise.             */
+static inline unsigned int iterationSeed(unsigned int worldSeed,
+	unsigned int iteration)
+{
+	unsigned int hash = worldSeed ^ (iteration + 1) * 0x9e3779b9u;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/* Creates a generator of the tiles of the world with the given seed, its */
+/* heights made by the noise and then fractalized.                        */
+TileGenerator::TileGenerator(unsigned int worldSeed, const NoiseSettings&
+	noise, const TileSettings& settings) : noise(worldSeed, noise),
+	settings(settings)
+{
+	this->worldSeed = worldSeed;
+}
+
+/* Returns the quads along each side of a generated tile, doubled by each */
+/* iteration of the fractalize.                                           */
+unsigned int TileGenerator::getTileQuads() const
+{
+	return this->settings.quads << this->settings.fractalizeIterations;
+}
+
+/* Returns the width and depth of a tile. */
+float TileGenerator::getTileWidth() const
+{
+	return this->settings.width;
+}
+
+/* Returns a new tile at the given row and column of the world. The noise */
+/* is filled from the tile's first vertex in the world, then each level   */
+/* of the fractalize is hashed from the world's rows and columns at that  */
+/* level. If cancelled is given and becomes true while fractalizing NULL  */
+/* is returned.                                                           */
+Mesh* TileGenerator::generate(int row, int col, const Color* color,
+	float snowCapHeight, const std::atomic<bool>* cancelled) const
+{
+	TRACE_SCOPE("TileGenerator::generate");
+
+	unsigned int quads = this->settings.quads;
+	Mesh* tile = new Mesh(quads, quads, this->settings.width,
+		this->settings.width, color, snowCapHeight);
+	int firstRow = row * (int)quads, firstCol = col * (int)quads;
+	this->noise.fill(tile, this->settings.range, firstRow, firstCol);
+	return fractalize(tile, this->worldSeed,
+		this->settings.fractalizeIterations, firstRow, firstCol, cancelled);
+}
+
+/* Fractalizes the mesh the given number of times. Each iteration doubles */
+/* the world's rows and columns, so the first vertex's row and column are */
+/* doubled with it. The mesh is deleted and the fractalized mesh is       */
+/* returned, or NULL if cancelled.                                        */
+Mesh* TileGenerator::fractalize(Mesh* mesh, unsigned int worldSeed,
+	unsigned int iterations, int firstRow, int firstCol,
+	const std::atomic<bool>* cancelled)
+{
+	for (unsigned int i = 0; i < iterations && mesh; i++)
+	{
+		Mesh* next = mesh->fractalize(iterationSeed(worldSeed, i), firstRow,
+			firstCol, cancelled);
+		delete mesh;
+		mesh = next;
+		firstRow *= 2;
+		firstCol *= 2;
+	}
+	return mesh;
+}
@@ -0,0 +1,75 @@
+/*
+ * TileGenerator.h
+ * Created by Zachary Ferguson
+ * Header file for the TileGenerator class, which generates any tile of a
+ * world without edges from the world's seed. The tile's noise and each level
+ * of its fractalize are found from the world's rows and columns instead of
+ * the tile's, so a tile can be generated on its own, in any order, and its
+ * edges still match the tiles around it exactly.
+ */
+
+#ifndef TILEGENERATOR_H
+#define TILEGENERATOR_H
+
+#include "Mesh.h"
+#include "NoiseGenerator.h"
+
+/* Parameters of the tiles of a world. */
+struct TileSettings
+{
+	/* Quads along each side of a tile before it is fractalized. */
+	unsigned int quads;
+	/* Width and depth of a tile. */
+	float width;
+	/* Range of the noise's heights, from -range/2 to range/2. */
+	float range;
+	/* Number of times each tile is fractalized. */
+	unsigned int fractalizeIterations;
+
+	/* Creates the default settings. */
+	TileSettings();
+};
+
+class TileGenerator
+{
+	private:
+
+		/* Seed of the world the noise and fractalize are hashed from. */
+		unsigned int worldSeed;
+		/* Generator of the heights before the tiles are fractalized. */
+		NoiseGenerator noise;
+		/* Parameters of the tiles. */
+		TileSettings settings;
+
+	public:
+
+		/* Creates a generator of the tiles of the world with the given  */
+		/* seed, its heights made by the noise and then fractalized.     */
+		TileGenerator(unsigned int worldSeed, const NoiseSettings& noise =
+			NoiseSettings(), const TileSettings& settings = TileSettings());
+
+		/* Returns the quads along each side of a generated tile. */
+		unsigned int getTileQuads() const;
+
+		/* Returns the width and depth of a tile. */
+		float getTileWidth() const;
+
+		/* Returns a new tile at the given row and column of the world.  */
+		/* Its mesh is centered on the origin, the tile's first vertex   */
+		/* being at (col*width, row*width) in the world. If cancelled is */
+		/* given and becomes true while fractalizing NULL is returned.   */
+		Mesh* generate(int row, int col, const Color* color,
+			float snowCapHeight = 100,
+			const std::atomic<bool>* cancelled = NULL) const;
+
+		/* Fractalizes the mesh the given number of times, its first     */
+		/* vertex being at firstRow and firstCol of the world's vertices */
+		/* before the first iteration. Each iteration's seed is hashed   */
+		/* from the world's seed and the iteration. The mesh is deleted  */
+		/* and the fractalized mesh is returned, or NULL if cancelled.   */
+		static Mesh* fractalize(Mesh* mesh, unsigned int worldSeed,
+			unsigned int iterations, int firstRow, int firstCol,
+			const std::atomic<bool>* cancelled = NULL);
+};
+
+#endif
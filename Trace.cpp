@@ -0,0 +1,149 @@
+/*
+ * Trace.cpp
+ * Created by Zachary Ferguson
+ * Source file for the Trace class, a light weight way to record the time
+ * spent in a scope into per thread ring buffers and dump them to a Chrome
+ * trace event JSON file.
+ */
+
+#include "Trace.h"
+#include <fstream>
+#include <iostream>
+#include <chrono>
+
+/* On x86 the time stamp counter is read directly since it is several times */
+/* cheaper than the operating system's clocks.                               */
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#define TRACE_USE_TSC
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define TRACE_USE_TSC
+#endif
+
+/* Head of the list of every thread's buffer. Buffers are only ever added. */
+static std::atomic<TraceBuffer*> traceBuffers(NULL);
+
+/* Identifier given to the next thread to record a scope. */
+static std::atomic<int> nextThreadId(1);
+
+/* Returns the wall clock time in nanoseconds. */
+static long long wallClock()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Ticks and wall clock time when the program started. The tick rate is   */
+/* measured against the wall clock from this point, and the start time is */
+/* subtracted from the times in the dump.                                 */
+static const long long startTicks = Trace::now();
+static const long long startWallClock = wallClock();
+
+/* Returns the current time in ticks. */
+long long Trace::now()
+{
+#ifdef TRACE_USE_TSC
+	return (long long)__rdtsc();
+#else
+	return wallClock();
+#endif
+}
+
+/* Returns the number of ticks in one second. */
+long long Trace::ticksPerSecond()
+{
+#ifdef TRACE_USE_TSC
+	/* Measure the rate of the time stamp counter since the start. */
+	long long elapsedTicks = Trace::now() - startTicks;
+	long long elapsedNanoseconds = wallClock() - startWallClock;
+	if(elapsedNanoseconds <= 0)
+	{
+		return 1000000000LL;
+	}
+	return (long long)(elapsedTicks * (1e9 / elapsedNanoseconds));
+#else
+	return 1000000000LL;
+#endif
+}
+
+/* Returns the calling thread's buffer, creating it on first use. */
+TraceBuffer* Trace::threadBuffer()
+{
+	static TRACE_THREAD_LOCAL TraceBuffer* buffer = NULL;
+
+	if(!buffer)
+	{
+		TraceBuffer* newBuffer = new TraceBuffer();
+		newBuffer->count = 0;
+		newBuffer->threadId = nextThreadId++;
+
+		/* Push the buffer onto the front of the list of buffers. */
+		newBuffer->next = traceBuffers.load();
+		while(!traceBuffers.compare_exchange_weak(newBuffer->next, newBuffer));
+
+		buffer = newBuffer;
+	}
+
+	return buffer;
+}
+
+/* Records a completed scope in the calling thread's buffer. */
+void Trace::record(const char* name, long long begin, long long end)
+{
+	TraceBuffer* buffer = Trace::threadBuffer();
+
+	/* Only this thread writes to the buffer, so no lock is needed. The */
+	/* release makes the event visible before the new count.            */
+	unsigned long long count = buffer->count.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[count % TRACE_BUFFER_SIZE];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+/* Writes all of the recorded scopes to the given file in the Chrome trace */
+/* event format. Returns true if the file was written. Scopes recorded     */
+/* while dumping may be torn or lost.                                      */
+bool Trace::dump(const char* filename)
+{
+	std::ofstream outFile(filename, std::ios::out);
+	if(!(outFile.is_open()))
+	{
+		std::cout << "Unable to save to " << filename << std::endl;
+		return false;
+	}
+
+	/* Times are written in microseconds since the program started. */
+	double ticksToMicroseconds = 1e6 / Trace::ticksPerSecond();
+	bool first = true;
+
+	outFile.setf(std::ios::fixed);
+	outFile.precision(3);
+	outFile << "{\"traceEvents\": [" << std::endl;
+	for (TraceBuffer* buffer = traceBuffers.load(); buffer;
+		buffer = buffer->next)
+	{
+		unsigned long long count = buffer->count.load(
+			std::memory_order_acquire);
+		unsigned long long oldest = (count > TRACE_BUFFER_SIZE) ?
+			(count - TRACE_BUFFER_SIZE) : 0;
+
+		for (unsigned long long i = oldest; i < count; i++)
+		{
+			const TraceEvent& event = buffer->events[i % TRACE_BUFFER_SIZE];
+			outFile << (first ? "" : ",\n") << "{\"name\": \"" << event.name
+				<< "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+				<< buffer->threadId << ", \"ts\": "
+				<< (event.begin - startTicks) * ticksToMicroseconds
+				<< ", \"dur\": "
+				<< (event.end - event.begin) * ticksToMicroseconds << "}";
+			first = false;
+		}
+	}
+	outFile << std::endl << "]}" << std::endl;
+
+	outFile.close();
+	return true;
+}
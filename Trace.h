@@ -0,0 +1,104 @@
+/*
+ * Trace.h
+ * Created by Zachary Ferguson
+ * Header file for the Trace class and the TRACE_SCOPE macro, a light weight
+ * way to record the time spent in a scope. Each thread records its scopes in
+ * its own ring buffer without locking and the buffers can be dumped to a
+ * Chrome trace event JSON file, viewable in chrome://tracing or Perfetto.
+ *
+ * Tracing is only compiled in when ENABLE_TRACING is defined, otherwise the
+ * TRACE_SCOPE macro expands to nothing.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+
+/* Number of scopes each thread remembers before overwriting the oldest. */
+#define TRACE_BUFFER_SIZE 16384
+
+/* Compiler specific storage class for thread local variables. */
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+/* A single completed scope. */
+struct TraceEvent
+{
+	/* Name of the scope, must be a string literal. */
+	const char* name;
+	/* Start and end time of the scope in ticks. */
+	long long begin, end;
+};
+
+/* Ring buffer of the scopes recorded by one thread. */
+struct TraceBuffer
+{
+	/* Recorded scopes, indexed by count modulo TRACE_BUFFER_SIZE. */
+	TraceEvent events[TRACE_BUFFER_SIZE];
+	/* Total number of scopes recorded by the thread. */
+	std::atomic<unsigned long long> count;
+	/* Small integer identifying the thread in the trace. */
+	int threadId;
+	/* Next buffer in the list of all the threads' buffers. */
+	TraceBuffer* next;
+};
+
+class Trace
+{
+	private:
+
+		/* Returns the calling thread's buffer, creating it on first use. */
+		static TraceBuffer* threadBuffer();
+
+	public:
+
+		/* Returns the current time in ticks. */
+		static long long now();
+
+		/* Returns the number of ticks in one second. */
+		static long long ticksPerSecond();
+
+		/* Records a completed scope in the calling thread's buffer. */
+		static void record(const char* name, long long begin, long long end);
+
+		/* Writes all of the recorded scopes to the given file in the   */
+		/* Chrome trace event format. Returns true if the file was      */
+		/* written. Scopes recorded while dumping may be torn or lost. */
+		static bool dump(const char* filename);
+};
+
+/* Records the time from its construction to its destruction as a scope. */
+class TraceScope
+{
+	private:
+
+		/* Name of the scope. */
+		const char* name;
+		/* Time the scope was entered in ticks. */
+		long long begin;
+
+	public:
+
+		/* Starts timing a scope with the given name. */
+		TraceScope(const char* name) : name(name), begin(Trace::now()) {}
+
+		/* Stops timing the scope and records it. */
+		~TraceScope() { Trace::record(this->name, this->begin, Trace::now()); }
+};
+
+/* Two levels of macros so __LINE__ is expanded before it is pasted. */
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/* Records the time until the end of the enclosing scope under name. */
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,490 @@
+/*
+ * UndoHistory.cpp
+ * Created by Zachary Ferguson
+ * Source file for the UndoHistory class, the undo and redo stacks of the
+ * edits made to a mesh.
+ */
+
+#include "UndoHistory.h"
+#include "MemoryTracker.h"
+#include "Trace.h"
+#include <cstring>
+
+/* Header bytes of the compressed heights at or above this value are runs */
+/* of heights equal to the one before them.                               */
+#define RUN_HEADER 0x80
+/* Longest run of equal heights a single header byte can hold. */
+#define MAX_RUN 0x80
+
+/* Compresses the heights into bytes. Each height is XORed with the one  */
+/* before it, which clears the sign, exponent, and top of the mantissa   */
+/* for neighbouring heights that are close. A header byte then gives the */
+/* number of low bytes of the XOR that are stored after it, or a run of  */
+/* heights equal to the one before for headers of RUN_HEADER and up.     */
+/* Heights too noisy to shrink are stored as they are, marked by the     */
+/* first byte.                                                           */
+static void compressHeights(const float* heights, size_t count,
+	std::vector<unsigned char>& compressed)
+{
+	compressed.clear();
+	compressed.reserve(count);
+	compressed.push_back(1);
+	unsigned int previous = 0;
+	for (size_t i = 0; i < count;)
+	{
+		unsigned int bits;
+		memcpy(&bits, heights + i, sizeof(bits));
+		unsigned int delta = bits ^ previous;
+		previous = bits;
+
+		if(delta == 0)
+		{
+			/* Count the run of equal heights. */
+			size_t run = 1;
+			while(i + run < count && run < MAX_RUN &&
+				memcmp(heights + i + run, heights + i, sizeof(float)) == 0)
+			{
+				run++;
+			}
+			compressed.push_back((unsigned char)(RUN_HEADER + run - 1));
+			i += run;
+			continue;
+		}
+
+		unsigned char length = 4;
+		while((delta >> ((length - 1) * 8)) == 0)
+		{
+			length--;
+		}
+		compressed.push_back(length);
+		for (unsigned char b = 0; b < length; b++)
+		{
+			compressed.push_back((unsigned char)(delta >> (b * 8)));
+		}
+		i++;
+	}
+
+	if(compressed.size() > count * sizeof(float))
+	{
+		compressed.assign(1, 0);
+		compressed.insert(compressed.end(), (const unsigned char*)heights,
+			(const unsigned char*)(heights + count));
+	}
+	compressed.shrink_to_fit();
+}
+
+/* Decompresses the bytes made by compressHeights into count heights. */
+static void decompressHeights(const std::vector<unsigned char>& compressed,
+	float* heights, size_t count)
+{
+	if(compressed[0] == 0)
+	{
+		memcpy(heights, compressed.data() + 1, count * sizeof(float));
+		return;
+	}
+
+	unsigned int previous = 0;
+	size_t in = 1;
+	for (size_t i = 0; i < count;)
+	{
+		unsigned char header = compressed[in++];
+		if(header >= RUN_HEADER)
+		{
+			for (size_t run = header - RUN_HEADER + 1; run > 0; run--)
+			{
+				memcpy(heights + (i++), &previous, sizeof(previous));
+			}
+			continue;
+		}
+
+		unsigned int delta = 0;
+		for (unsigned char b = 0; b < header; b++)
+		{
+			delta |= (unsigned int)compressed[in++] << (b * 8);
+		}
+		previous ^= delta;
+		memcpy(heights + (i++), &previous, sizeof(previous));
+	}
+}
+
+/* A change to the height of a single vertex. */
+class HeightEntry : public UndoEntry
+{
+	public:
+
+		unsigned int row, col;
+		float before, after;
+
+		HeightEntry(unsigned int row, unsigned int col, float before,
+			float after)
+		{
+			this->row = row;
+			this->col = col;
+			this->before = before;
+			this->after = after;
+		}
+
+		Mesh* undo(Mesh* mesh)
+		{
+			mesh->setHeight(this->row, this->col, this->before);
+			return mesh;
+		}
+
+		Mesh* redo(Mesh* mesh)
+		{
+			mesh->setHeight(this->row, this->col, this->after);
+			return mesh;
+		}
+
+		size_t bytes() const
+		{
+			return sizeof(HeightEntry);
+		}
+};
+
+/* A flatten or randomize, kept as the compressed heights from before it */
+/* and the parameters to replay it.                                      */
+class HeightsEntry : public UndoEntry
+{
+	private:
+
+		/* Compressed heights of the mesh before the edit. */
+		std::vector<unsigned char> before;
+		/* Number of heights compressed. */
+		size_t count;
+		/* True for a randomize, false for a flatten. */
+		bool randomize;
+		/* Range and seed of the randomize. */
+		float range;
+		unsigned int seed;
+
+	public:
+
+		HeightsEntry(const Mesh* mesh, bool randomize, float range,
+			unsigned int seed)
+		{
+			this->count = (size_t)mesh->getRows() * mesh->getCols();
+			this->randomize = randomize;
+			this->range = range;
+			this->seed = seed;
+
+			std::vector<float> heights(this->count);
+			mesh->getHeights(heights.data());
+			compressHeights(heights.data(), this->count, this->before);
+			MemoryTracker::allocate(UNDO_HISTORY, this->before.capacity());
+		}
+
+		~HeightsEntry()
+		{
+			MemoryTracker::release(UNDO_HISTORY, this->before.capacity());
+		}
+
+		Mesh* undo(Mesh* mesh)
+		{
+			std::vector<float> heights(this->count);
+			decompressHeights(this->before, heights.data(), this->count);
+			mesh->setHeights(heights.data());
+			return mesh;
+		}
+
+		Mesh* redo(Mesh* mesh)
+		{
+			if(this->randomize)
+			{
+				mesh->randomize(this->range, this->seed);
+			}
+			else
+			{
+				mesh->flatten();
+			}
+			return mesh;
+		}
+
+		size_t bytes() const
+		{
+			return sizeof(HeightsEntry) + this->before.capacity();
+		}
+};
+
+/* An edit that replaced the mesh, kept as the mesh it replaced. Undoing */
+/* and redoing it swaps the two meshes.                                  */
+class ReplaceEntry : public UndoEntry
+{
+	private:
+
+		/* The mesh swapped out by the edit, or by undoing it. */
+		Mesh* other;
+
+	public:
+
+		ReplaceEntry(Mesh* oldMesh)
+		{
+			this->other = oldMesh;
+		}
+
+		~ReplaceEntry()
+		{
+			delete this->other;
+		}
+
+		Mesh* undo(Mesh* mesh)
+		{
+			Mesh* swapped = this->other;
+			this->other = mesh;
+			return swapped;
+		}
+
+		Mesh* redo(Mesh* mesh)
+		{
+			return this->undo(mesh);
+		}
+
+		size_t bytes() const
+		{
+			return sizeof(ReplaceEntry) + (size_t)this->other->getRows() *
+				this->other->getCols() * sizeof(vec4);
+		}
+};
+
+/* A brush stroke, kept as a snapshot of the mesh from before it. The */
+/* snapshot shares every tile the stroke did not touch, so it only    */
+/* holds the tiles the stroke changed. Undoing and redoing it swaps   */
+/* the tiles of the mesh with those of the snapshot.                  */
+class TilesEntry : public UndoEntry
+{
+	private:
+
+		/* Snapshot of the mesh from before the stroke, or after it once */
+		/* the stroke is undone.                                         */
+		Mesh* other;
+		/* Bytes of the tiles the stroke changed. */
+		size_t tileBytes;
+
+	public:
+
+		TilesEntry(Mesh* before, const Mesh* after)
+		{
+			this->other = before;
+			this->tileBytes = 0;
+			for (unsigned int t = 0; t < after->getTileCount(); t++)
+			{
+				if(!after->sharesTile(before, t))
+				{
+					this->tileBytes += (size_t)TILE_ROWS * after->getCols() *
+						sizeof(vec4);
+				}
+			}
+		}
+
+		~TilesEntry()
+		{
+			delete this->other;
+		}
+
+		Mesh* undo(Mesh* mesh)
+		{
+			Mesh* current = mesh->snapshot();
+			mesh->shareTiles(this->other);
+			delete this->other;
+			this->other = current;
+			return mesh;
+		}
+
+		Mesh* redo(Mesh* mesh)
+		{
+			return this->undo(mesh);
+		}
+
+		size_t bytes() const
+		{
+			return sizeof(TilesEntry) + this->tileBytes;
+		}
+};
+
+/* Creates an empty history that holds at most budget bytes. */
+UndoHistory::UndoHistory(size_t budget)
+{
+	this->totalBytes = 0;
+	this->budget = budget;
+	this->mergeHeights = false;
+}
+
+/* Deletes every entry, and the meshes held by them. */
+UndoHistory::~UndoHistory()
+{
+	this->clearRedo();
+	for (unsigned int i = 0; i < this->undoStack.size(); i++)
+	{
+		delete this->undoStack[i];
+	}
+}
+
+/* Adds an edit that was just made. The edits that were undone can no */
+/* longer be redone.                                                   */
+void UndoHistory::push(UndoEntry* entry)
+{
+	this->clearRedo();
+	this->undoStack.push_back(entry);
+	this->totalBytes += entry->bytes();
+	this->mergeHeights = false;
+	this->enforceBudget();
+}
+
+/* Forgets the oldest edits until the entries fit in the budget. The most */
+/* recent edit is always kept so it can be undone.                        */
+void UndoHistory::enforceBudget()
+{
+	while(this->totalBytes > this->budget && !this->redoStack.empty())
+	{
+		this->totalBytes -= this->redoStack.front()->bytes();
+		delete this->redoStack.front();
+		this->redoStack.erase(this->redoStack.begin());
+	}
+	while(this->totalBytes > this->budget && this->undoStack.size() > 1)
+	{
+		this->totalBytes -= this->undoStack.front()->bytes();
+		delete this->undoStack.front();
+		this->undoStack.pop_front();
+	}
+}
+
+/* Deletes the entries of the redo stack. */
+void UndoHistory::clearRedo()
+{
+	for (unsigned int i = 0; i < this->redoStack.size(); i++)
+	{
+		this->totalBytes -= this->redoStack[i]->bytes();
+		delete this->redoStack[i];
+	}
+	this->redoStack.clear();
+}
+
+/* Records the height of a vertex being changed. Consecutive edits of the */
+/* same vertex, such as those made while dragging the height slider, are  */
+/* merged into one.                                                       */
+void UndoHistory::recordHeight(unsigned int row, unsigned int col,
+	float before, float after)
+{
+	if(this->mergeHeights)
+	{
+		HeightEntry* last = (HeightEntry*)this->undoStack.back();
+		if(last->row == row && last->col == col)
+		{
+			last->after = after;
+			return;
+		}
+	}
+	this->push(new HeightEntry(row, col, before, after));
+	this->mergeHeights = true;
+}
+
+/* Records the given mesh about to be flattened. */
+void UndoHistory::recordFlatten(const Mesh* mesh)
+{
+	TRACE_SCOPE("UndoHistory::recordFlatten");
+
+	this->push(new HeightsEntry(mesh, false, 0, 0));
+}
+
+/* Records the given mesh about to be randomized with the range and seed. */
+void UndoHistory::recordRandomize(const Mesh* mesh, float range,
+	unsigned int seed)
+{
+	TRACE_SCOPE("UndoHistory::recordRandomize");
+
+	this->push(new HeightsEntry(mesh, true, range, seed));
+}
+
+/* Records the mesh being replaced by a new one. The history takes */
+/* ownership of the old mesh.                                      */
+void UndoHistory::recordReplace(Mesh* oldMesh)
+{
+	this->push(new ReplaceEntry(oldMesh));
+}
+
+/* Records a brush stroke, given a snapshot of the mesh from before it and */
+/* the mesh after it. The history takes ownership of the snapshot.         */
+void UndoHistory::recordStroke(Mesh* before, const Mesh* after)
+{
+	TRACE_SCOPE("UndoHistory::recordStroke");
+
+	this->push(new TilesEntry(before, after));
+}
+
+/* Ends merging of height edits, so the next one is separate. */
+void UndoHistory::endHeightEdit()
+{
+	this->mergeHeights = false;
+}
+
+/* Undoes the most recent edit of the mesh. Returns the mesh to use, which */
+/* is mesh itself unless the edit replaced it.                             */
+Mesh* UndoHistory::undo(Mesh* mesh)
+{
+	TRACE_SCOPE("UndoHistory::undo");
+
+	if(this->undoStack.empty())
+	{
+		return mesh;
+	}
+	UndoEntry* entry = this->undoStack.back();
+	this->undoStack.pop_back();
+	this->totalBytes -= entry->bytes();
+	mesh = entry->undo(mesh);
+	this->totalBytes += entry->bytes();
+	this->redoStack.push_back(entry);
+	this->mergeHeights = false;
+	return mesh;
+}
+
+/* Redoes the most recently undone edit of the mesh. Returns the mesh to */
+/* use, which is mesh itself unless the edit replaced it.                */
+Mesh* UndoHistory::redo(Mesh* mesh)
+{
+	TRACE_SCOPE("UndoHistory::redo");
+
+	if(this->redoStack.empty())
+	{
+		return mesh;
+	}
+	UndoEntry* entry = this->redoStack.back();
+	this->redoStack.pop_back();
+	this->totalBytes -= entry->bytes();
+	mesh = entry->redo(mesh);
+	this->totalBytes += entry->bytes();
+	this->undoStack.push_back(entry);
+	this->mergeHeights = false;
+	return mesh;
+}
+
+/* Returns true if there is an edit to undo. */
+bool UndoHistory::canUndo() const
+{
+	return !this->undoStack.empty();
+}
+
+/* Returns true if there is an edit to redo. */
+bool UndoHistory::canRedo() const
+{
+	return !this->redoStack.empty();
+}
+
+/* Sets the most bytes the history can hold, forgetting the oldest edits if */
+/* it holds more.                                                           */
+void UndoHistory::setBudget(size_t budget)
+{
+	this->budget = budget;
+	this->enforceBudget();
+}
+
+/* Returns the most bytes the history can hold. */
+size_t UndoHistory::getBudget() const
+{
+	return this->budget;
+}
+
+/* Returns the bytes held by the history. */
+size_t UndoHistory::getBytes() const
+{
+	return this->totalBytes;
+}
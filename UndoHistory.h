@@ -0,0 +1,119 @@
+/*
+ * UndoHistory.h
+ * Created by Zachary Ferguson
+ * Header file for the UndoHistory class, the undo and redo stacks of the
+ * edits made to a mesh. Each kind of edit is kept in the smallest form that
+ * can restore it: a single vertex edit as its old and new height, a flatten
+ * or randomize as the compressed old heights and the parameters to replay
+ * it, an edit that replaces the mesh as the mesh it replaced, so undoing it
+ * is only a swap, and a brush stroke as the tiles it changed.
+ */
+
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <deque>
+#include <vector>
+#include "Mesh.h"
+
+/* Default number of bytes the history can hold before the oldest edits */
+/* are forgotten.                                                       */
+#define DEFAULT_UNDO_BUDGET (256 << 20)
+
+/* An edit that can be undone and redone. */
+class UndoEntry
+{
+	public:
+
+		virtual ~UndoEntry() {}
+
+		/* Undoes the edit on the given mesh. Returns the mesh to use, */
+		/* which is different if the edit replaced the mesh.           */
+		virtual Mesh* undo(Mesh* mesh) = 0;
+
+		/* Redoes the edit on the given mesh. Returns the mesh to use, */
+		/* which is different if the edit replaced the mesh.           */
+		virtual Mesh* redo(Mesh* mesh) = 0;
+
+		/* Returns the number of bytes held by this entry. */
+		virtual size_t bytes() const = 0;
+};
+
+class UndoHistory
+{
+	private:
+
+		/* Edits that can be undone, the most recent at the back. */
+		std::deque<UndoEntry*> undoStack;
+		/* Edits that can be redone, the most recently undone at the back. */
+		std::vector<UndoEntry*> redoStack;
+		/* Bytes held by the entries of both stacks. */
+		size_t totalBytes;
+		/* Most bytes the entries can hold. */
+		size_t budget;
+		/* Set while the last entry is a height edit more edits of the same */
+		/* vertex can be merged into.                                       */
+		bool mergeHeights;
+
+		/* Adds an edit that was just made, forgetting the redo stack. */
+		void push(UndoEntry* entry);
+		/* Forgets the oldest edits until the entries fit in the budget. */
+		void enforceBudget();
+		/* Deletes the entries of the redo stack. */
+		void clearRedo();
+
+	public:
+
+		/* Creates an empty history that holds at most budget bytes. */
+		UndoHistory(size_t budget = DEFAULT_UNDO_BUDGET);
+
+		/* Deletes every entry, and the meshes held by them. */
+		~UndoHistory();
+
+		/* Records the height of a vertex being changed. Consecutive edits */
+		/* of the same vertex are merged into one.                         */
+		void recordHeight(unsigned int row, unsigned int col, float before,
+			float after);
+
+		/* Records the given mesh about to be flattened. */
+		void recordFlatten(const Mesh* mesh);
+
+		/* Records the given mesh about to be randomized with the range and */
+		/* seed.                                                            */
+		void recordRandomize(const Mesh* mesh, float range, unsigned int seed);
+
+		/* Records the mesh being replaced by a new one. The history takes */
+		/* ownership of the old mesh.                                      */
+		void recordReplace(Mesh* oldMesh);
+
+		/* Records a brush stroke, given a snapshot of the mesh from before */
+		/* it and the mesh after it. The history takes ownership of the     */
+		/* snapshot.                                                        */
+		void recordStroke(Mesh* before, const Mesh* after);
+
+		/* Ends merging of height edits, so the next one is separate. */
+		void endHeightEdit();
+
+		/* Undoes the most recent edit of the mesh. Returns the mesh to */
+		/* use, which is mesh itself unless the edit replaced it.       */
+		Mesh* undo(Mesh* mesh);
+
+		/* Redoes the most recently undone edit of the mesh. Returns the */
+		/* mesh to use, which is mesh itself unless the edit replaced it. */
+		Mesh* redo(Mesh* mesh);
+
+		/* Returns true if there is an edit to undo. */
+		bool canUndo() const;
+		/* Returns true if there is an edit to redo. */
+		bool canRedo() const;
+
+		/* Sets the most bytes the history can hold, forgetting the oldest */
+		/* edits if it holds more.                                         */
+		void setBudget(size_t budget);
+		/* Returns the most bytes the history can hold. */
+		size_t getBudget() const;
+		/* Returns the bytes held by the history. */
+		size_t getBytes() const;
+};
+
+#endif
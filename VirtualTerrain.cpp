@@ -0,0 +1,362 @@
+/*
+ * VirtualTerrain.cpp
+ * Created by Zachary Ferguson
+ * Source file for the VirtualTerrain class, a heightfield without edges whose
+ * tiles are generated from a seed when they come into view and kept in a
+ * least recently used cache.
+ */
+
+#include "VirtualTerrain.h"
+#include "Trace.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+/* Returns the settings of the tiles of a terrain. */
+static TileSettings terrainTiles(float range, float tileWidth)
+{
+	TileSettings tiles;
+	tiles.quads = TERRAIN_TILE_QUADS;
+	tiles.width = tileWidth;
+	tiles.range = range;
+	return tiles;
+}
+
+/* Creates a terrain of the noise with the given seed and settings. The */
+/* heights span -range/2 to range/2. The tiles have the given color and */
+/* snow cap height, and at most maxBytes of vertices are cached.        */
+VirtualTerrain::VirtualTerrain(unsigned int seed, const NoiseSettings&
+	settings, float range, const Color* color, float snowCapHeight,
+	size_t maxBytes, float tileWidth, float viewDistance) :
+	generator(seed, settings, terrainTiles(range, tileWidth)), color(*color)
+{
+	assert(tileWidth > 0 && viewDistance > 0);
+	this->range = range;
+	this->tileWidth = tileWidth;
+	this->snowCapHeight = snowCapHeight;
+	this->viewDistance = viewDistance;
+	this->maxBytes = maxBytes;
+	this->usedBytes = 0;
+	this->generatedCount = 0;
+	this->evictedCount = 0;
+}
+
+/* Deletes this terrain and its cached tiles. */
+VirtualTerrain::~VirtualTerrain()
+{
+	for (std::unordered_map<unsigned long long, CachedTile>::iterator it =
+		this->tiles.begin(); it != this->tiles.end(); it++)
+	{
+		delete it->second.mesh;
+	}
+}
+
+/* Returns the key of the tile at the given row and column. */
+unsigned long long VirtualTerrain::tileKey(int row, int col)
+{
+	return ((unsigned long long)(unsigned int)row << 32) |
+		(unsigned int)col;
+}
+
+/* Returns the row and column of the tile with the given key. */
+void VirtualTerrain::tileIndex(unsigned long long key, int& row, int& col)
+{
+	row = (int)(unsigned int)(key >> 32);
+	col = (int)(unsigned int)(key & 0xffffffffu);
+}
+
+/* Returns the bytes of vertices held by one tile. */
+size_t VirtualTerrain::tileBytes() const
+{
+	return (size_t)(TERRAIN_TILE_QUADS + 1) * (TERRAIN_TILE_QUADS + 1) *
+		sizeof(vec4);
+}
+
+/* Returns the center of the tile at the given row and column. */
+vec4 VirtualTerrain::tileCenter(int row, int col) const
+{
+	return vec4((float)((col + 0.5) * this->tileWidth), 0,
+		(float)((row + 0.5) * this->tileWidth), 0);
+}
+
+/* Returns the radius of a sphere around every vertex of a tile, from its */
+/* corners at the highest heights.                                        */
+float VirtualTerrain::tileRadius() const
+{
+	float half = this->tileWidth / 2.0f, height = this->range / 2.0f;
+	return sqrt(2.0f * half * half + height * height);
+}
+
+/* Returns true if the tile at the given row and column is within the view */
+/* distance of the eye and its bounding sphere reaches inside the cone     */
+/* around the unit direction that holds the view.                          */
+bool VirtualTerrain::isInView(int row, int col, const vec4& eye,
+	const vec4& direction) const
+{
+	vec3 toTile = vec3(this->tileCenter(row, col)) - vec3(eye);
+	float distance = toTile.length();
+	float radius = this->tileRadius();
+	if(distance - radius > this->viewDistance)
+	{
+		return false;
+	}
+	float along = toTile * vec3(direction);
+	float across = sqrt(std::max(distance * distance - along * along, 0.0f));
+	return across * cos(TERRAIN_VIEW_HALF_ANGLE) -
+		along * sin(TERRAIN_VIEW_HALF_ANGLE) <= radius;
+}
+
+/* Deletes the tile with the given key from the cache. */
+void VirtualTerrain::evictTile(unsigned long long key)
+{
+	std::unordered_map<unsigned long long, CachedTile>::iterator it =
+		this->tiles.find(key);
+	assert(it != this->tiles.end());
+	delete it->second.mesh;
+	this->recentlyUsed.erase(it->second.use);
+	this->tiles.erase(it);
+	this->usedBytes -= this->tileBytes();
+	this->evictedCount++;
+}
+
+/* Returns the tile at the given row and column, generating it if it is not */
+/* cached. The least recently used tiles are evicted to make room.          */
+const Mesh* VirtualTerrain::getTile(int row, int col)
+{
+	unsigned long long key = tileKey(row, col);
+	std::unordered_map<unsigned long long, CachedTile>::iterator it =
+		this->tiles.find(key);
+	if(it != this->tiles.end())
+	{
+		this->recentlyUsed.splice(this->recentlyUsed.begin(),
+			this->recentlyUsed, it->second.use);
+		return it->second.mesh;
+	}
+
+	while(!this->recentlyUsed.empty() &&
+		this->usedBytes + this->tileBytes() > this->maxBytes)
+	{
+		this->evictTile(this->recentlyUsed.back());
+	}
+	CachedTile tile;
+	tile.mesh = this->generator.generate(row, col, &this->color,
+		this->snowCapHeight);
+	this->recentlyUsed.push_front(key);
+	tile.use = this->recentlyUsed.begin();
+	this->tiles[key] = tile;
+	this->usedBytes += this->tileBytes();
+	this->generatedCount++;
+	return tile.mesh;
+}
+
+/* Finds the tiles in view of a camera at the eye looking at the target.   */
+/* Only as many of the nearest tiles as fit in the memory limit are kept.  */
+/* The cached ones are moved to the front of the use order, so the tiles   */
+/* that left the view are the first evicted to make room for the new      */
+/* ones, which are generated across the threads.                          */
+void VirtualTerrain::update(const vec4& eye, const vec4& target)
+{
+	TRACE_SCOPE("VirtualTerrain::update");
+
+	vec3 view = vec3(target) - vec3(eye);
+	if(view.length() <= 0)
+	{
+		return;
+	}
+	vec4 direction = vec4(view / view.length());
+
+	/* Find the tiles in view around the eye, nearest first. */
+	float reach = this->viewDistance + this->tileRadius();
+	int firstRow = (int)floor((eye[2] - reach) / this->tileWidth);
+	int lastRow = (int)floor((eye[2] + reach) / this->tileWidth);
+	int firstCol = (int)floor((eye[0] - reach) / this->tileWidth);
+	int lastCol = (int)floor((eye[0] + reach) / this->tileWidth);
+	std::vector<std::pair<float, unsigned long long> > inView;
+	for (int r = firstRow; r <= lastRow; r++)
+	{
+		for (int c = firstCol; c <= lastCol; c++)
+		{
+			if(this->isInView(r, c, eye, direction))
+			{
+				vec3 toTile = vec3(this->tileCenter(r, c)) - vec3(eye);
+				inView.push_back(std::make_pair(toTile.length(),
+					tileKey(r, c)));
+			}
+		}
+	}
+	std::sort(inView.begin(), inView.end());
+	size_t capacity = std::max((size_t)1, this->maxBytes / this->tileBytes());
+	if(inView.size() > capacity)
+	{
+		inView.resize(capacity);
+	}
+
+	/* Use the cached tiles in view, and find those to generate. */
+	this->visible.clear();
+	std::vector<unsigned long long> missing;
+	for (int i = (int)inView.size() - 1; i >= 0; i--)
+	{
+		unsigned long long key = inView[i].second;
+		std::unordered_map<unsigned long long, CachedTile>::iterator it =
+			this->tiles.find(key);
+		if(it != this->tiles.end())
+		{
+			this->recentlyUsed.splice(this->recentlyUsed.begin(),
+				this->recentlyUsed, it->second.use);
+		}
+		else
+		{
+			missing.push_back(key);
+		}
+	}
+	for (size_t i = 0; i < inView.size(); i++)
+	{
+		this->visible.push_back(inView[i].second);
+	}
+
+	/* Evict the tiles far out of view, then the least recently used */
+	/* until the new tiles fit.                                      */
+	std::vector<unsigned long long> far;
+	for (std::unordered_map<unsigned long long, CachedTile>::iterator it =
+		this->tiles.begin(); it != this->tiles.end(); it++)
+	{
+		int row, col;
+		tileIndex(it->first, row, col);
+		vec3 toTile = vec3(this->tileCenter(row, col)) - vec3(eye);
+		if(toTile.length() - this->tileRadius() > 2 * this->viewDistance)
+		{
+			far.push_back(it->first);
+		}
+	}
+	for (size_t i = 0; i < far.size(); i++)
+	{
+		this->evictTile(far[i]);
+	}
+	while(!this->recentlyUsed.empty() && this->usedBytes +
+		missing.size() * this->tileBytes() > this->maxBytes)
+	{
+		this->evictTile(this->recentlyUsed.back());
+	}
+
+	/* Generate the missing tiles, each thread filling whole tiles. */
+	std::vector<Mesh*> generated(missing.size());
+	Parallel::forRange(0, missing.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			int row, col;
+			tileIndex(missing[i], row, col);
+			generated[i] = this->generator.generate(row, col, &this->color,
+				this->snowCapHeight);
+		}
+	});
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		CachedTile tile;
+		tile.mesh = generated[i];
+		this->recentlyUsed.push_front(missing[i]);
+		tile.use = this->recentlyUsed.begin();
+		this->tiles[missing[i]] = tile;
+		this->usedBytes += this->tileBytes();
+		this->generatedCount++;
+	}
+}
+
+/* Draws the tiles found in view by the last update, each moved from the */
+/* origin to its place.                                                  */
+void VirtualTerrain::draw(bool displayEdges, bool displayFaces) const
+{
+	TRACE_SCOPE("VirtualTerrain::draw");
+
+	for (size_t i = 0; i < this->visible.size(); i++)
+	{
+		std::unordered_map<unsigned long long, CachedTile>::const_iterator
+			it = this->tiles.find(this->visible[i]);
+		if(it == this->tiles.end())
+		{
+			continue;
+		}
+		int row, col;
+		tileIndex(it->first, row, col);
+		vec4 center = this->tileCenter(row, col);
+		glPushMatrix();
+		glTranslatef(center[0], center[1], center[2]);
+		it->second.mesh->draw(displayEdges, displayFaces);
+		glPopMatrix();
+	}
+}
+
+/* Finds the vertex of the tiles in view the ray passes closest to, within */
+/* SELECTION_RADIUS. Only the tiles whose bounding sphere the ray passes   */
+/* near are searched, with the ray moved into the tile's frame.            */
+bool VirtualTerrain::selectVertex(ray userRay, vec4& vertex) const
+{
+	TRACE_SCOPE("VirtualTerrain::selectVertex");
+
+	vec3 eye = userRay.value(0);
+	vec3 direction = vec3(userRay.value(1)) - eye;
+	float reach = this->tileRadius() + (float)SELECTION_RADIUS;
+	float closestDistance = FLT_MAX;
+	bool found = false;
+	for (size_t i = 0; i < this->visible.size(); i++)
+	{
+		std::unordered_map<unsigned long long, CachedTile>::const_iterator
+			it = this->tiles.find(this->visible[i]);
+		if(it == this->tiles.end())
+		{
+			continue;
+		}
+		int row, col;
+		tileIndex(it->first, row, col);
+		vec4 center = this->tileCenter(row, col);
+		if((direction % (vec3(center) - eye)).length() > reach)
+		{
+			continue;
+		}
+
+		ray tileRay(userRay.value(0) - center, userRay.origin() - center);
+		std::vector<unsigned int>* indecies =
+			it->second.mesh->selectVertex(tileRay);
+		if(!indecies)
+		{
+			continue;
+		}
+		vec4 v = it->second.mesh->getVertex(indecies->at(0),
+			indecies->at(1)) + center;
+		deleteIndecies(indecies);
+		float distance = (direction % (vec3(v) - eye)).length();
+		if(distance < closestDistance)
+		{
+			closestDistance = distance;
+			vertex = v;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/* Returns the number of tiles cached. */
+unsigned int VirtualTerrain::getCachedTileCount() const
+{
+	return (unsigned int)this->tiles.size();
+}
+
+/* Returns the bytes of vertices held by the cached tiles. */
+size_t VirtualTerrain::getCachedBytes() const
+{
+	return this->usedBytes;
+}
+
+/* Returns the number of tiles generated so far. */
+unsigned long long VirtualTerrain::getGeneratedCount() const
+{
+	return this->generatedCount;
+}
+
+/* Returns the number of tiles evicted so far. */
+unsigned long long VirtualTerrain::getEvictedCount() const
+{
+	return this->evictedCount;
+}
@@ -0,0 +1,138 @@
+/*
+ * VirtualTerrain.h
+ * Created by Zachary Ferguson
+ * Header file for the VirtualTerrain class, a heightfield without edges whose
+ * tiles are generated from a seed when they first come into view of the
+ * camera. The noise is keyed by position, so a tile that is evicted and later
+ * generated again has the same heights. The generated tiles are kept in a
+ * least recently used cache with a limit on its memory.
+ */
+
+#ifndef VIRTUALTERRAIN_H
+#define VIRTUALTERRAIN_H
+
+#include "Mesh.h"
+#include "TileGenerator.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/* Quads along each side of a tile. */
+#define TERRAIN_TILE_QUADS 32
+
+/* Default width and depth of a tile. */
+#define DEFAULT_TERRAIN_TILE_WIDTH 8.0f
+
+/* Default bytes of vertices the cached tiles may hold. */
+#define DEFAULT_TERRAIN_CACHE_BYTES (64 << 20)
+
+/* Default distance from the eye tiles are drawn to, the far plane of the */
+/* GL3DWindow.                                                            */
+#define DEFAULT_TERRAIN_VIEW_DISTANCE 100.0f
+
+/* Half the angle, in radians, across the corners of the GL3DWindow's */
+/* square 60 degree view, atan(tan(30 degrees)*sqrt(2)).              */
+#define TERRAIN_VIEW_HALF_ANGLE 0.6847f
+
+class VirtualTerrain
+{
+	private:
+
+		/* A generated tile and its place in the use order. */
+		struct CachedTile
+		{
+			Mesh* mesh;
+			std::list<unsigned long long>::iterator use;
+		};
+
+		/* Generator of the tiles from the world's seed. */
+		TileGenerator generator;
+		/* Range of the heights, from -range/2 to range/2. */
+		float range;
+		/* Width and depth of a tile. */
+		float tileWidth;
+		/* Color and snow cap height of the tiles. */
+		Color color;
+		float snowCapHeight;
+		/* Distance from the eye tiles are drawn to. */
+		float viewDistance;
+
+		/* Bytes of vertices the cached tiles may hold, and hold now. */
+		size_t maxBytes, usedBytes;
+		/* Generated tiles by their key. */
+		std::unordered_map<unsigned long long, CachedTile> tiles;
+		/* Keys of the generated tiles, most recently used first. */
+		std::list<unsigned long long> recentlyUsed;
+		/* Keys of the tiles in view at the last update. */
+		std::vector<unsigned long long> visible;
+		/* Number of tiles generated and evicted so far. */
+		unsigned long long generatedCount, evictedCount;
+
+		/* Returns the key of the tile at the given row and column. */
+		static unsigned long long tileKey(int row, int col);
+		/* Returns the row and column of the tile with the given key. */
+		static void tileIndex(unsigned long long key, int& row, int& col);
+
+		/* Returns the bytes of vertices held by one tile. */
+		size_t tileBytes() const;
+
+		/* Returns the center of the tile at the given row and column. */
+		vec4 tileCenter(int row, int col) const;
+
+		/* Returns the radius of a sphere around every vertex of a tile. */
+		float tileRadius() const;
+
+		/* Returns true if the tile at the given row and column is within */
+		/* the view distance of the eye and inside the view looking along */
+		/* the unit direction.                                            */
+		bool isInView(int row, int col, const vec4& eye,
+			const vec4& direction) const;
+
+		/* Deletes the tile with the given key from the cache. */
+		void evictTile(unsigned long long key);
+
+	public:
+
+		/* Creates a terrain of the noise with the given seed and settings. */
+		/* The heights span -range/2 to range/2. The tiles have the given   */
+		/* color and snow cap height, and at most maxBytes of vertices are  */
+		/* cached.                                                          */
+		VirtualTerrain(unsigned int seed, const NoiseSettings& settings,
+			float range, const Color* color, float snowCapHeight,
+			size_t maxBytes = DEFAULT_TERRAIN_CACHE_BYTES,
+			float tileWidth = DEFAULT_TERRAIN_TILE_WIDTH,
+			float viewDistance = DEFAULT_TERRAIN_VIEW_DISTANCE);
+
+		/* Deletes this terrain and its cached tiles. */
+		virtual ~VirtualTerrain();
+
+		/* Returns the tile at the given row and column, generating it if */
+		/* it is not cached. The tile's first vertex is at                */
+		/* (col*width, row*width) and its mesh is centered on the origin. */
+		const Mesh* getTile(int row, int col);
+
+		/* Finds the tiles in view of a camera at the eye looking at the  */
+		/* target, generating those not cached across the threads, nearest */
+		/* first. Tiles further than twice the view distance are evicted,  */
+		/* and the least recently used tiles are evicted to stay within    */
+		/* the memory limit.                                               */
+		void update(const vec4& eye, const vec4& target);
+
+		/* Draws the tiles found in view by the last update. */
+		void draw(bool displayEdges, bool displayFaces) const;
+
+		/* Finds the vertex of the tiles in view the ray passes closest to, */
+		/* within SELECTION_RADIUS. Returns false if it passes none.        */
+		bool selectVertex(ray userRay, vec4& vertex) const;
+
+		/* Returns the number of tiles cached. */
+		unsigned int getCachedTileCount() const;
+		/* Returns the bytes of vertices held by the cached tiles. */
+		size_t getCachedBytes() const;
+		/* Returns the number of tiles generated so far. */
+		unsigned long long getGeneratedCount() const;
+		/* Returns the number of tiles evicted so far. */
+		unsigned long long getEvictedCount() const;
+};
+
+#endif
@@ -5,12 +5,22 @@
  */
 
 #include "MeshModeler.h"
+#include "MemoryTracker.h"
 
 /* Constructs a 3D World with a camera and spinning cude. */
 int main(int argc, char* const argv[])
 {
-	MeshModeler* meshModeler = new MeshModeler(450, 150, 900, 600, 
-		"Mesh Modeler");
+	MemoryTracker::dumpOnExit(MEMORY_REPORT_FILENAME);
+
+	/* Enable FLTK's thread support so the mesh worker can post progress. */
+	Fl::lock();
+
+	MeshModeler* meshModeler = new MeshModeler(350, 150, 1110, 
+		600 + STATUS_BAR_HEIGHT, "Mesh Modeler");
 	meshModeler->show();
-	return Fl::run();
+	int result = Fl::run();
+
+	/* Closing the window is a clean exit, so the autosave is deleted. */
+	delete meshModeler;
+	return result;
 }
\ No newline at end of file
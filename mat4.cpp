@@ -4,25 +4,11 @@
  * Definition for 4X4 Matrix Class containing 4 vec4's as Rows.
  */
 
-#include "mat4.h"   /* Class and function prototypes. */
+#include "mat4.h"     /* Class and function prototypes.         */
+#include "Parallel.h" /* Used to split large arrays over threads. */
 
-/****************/
-/* Constructors */
-/****************/
-
-/* Creates a matrix of all zeros. */
-mat4::mat4() : mat4(vec4(), vec4(), vec4(), vec4()){}
-
-/* Constructs a matrix from the given three vectors. */
-/* The vectors become the rows of the matrix.        */
-mat4::mat4(const vec4& row1, const vec4& row2, const vec4& row3, 
-	const vec4& row4)
-{
-	data[0] = row1;
-	data[1] = row2;
-	data[2] = row3;
-	data[3] = row4;
-}
+/* Fewest points given to each thread when transforming an array. */
+#define TRANSFORM_GRAIN 16384
 
 /***********************/
 /* Static Initializers */
@@ -88,33 +74,6 @@ mat4 mat4::identity()
 				vec4(0, 0, 0, 1));
 }
 
-/* Returns the ith row in this matrix. */
-vec4 mat4::operator[](unsigned int index) const
-{
-	/* Check index is in bounds */
-	assert(index < 4);
-	/* Return the row corresponding to the given index */
-	return data[index];
-}
-
-/* Returns a reference to the ith row in this matrix. */
-vec4& mat4::operator[](unsigned int index)
-{
-	/* Check index is in bounds */
-	assert(index < 4);
-	/* Return the row corresponding to the given index */
-	return data[index];
-}
-
-/* Returns the column of this matrix corresponding to the given index. */
-vec4 mat4::getColumn(unsigned int index) const
-{
-	/* Check column is in bounds */
-	assert(index < 4);
-	/* Create and return the column */
-	return vec4(data[0][index], data[1][index], data[2][index], data[3][index]);
-}
-
 /**********************/
 /* Display the Matrix */
 /**********************/
@@ -137,132 +96,132 @@ std::string mat4::toString()
 	return stream.str();
 }
 
-/* Returns the transpose of this matrix (x_ij == x_ji). */
-mat4 mat4::transpose() const
-{
-	/* Make a new matrix with rows equal to the columns of this matrix */
-	return mat4(this->getColumn(0), this->getColumn(1), this->getColumn(2),
-				this->getColumn(3));
-}
-
-/* Returns a boolean for if the matrices are equal to each other. */
-bool operator==(const mat4& m1, const mat4& m2)
-{
-	/* Compare vectors */
-	return m1[0] == m2[0] && 
-		   m1[1] == m2[1] &&
-		   m1[2] == m2[2] &&
-		   m1[3] == m2[3];
-}
-
-/* Returns a boolean for if the matrices are not equal to each other. */
-bool operator!=(const mat4& m1, const mat4& m2)
-{
-	/* Return if they are not equal. */
-	return !(m1 == m2);
-}
-
-/* Return the sum of the given matrices. */
-mat4 operator+ (const mat4& m1, const mat4& m2)
-{
-	/* Sum up the rows */
-	vec4 row1 = m1[0] + m2[0];
-	vec4 row2 = m1[1] + m2[1];
-	vec4 row3 = m1[2] + m2[2];
-	vec4 row4 = m1[3] + m2[3];
-	
-	/* Return a new matrix of the sum of the vectors */
-	return mat4(row1, row2, row3, row4);
-}
-
-/* Return the difference between the given matrices. */
-mat4 operator- (const mat4& m1, const mat4& m2)
-{
-	/* Return the difference of the matrices */
-	return m1 + (-1 * m2);
-}
+/*************************/
+/* Batched Vertex Arrays */
+/*************************/
 
-/* Multiplies the given constant by the given matrix.          */
-/* Must give a mat4 and a float for to multiply in that order. */
-/* Returns the new matrix after the multiplication.            */
-mat4 operator* (const mat4& m, float c)
+/* Transforms points[begin, end) given the columns of the matrix, keeping */
+/* the w of each point.                                                   */
+static void transformPointRange(const vec4* columns, const vec4* points,
+	vec4* transformed, size_t begin, size_t end)
 {
-	/* multiply c by the up the rows */
-	vec4 row1 = c * m[0];
-	vec4 row2 = c * m[1];
-	vec4 row3 = c * m[2];
-	vec4 row4 = c * m[3];
-
-	/* Return a new matrix of the new vectors */
-	return mat4(row1, row2, row3, row4);
-}
-
-/* Multiplies the given constant by the given matrix.      */
-/* Must give a float and a mat4 to multiply in that order. */
-/* Returns the new matrix after the multiplication.        */
-mat4 operator* (float c, const mat4& m)
-{
-	return m * c;
-}
-
-/* Divides given matrix entries by the given constant.     */
-/* Must give a float and a mat4 to multiply in that order. */
-/* Returns the new matrix after the division.              */
-mat4 operator/ (const mat4& m, float c)
-{
-	/* Check that c is not zero */
-	assert(c != 0);
-	/* Divide the matrix by c */
-	return m * (1/c);
+#ifdef VEC4_USE_SSE
+	/* The product is the sum of the columns scaled by the coordinates. */
+	__m128 column1 = columns[0].simd();
+	__m128 column2 = columns[1].simd();
+	__m128 column3 = columns[2].simd();
+	__m128 column4 = columns[3].simd();
+	for (size_t i = begin; i < end; i++)
+	{
+		__m128 point = points[i].simd();
+		float w = points[i][3];
+		__m128 product = _mm_add_ps(column4, _mm_mul_ps(column1, 
+			_mm_shuffle_ps(point, point, _MM_SHUFFLE(0, 0, 0, 0))));
+		product = _mm_add_ps(product, _mm_mul_ps(column2, 
+			_mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1))));
+		product = _mm_add_ps(product, _mm_mul_ps(column3, 
+			_mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2))));
+		transformed[i] = vec4(product);
+		transformed[i][3] = w;
+	}
+#else
+	for (size_t i = begin; i < end; i++)
+	{
+		vec4 point = points[i];
+		vec4 product = columns[3];
+		product += point[0] * columns[0];
+		product += point[1] * columns[1];
+		product += point[2] * columns[2];
+		product[3] = point[3];
+		transformed[i] = product;
+	}
+#endif
 }
 
-/* Multiply the given two 3x3 matrices and return the new matrix. */
-mat4 operator* (const mat4& m1, const mat4& m2)
+/* Transforms the points [begin, end) of the x, y, and z arrays given the */
+/* rows of the matrix.                                                    */
+static void transformCoordinateRange(const vec4* m, const float* x, 
+	const float* y, const float* z, float* xOut, float* yOut, float* zOut,
+	size_t begin, size_t end)
 {
-	mat4 product = mat4();
-	
-	/* Multiply the rows of m1 times the columns of m2. */
-	for(int r = 0; r < 4; r++)
+	size_t i = begin;
+#ifdef VEC4_USE_SSE
+	/* Transform four points at a time with each matrix entry broadcast */
+	/* across a register.                                               */
+	__m128 entries[3][4];
+	for (int r = 0; r < 3; r++)
 	{
-		for(int c = 0; c < 4; c++)
+		for (int c = 0; c < 4; c++)
 		{
-			product[r][c] = m1[r] * m2.getColumn(c);
+			entries[r][c] = _mm_set1_ps(m[r][c]);
 		}
 	}
-	
-	return product;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 results[3];
+		for (int r = 0; r < 3; r++)
+		{
+			results[r] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(entries[r][0], px), 
+					_mm_mul_ps(entries[r][1], py)),
+				_mm_add_ps(_mm_mul_ps(entries[r][2], pz), entries[r][3]));
+		}
+		_mm_storeu_ps(xOut + i, results[0]);
+		_mm_storeu_ps(yOut + i, results[1]);
+		_mm_storeu_ps(zOut + i, results[2]);
+	}
+#endif
+	/* Transform the remaining points one at a time. */
+	for (; i < end; i++)
+	{
+		float px = x[i], py = y[i], pz = z[i];
+		xOut[i] = m[0][0] * px + m[0][1] * py + m[0][2] * pz + m[0][3];
+		yOut[i] = m[1][0] * px + m[1][1] * py + m[1][2] * pz + m[1][3];
+		zOut[i] = m[2][0] * px + m[2][1] * py + m[2][2] * pz + m[2][3];
+	}
 }
 
-/* Multiply the given 3x3 matrices and vec4 and return the new matrix. */
-/* Must give a mat4 for the matrix and a vec4 for the vector in that   */
-/* order.                                                              */
-vec4 operator* (const mat4& m, const vec4& v)
+/* Transforms an array of count points stored as vec4's (AoS). Each point */
+/* is multiplied as a column vector with w taken as 1 and keeps its own   */
+/* w. points and transformed may be the same array.                       */
+void mat4::transformPoints(const vec4* points, vec4* transformed, 
+	size_t count) const
 {
-	vec4 product = vec4();
-	
-	/* Multiply the rows of m by the vector to get the products components. */
-	for(int i = 0; i < 4; i++)
+	const mat4 columns = this->transpose();
+
+	/* Small arrays skip the thread pool entirely. */
+	if(count <= TRANSFORM_GRAIN)
 	{
-		product[i] = m[i] * v;
+		transformPointRange(columns.data, points, transformed, 0, count);
+		return;
 	}
-
-	/* Return the new product vector*/
-	return product;
+	Parallel::forRange(0, count, TRANSFORM_GRAIN, [&](size_t begin, 
+		size_t end)
+	{
+		transformPointRange(columns.data, points, transformed, begin, end);
+	});
 }
 
-/* Multiply the given 3x3 matrices and vec4 and return the new matrix. */
-/* Must give a vec4 for the vector and a mat4 for the matrix in that   */
-/* order.                                                              */
-vec4 operator* (const vec4& v, const mat4& m)
+/* Transforms count points stored as separate arrays of x, y, and z */
+/* coordinates (SoA), with w taken as 1. The output arrays may be   */
+/* the input arrays.                                                */
+void mat4::transformPoints(const float* x, const float* y, const float* z,
+	float* xOut, float* yOut, float* zOut, size_t count) const
 {
-	vec4 product = vec4();
-	
-	/* Multiply the rows of m by the vector to get the products components. */
-	for(int i = 0; i < 4; i++)
+	/* Small arrays skip the thread pool entirely. */
+	if(count <= TRANSFORM_GRAIN)
 	{
-		product[i] = m.getColumn(i) * v;
+		transformCoordinateRange(this->data, x, y, z, xOut, yOut, zOut, 0, 
+			count);
+		return;
 	}
-
-	/* Return the new product vector*/
-	return product;
-}
\ No newline at end of file
+	Parallel::forRange(0, count, TRANSFORM_GRAIN, [&](size_t begin, 
+		size_t end)
+	{
+		transformCoordinateRange(this->data, x, y, z, xOut, yOut, zOut, 
+			begin, end);
+	});
+}
@@ -2,6 +2,10 @@
  * amt4.h
  * Created by Zachary Ferguson
  * Header file for the mat4 class, a 4x4 matrix.
+ *
+ * The arithmetic operators are defined inline in this header. Products are
+ * computed by broadcasting each component of one operand across the rows of
+ * the other, which maps directly onto the SSE operations of vec4.
  */
  
 #ifndef MAT4_H
@@ -10,6 +14,7 @@
 #include "vec4.h" /* Used to store vec4's in the mat4.  */
 #include "mat3.h" /* Used to convert to 3x3.            */
 #include <cmath>  /* Need to get float trig. functions. */
+#include <cstddef> /* Used for the size of vertex arrays. */
 
 class mat4
 {
@@ -75,6 +80,23 @@ class mat4
 		/* Returns the transpose of the matrix (v_ij == v_ji) */
 		mat4 transpose() const;
 
+		/*************************/
+		/* Batched Vertex Arrays */
+		/*************************/
+		/* Transforms an array of count points stored as vec4's (AoS).   */
+		/* Each point is multiplied as a column vector with w taken as   */
+		/* 1, so translations apply, and keeps its own w. points and     */
+		/* transformed may be the same array. Large arrays are split    */
+		/* across threads.                                               */
+		void transformPoints(const vec4* points, vec4* transformed, 
+			size_t count) const;
+
+		/* Transforms count points stored as separate arrays of x, y, and */
+		/* z coordinates (SoA), with w taken as 1. The output arrays may  */
+		/* be the input arrays. Large arrays are split across threads.    */
+		void transformPoints(const float* x, const float* y, const float* z,
+			float* xOut, float* yOut, float* zOut, size_t count) const;
+
 		/** Friend Functions **/
 
 		/* Checks if m1 == m2 */
@@ -110,4 +132,183 @@ class mat4
 		friend vec4 operator* (const vec4& v,  const mat4& m);
 };
 
-#endif
\ No newline at end of file
+/****************/
+/* Constructors */
+/****************/
+
+/* Creates a matrix of all zeros. */
+inline mat4::mat4() {}
+
+/* Constructs a matrix from the given three vectors. */
+/* The vectors become the rows of the matrix.        */
+inline mat4::mat4(const vec4& row1, const vec4& row2, const vec4& row3, 
+	const vec4& row4)
+{
+	data[0] = row1;
+	data[1] = row2;
+	data[2] = row3;
+	data[3] = row4;
+}
+
+/*********************/
+/* Getters & Setters */
+/*********************/
+
+/* Returns the ith row in this matrix. */
+inline vec4 mat4::operator[](unsigned int index) const
+{
+	/* Check index is in bounds */
+	assert(index < 4);
+	/* Return the row corresponding to the given index */
+	return data[index];
+}
+
+/* Returns a reference to the ith row in this matrix. */
+inline vec4& mat4::operator[](unsigned int index)
+{
+	/* Check index is in bounds */
+	assert(index < 4);
+	/* Return the row corresponding to the given index */
+	return data[index];
+}
+
+/* Returns the column of this matrix corresponding to the given index. */
+inline vec4 mat4::getColumn(unsigned int index) const
+{
+	/* Check column is in bounds */
+	assert(index < 4);
+	/* Create and return the column */
+	return vec4(data[0][index], data[1][index], data[2][index], data[3][index]);
+}
+
+/*********************/
+/* Matrix Operations */
+/*********************/
+
+/* Returns the transpose of this matrix (x_ij == x_ji). */
+inline mat4 mat4::transpose() const
+{
+#ifdef VEC4_USE_SSE
+	__m128 row1 = data[0].simd(), row2 = data[1].simd(), 
+		row3 = data[2].simd(), row4 = data[3].simd();
+	_MM_TRANSPOSE4_PS(row1, row2, row3, row4);
+	return mat4(vec4(row1), vec4(row2), vec4(row3), vec4(row4));
+#else
+	/* Make a new matrix with rows equal to the columns of this matrix */
+	return mat4(this->getColumn(0), this->getColumn(1), this->getColumn(2),
+				this->getColumn(3));
+#endif
+}
+
+/* Returns a boolean for if the matrices are equal to each other. */
+inline bool operator==(const mat4& m1, const mat4& m2)
+{
+	/* Compare vectors */
+	return m1.data[0] == m2.data[0] && 
+		   m1.data[1] == m2.data[1] &&
+		   m1.data[2] == m2.data[2] &&
+		   m1.data[3] == m2.data[3];
+}
+
+/* Returns a boolean for if the matrices are not equal to each other. */
+inline bool operator!=(const mat4& m1, const mat4& m2)
+{
+	/* Return if they are not equal. */
+	return !(m1 == m2);
+}
+
+/* Return the sum of the given matrices. */
+inline mat4 operator+ (const mat4& m1, const mat4& m2)
+{
+	/* Return a new matrix of the sum of the rows */
+	return mat4(m1.data[0] + m2.data[0], m1.data[1] + m2.data[1],
+				m1.data[2] + m2.data[2], m1.data[3] + m2.data[3]);
+}
+
+/* Return the difference between the given matrices. */
+inline mat4 operator- (const mat4& m1, const mat4& m2)
+{
+	/* Return a new matrix of the difference of the rows */
+	return mat4(m1.data[0] - m2.data[0], m1.data[1] - m2.data[1],
+				m1.data[2] - m2.data[2], m1.data[3] - m2.data[3]);
+}
+
+/* Multiplies the given constant by the given matrix.          */
+/* Must give a mat4 and a float for to multiply in that order. */
+/* Returns the new matrix after the multiplication.            */
+inline mat4 operator* (const mat4& m, float c)
+{
+	/* Return a new matrix of the scaled rows */
+	return mat4(m.data[0] * c, m.data[1] * c, m.data[2] * c, m.data[3] * c);
+}
+
+/* Multiplies the given constant by the given matrix.      */
+/* Must give a float and a mat4 to multiply in that order. */
+/* Returns the new matrix after the multiplication.        */
+inline mat4 operator* (float c, const mat4& m)
+{
+	return m * c;
+}
+
+/* Divides given matrix entries by the given constant.     */
+/* Must give a float and a mat4 to multiply in that order. */
+/* Returns the new matrix after the division.              */
+inline mat4 operator/ (const mat4& m, float c)
+{
+	/* Check that c is not zero */
+	assert(c != 0);
+	/* Divide the matrix by c */
+	return m * (1/c);
+}
+
+/* Multiply the given vec4 as a row vector by the given matrix. This is the */
+/* sum of the rows of the matrix scaled by the components of the vector.    */
+inline vec4 operator* (const vec4& v, const mat4& m)
+{
+#ifdef VEC4_USE_SSE
+	__m128 components = v.simd();
+	__m128 product = _mm_mul_ps(m.data[0].simd(), 
+		_mm_shuffle_ps(components, components, _MM_SHUFFLE(0, 0, 0, 0)));
+	product = _mm_add_ps(product, _mm_mul_ps(m.data[1].simd(), 
+		_mm_shuffle_ps(components, components, _MM_SHUFFLE(1, 1, 1, 1))));
+	product = _mm_add_ps(product, _mm_mul_ps(m.data[2].simd(), 
+		_mm_shuffle_ps(components, components, _MM_SHUFFLE(2, 2, 2, 2))));
+	product = _mm_add_ps(product, _mm_mul_ps(m.data[3].simd(), 
+		_mm_shuffle_ps(components, components, _MM_SHUFFLE(3, 3, 3, 3))));
+	return vec4(product);
+#else
+	return v[0] * m.data[0] + v[1] * m.data[1] + v[2] * m.data[2] + 
+		v[3] * m.data[3];
+#endif
+}
+
+/* Multiply the given two 4x4 matrices and return the new matrix. Each row */
+/* of the product is the row of m1 multiplied by m2.                       */
+inline mat4 operator* (const mat4& m1, const mat4& m2)
+{
+	return mat4(m1.data[0] * m2, m1.data[1] * m2, m1.data[2] * m2, 
+		m1.data[3] * m2);
+}
+
+/* Multiply the given 4x4 matrix and vec4 and return the new vector.   */
+/* Must give a mat4 for the matrix and a vec4 for the vector in that   */
+/* order.                                                              */
+inline vec4 operator* (const mat4& m, const vec4& v)
+{
+#ifdef VEC4_USE_SSE
+	/* Multiply each row by the vector, then transpose the products so the */
+	/* four dot products are summed at once.                               */
+	__m128 components = v.simd();
+	__m128 row1 = _mm_mul_ps(m.data[0].simd(), components);
+	__m128 row2 = _mm_mul_ps(m.data[1].simd(), components);
+	__m128 row3 = _mm_mul_ps(m.data[2].simd(), components);
+	__m128 row4 = _mm_mul_ps(m.data[3].simd(), components);
+	_MM_TRANSPOSE4_PS(row1, row2, row3, row4);
+	return vec4(_mm_add_ps(_mm_add_ps(row1, row2), _mm_add_ps(row3, row4)));
+#else
+	/* Multiply the rows of m by the vector to get the products components. */
+	return vec4(m.data[0] * v, m.data[1] * v, m.data[2] * v, m.data[3] * v);
+#endif
+}
+
+#endif
@@ -7,10 +7,11 @@
 
 #include <iostream> /* Included for output to stdout.                     */
 #include <assert.h> /* Included to assert if arguments are valid.         */
-#include "vec4.h"
 
 #define EPSILON 0.00000001 /* Amount of tolerance for is equal operators. */
 
+#include "vec4.h"
+
 class vec4;
 
 class vec3
@@ -2,21 +2,35 @@
  * vec4.h
  * Created by Zachary Ferguson
  * Header file for the vec4 class, a 4 dimensional vector.
+ *
+ * The arithmetic operators are defined inline in this header so they can be
+ * inlined into the loops that use them. On x86 they are computed with SSE
+ * instructions, otherwise they fall back to scalar code.
  */
 
 #ifndef VEC4_H
 #define VEC4_H
 
+#include <assert.h> /* Used to assert if arguments are valid.      */
+#include <cmath>    /* Used for the square root and absolute value. */
 #include <sstream>  /* Used to create a string representation.     */
 #include <string>   /* Used for the return of the toString mathod. */
 #include "vec3.h"   /* Include 3D vector for type conversion.      */
 
+/* SSE is available on every x86 processor the modeler can run on. */
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define VEC4_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 class vec3;
 
 class vec4
 {
 	private:
-	
+
+		/* The components are loaded and stored unaligned, so a vec4 can */
+		/* still be passed by value and stored in a std::vector on Win32. */
 		float data[4];
 
 	public:
@@ -32,13 +46,21 @@ class vec4
 
 		/* Set the values of this vector to the given floats. */
 		vec4(float x, float y, float z, float t);
-	
+
+#ifdef VEC4_USE_SSE
+		/* Set the values of this vector to the given SSE register. */
+		explicit vec4(__m128 v);
+
+		/* Returns the values of this vector in a SSE register. */
+		__m128 simd() const;
+#endif
+
 		/*********************/
 		/* Getters & Setters */
 		/*********************/
 		/* Returns the value at index. */
 		float operator[](unsigned int index) const;
-	
+
 		/* Returns a reference to the value at index. */
 		float& operator[](unsigned int index);
 
@@ -55,36 +77,268 @@ class vec4
 		/*********************/
 		/* Returns the geometric length of the vector. */
 		float length() const;
-		
+
+		/* Adds v to this vector in place (this += v). */
+		vec4& operator+=(const vec4& v);
+
+		/* Subtracts v from this vector in place (this -= v). */
+		vec4& operator-=(const vec4& v);
+
+		/* Scales this vector in place (this *= c). */
+		vec4& operator*=(float c);
+
+		/* Divides this vector in place (this /= c). */
+		vec4& operator/=(float c);
+
 		/** Friend Functions **/
-		
+
 		/* Checks if v1 == v2 */
 		friend bool operator==(const vec4& v1, const vec4& v2);
-	
+
 		/* Checks if v1 != v2 */
 		friend bool operator!=(const vec4& v1, const vec4& v2);
-	
+
 		/* Vector Addition (v1 + v2) */
 		friend vec4 operator+ (const vec4& v1, const vec4& v2);
-	
+
 		/* Vector Subtraction (v1 - v2) */
 		friend vec4 operator- (const vec4& v1, const vec4& v2);
-	
+
 		/* Scalar Multiplication (v * c) */
-		friend vec4 operator* (const vec4& v, float c);	
-	
+		friend vec4 operator* (const vec4& v, float c);
+
 		/* Scalar Multiplication (c * v) */
 		friend vec4 operator* (float c, const vec4& v);
-	
+
 		/* Scalar Division (v/c) */
 		friend vec4 operator/ (const vec4& v, float c);
-	
+
 		/* Dot Product (v1 * v2) */
 		friend float operator* (const vec4& v1, const vec4& v2);
-	
+
 		/* Cross Product (v1 % v2)          */
 		/* No such operation on 4D vectors. */
 		//friend vec4 operator% (const vec4& v1, const vec4& v2);
 };
 
-#endif
\ No newline at end of file
+/****************/
+/* Constructors */
+/****************/
+
+/* Constructor for the 4 dimensional zero vector.             */
+/* Creates a vector with zeros for x, y, z, and t components. */
+inline vec4::vec4()
+{
+	(this->data)[0] = 0;
+	(this->data)[1] = 0;
+	(this->data)[2] = 0;
+	(this->data)[3] = 0;
+}
+
+/* Constructor to create a 4-dimensional vector with the given parameters. */
+/* Takes three floating point numbers in the order x, y, z, and t.         */
+inline vec4::vec4(float x, float y, float z, float t)
+{
+	(this->data)[0] = x;
+	(this->data)[1] = y;
+	(this->data)[2] = z;
+	(this->data)[3] = t;
+}
+
+#ifdef VEC4_USE_SSE
+/* Constructor to create a 4-dimensional vector from a SSE register. */
+inline vec4::vec4(__m128 v)
+{
+	_mm_storeu_ps(this->data, v);
+}
+
+/* Returns the x, y, z, and t components in a SSE register. */
+inline __m128 vec4::simd() const
+{
+	return _mm_loadu_ps(this->data);
+}
+#endif
+
+/*********************/
+/* Getters & Setters */
+/*********************/
+
+/* Indexing operator that returns the value at the index.    */
+/* 0 for x, 1 for y, 2 for z, and 3 for the t value.         */
+/* If the given index is out of bounds an error is asserted. */
+inline float vec4::operator[](unsigned int index) const
+{
+	/* Check index is in bounds */
+	assert(index < 4);
+	/* Return the component corresponding to the given index */
+	return (this->data)[index];
+}
+
+/* Indexing operator that returns a reference to the value at index. */
+/* 0 for x, 1 for y, 2 for z, and 3 for the t value.                 */
+/* If the given index is out of bounds an error is asserted.         */
+inline float& vec4::operator[](unsigned int index)
+{
+	/* Check index is in bounds */
+	assert(index < 4);
+	/* Return the component corresponding to the given index */
+	return (this->data)[index];
+}
+
+/*********************/
+/* Vector Operations */
+/*********************/
+
+/* Calculates the magnitude of this vector.          */
+/* Returns a float for the magnitude of this vector. */
+inline float vec4::length() const
+{
+	/* The magnitude is the square root of the dot product with itself. */
+	return sqrt((*this) * (*this));
+}
+
+/* Adds the given vector to this vector and returns this vector. Used to */
+/* accumulate sums without creating a new vector for each term.         */
+inline vec4& vec4::operator+=(const vec4& v)
+{
+#ifdef VEC4_USE_SSE
+	_mm_storeu_ps(this->data, _mm_add_ps(this->simd(), v.simd()));
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		(this->data)[i] += v[i];
+	}
+#endif
+	return *this;
+}
+
+/* Subtracts the given vector from this vector and returns this vector. */
+inline vec4& vec4::operator-=(const vec4& v)
+{
+#ifdef VEC4_USE_SSE
+	_mm_storeu_ps(this->data, _mm_sub_ps(this->simd(), v.simd()));
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		(this->data)[i] -= v[i];
+	}
+#endif
+	return *this;
+}
+
+/* Multiplies this vector by the given scalar and returns this vector. */
+inline vec4& vec4::operator*=(float c)
+{
+#ifdef VEC4_USE_SSE
+	_mm_storeu_ps(this->data, _mm_mul_ps(this->simd(), _mm_set1_ps(c)));
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		(this->data)[i] *= c;
+	}
+#endif
+	return *this;
+}
+
+/* Divides this vector by the given scalar and returns this vector. */
+inline vec4& vec4::operator/=(float c)
+{
+	/* Make sure the constant to be divided by is not zero */
+	assert(c != 0);
+	/* Multiply by the reciprocal of c, the same as operator/ */
+	return (*this) *= (1/c);
+}
+
+/* Determines if the given two vectors are equal.  */
+/* Returns a boolean for if the vectors are equal. */
+inline bool operator==(const vec4& v1, const vec4& v2)
+{
+	/* Compare components */
+	return (fabs(v1[0] - v2[0]) < EPSILON) && \
+		   (fabs(v1[1] - v2[1]) < EPSILON) && \
+		   (fabs(v1[2] - v2[2]) < EPSILON) && \
+		   (fabs(v1[3] - v2[3]) < EPSILON);
+}
+
+/* Determines if the given two vectors are not equal.  */
+/* Returns a boolean for if the vectors are not equal. */
+inline bool operator!=(const vec4& v1, const vec4& v2)
+{
+	/* Return if they are not equal */
+	return !(v1 == v2);
+}
+
+/* Operator for adding two vectors together. */
+/* Must give two vectors to be added.        */
+/* Returns there sum.                        */
+inline vec4 operator+(const vec4& v1, const vec4& v2)
+{
+#ifdef VEC4_USE_SSE
+	return vec4(_mm_add_ps(v1.simd(), v2.simd()));
+#else
+	/* Sum up the components */
+	return vec4(v1[0] + v2[0], v1[1] + v2[1], v1[2] + v2[2], v1[3] + v2[3]);
+#endif
+}
+
+/* Operator for subtracting two vectors together.   */
+/* Must give two vectors to be subtracted.          */
+/* Returns there difference.                        */
+inline vec4 operator-(const vec4& v1, const vec4& v2)
+{
+#ifdef VEC4_USE_SSE
+	return vec4(_mm_sub_ps(v1.simd(), v2.simd()));
+#else
+	/* Subtract the components */
+	return vec4(v1[0] - v2[0], v1[1] - v2[1], v1[2] - v2[2], v1[3] - v2[3]);
+#endif
+}
+
+/* Operator for scalar multiplication.                  */
+/* Must give a vector and a float scalar in that order. */
+inline vec4 operator* (const vec4& v, float c)
+{
+#ifdef VEC4_USE_SSE
+	return vec4(_mm_mul_ps(v.simd(), _mm_set1_ps(c)));
+#else
+	/* Multiply the components by c */
+	return vec4(v[0] * c, v[1] * c, v[2] * c, v[3] * c);
+#endif
+}
+
+/* Operator for scalar multiplication.                  */
+/* Must give a float scalar and a vector in that order. */
+inline vec4 operator* (float c, const vec4& v)
+{
+	/* Multiply v times c */
+	return v * c;
+}
+
+/* Operator for scalar division of the given vector.  */
+inline vec4 operator/ (const vec4& v, float c)
+{
+	/* Make sure the constant to be divided by is not zero */
+	assert(c != 0);
+	/* Multiply v * the reciprocal of c */
+	return v * (1/c);
+}
+
+/* Operator for computing the Dot Product (Inner Product) between two       */
+/* vectors. Returns a float for the inner product of the two given vectors. */
+inline float operator* (const vec4& v1, const vec4& v2)
+{
+#ifdef VEC4_USE_SSE
+	/* Multiply the components then add the upper half onto the lower half */
+	/* and the second component onto the first.                            */
+	__m128 product = _mm_mul_ps(v1.simd(), v2.simd());
+	__m128 sum = _mm_add_ps(product, _mm_movehl_ps(product, product));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(sum);
+#else
+	/* Calculate the Dot Product */
+	return (v1[0] * v2[0]) + (v1[1] * v2[1]) + (v1[2] * v2[2]) +
+		(v1[3] * v2[3]);
+#endif
+}
+
+#endif